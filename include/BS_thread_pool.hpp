@@ -36,19 +36,25 @@ import std;
     #undef BS_THREAD_POOL_IMPORT_STD
 
     #include <algorithm>
+    #include <array>
+    #include <atomic>
     #include <chrono>
     #include <condition_variable>
     #include <cstddef>
     #include <cstdint>
+    #include <deque>
     #include <functional>
     #include <future>
     #include <iostream>
+    #include <iterator>
     #include <limits>
     #include <memory>
     #include <mutex>
+    #include <new>
     #include <optional>
     #include <queue>
     #include <string>
+    #include <string_view>
     #include <thread>
     #include <tuple>
     #include <type_traits>
@@ -66,15 +72,28 @@ import std;
     #ifdef __cpp_impl_three_way_comparison
         #include <compare>
     #endif
-    #ifdef __cpp_lib_int_pow2
+    #if defined(__cpp_lib_int_pow2) || defined(__cpp_lib_bitops)
         #include <bit>
     #endif
     #ifdef __cpp_lib_semaphore
         #include <semaphore>
     #endif
+    #ifdef __cpp_lib_memory_resource
+        #include <memory_resource>
+    #endif
     #ifdef __cpp_lib_jthread
         #include <stop_token>
     #endif
+    #if defined(__cpp_impl_coroutine) && defined(__cpp_lib_coroutine)
+        #include <coroutine>
+    #endif
+    #if defined(BS_THREAD_POOL_NATIVE_EXTENSIONS) && defined(__linux__)
+        #include <fstream>
+    #endif
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
 #endif
 
 #ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
@@ -219,1908 +238,9473 @@ inline constexpr bool thread_pool_native_extensions = false;
 /**
  * @brief The type used for the bitmask template parameter of the thread pool.
  */
-using opt_t = std::uint8_t;
+using opt_t = std::uint16_t;
 
 template <opt_t>
 class thread_pool;
 
+template <opt_t>
+class fair_queue;
+
+template <opt_t>
+class task_group;
+
 #ifdef __cpp_lib_move_only_function
 /**
- * @brief The template to use to store functions in the task queue and other places. In C++23 and later we use `std::move_only_function`.
+ * @brief The template to use to store functions such as the initialization and cleanup functions. In C++23 and later we use `std::move_only_function`.
  */
 template <typename... S>
 using function_t = std::move_only_function<S...>;
 #else
 /**
- * @brief The template to use to store functions in the task queue and other places. In C++17 we use `std::function`.
+ * @brief The template to use to store functions such as the initialization and cleanup functions. In C++17 we use `std::function`.
  */
 template <typename... S>
 using function_t = std::function<S...>;
 #endif
 
-/**
- * @brief The type of tasks in the task queue.
- */
-using task_t = function_t<void()>;
+#ifndef BS_THREAD_POOL_ARENA_BUFFER_SIZE
+    // The size, in bytes, of the buffer that each thread in a pool uses as the initial storage of its arena, returned by `BS::this_thread::memory_resource()`. May be defined by the user before including the library, or as a compiler flag, to change the default.
+    #define BS_THREAD_POOL_ARENA_BUFFER_SIZE 4096
+#endif
 
-#ifdef __cpp_lib_jthread
-/**
- * @brief The type of threads to use. In C++20 and later we use `std::jthread`.
- */
-using thread_t = std::jthread;
-    // The following macros are used to determine how to stop the workers. In C++20 and later we can use `std::stop_token`.
-    #define BS_THREAD_POOL_WORKER_TOKEN const std::stop_token &stop_token,
-    #define BS_THREAD_POOL_WAIT_TOKEN , stop_token
-    #define BS_THREAD_POOL_STOP_CONDITION stop_token.stop_requested()
-    #define BS_THREAD_POOL_OR_STOP_CONDITION
-#else
 /**
- * @brief The type of threads to use. In C++17 we use`std::thread`.
+ * @brief The size, in bytes, of the buffer that each thread in a pool uses as the initial storage of its arena, returned by `BS::this_thread::memory_resource()`. Allocations from the arena are served from this buffer without allocating any memory, as long as the total size allocated by a single task fits in it. Can be changed by defining the macro `BS_THREAD_POOL_ARENA_BUFFER_SIZE` at compilation time.
  */
-using thread_t = std::thread;
-    // The following macros are used to determine how to stop the workers. In C++17 we use a manual flag `workers_running`.
-    #define BS_THREAD_POOL_WORKER_TOKEN
-    #define BS_THREAD_POOL_WAIT_TOKEN
-    #define BS_THREAD_POOL_STOP_CONDITION !workers_running
-    #define BS_THREAD_POOL_OR_STOP_CONDITION || !workers_running
+inline constexpr std::size_t arena_buffer_size = BS_THREAD_POOL_ARENA_BUFFER_SIZE;
+
+#ifndef BS_THREAD_POOL_TASK_BUFFER_SIZE
+    // The size, in bytes, of the buffer used to store the callable object of a task inline, without allocating memory on the heap. May be defined by the user before including the library, or as a compiler flag, to change the default.
+    #define BS_THREAD_POOL_TASK_BUFFER_SIZE 64
 #endif
 
 /**
- * @brief A type used to indicate the priority of a task. Defined to be a signed integer with a width of exactly 8 bits (-128 to +127).
+ * @brief The size, in bytes, of the buffer used to store the callable object of a task inline. Callable objects larger than this are allocated on the heap. Can be changed by defining the macro `BS_THREAD_POOL_TASK_BUFFER_SIZE` at compilation time.
  */
-using priority_t = std::int8_t;
+inline constexpr std::size_t task_buffer_size = BS_THREAD_POOL_TASK_BUFFER_SIZE;
+
+#ifndef BS_THREAD_POOL_TRACE_BUFFER_SIZE
+    // The number of events that each thread in a pool with tracing enabled keeps in its trace buffer. May be defined by the user before including the library, or as a compiler flag, to change the default.
+    #define BS_THREAD_POOL_TRACE_BUFFER_SIZE 8192
+#endif
 
 /**
- * @brief An enum containing some pre-defined priorities for convenience.
+ * @brief The number of events that each thread in a `BS::thread_pool` with the flag `BS::tp::trace` enabled keeps in its trace buffer. The buffer is allocated when the thread is created, and once it is full, each new event overwrites the oldest one. Can be changed by defining the macro `BS_THREAD_POOL_TRACE_BUFFER_SIZE` at compilation time.
  */
-enum pr : priority_t
-{
-    lowest = -128,
-    low = -64,
-    normal = 0,
-    high = +64,
-    highest = +127
-};
+inline constexpr std::size_t trace_buffer_size = BS_THREAD_POOL_TRACE_BUFFER_SIZE;
+
+static_assert(trace_buffer_size > 0, "BS_THREAD_POOL_TRACE_BUFFER_SIZE must be positive.");
 
 /**
- * @brief A helper struct to store a task with an assigned priority.
+ * @brief A move-only type-erased wrapper for a callable object with no arguments and no return value, used to store tasks in the task queue. Unlike `std::function`, the callable object does not need to be copyable, and as long as it is no larger than `BS::task_buffer_size` bytes (and can be moved without throwing), it is stored inline within the wrapper itself, so no memory is allocated on the heap. Larger callable objects are allocated on the heap.
  */
-struct [[nodiscard]] pr_task
+class [[nodiscard]] small_task
 {
+public:
     /**
-     * @brief Construct a new task with an assigned priority.
-     *
-     * @param task_ The task.
-     * @param priority_ The desired priority.
+     * @brief Construct an empty task.
      */
-    explicit pr_task(task_t&& task_, const priority_t priority_ = 0) noexcept(std::is_nothrow_move_constructible_v<task_t>) : task(std::move(task_)), priority(priority_) {}
+    small_task() noexcept = default;
 
     /**
-     * @brief Compare the priority of two tasks.
+     * @brief Construct a task from a callable object.
      *
-     * @param lhs The first task.
-     * @param rhs The second task.
-     * @return `true` if the first task has a lower priority than the second task, `false` otherwise.
+     * @tparam F The type of the callable object.
+     * @param func The callable object. Will be moved into the task if it is an rvalue, or copied otherwise.
      */
-    [[nodiscard]] friend bool operator<(const pr_task& lhs, const pr_task& rhs) noexcept
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, small_task> && std::is_invocable_v<std::decay_t<F>&>>>
+    small_task(F&& func) // NOLINT(google-explicit-constructor, hicpp-explicit-conversions) This constructor must be implicit so that callable objects can be passed directly wherever a task is expected.
     {
-        return lhs.priority < rhs.priority;
+        emplace(std::forward<F>(func));
     }
 
+#ifdef __cpp_lib_memory_resource
     /**
-     * @brief The task.
-     */
-    task_t task;
-
-    /**
-     * @brief The priority of the task.
+     * @brief Construct a task from a callable object, allocating the callable object from the given memory resource if it is not stored inline. Only available if `std::pmr::memory_resource` is supported.
+     *
+     * @tparam F The type of the callable object.
+     * @param resource The memory resource to allocate from, which must outlive the task. If `nullptr`, the callable object is allocated on the heap as usual.
+     * @param func The callable object. Will be moved into the task if it is an rvalue, or copied otherwise.
      */
-    priority_t priority = 0;
-}; // struct pr_task
-
-// In C++20 and later we can use concepts. In C++17 we instead use SFINAE ("Substitution Failure Is Not An Error") with `std::enable_if_t`.
-#ifdef __cpp_concepts
-    #define BS_THREAD_POOL_IF_PAUSE_ENABLED template <bool P = pause_enabled> requires(P)
-template <typename F>
-concept init_func_c = std::invocable<F> || std::invocable<F, std::size_t>;
-    #define BS_THREAD_POOL_INIT_FUNC_CONCEPT(F) init_func_c F
-#else
-    #define BS_THREAD_POOL_IF_PAUSE_ENABLED template <bool P = pause_enabled, typename = std::enable_if_t<P>>
-    #define BS_THREAD_POOL_INIT_FUNC_CONCEPT(F) typename F, typename = std::enable_if_t<std::is_invocable_v<F> || std::is_invocable_v<F, std::size_t>> // NOLINT(bugprone-macro-parentheses)
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, small_task> && std::is_invocable_v<std::decay_t<F>&>>>
+    small_task(std::allocator_arg_t, std::pmr::memory_resource* const resource, F&& func)
+    {
+        using callable_t = std::decay_t<F>;
+        if constexpr (stored_inline<callable_t> || (sizeof(allocated<callable_t>) > task_buffer_size))
+        {
+            emplace(std::forward<F>(func));
+        }
+        else
+        {
+            if (resource == nullptr)
+            {
+                emplace(std::forward<F>(func));
+                return;
+            }
+            void* const storage = resource->allocate(sizeof(callable_t), alignof(callable_t));
+    #ifdef __cpp_exceptions
+            try
+            {
+    #endif
+                ::new (static_cast<void*>(&buffer)) allocated<callable_t>{::new (storage) callable_t(std::forward<F>(func)), resource};
+    #ifdef __cpp_exceptions
+            }
+            catch (...)
+            {
+                resource->deallocate(storage, sizeof(callable_t), alignof(callable_t));
+                throw;
+            }
+    #endif
+            ops = &resource_ops<callable_t>;
+        }
+    }
 #endif
 
-/**
- * @brief A helper class to facilitate waiting for and/or getting the results of multiple futures at once.
- *
- * @tparam T The return type of the futures.
- */
-template <typename T>
-class [[nodiscard]] multi_future : public std::vector<std::future<T>>
-{
-public:
-    // Inherit all constructors from the base class `std::vector`.
-    using std::vector<std::future<T>>::vector;
+    // The copy constructor and copy assignment operator are deleted. A task can only be moved.
+    small_task(const small_task&) = delete;
+    small_task& operator=(const small_task&) = delete;
 
     /**
-     * @brief Get the results from all the futures stored in this `BS::multi_future`, rethrowing any stored exceptions.
+     * @brief Move-construct a task. The other task will be left empty.
      *
-     * @return If the futures return `void`, this function returns `void` as well. Otherwise, it returns a vector containing the results.
+     * @param other The task to move.
      */
-    [[nodiscard]] std::conditional_t<std::is_void_v<T>, void, std::vector<T>> get()
+    small_task(small_task&& other) noexcept : ops(other.ops)
     {
-        if constexpr (std::is_void_v<T>)
-        {
-            for (std::future<T>& future : *this)
-                future.get();
-            return;
-        }
-        else
+        if (ops != nullptr)
         {
-            std::vector<T> results;
-            results.reserve(this->size());
-            for (std::future<T>& future : *this)
-                results.push_back(future.get());
-            return results;
+            ops->relocate(&other.buffer, &buffer);
+            other.ops = nullptr;
         }
     }
 
     /**
-     * @brief Check how many of the futures stored in this `BS::multi_future` are ready.
+     * @brief Move-assign a task. The other task will be left empty.
      *
-     * @return The number of ready futures.
+     * @param other The task to move.
+     * @return A reference to this task.
      */
-    [[nodiscard]] std::size_t ready_count() const
+    small_task& operator=(small_task&& other) noexcept
     {
-        std::size_t count = 0;
-        for (const std::future<T>& future : *this)
+        if (this != &other)
         {
-            if (future.wait_for(std::chrono::duration<double>::zero()) == std::future_status::ready)
-                ++count;
+            reset();
+            if (other.ops != nullptr)
+            {
+                other.ops->relocate(&other.buffer, &buffer);
+                ops = other.ops;
+                other.ops = nullptr;
+            }
         }
-        return count;
+        return *this;
     }
 
     /**
-     * @brief Check if all the futures stored in this `BS::multi_future` are valid.
-     *
-     * @return `true` if all futures are valid, `false` if at least one of the futures is not valid.
+     * @brief Destruct the task, destroying the stored callable object, if any.
      */
-    [[nodiscard]] bool valid() const noexcept
+    ~small_task()
     {
-        bool is_valid = true;
-        for (const std::future<T>& future : *this)
-            is_valid = is_valid && future.valid();
-        return is_valid;
+        reset();
     }
 
     /**
-     * @brief Wait for all the futures stored in this `BS::multi_future`.
+     * @brief Invoke the stored callable object. The task must not be empty.
      */
-    void wait() const
+    void operator()()
     {
-        for (const std::future<T>& future : *this)
-            future.wait();
+        ops->invoke(&buffer);
     }
 
     /**
-     * @brief Wait for all the futures stored in this `BS::multi_future`, but stop waiting after the specified duration has passed. This function first waits for the first future for the desired duration. If that future is ready before the duration expires, this function waits for the second future for whatever remains of the duration. It continues similarly until the duration expires.
+     * @brief Check whether the task stores a callable object.
      *
-     * @tparam R An arithmetic type representing the number of ticks to wait.
-     * @tparam P An `std::ratio` representing the length of each tick in seconds.
-     * @param duration The amount of time to wait.
-     * @return `true` if all futures have been waited for before the duration expired, `false` otherwise.
+     * @return `true` if the task is not empty, `false` otherwise.
      */
-    template <typename R, typename P>
-    bool wait_for(const std::chrono::duration<R, P>& duration) const
+    [[nodiscard]] explicit operator bool() const noexcept
     {
-        const std::chrono::time_point<std::chrono::steady_clock> start_time = std::chrono::steady_clock::now();
-        for (const std::future<T>& future : *this)
-        {
-            future.wait_for(duration - (std::chrono::steady_clock::now() - start_time));
-            if (duration < std::chrono::steady_clock::now() - start_time)
-                return false;
-        }
-        return true;
+        return ops != nullptr;
     }
 
     /**
-     * @brief Wait for all the futures stored in this `BS::multi_future`, but stop waiting after the specified time point has been reached. This function first waits for the first future until the desired time point. If that future is ready before the time point is reached, this function waits for the second future until the desired time point. It continues similarly until the time point is reached.
+     * @brief Check whether a callable object of a given type would be stored inline, without allocating memory on the heap.
      *
-     * @tparam C The type of the clock used to measure time.
-     * @tparam D An `std::chrono::duration` type used to indicate the time point.
-     * @param timeout_time The time point at which to stop waiting.
-     * @return `true` if all futures have been waited for before the time point was reached, `false` otherwise.
+     * @tparam F The type of the callable object.
      */
-    template <typename C, typename D>
-    bool wait_until(const std::chrono::time_point<C, D>& timeout_time) const
+    template <typename F>
+    static constexpr bool stored_inline = (sizeof(F) <= task_buffer_size) && (alignof(F) <= alignof(std::max_align_t)) && std::is_nothrow_move_constructible_v<F>;
+
+private:
+    /**
+     * @brief A helper struct containing pointers to the functions used to invoke, move, and destroy a callable object of a specific type stored in the buffer.
+     */
+    struct operations
     {
-        for (const std::future<T>& future : *this)
-        {
-            future.wait_until(timeout_time);
-            if (timeout_time < std::chrono::steady_clock::now())
-                return false;
-        }
-        return true;
-    }
-}; // class multi_future
+        void (*invoke)(void*);
+        void (*relocate)(void*, void*) noexcept;
+        void (*destroy)(void*) noexcept;
+    };
 
-/**
- * @brief A helper class to divide a range into blocks. Used by `detach_blocks()`, `submit_blocks()`, `detach_loop()`, and `submit_loop()`.
- *
- * @tparam T The type of the indices. Should be a signed or unsigned integer.
- */
-template <typename T>
-class [[nodiscard]] blocks
-{
-public:
     /**
-     * @brief Construct a `blocks` object with the given specifications.
+     * @brief Store a callable object in an empty task, inline if possible, or on the heap otherwise.
      *
-     * @param first_index_ The first index in the range.
-     * @param index_after_last_ The index after the last index in the range.
-     * @param num_blocks_ The desired number of blocks to divide the range into.
+     * @tparam F The type of the callable object.
+     * @param func The callable object.
      */
-    blocks(const T first_index_, const T index_after_last_, const std::size_t num_blocks_) noexcept : first_index(first_index_), index_after_last(index_after_last_), num_blocks(num_blocks_)
+    template <typename F>
+    void emplace(F&& func)
     {
-        if (index_after_last > first_index)
+        using callable_t = std::decay_t<F>;
+        if constexpr (stored_inline<callable_t>)
         {
-            const std::size_t total_size = static_cast<std::size_t>(index_after_last - first_index);
-            num_blocks = std::min(num_blocks, total_size);
-            block_size = total_size / num_blocks;
-            remainder = total_size % num_blocks;
-            if (block_size == 0)
-            {
-                block_size = 1;
-                num_blocks = (total_size > 1) ? total_size : 1;
-            }
+            ::new (static_cast<void*>(&buffer)) callable_t(std::forward<F>(func));
+            ops = &inline_ops<callable_t>;
         }
         else
         {
-            num_blocks = 0;
+            ::new (static_cast<void*>(&buffer)) callable_t*(new callable_t(std::forward<F>(func)));
+            ops = &heap_ops<callable_t>;
         }
     }
 
     /**
-     * @brief Get the index after the last index of a block.
-     *
-     * @param block The block number.
-     * @return The index after the last index.
+     * @brief Destroy the stored callable object, if any, leaving the task empty.
      */
-    [[nodiscard]] T end(const std::size_t block) const noexcept
+    void reset() noexcept
     {
-        return (block == num_blocks - 1) ? index_after_last : start(block + 1);
+        if (ops != nullptr)
+        {
+            ops->destroy(&buffer);
+            ops = nullptr;
+        }
     }
 
     /**
-     * @brief Get the number of blocks. Note that this may be different than the desired number of blocks that was passed to the constructor.
+     * @brief The operations for a callable object stored inline in the buffer.
      *
-     * @return The number of blocks.
+     * @tparam F The type of the callable object.
      */
-    [[nodiscard]] std::size_t get_num_blocks() const noexcept
-    {
-        return num_blocks;
-    }
+    template <typename F>
+    static constexpr operations inline_ops = {
+        [](void* const storage)
+        {
+            (*static_cast<F*>(storage))();
+        },
+        [](void* const from, void* const to) noexcept
+        {
+            ::new (to) F(std::move(*static_cast<F*>(from)));
+            static_cast<F*>(from)->~F();
+        },
+        [](void* const storage) noexcept
+        {
+            static_cast<F*>(storage)->~F();
+        }};
 
     /**
-     * @brief Get the first index of a block.
+     * @brief The operations for a callable object allocated on the heap, in which case the buffer stores a pointer to it.
      *
-     * @param block The block number.
-     * @return The first index.
-     */
-    [[nodiscard]] T start(const std::size_t block) const noexcept
-    {
-        return first_index + static_cast<T>(block * block_size) + static_cast<T>(block < remainder ? block : remainder);
-    }
-
-private:
-    /**
-     * @brief The size of each block (except possibly the last block).
+     * @tparam F The type of the callable object.
      */
-    std::size_t block_size = 0;
+    template <typename F>
+    static constexpr operations heap_ops = {
+        [](void* const storage)
+        {
+            (**static_cast<F**>(storage))();
+        },
+        [](void* const from, void* const to) noexcept
+        {
+            ::new (to) F*(*static_cast<F**>(from));
+        },
+        [](void* const storage) noexcept
+        {
+            delete *static_cast<F**>(storage);
+        }};
 
+#ifdef __cpp_lib_memory_resource
     /**
-     * @brief The first index in the range.
+     * @brief A helper struct stored in the buffer of a task whose callable object was allocated from a memory resource, containing a pointer to the callable object and the memory resource to return it to.
+     *
+     * @tparam F The type of the callable object.
      */
-    T first_index = 0;
+    template <typename F>
+    struct allocated
+    {
+        F* callable;
+        std::pmr::memory_resource* resource;
+    };
 
     /**
-     * @brief The index after the last index in the range.
+     * @brief The operations for a callable object allocated from a memory resource, in which case the buffer stores an `allocated<F>` object.
+     *
+     * @tparam F The type of the callable object.
      */
-    T index_after_last = 0;
+    template <typename F>
+    static constexpr operations resource_ops = {
+        [](void* const storage)
+        {
+            (*static_cast<allocated<F>*>(storage)->callable)();
+        },
+        [](void* const from, void* const to) noexcept
+        {
+            ::new (to) allocated<F>(*static_cast<allocated<F>*>(from));
+        },
+        [](void* const storage) noexcept
+        {
+            const allocated<F> node = *static_cast<allocated<F>*>(storage);
+            node.callable->~F();
+            node.resource->deallocate(node.callable, sizeof(F), alignof(F));
+        }};
+#endif
 
     /**
-     * @brief The number of blocks.
+     * @brief The buffer used to store the callable object, or a pointer to it if it is allocated on the heap.
      */
-    std::size_t num_blocks = 0;
+    alignas(std::max_align_t) std::byte buffer[task_buffer_size]; // NOLINT(cppcoreguidelines-avoid-c-arrays, hicpp-avoid-c-arrays, modernize-avoid-c-arrays) This is raw storage for placement new.
 
     /**
-     * @brief The remainder obtained after dividing the total size by the number of blocks.
+     * @brief A pointer to the operations for the type of the stored callable object, or `nullptr` if the task is empty.
      */
-    std::size_t remainder = 0;
-}; // class blocks
+    const operations* ops = nullptr;
+}; // class small_task
 
-#ifdef __cpp_exceptions
 /**
- * @brief An exception that will be thrown by `wait()`, `wait_for()`, and `wait_until()` if the user tries to call them from within a thread of the same pool, which would result in a deadlock. Only used if the flag `BS:tp::wait_deadlock_checks` is enabled in the template parameter of `BS::thread_pool`.
+ * @brief The type of tasks in the task queue. This is a move-only type which stores small callable objects inline, without allocating memory on the heap.
  */
-struct wait_deadlock : public std::runtime_error
-{
-    wait_deadlock() : std::runtime_error("BS::wait_deadlock") {};
-};
-#endif
+using task_t = small_task;
 
-#ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
-    #if defined(_WIN32)
+#ifdef __cpp_lib_jthread
 /**
- * @brief An enum containing pre-defined OS-specific process priority values for portability.
+ * @brief The type of threads to use. In C++20 and later we use `std::jthread`.
  */
-enum class os_process_priority
-{
-    idle = IDLE_PRIORITY_CLASS,
-    below_normal = BELOW_NORMAL_PRIORITY_CLASS,
-    normal = NORMAL_PRIORITY_CLASS,
-    above_normal = ABOVE_NORMAL_PRIORITY_CLASS,
-    high = HIGH_PRIORITY_CLASS,
-    realtime = REALTIME_PRIORITY_CLASS
-};
-
-/**
- * @brief An enum containing pre-defined OS-specific thread priority values for portability.
- */
-enum class os_thread_priority
-{
-    idle = THREAD_PRIORITY_IDLE,
-    lowest = THREAD_PRIORITY_LOWEST,
-    below_normal = THREAD_PRIORITY_BELOW_NORMAL,
-    normal = THREAD_PRIORITY_NORMAL,
-    above_normal = THREAD_PRIORITY_ABOVE_NORMAL,
-    highest = THREAD_PRIORITY_HIGHEST,
-    realtime = THREAD_PRIORITY_TIME_CRITICAL
-};
-    #elif defined(__linux__) || defined(__APPLE__)
-/**
- * @brief An enum containing pre-defined OS-specific process priority values for portability.
- */
-enum class os_process_priority
-{
-    idle = PRIO_MAX - 2,
-    below_normal = PRIO_MAX / 2,
-    normal = 0,
-    above_normal = PRIO_MIN / 3,
-    high = PRIO_MIN * 2 / 3,
-    realtime = PRIO_MIN
-};
-
+using thread_t = std::jthread;
+    // The following macros are used to determine how to stop the workers. In C++20 and later we can use `std::stop_token`.
+    #define BS_THREAD_POOL_WORKER_TOKEN const std::stop_token &stop_token,
+    #define BS_THREAD_POOL_WAIT_TOKEN , stop_token
+    #define BS_THREAD_POOL_STOP_CONDITION stop_token.stop_requested()
+    #define BS_THREAD_POOL_OR_STOP_CONDITION
+#else
 /**
- * @brief An enum containing pre-defined OS-specific thread priority values for portability.
+ * @brief The type of threads to use. In C++17 we use`std::thread`.
  */
-enum class os_thread_priority
-{
-    idle,
-    lowest,
-    below_normal,
-    normal,
-    above_normal,
-    highest,
-    realtime
-};
-    #endif
+using thread_t = std::thread;
+    // The following macros are used to determine how to stop the workers. In C++17 we use a manual flag `workers_running`.
+    #define BS_THREAD_POOL_WORKER_TOKEN
+    #define BS_THREAD_POOL_WAIT_TOKEN
+    #define BS_THREAD_POOL_STOP_CONDITION !workers_running
+    #define BS_THREAD_POOL_OR_STOP_CONDITION || !workers_running
+#endif
 
 /**
- * @brief Get the processor affinity of the current process using the current platform's native API. This should work on Windows and Linux, but is not possible on macOS as the native API does not allow it.
- *
- * @return An `std::optional` object, optionally containing the processor affinity of the current process as an `std::vector<bool>` where each element corresponds to a logical processor. If the returned object does not contain a value, then the affinity could not be determined. On macOS, this function always returns `std::nullopt`.
+ * @brief A type used to indicate the priority of a task. Defined to be a signed integer with a width of exactly 8 bits (-128 to +127).
  */
-[[nodiscard]] inline std::optional<std::vector<bool>> get_os_process_affinity()
-{
-    #if defined(_WIN32)
-    DWORD_PTR process_mask = 0;
-    DWORD_PTR system_mask = 0;
-    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) == 0)
-        return std::nullopt;
-        #ifdef __cpp_lib_int_pow2
-    const std::size_t num_cpus = static_cast<std::size_t>(std::bit_width(system_mask));
-        #else
-    std::size_t num_cpus = 0;
-    if (system_mask != 0)
-    {
-        num_cpus = 1;
-        while ((system_mask >>= 1U) != 0U)
-            ++num_cpus;
-    }
-        #endif
-    std::vector<bool> affinity(num_cpus);
-    for (std::size_t i = 0; i < num_cpus; ++i)
-        affinity[i] = ((process_mask & (1ULL << i)) != 0ULL);
-    return affinity;
-    #elif defined(__linux__)
-    cpu_set_t cpu_set;
-    CPU_ZERO(&cpu_set);
-    if (sched_getaffinity(getpid(), sizeof(cpu_set_t), &cpu_set) != 0)
-        return std::nullopt;
-    const int num_cpus = get_nprocs();
-    if (num_cpus < 1)
-        return std::nullopt;
-    std::vector<bool> affinity(static_cast<std::size_t>(num_cpus));
-    for (std::size_t i = 0; i < affinity.size(); ++i)
-        affinity[i] = CPU_ISSET(i, &cpu_set);
-    return affinity;
-    #elif defined(__APPLE__)
-    return std::nullopt;
-    #endif
-}
+using priority_t = std::int8_t;
 
 /**
- * @brief Set the processor affinity of the current process using the current platform's native API. This should work on Windows and Linux, but is not possible on macOS as the native API does not allow it.
- *
- * @param affinity The processor affinity to set, as an `std::vector<bool>` where each element corresponds to a logical processor.
- * @return `true` if the affinity was set successfully, `false` otherwise. On macOS, this function always returns `false`.
+ * @brief An enum containing some pre-defined priorities for convenience.
  */
-inline bool set_os_process_affinity(const std::vector<bool>& affinity)
+enum pr : priority_t
 {
-    #if defined(_WIN32)
-    DWORD_PTR process_mask = 0;
-    for (std::size_t i = 0; i < std::min<std::size_t>(affinity.size(), sizeof(DWORD_PTR) * 8); ++i)
-        process_mask |= (affinity[i] ? (1ULL << i) : 0ULL);
-    return SetProcessAffinityMask(GetCurrentProcess(), process_mask) != 0;
-    #elif defined(__linux__)
-    cpu_set_t cpu_set;
-    CPU_ZERO(&cpu_set);
-    for (std::size_t i = 0; i < std::min<std::size_t>(affinity.size(), CPU_SETSIZE); ++i)
-    {
-        if (affinity[i])
-            CPU_SET(i, &cpu_set);
-    }
-    return sched_setaffinity(getpid(), sizeof(cpu_set_t), &cpu_set) == 0;
-    #elif defined(__APPLE__)
-    return affinity[0] && false; // NOLINT(readability-simplify-boolean-expr) // Using `affinity` to suppress unused parameter warning.
-    #endif
-}
+    lowest = -128,
+    low = -64,
+    normal = 0,
+    high = +64,
+    highest = +127
+};
 
 /**
- * @brief Get the priority of the current process using the current platform's native API. This should work on Windows, Linux, and macOS.
+ * @brief Find the position of the most significant set bit of a non-zero 64-bit word.
  *
- * @return An `std::optional` object, optionally containing the priority of the current process, as a member of the enum `BS::os_process_priority`. If the returned object does not contain a value, then either the priority could not be determined, or it is not one of the pre-defined values and therefore cannot be represented in a portable way.
+ * @param word The word.
+ * @return The position of the bit, from 0 to 63.
  */
-[[nodiscard]] inline std::optional<os_process_priority> get_os_process_priority()
+[[nodiscard]] inline std::size_t highest_set_bit(const std::uint64_t word) noexcept
 {
-    #if defined(_WIN32)
-    // On Windows, this is straightforward.
-    const DWORD priority = GetPriorityClass(GetCurrentProcess());
-    if (priority == 0)
-        return std::nullopt;
-    return static_cast<os_process_priority>(priority);
-    #elif defined(__linux__) || defined(__APPLE__)
-    // On Linux/macOS there is no direct analogue of `GetPriorityClass()` on Windows, so instead we get the "nice" value. The usual range is -20 to 19 or 20, with higher values corresponding to lower priorities. However, we are only using 6 pre-defined values for portability, so if the value was set via any means other than `BS::set_os_process_priority()`, it may not match one of our pre-defined values. Note that `getpriority()` returns -1 on error, but since this does not correspond to any of our pre-defined values, this function will return `std::nullopt` anyway.
-    const int nice_val = getpriority(PRIO_PROCESS, static_cast<id_t>(getpid()));
-    switch (nice_val)
+#if defined(__cpp_lib_bitops)
+    return 63 - static_cast<std::size_t>(std::countl_zero(word));
+#elif defined(__GNUC__)
+    return 63 - static_cast<std::size_t>(__builtin_clzll(word));
+#else
+    std::size_t position = 0;
+    std::uint64_t remaining = word;
+    for (std::size_t shift = 32; shift > 0; shift /= 2)
     {
-    case static_cast<int>(os_process_priority::idle):
-        return os_process_priority::idle;
-    case static_cast<int>(os_process_priority::below_normal):
-        return os_process_priority::below_normal;
-    case static_cast<int>(os_process_priority::normal):
-        return os_process_priority::normal;
-    case static_cast<int>(os_process_priority::above_normal):
-        return os_process_priority::above_normal;
-    case static_cast<int>(os_process_priority::high):
-        return os_process_priority::high;
-    case static_cast<int>(os_process_priority::realtime):
-        return os_process_priority::realtime;
-    default:
-        return std::nullopt;
+        if ((remaining >> shift) != 0)
+        {
+            remaining >>= shift;
+            position += shift;
+        }
     }
-    #endif
-}
-
-/**
- * @brief Set the priority of the current process using the current platform's native API. This should work on Windows, Linux, and macOS. However, note that higher priorities might require elevated permissions.
- *
- * @param priority The priority to set. Must be a value from the enum `BS::os_process_priority`.
- * @return `true` if the priority was set successfully, `false` otherwise. Usually, `false` means that the user does not have the necessary permissions to set the desired priority.
- */
-inline bool set_os_process_priority(const os_process_priority priority)
-{
-    #if defined(_WIN32)
-    // On Windows, this is straightforward.
-    return SetPriorityClass(GetCurrentProcess(), static_cast<DWORD>(priority)) != 0;
-    #elif defined(__linux__) || defined(__APPLE__)
-    // On Linux/macOS there is no direct analogue of `SetPriorityClass()` on Windows, so instead we set the "nice" value. The usual range is -20 to 19 or 20, with higher values corresponding to lower priorities. However, we are only using 6 pre-defined values for portability. Note that the "nice" values are only relevant for the `SCHED_OTHER` policy, but we do not set that policy here, as it is per-thread rather than per-process.
-    // Also, it's important to note that a non-root user cannot decrease the nice value (i.e. increase the process priority), only increase it. This can cause confusing behavior. For example, if the current priority is `BS::os_process_priority::normal` and the user sets it to `BS::os_process_priority::idle`, they cannot change it back `BS::os_process_priority::normal`.
-    return setpriority(PRIO_PROCESS, static_cast<id_t>(getpid()), static_cast<int>(priority)) == 0;
-    #endif
-}
+    return position;
 #endif
+}
 
 /**
- * @brief A class used to obtain information about the current thread and, if native extensions are enabled, set its priority and affinity.
+ * @brief A priority queue of tasks with O(1) push and pop, used as the task queue if the flag `BS::tp::priority` is enabled in the template parameter of `BS::thread_pool`. Each of the 256 possible priorities has its own FIFO bucket, and a 256-bit occupancy bitmap records which buckets are non-empty, so the highest-priority task is found with at most 4 find-first-set operations. Tasks with the same priority are executed in the order they were submitted.
  */
-class [[nodiscard]] this_thread
+class [[nodiscard]] priority_task_queue
 {
-    template <opt_t>
-    friend class thread_pool;
-
 public:
     /**
-     * @brief Get the index of the current thread. If this thread belongs to a `BS::thread_pool` object, the return value will be an index in the range `[0, N)` where `N == BS::thread_pool::get_thread_count()`. Otherwise, for example if this thread is the main thread or an independent thread not in any pools, `std::nullopt` will be returned.
+     * @brief Push a new task into the queue with the given priority.
      *
-     * @return An `std::optional` object, optionally containing a thread index.
+     * @tparam F The type of the task.
+     * @param task The task.
+     * @param priority The priority of the task. The default is 0, used for tasks moved back from the local queues and mailboxes, which do not keep their priorities.
      */
-    [[nodiscard]] static std::optional<std::size_t> get_index() noexcept
+    template <typename F>
+    void emplace(F&& task, const priority_t priority = 0)
     {
-        return my_index;
+        const std::size_t index = get_index(priority);
+        buckets[index].tasks.emplace_back(std::forward<F>(task));
+        occupancy[index / word_bits] |= std::uint64_t{1} << (index % word_bits);
+        ++count;
     }
 
     /**
-     * @brief Get a pointer to the thread pool that owns the current thread. If this thread belongs to a `BS::thread_pool` object, the return value will be a `void` pointer to that object. Otherwise, for example if this thread is the main thread or an independent thread not in any pools, `std::nullopt` will be returned.
+     * @brief Check whether the queue is empty.
      *
-     * @return An `std::optional` object, optionally containing a pointer to a thread pool. Note that this will be a `void` pointer, so it must be cast to the desired instantiation of the `BS::thread_pool` template in order to use any member functions.
+     * @return `true` if the queue is empty, `false` otherwise.
      */
-    [[nodiscard]] static std::optional<void*> get_pool() noexcept
+    [[nodiscard]] bool empty() const noexcept
     {
-        return my_pool;
+        return count == 0;
     }
 
-#ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
     /**
-     * @brief Get the processor affinity of the current thread using the current platform's native API. This should work on Windows and Linux, but is not possible on macOS as the native API does not allow it.
+     * @brief Pop the oldest task with the highest priority. The queue must not be empty.
      *
-     * @return An `std::optional` object, optionally containing the processor affinity of the current thread as an `std::vector<bool>` where each element corresponds to a logical processor. If the returned object does not contain a value, then the affinity could not be determined. On macOS, this function always returns `std::nullopt`.
+     * @return The task.
      */
-    [[nodiscard]] static std::optional<std::vector<bool>> get_os_thread_affinity()
+    [[nodiscard]] task_t pop()
     {
-    #if defined(_WIN32)
-        // Windows does not have a `GetThreadAffinityMask()` function, but `SetThreadAffinityMask()` returns the previous affinity mask, so we can use that to get the current affinity and then restore it. It's a bit of a hack, but it works. Since the thread affinity must be a subset of the process affinity, we use the process affinity as the temporary value.
-        DWORD_PTR process_mask = 0;
-        DWORD_PTR system_mask = 0;
-        if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) == 0)
-            return std::nullopt;
-        const DWORD_PTR previous_mask = SetThreadAffinityMask(GetCurrentThread(), process_mask);
-        if (previous_mask == 0)
-            return std::nullopt;
-        SetThreadAffinityMask(GetCurrentThread(), previous_mask);
-        #ifdef __cpp_lib_int_pow2
-        const std::size_t num_cpus = static_cast<std::size_t>(std::bit_width(system_mask));
-        #else
-        std::size_t num_cpus = 0;
-        if (system_mask != 0)
+        std::size_t word = num_words - 1;
+        while (occupancy[word] == 0)
+            --word;
+        const std::size_t index = (word * word_bits) + highest_set_bit(occupancy[word]);
+        bucket& current = buckets[index];
+        task_t task = std::move(current.tasks[current.head]);
+        ++current.head;
+        if (current.head == current.tasks.size())
         {
-            num_cpus = 1;
-            while ((system_mask >>= 1U) != 0U)
-                ++num_cpus;
+            // The bucket is now empty, so we can reuse its storage from the beginning.
+            current.tasks.clear();
+            current.head = 0;
+            occupancy[word] &= ~(std::uint64_t{1} << (index % word_bits));
         }
-        #endif
-        std::vector<bool> affinity(num_cpus);
-        for (std::size_t i = 0; i < num_cpus; ++i)
-            affinity[i] = ((previous_mask & (1ULL << i)) != 0ULL);
-        return affinity;
-    #elif defined(__linux__)
-        cpu_set_t cpu_set;
-        CPU_ZERO(&cpu_set);
-        if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set) != 0)
-            return std::nullopt;
-        const int num_cpus = get_nprocs();
-        if (num_cpus < 1)
-            return std::nullopt;
-        std::vector<bool> affinity(static_cast<std::size_t>(num_cpus));
-        for (std::size_t i = 0; i < affinity.size(); ++i)
-            affinity[i] = CPU_ISSET(i, &cpu_set);
-        return affinity;
-    #elif defined(__APPLE__)
-        return std::nullopt;
-    #endif
+        else if (current.head >= compact_threshold && 2 * current.head >= current.tasks.size())
+        {
+            // Most of the bucket consists of tasks that were already popped, so move the remaining ones to the front to avoid growing the buffer indefinitely.
+            current.tasks.erase(current.tasks.begin(), current.tasks.begin() + static_cast<std::ptrdiff_t>(current.head));
+            current.head = 0;
+        }
+        --count;
+        return task;
     }
 
     /**
-     * @brief Set the processor affinity of the current thread using the current platform's native API. This should work on Windows and Linux, but is not possible on macOS as the native API does not allow it. Note that the thread affinity must be a subset of the process affinity (as obtained using `BS::get_os_process_affinity()`) for the containing process of a thread.
+     * @brief Get the number of tasks in the queue.
      *
-     * @param affinity The processor affinity to set, as an `std::vector<bool>` where each element corresponds to a logical processor.
-     * @return `true` if the affinity was set successfully, `false` otherwise. On macOS, this function always returns `false`.
+     * @return The number of tasks.
      */
-    static bool set_os_thread_affinity(const std::vector<bool>& affinity)
+    [[nodiscard]] std::size_t size() const noexcept
     {
-    #if defined(_WIN32)
-        DWORD_PTR thread_mask = 0;
-        for (std::size_t i = 0; i < std::min<std::size_t>(affinity.size(), sizeof(DWORD_PTR) * 8); ++i)
-            thread_mask |= (affinity[i] ? (1ULL << i) : 0ULL);
-        return SetThreadAffinityMask(GetCurrentThread(), thread_mask) != 0;
-    #elif defined(__linux__)
-        cpu_set_t cpu_set;
-        CPU_ZERO(&cpu_set);
-        for (std::size_t i = 0; i < std::min<std::size_t>(affinity.size(), CPU_SETSIZE); ++i)
-        {
-            if (affinity[i])
-                CPU_SET(i, &cpu_set);
-        }
-        return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set) == 0;
-    #elif defined(__APPLE__)
-        return affinity[0] && false; // NOLINT(readability-simplify-boolean-expr) // Using `affinity` to suppress unused parameter warning.
-    #endif
+        return count;
     }
 
+private:
     /**
-     * @brief Get the name of the current thread using the current platform's native API. This should work on Windows, Linux, and macOS.
+     * @brief A helper struct to store the tasks with a single priority, in FIFO order. Popped tasks are skipped using an index rather than erased, which is much cheaper than keeping a separate `std::deque` for each of the 256 priorities.
+     */
+    struct bucket
+    {
+        /**
+         * @brief The tasks in the bucket. Only the elements starting at `head` are still waiting.
+         */
+        std::vector<task_t> tasks;
+
+        /**
+         * @brief The index of the next task to pop.
+         */
+        std::size_t head = 0;
+    }; // struct bucket
+
+    /**
+     * @brief The number of bits in each word of the occupancy bitmap.
+     */
+    static constexpr std::size_t word_bits = 64;
+
+    /**
+     * @brief The number of possible priorities, and therefore buckets.
+     */
+    static constexpr std::size_t num_buckets = 256;
+
+    /**
+     * @brief The number of words in the occupancy bitmap.
+     */
+    static constexpr std::size_t num_words = num_buckets / word_bits;
+
+    /**
+     * @brief The minimum number of popped tasks at the front of a bucket before it is compacted.
+     */
+    static constexpr std::size_t compact_threshold = 64;
+
+    /**
+     * @brief Convert a priority to the index of its bucket, such that the lowest priority maps to 0 and the highest to 255.
      *
-     * @return An `std::optional` object, optionally containing the name of the current thread. If the returned object does not contain a value, then the name could not be determined.
+     * @param priority The priority.
+     * @return The index.
      */
-    [[nodiscard]] static std::optional<std::string> get_os_thread_name()
+    [[nodiscard]] static constexpr std::size_t get_index(const priority_t priority) noexcept
     {
-    #if defined(_WIN32)
-        // On Windows thread names are wide strings, so we need to convert them to normal strings.
-        PWSTR data = nullptr;
-        const HRESULT hr = GetThreadDescription(GetCurrentThread(), &data);
-        if (FAILED(hr))
-            return std::nullopt;
-        if (data == nullptr)
-            return std::nullopt;
-        const int size = WideCharToMultiByte(CP_UTF8, 0, data, -1, nullptr, 0, nullptr, nullptr);
-        if (size == 0)
-        {
-            LocalFree(data);
-            return std::nullopt;
-        }
-        std::string name(static_cast<std::size_t>(size) - 1, 0);
-        const int result = WideCharToMultiByte(CP_UTF8, 0, data, -1, name.data(), size, nullptr, nullptr);
-        LocalFree(data);
-        if (result == 0)
-            return std::nullopt;
-        return name;
-    #elif defined(__linux__) || defined(__APPLE__)
-        #ifdef __linux__
-        // On Linux thread names are limited to 16 characters, including the null terminator.
-        constexpr std::size_t buffer_size = 16;
-        #else
-        // On macOS thread names are limited to 64 characters, including the null terminator.
-        constexpr std::size_t buffer_size = 64;
-        #endif
-        char name[buffer_size] = {};
-        if (pthread_getname_np(pthread_self(), name, buffer_size) != 0)
-            return std::nullopt;
-        return std::string(name);
-    #endif
+        return static_cast<std::size_t>(static_cast<int>(priority) - static_cast<int>(pr::lowest));
     }
 
     /**
-     * @brief Set the name of the current thread using the current platform's native API. This should work on Windows, Linux, and macOS. Note that on Linux thread names are limited to 16 characters, including the null terminator.
+     * @brief The buckets, one for each priority.
+     */
+    std::array<bucket, num_buckets> buckets = {};
+
+    /**
+     * @brief A bitmap indicating which buckets are non-empty.
+     */
+    std::array<std::uint64_t, num_words> occupancy = {};
+
+    /**
+     * @brief The total number of tasks in the queue.
+     */
+    std::size_t count = 0;
+}; // class priority_task_queue
+
+/**
+ * @brief A log-linear histogram of durations, in nanoseconds, as collected by `BS::thread_pool` if the flag `BS::tp::statistics` is enabled in its template parameter. Values below 16 have a bucket of their own, and every power of two above that is divided into 16 linear sub-buckets, as in HDR histograms, so the bucket a value falls into is never more than 1/16 (6.25%) wider than the value itself. Values of 2^40 nanoseconds (about 18 minutes) or more are counted in the last bucket. Objects of this class are snapshots: they are not modified by the pool, so they can be inspected, merged, and exported freely.
+ */
+class [[nodiscard]] latency_histogram
+{
+    friend class histogram_recorder;
+
+public:
+    /**
+     * @brief The number of bits used for the linear sub-buckets within each power of two.
+     */
+    static constexpr std::size_t sub_bucket_bits = 4;
+
+    /**
+     * @brief The number of linear sub-buckets within each power of two.
+     */
+    static constexpr std::size_t sub_bucket_count = std::size_t{1} << sub_bucket_bits;
+
+    /**
+     * @brief The number of bits of the largest value that has its own bucket. Larger values are counted in the last bucket.
+     */
+    static constexpr std::size_t max_value_bits = 40;
+
+    /**
+     * @brief The total number of buckets.
+     */
+    static constexpr std::size_t num_buckets = (max_value_bits - sub_bucket_bits + 1) * sub_bucket_count;
+
+    /**
+     * @brief Get the index of the bucket a value falls into.
      *
-     * @param name The name to set.
-     * @return `true` if the name was set successfully, `false` otherwise.
+     * @param value The value, in nanoseconds.
+     * @return The index of the bucket.
      */
-    static bool set_os_thread_name(const std::string& name)
+    [[nodiscard]] static std::size_t bucket_index(const std::uint64_t value) noexcept
     {
-    #if defined(_WIN32)
-        // On Windows thread names are wide strings, so we need to convert them from normal strings.
-        const int size = MultiByteToWideChar(CP_UTF8, 0, name.data(), -1, nullptr, 0);
-        if (size == 0)
-            return false;
-        std::wstring wide(static_cast<std::size_t>(size), 0);
-        if (MultiByteToWideChar(CP_UTF8, 0, name.data(), -1, wide.data(), size) == 0)
-            return false;
-        const HRESULT hr = SetThreadDescription(GetCurrentThread(), wide.data());
-        return SUCCEEDED(hr);
-    #elif defined(__linux__)
-        // On Linux this is straightforward.
-        return pthread_setname_np(pthread_self(), name.data()) == 0;
-    #elif defined(__APPLE__)
-        // On macOS, unlike Linux, a thread can only set a name for itself, so the signature is different.
-        return pthread_setname_np(name.data()) == 0;
-    #endif
+        if (value < sub_bucket_count)
+            return static_cast<std::size_t>(value);
+        const std::size_t bit = highest_set_bit(value);
+        if (bit >= max_value_bits)
+            return num_buckets - 1;
+        const std::uint64_t sub_bucket = (value >> (bit - sub_bucket_bits)) - sub_bucket_count;
+        return ((bit - sub_bucket_bits + 1) * sub_bucket_count) + static_cast<std::size_t>(sub_bucket);
     }
 
     /**
-     * @brief Get the priority of the current thread using the current platform's native API. This should work on Windows, Linux, and macOS.
+     * @brief Get the smallest value that falls into a bucket.
      *
-     * @return An `std::optional` object, optionally containing the priority of the current thread, as a member of the enum `BS::os_thread_priority`. If the returned object does not contain a value, then either the priority could not be determined, or it is not one of the pre-defined values.
+     * @param index The index of the bucket.
+     * @return The smallest value, in nanoseconds.
      */
-    [[nodiscard]] static std::optional<os_thread_priority> get_os_thread_priority()
+    [[nodiscard]] static std::uint64_t bucket_lower_bound(const std::size_t index) noexcept
     {
-    #if defined(_WIN32)
-        // On Windows, this is straightforward.
-        const int priority = GetThreadPriority(GetCurrentThread());
-        if (priority == THREAD_PRIORITY_ERROR_RETURN)
-            return std::nullopt;
-        return static_cast<os_thread_priority>(priority);
-    #elif defined(__linux__)
-        // On Linux, we distill the choices of scheduling policy, priority, and "nice" value into 7 pre-defined levels, for simplicity and portability. The total number of possible combinations of policies and priorities is much larger, so if the value was set via any means other than `BS::this_thread::set_os_thread_priority()`, it may not match one of our pre-defined values.
-        int policy = 0;
-        struct sched_param param = {};
-        if (pthread_getschedparam(pthread_self(), &policy, &param) != 0)
-            return std::nullopt;
-        if (policy == SCHED_FIFO && param.sched_priority == sched_get_priority_max(SCHED_FIFO))
-        {
-            // The only pre-defined priority that uses SCHED_FIFO and the maximum available priority value is the "realtime" priority.
-            return os_thread_priority::realtime;
-        }
-        if (policy == SCHED_RR && param.sched_priority == sched_get_priority_min(SCHED_RR) + (sched_get_priority_max(SCHED_RR) - sched_get_priority_min(SCHED_RR)) / 2)
-        {
-            // The only pre-defined priority that uses SCHED_RR and a priority in the middle of the available range is the "highest" priority.
-            return os_thread_priority::highest;
-        }
-        #ifdef __linux__
-        if (policy == SCHED_IDLE)
-        {
-            // The only pre-defined priority that uses SCHED_IDLE is the "idle" priority. Note that this scheduling policy is not available on macOS.
-            return os_thread_priority::idle;
-        }
-        #endif
-        if (policy == SCHED_OTHER)
-        {
-            // For SCHED_OTHER, the result depends on the "nice" value. The usual range is -20 to 19 or 20, with higher values corresponding to lower priorities. Note that `getpriority()` returns -1 on error, but since this does not correspond to any of our pre-defined values, this function will return `std::nullopt` anyway.
-            const int nice_val = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
-            switch (nice_val)
-            {
-            case PRIO_MIN + 2:
-                return os_thread_priority::above_normal;
-            case 0:
-                return os_thread_priority::normal;
-            case (PRIO_MAX / 2) + (PRIO_MAX % 2):
-                return os_thread_priority::below_normal;
-            case PRIO_MAX - 3:
-                return os_thread_priority::lowest;
-        #ifdef __APPLE__
-            // `SCHED_IDLE` doesn't exist on macOS, so we use the policy `SCHED_OTHER` with a "nice" value of `PRIO_MAX - 2`.
-            case PRIO_MAX - 2:
-                return os_thread_priority::idle;
-        #endif
-            default:
-                return std::nullopt;
-            }
-        }
-        return std::nullopt;
-    #elif defined(__APPLE__)
-        // On macOS, we distill the choices of scheduling policy and priority into 7 pre-defined levels, for simplicity and portability. The total number of possible combinations of policies and priorities is much larger, so if the value was set via any means other than `BS::this_thread::set_os_thread_priority()`, it may not match one of our pre-defined values.
-        int policy = 0;
-        struct sched_param param = {};
-        if (pthread_getschedparam(pthread_self(), &policy, &param) != 0)
-            return std::nullopt;
-        if (policy == SCHED_FIFO && param.sched_priority == sched_get_priority_max(SCHED_FIFO))
-        {
-            // The only pre-defined priority that uses SCHED_FIFO and the maximum available priority value is the "realtime" priority.
-            return os_thread_priority::realtime;
-        }
-        if (policy == SCHED_RR && param.sched_priority == sched_get_priority_min(SCHED_RR) + (sched_get_priority_max(SCHED_RR) - sched_get_priority_min(SCHED_RR)) / 2)
-        {
-            // The only pre-defined priority that uses SCHED_RR and a priority in the middle of the available range is the "highest" priority.
-            return os_thread_priority::highest;
-        }
-        if (policy == SCHED_OTHER)
+        if (index < sub_bucket_count)
+            return index;
+        const std::uint64_t mantissa = sub_bucket_count + (index % sub_bucket_count);
+        return mantissa << ((index / sub_bucket_count) - 1);
+    }
+
+    /**
+     * @brief Get the largest value that falls into a bucket. For the last bucket, this is the largest value of type `std::uint64_t`.
+     *
+     * @param index The index of the bucket.
+     * @return The largest value, in nanoseconds.
+     */
+    [[nodiscard]] static std::uint64_t bucket_upper_bound(const std::size_t index) noexcept
+    {
+        if (index == num_buckets - 1)
+            return std::numeric_limits<std::uint64_t>::max();
+        if (index < sub_bucket_count)
+            return index;
+        return bucket_lower_bound(index) + (std::uint64_t{1} << ((index / sub_bucket_count) - 1)) - 1;
+    }
+
+    /**
+     * @brief Get the number of values in a bucket.
+     *
+     * @param index The index of the bucket.
+     * @return The number of values.
+     */
+    [[nodiscard]] std::uint64_t get_bucket(const std::size_t index) const noexcept
+    {
+        return buckets[index];
+    }
+
+    /**
+     * @brief Get the total number of values in the histogram.
+     *
+     * @return The number of values.
+     */
+    [[nodiscard]] std::uint64_t get_count() const noexcept
+    {
+        return count;
+    }
+
+    /**
+     * @brief Get the largest value in the histogram, or 0 if it is empty.
+     *
+     * @return The largest value, in nanoseconds.
+     */
+    [[nodiscard]] std::uint64_t get_max() const noexcept
+    {
+        return max_value;
+    }
+
+    /**
+     * @brief Get the mean of the values in the histogram, or 0 if it is empty.
+     *
+     * @return The mean, in nanoseconds.
+     */
+    [[nodiscard]] double get_mean() const noexcept
+    {
+        return (count == 0) ? 0.0 : (static_cast<double>(sum) / static_cast<double>(count));
+    }
+
+    /**
+     * @brief Get an estimate of a quantile of the values in the histogram, or 0 if it is empty. The estimate is the upper bound of the bucket that contains the quantile, so it is never smaller than the exact quantile, and at most 6.25% larger (except in the last bucket), but never larger than the largest value.
+     *
+     * @param quantile The quantile, between 0 and 1. For example, 0.5 is the median and 0.99 is the 99th percentile.
+     * @return The estimate, in nanoseconds.
+     */
+    [[nodiscard]] std::uint64_t get_quantile(const double quantile) const noexcept
+    {
+        if (count == 0)
+            return 0;
+        const double clamped = std::min(std::max(quantile, 0.0), 1.0);
+        const double exact_rank = clamped * static_cast<double>(count);
+        std::uint64_t rank = static_cast<std::uint64_t>(exact_rank);
+        if ((static_cast<double>(rank) < exact_rank) || (rank == 0))
+            ++rank;
+        std::uint64_t cumulative = 0;
+        for (std::size_t i = 0; i < num_buckets; ++i)
         {
-            // For SCHED_OTHER, the result depends on the specific value of the priority.
-            if (param.sched_priority == sched_get_priority_max(SCHED_OTHER))
-                return os_thread_priority::above_normal;
-            if (param.sched_priority == sched_get_priority_min(SCHED_OTHER) + (sched_get_priority_max(SCHED_OTHER) - sched_get_priority_min(SCHED_OTHER)) / 2)
-                return os_thread_priority::normal;
-            if (param.sched_priority == sched_get_priority_min(SCHED_OTHER) + (sched_get_priority_max(SCHED_OTHER) - sched_get_priority_min(SCHED_OTHER)) * 2 / 3)
-                return os_thread_priority::below_normal;
-            if (param.sched_priority == sched_get_priority_min(SCHED_OTHER) + (sched_get_priority_max(SCHED_OTHER) - sched_get_priority_min(SCHED_OTHER)) / 3)
-                return os_thread_priority::lowest;
-            if (param.sched_priority == sched_get_priority_min(SCHED_OTHER))
-                return os_thread_priority::idle;
-            return std::nullopt;
+            cumulative += buckets[i];
+            if (cumulative >= rank)
+                return std::min(bucket_upper_bound(i), max_value);
         }
-        return std::nullopt;
-    #endif
+        return max_value;
     }
 
     /**
-     * @brief Set the priority of the current thread using the current platform's native API. This should work on Windows, Linux, and macOS. However, note that higher priorities might require elevated permissions.
+     * @brief Get the sum of the values in the histogram.
      *
-     * @param priority The priority to set. Must be a value from the enum `BS::os_thread_priority`.
-     * @return `true` if the priority was set successfully, `false` otherwise. Usually, `false` means that the user does not have the necessary permissions to set the desired priority.
+     * @return The sum, in nanoseconds.
      */
-    static bool set_os_thread_priority(const os_thread_priority priority)
+    [[nodiscard]] std::uint64_t get_sum() const noexcept
     {
-    #if defined(_WIN32)
-        // On Windows, this is straightforward.
-        return SetThreadPriority(GetCurrentThread(), static_cast<int>(priority)) != 0;
-    #elif defined(__linux__)
-        // On Linux, we distill the choices of scheduling policy, priority, and "nice" value into 7 pre-defined levels, for simplicity and portability. The total number of possible combinations of policies and priorities is much larger, but allowing more fine-grained control would not be portable.
-        int policy = 0;
-        struct sched_param param = {};
-        std::optional<int> nice_val = std::nullopt;
-        switch (priority)
-        {
-        case os_thread_priority::realtime:
-            // "Realtime" pre-defined priority: We use the policy `SCHED_FIFO` with the highest possible priority.
-            policy = SCHED_FIFO;
-            param.sched_priority = sched_get_priority_max(SCHED_FIFO);
-            break;
-        case os_thread_priority::highest:
-            // "Highest" pre-defined priority: We use the policy `SCHED_RR` ("round-robin") with a priority in the middle of the available range.
-            policy = SCHED_RR;
-            param.sched_priority = sched_get_priority_min(SCHED_RR) + (sched_get_priority_max(SCHED_RR) - sched_get_priority_min(SCHED_RR)) / 2;
-            break;
-        case os_thread_priority::above_normal:
-            // "Above normal" pre-defined priority: We use the policy `SCHED_OTHER` (the default). This policy does not accept a priority value, so priority must be 0. However, we set the "nice" value to the minimum value as given by `PRIO_MIN`, plus 2 (which should evaluate to -18). The usual range is -20 to 19 or 20, with higher values corresponding to lower priorities.
-            policy = SCHED_OTHER;
-            param.sched_priority = 0;
-            nice_val = PRIO_MIN + 2;
-            break;
-        case os_thread_priority::normal:
-            // "Normal" pre-defined priority: We use the policy `SCHED_OTHER`, priority must be 0, and we set the "nice" value to 0 (the default).
-            policy = SCHED_OTHER;
-            param.sched_priority = 0;
-            nice_val = 0;
-            break;
-        case os_thread_priority::below_normal:
-            // "Below normal" pre-defined priority: We use the policy `SCHED_OTHER`, priority must be 0, and we set the "nice" value to half the maximum value as given by `PRIO_MAX`, rounded up (which should evaluate to 10).
-            policy = SCHED_OTHER;
-            param.sched_priority = 0;
-            nice_val = (PRIO_MAX / 2) + (PRIO_MAX % 2);
-            break;
-        case os_thread_priority::lowest:
-            // "Lowest" pre-defined priority: We use the policy `SCHED_OTHER`, priority must be 0, and we set the "nice" value to the maximum value as given by `PRIO_MAX`, minus 3 (which should evaluate to 17).
-            policy = SCHED_OTHER;
-            param.sched_priority = 0;
-            nice_val = PRIO_MAX - 3;
-            break;
-        case os_thread_priority::idle:
-            // "Idle" pre-defined priority on Linux: We use the policy `SCHED_IDLE`, priority must be 0, and we don't touch the "nice" value.
-            policy = SCHED_IDLE;
-            param.sched_priority = 0;
-            break;
-        default:
-            return false;
-        }
-        bool success = (pthread_setschedparam(pthread_self(), policy, &param) == 0);
-        if (nice_val.has_value())
-            success = success && (setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), nice_val.value()) == 0);
-        return success;
-    #elif defined(__APPLE__)
-        // On macOS, unlike Linux, the "nice" value is per-process, not per-thread (in compliance with the POSIX standard). However, unlike Linux, `SCHED_OTHER` on macOS does have a range of priorities. So for `realtime` and `highest` priorities we use `SCHED_FIFO` and `SCHED_RR` respectively as for Linux, but for the other priorities we use `SCHED_OTHER` with a priority in the range given by `sched_get_priority_min(SCHED_OTHER)` to `sched_get_priority_max(SCHED_OTHER)`.
-        int policy = 0;
-        struct sched_param param = {};
-        switch (priority)
+        return sum;
+    }
+
+    /**
+     * @brief Add the values of another histogram to this histogram.
+     *
+     * @param other The other histogram.
+     */
+    void merge(const latency_histogram& other) noexcept
+    {
+        for (std::size_t i = 0; i < num_buckets; ++i)
+            buckets[i] += other.buckets[i];
+        count += other.count;
+        sum += other.sum;
+        max_value = std::max(max_value, other.max_value);
+    }
+
+    /**
+     * @brief Write the histogram to a stream in the Prometheus text exposition format, as a metric of type `histogram` with the values converted to seconds. To keep the output short, there is one cumulative bucket for each power of two, with the label `le` set to that power of two, plus the bucket `+Inf`, followed by the `_sum` and `_count` samples.
+     *
+     * @param stream The output stream.
+     * @param name The name of the metric.
+     */
+    void write_prometheus(std::ostream& stream, const std::string_view name) const
+    {
+        const std::streamsize old_precision = stream.precision(12);
+        stream << "# TYPE " << name << " histogram\n";
+        std::uint64_t cumulative = 0;
+        // The last group of sub-buckets also contains the values that are too large to have their own bucket, so it is only covered by the bucket `+Inf`.
+        for (std::size_t group = 0; group < (num_buckets / sub_bucket_count) - 1; ++group)
         {
-        case os_thread_priority::realtime:
-            // "Realtime" pre-defined priority: We use the policy `SCHED_FIFO` with the highest possible priority.
-            policy = SCHED_FIFO;
-            param.sched_priority = sched_get_priority_max(SCHED_FIFO);
-            break;
-        case os_thread_priority::highest:
-            // "Highest" pre-defined priority: We use the policy `SCHED_RR` ("round-robin") with a priority in the middle of the available range.
-            policy = SCHED_RR;
-            param.sched_priority = sched_get_priority_min(SCHED_RR) + (sched_get_priority_max(SCHED_RR) - sched_get_priority_min(SCHED_RR)) / 2;
-            break;
-        case os_thread_priority::above_normal:
-            // "Above normal" pre-defined priority: We use the policy `SCHED_OTHER` (the default) with the highest possible priority.
-            policy = SCHED_OTHER;
-            param.sched_priority = sched_get_priority_max(SCHED_OTHER);
-            break;
-        case os_thread_priority::normal:
-            // "Normal" pre-defined priority: We use the policy `SCHED_OTHER` (the default) with a priority in the middle of the available range (which appears to be the default?).
-            policy = SCHED_OTHER;
-            param.sched_priority = sched_get_priority_min(SCHED_OTHER) + (sched_get_priority_max(SCHED_OTHER) - sched_get_priority_min(SCHED_OTHER)) / 2;
-            break;
-        case os_thread_priority::below_normal:
-            // "Below normal" pre-defined priority: We use the policy `SCHED_OTHER` (the default) with a priority equal to 2/3rds of the normal value.
-            policy = SCHED_OTHER;
-            param.sched_priority = sched_get_priority_min(SCHED_OTHER) + (sched_get_priority_max(SCHED_OTHER) - sched_get_priority_min(SCHED_OTHER)) * 2 / 3;
-            break;
-        case os_thread_priority::lowest:
-            // "Lowest" pre-defined priority: We use the policy `SCHED_OTHER` (the default) with a priority equal to 1/3rd of the normal value.
-            policy = SCHED_OTHER;
-            param.sched_priority = sched_get_priority_min(SCHED_OTHER) + (sched_get_priority_max(SCHED_OTHER) - sched_get_priority_min(SCHED_OTHER)) / 3;
-            break;
-        case os_thread_priority::idle:
-            // "Idle" pre-defined priority on macOS: We use the policy `SCHED_OTHER` (the default) with the lowest possible priority.
-            policy = SCHED_OTHER;
-            param.sched_priority = sched_get_priority_min(SCHED_OTHER);
-            break;
-        default:
-            return false;
+            for (std::size_t i = group * sub_bucket_count; i < (group + 1) * sub_bucket_count; ++i)
+                cumulative += buckets[i];
+            const std::uint64_t bound = bucket_upper_bound(((group + 1) * sub_bucket_count) - 1) + 1;
+            stream << name << "_bucket{le=\"" << (static_cast<double>(bound) / 1e9) << "\"} " << cumulative << '\n';
         }
-        return pthread_setschedparam(pthread_self(), policy, &param) == 0;
-    #endif
+        stream << name << "_bucket{le=\"+Inf\"} " << count << '\n';
+        stream << name << "_sum " << (static_cast<double>(sum) / 1e9) << '\n';
+        stream << name << "_count " << count << '\n';
+        stream.precision(old_precision);
     }
-#endif
 
 private:
-    inline static thread_local std::optional<std::size_t> my_index = std::nullopt;
-    inline static thread_local std::optional<void*> my_pool = std::nullopt;
-}; // class this_thread
+    /**
+     * @brief The number of values in each bucket.
+     */
+    std::array<std::uint64_t, num_buckets> buckets = {};
+
+    /**
+     * @brief The total number of values.
+     */
+    std::uint64_t count = 0;
+
+    /**
+     * @brief The largest value.
+     */
+    std::uint64_t max_value = 0;
+
+    /**
+     * @brief The sum of the values.
+     */
+    std::uint64_t sum = 0;
+}; // class latency_histogram
 
 /**
- * @brief A meta-programming template to determine the common type of two integer types. Unlike `std::common_type`, this template maintains correct signedness.
- *
- * @tparam T1 The first type.
- * @tparam T2 The second type.
- * @tparam Enable A dummy parameter to enable SFINAE in specializations.
+ * @brief A log-linear histogram of durations which is updated by a single thread and can be read by any other thread at the same time, without locking. Used by `BS::thread_pool` to collect the statistics of each worker if the flag `BS::tp::statistics` is enabled. Since only the owning thread writes to the counters, each update is a relaxed load followed by a relaxed store, which is much cheaper than an atomic read-modify-write operation.
  */
-template <typename T1, typename T2, typename Enable = void>
-struct common_index_type
+class [[nodiscard]] histogram_recorder
 {
-    // Fallback to `std::common_type_t` if no specialization matches.
-    using type = std::common_type_t<T1, T2>;
-};
+public:
+    /**
+     * @brief Record a value. Must only be called by the thread that owns the histogram.
+     *
+     * @param value The value, in nanoseconds.
+     */
+    void record(const std::uint64_t value) noexcept
+    {
+        increase(buckets[latency_histogram::bucket_index(value)], 1);
+        increase(sum, value);
+        if (value > max_value.load(std::memory_order_relaxed))
+            max_value.store(value, std::memory_order_relaxed);
+    }
 
-// The common type of two signed integers is the larger of the integers, with the same signedness.
-template <typename T1, typename T2>
-struct common_index_type<T1, T2, std::enable_if_t<std::is_signed_v<T1> && std::is_signed_v<T2>>>
-{
-    using type = std::conditional_t<(sizeof(T1) >= sizeof(T2)), T1, T2>;
-};
+    /**
+     * @brief Take a snapshot of the histogram. May be called by any thread. The total count of the snapshot is the sum of its buckets, so quantiles are always consistent, but the sum may include a few values that are not yet counted in the buckets, or vice versa.
+     *
+     * @return The snapshot.
+     */
+    [[nodiscard]] latency_histogram snapshot() const noexcept
+    {
+        latency_histogram result;
+        for (std::size_t i = 0; i < latency_histogram::num_buckets; ++i)
+        {
+            result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+            result.count += result.buckets[i];
+        }
+        result.max_value = max_value.load(std::memory_order_relaxed);
+        result.sum = sum.load(std::memory_order_relaxed);
+        return result;
+    }
 
-// The common type of two unsigned integers is the larger of the integers, with the same signedness.
-template <typename T1, typename T2>
-struct common_index_type<T1, T2, std::enable_if_t<std::is_unsigned_v<T1> && std::is_unsigned_v<T2>>>
+private:
+    /**
+     * @brief Increase a counter that is only written by the current thread.
+     *
+     * @param counter The counter.
+     * @param value The amount to add.
+     */
+    static void increase(std::atomic<std::uint64_t>& counter, const std::uint64_t value) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief The number of values in each bucket.
+     */
+    std::array<std::atomic<std::uint64_t>, latency_histogram::num_buckets> buckets = {};
+
+    /**
+     * @brief The largest value.
+     */
+    std::atomic<std::uint64_t> max_value = 0;
+
+    /**
+     * @brief The sum of the values.
+     */
+    std::atomic<std::uint64_t> sum = 0;
+}; // class histogram_recorder
+
+/**
+ * @brief A snapshot of the statistics collected by `BS::thread_pool` if the flag `BS::tp::statistics` is enabled in its template parameter, either for a single thread or for the whole pool. All durations are in nanoseconds.
+ */
+struct pool_statistics
 {
-    using type = std::conditional_t<(sizeof(T1) >= sizeof(T2)), T1, T2>;
-};
+    /**
+     * @brief Add the statistics of another snapshot to this snapshot.
+     *
+     * @param other The other snapshot.
+     */
+    void merge(const pool_statistics& other) noexcept
+    {
+        wait_time.merge(other.wait_time);
+        execution_time.merge(other.execution_time);
+        idle_time.merge(other.idle_time);
+        steals += other.steals;
+    }
 
-// The common type of a signed and an unsigned integer is a signed integer that can hold the full ranges of both integers.
-template <typename T1, typename T2>
-struct common_index_type<T1, T2, std::enable_if_t<(std::is_signed_v<T1> && std::is_unsigned_v<T2>) || (std::is_unsigned_v<T1> && std::is_signed_v<T2>)>>
+    /**
+     * @brief Write the statistics to a stream in the Prometheus text exposition format: the histograms `<prefix>_task_wait_seconds`, `<prefix>_task_execution_seconds`, and `<prefix>_worker_idle_seconds`, and the counter `<prefix>_steals_total`.
+     *
+     * @param stream The output stream.
+     * @param prefix The prefix of the metric names. The default is `bs_thread_pool`.
+     */
+    void write_prometheus(std::ostream& stream, const std::string_view prefix = "bs_thread_pool") const
+    {
+        wait_time.write_prometheus(stream, std::string(prefix) + "_task_wait_seconds");
+        execution_time.write_prometheus(stream, std::string(prefix) + "_task_execution_seconds");
+        idle_time.write_prometheus(stream, std::string(prefix) + "_worker_idle_seconds");
+        stream << "# TYPE " << prefix << "_steals_total counter\n";
+        stream << prefix << "_steals_total " << steals << '\n';
+    }
+
+    /**
+     * @brief The time each task spent waiting in a queue, from being submitted until a thread started executing it.
+     */
+    latency_histogram wait_time;
+
+    /**
+     * @brief The time each task took to execute. The number of values is the number of tasks executed.
+     */
+    latency_histogram execution_time;
+
+    /**
+     * @brief The duration of each period in which a thread had no tasks to execute, including any time spent spinning. The sum is the total idle time.
+     */
+    latency_histogram idle_time;
+
+    /**
+     * @brief The number of tasks taken by a thread from the local queue of another thread or, if NUMA-aware scheduling is enabled, from the queue of another node. Only non-zero if work stealing is enabled.
+     */
+    std::uint64_t steals = 0;
+}; // struct pool_statistics
+
+/**
+ * @brief A single task executed by a `BS::thread_pool` with the flag `BS::tp::trace` enabled in its template parameter, as recorded in the trace buffer of the thread that executed it. All times are in nanoseconds since the pool was created.
+ */
+struct trace_event
 {
-    using S = std::conditional_t<std::is_signed_v<T1>, T1, T2>;
-    using U = std::conditional_t<std::is_unsigned_v<T1>, T1, T2>;
-    static constexpr std::size_t larger_size = (sizeof(S) > sizeof(U)) ? sizeof(S) : sizeof(U);
-    using type = std::conditional_t<larger_size <= 4,
-        // If both integers are 32 bits or less, the common type should be a signed type that can hold both of them. If both are 8 bits, or the signed type is 16 bits and the unsigned type is 8 bits, the common type is `std::int16_t`. Otherwise, if both are 16 bits, or the signed type is 32 bits and the unsigned type is smaller, the common type is `std::int32_t`. Otherwise, if both are 32 bits or less, the common type is `std::int64_t`.
-        std::conditional_t<larger_size == 1 || (sizeof(S) == 2 && sizeof(U) == 1), std::int16_t, std::conditional_t<larger_size == 2 || (sizeof(S) == 4 && sizeof(U) < 4), std::int32_t, std::int64_t>>,
-        // If the unsigned integer is 64 bits, the common type should also be an unsigned 64-bit integer, that is, `std::uint64_t`. The reason is that the most common scenario where this might happen is where the indices go from 0 to `x` where `x` has been previously defined as `std::size_t`, e.g. the size of a vector. Note that this will fail if the first index is negative; in that case, the user must cast the indices explicitly to the desired common type. If the unsigned integer is not 64 bits, then the signed integer must be 64 bits, hence the common type is `std::int64_t`.
-        std::conditional_t<sizeof(U) == 8, std::uint64_t, std::int64_t>>;
-};
+    /**
+     * @brief The tag of the task, given by the `BS::this_thread::trace_tag` that was active in the thread that submitted it, or `nullptr` if there was none.
+     */
+    const char* tag = nullptr;
+
+    /**
+     * @brief The index of the thread that executed the task.
+     */
+    std::size_t thread_idx = 0;
+
+    /**
+     * @brief The time at which the task was submitted.
+     */
+    std::uint64_t enqueued = 0;
+
+    /**
+     * @brief The time at which the thread started executing the task.
+     */
+    std::uint64_t dequeued = 0;
+
+    /**
+     * @brief The time at which the task finished executing.
+     */
+    std::uint64_t completed = 0;
+
+    /**
+     * @brief The priority with which the task was submitted.
+     */
+    priority_t priority = 0;
+}; // struct trace_event
+
+// In C++20 and later we can use concepts. In C++17 we instead use SFINAE ("Substitution Failure Is Not An Error") with `std::enable_if_t`.
+#ifdef __cpp_concepts
+    #define BS_THREAD_POOL_IF_PAUSE_ENABLED template <bool P = pause_enabled> requires(P)
+    #define BS_THREAD_POOL_IF_NUMA_ENABLED template <bool N = numa_enabled> requires(N)
+    #define BS_THREAD_POOL_IF_WORK_STEALING_ENABLED template <bool W = work_stealing_enabled> requires(W)
+    #define BS_THREAD_POOL_IF_STATISTICS_ENABLED template <bool S = statistics_enabled> requires(S)
+    #define BS_THREAD_POOL_IF_ELASTIC_ENABLED template <bool E = elastic_enabled> requires(E)
+    #define BS_THREAD_POOL_IF_TRACE_ENABLED template <bool T = trace_enabled> requires(T)
+template <typename F>
+concept init_func_c = std::invocable<F> || std::invocable<F, std::size_t>;
+    #define BS_THREAD_POOL_INIT_FUNC_CONCEPT(F) init_func_c F
+#else
+    #define BS_THREAD_POOL_IF_PAUSE_ENABLED template <bool P = pause_enabled, typename = std::enable_if_t<P>>
+    #define BS_THREAD_POOL_IF_NUMA_ENABLED template <bool N = numa_enabled, typename = std::enable_if_t<N>>
+    #define BS_THREAD_POOL_IF_WORK_STEALING_ENABLED template <bool W = work_stealing_enabled, typename = std::enable_if_t<W>>
+    #define BS_THREAD_POOL_IF_STATISTICS_ENABLED template <bool S = statistics_enabled, typename = std::enable_if_t<S>>
+    #define BS_THREAD_POOL_IF_ELASTIC_ENABLED template <bool E = elastic_enabled, typename = std::enable_if_t<E>>
+    #define BS_THREAD_POOL_IF_TRACE_ENABLED template <bool T = trace_enabled, typename = std::enable_if_t<T>>
+    #define BS_THREAD_POOL_INIT_FUNC_CONCEPT(F) typename F, typename = std::enable_if_t<std::is_invocable_v<F> || std::is_invocable_v<F, std::size_t>> // NOLINT(bugprone-macro-parentheses)
+#endif
 
 /**
- * @brief A helper type alias to obtain the common type from the template `BS::common_index_type`.
+ * @brief A helper class to facilitate waiting for and/or getting the results of multiple futures at once.
  *
- * @tparam T1 The first type.
- * @tparam T2 The second type.
+ * @tparam T The return type of the futures.
  */
-template <typename T1, typename T2>
-using common_index_type_t = typename common_index_type<T1, T2>::type;
+template <typename T>
+class [[nodiscard]] multi_future : public std::vector<std::future<T>>
+{
+public:
+    // Inherit all constructors from the base class `std::vector`.
+    using std::vector<std::future<T>>::vector;
+
+    /**
+     * @brief Get the results from all the futures stored in this `BS::multi_future`, rethrowing any stored exceptions. Waits for all the futures first, so that if an exception is rethrown, none of the tasks are still running.
+     *
+     * @return If the futures return `void`, this function returns `void` as well. Otherwise, it returns a vector containing the results.
+     */
+    [[nodiscard]] std::conditional_t<std::is_void_v<T>, void, std::vector<T>> get()
+    {
+        wait();
+        if constexpr (std::is_void_v<T>)
+        {
+            for (std::future<T>& future : *this)
+                future.get();
+            return;
+        }
+        else
+        {
+            std::vector<T> results;
+            results.reserve(this->size());
+            for (std::future<T>& future : *this)
+                results.push_back(future.get());
+            return results;
+        }
+    }
+
+    /**
+     * @brief Check how many of the futures stored in this `BS::multi_future` are ready.
+     *
+     * @return The number of ready futures.
+     */
+    [[nodiscard]] std::size_t ready_count() const
+    {
+        std::size_t count = 0;
+        for (const std::future<T>& future : *this)
+        {
+            if (future.wait_for(std::chrono::duration<double>::zero()) == std::future_status::ready)
+                ++count;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Check if all the futures stored in this `BS::multi_future` are valid.
+     *
+     * @return `true` if all futures are valid, `false` if at least one of the futures is not valid.
+     */
+    [[nodiscard]] bool valid() const noexcept
+    {
+        bool is_valid = true;
+        for (const std::future<T>& future : *this)
+            is_valid = is_valid && future.valid();
+        return is_valid;
+    }
+
+    /**
+     * @brief Wait for all the futures stored in this `BS::multi_future`.
+     */
+    void wait() const
+    {
+        for (const std::future<T>& future : *this)
+            future.wait();
+    }
+
+    /**
+     * @brief Wait for all the futures stored in this `BS::multi_future`, but stop waiting after the specified duration has passed. This function first waits for the first future for the desired duration. If that future is ready before the duration expires, this function waits for the second future for whatever remains of the duration. It continues similarly until the duration expires.
+     *
+     * @tparam R An arithmetic type representing the number of ticks to wait.
+     * @tparam P An `std::ratio` representing the length of each tick in seconds.
+     * @param duration The amount of time to wait.
+     * @return `true` if all futures have been waited for before the duration expired, `false` otherwise.
+     */
+    template <typename R, typename P>
+    bool wait_for(const std::chrono::duration<R, P>& duration) const
+    {
+        const std::chrono::time_point<std::chrono::steady_clock> start_time = std::chrono::steady_clock::now();
+        for (const std::future<T>& future : *this)
+        {
+            future.wait_for(duration - (std::chrono::steady_clock::now() - start_time));
+            if (duration < std::chrono::steady_clock::now() - start_time)
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Wait for all the futures stored in this `BS::multi_future`, but stop waiting after the specified time point has been reached. This function first waits for the first future until the desired time point. If that future is ready before the time point is reached, this function waits for the second future until the desired time point. It continues similarly until the time point is reached.
+     *
+     * @tparam C The type of the clock used to measure time.
+     * @tparam D An `std::chrono::duration` type used to indicate the time point.
+     * @param timeout_time The time point at which to stop waiting.
+     * @return `true` if all futures have been waited for before the time point was reached, `false` otherwise.
+     */
+    template <typename C, typename D>
+    bool wait_until(const std::chrono::time_point<C, D>& timeout_time) const
+    {
+        for (const std::future<T>& future : *this)
+        {
+            future.wait_until(timeout_time);
+            if (timeout_time < std::chrono::steady_clock::now())
+                return false;
+        }
+        return true;
+    }
+}; // class multi_future
+
+/**
+ * @brief A helper class storing the shared state of a `BS::group_future`: a single atomic counter of the tasks that have not finished yet, a mutex and condition variable to wait on, the results of the tasks stored contiguously in a preallocated vector, and the first exception thrown by any of the tasks. Used by `submit_blocks_grouped()` and `submit_sequence_grouped()`.
+ *
+ * @tparam T The return type of the tasks (can be `void`).
+ */
+template <typename T>
+class [[nodiscard]] group_state
+{
+    static_assert(std::is_void_v<T> || (std::is_default_constructible_v<T> && std::is_move_assignable_v<T>), "The results of a BS::group_future are stored in a preallocated vector, so the return type of the tasks must be default-constructible and move-assignable.");
+    static_assert(!std::is_same_v<T, bool>, "The results of a BS::group_future are written by different threads at the same time, which is not possible with std::vector<bool>. Please use a different return type, such as char.");
+
+public:
+    /**
+     * @brief Construct a new state for the given number of tasks.
+     *
+     * @param count The number of tasks.
+     */
+    explicit group_state(const std::size_t count) : remaining(count), total(count)
+    {
+        if constexpr (!std::is_void_v<T>)
+            results.resize(count);
+    }
+
+    // The copy and move constructors and assignment operators are deleted. The state is only ever accessed through a shared pointer.
+    group_state(const group_state&) = delete;
+    group_state(group_state&&) = delete;
+    group_state& operator=(const group_state&) = delete;
+    group_state& operator=(group_state&&) = delete;
+    ~group_state() = default;
+
+    /**
+     * @brief Invoke a function, store its returned value at the given index or store any exception it throws if it is the first one, and then mark the task as finished. The task that finishes last wakes up any threads waiting for the group.
+     *
+     * @tparam F The type of the function.
+     * @param idx The index of the task in the group.
+     * @param func The function to invoke.
+     */
+    template <typename F>
+    void complete(const std::size_t idx, F&& func)
+    {
+#ifdef __cpp_exceptions
+        try
+        {
+#endif
+            if constexpr (std::is_void_v<T>)
+                std::forward<F>(func)();
+            else
+                results[idx] = std::forward<F>(func)();
+#ifdef __cpp_exceptions
+        }
+        catch (...)
+        {
+            if (!has_exception.exchange(true, std::memory_order_relaxed))
+                exception = std::current_exception();
+        }
+#endif
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            // Locking the mutex here, even though we don't modify anything it protects, guarantees that a thread which checked the counter while holding the mutex is already waiting on the condition variable, so it will not miss the notification.
+            {
+                const std::scoped_lock lock(mutex);
+            }
+            done_cv.notify_all();
+        }
+    }
+
+    /**
+     * @brief Wait for all the tasks, and then get their results, rethrowing the first exception thrown by any of them, if any.
+     *
+     * @return If the tasks return `void`, this function returns `void` as well. Otherwise, it returns a reference to the vector containing the results, in the order of the tasks.
+     */
+    [[nodiscard]] std::conditional_t<std::is_void_v<T>, void, std::vector<T>&> get()
+    {
+        wait();
+#ifdef __cpp_exceptions
+        if (has_exception.load(std::memory_order_relaxed))
+            std::rethrow_exception(exception);
+#endif
+        if constexpr (!std::is_void_v<T>)
+            return results;
+    }
+
+    /**
+     * @brief Check how many of the tasks have finished.
+     *
+     * @return The number of finished tasks.
+     */
+    [[nodiscard]] std::size_t ready_count() const noexcept
+    {
+        return total - remaining.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Get the number of tasks in the group.
+     *
+     * @return The number of tasks.
+     */
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return total;
+    }
+
+    /**
+     * @brief Wait for all the tasks to finish.
+     */
+    void wait()
+    {
+        if (remaining.load(std::memory_order_acquire) == 0)
+            return;
+        std::unique_lock lock(mutex);
+        done_cv.wait(lock,
+            [this]
+            {
+                return remaining.load(std::memory_order_acquire) == 0;
+            });
+    }
+
+    /**
+     * @brief Wait for all the tasks to finish, but stop waiting after the specified time point has been reached.
+     *
+     * @tparam C The type of the clock used to measure time.
+     * @tparam D An `std::chrono::duration` type used to indicate the time point.
+     * @param timeout_time The time point at which to stop waiting.
+     * @return `true` if all the tasks finished before the time point was reached, `false` otherwise.
+     */
+    template <typename C, typename D>
+    bool wait_until(const std::chrono::time_point<C, D>& timeout_time)
+    {
+        if (remaining.load(std::memory_order_acquire) == 0)
+            return true;
+        std::unique_lock lock(mutex);
+        return done_cv.wait_until(lock, timeout_time,
+            [this]
+            {
+                return remaining.load(std::memory_order_acquire) == 0;
+            });
+    }
+
+private:
+    /**
+     * @brief A condition variable to notify the waiting threads that all the tasks have finished.
+     */
+    std::condition_variable done_cv;
+
+#ifdef __cpp_exceptions
+    /**
+     * @brief The first exception thrown by any of the tasks. Only written by the task that set `has_exception`, and only read after all the tasks have finished.
+     */
+    std::exception_ptr exception = nullptr;
+
+    /**
+     * @brief A flag indicating whether any of the tasks threw an exception.
+     */
+    std::atomic<bool> has_exception = false;
+#endif
+
+    /**
+     * @brief A mutex used together with `done_cv`. Only locked by the waiting threads and by the task that finishes last, never by the other tasks.
+     */
+    std::mutex mutex;
+
+    /**
+     * @brief The number of tasks that have not finished yet.
+     */
+    std::atomic<std::size_t> remaining;
+
+    /**
+     * @brief The results of the tasks, in the order of the tasks. Each task writes only to its own element, so no locking is needed. Only used if the tasks have a return value.
+     */
+    std::conditional_t<std::is_void_v<T>, std::monostate, std::vector<T>> results;
+
+    /**
+     * @brief The total number of tasks in the group.
+     */
+    const std::size_t total;
+}; // class group_state
+
+/**
+ * @brief A helper class to wait for and/or get the results of a group of tasks, returned by `submit_blocks_grouped()` and `submit_sequence_grouped()`. Unlike `BS::multi_future`, which stores one `std::future` (and one shared state) per task, all the tasks in the group share a single state with a single counter of unfinished tasks, and their results are written directly into one contiguous vector. Therefore, submitting the tasks does not allocate any memory per task, waiting for them and checking how many are ready take constant time, and getting the results does not copy them. `BS::group_future` objects can be copied, and all the copies refer to the same group.
+ *
+ * @tparam T The return type of the tasks (can be `void`).
+ */
+template <typename T>
+class [[nodiscard]] group_future
+{
+public:
+    /**
+     * @brief Construct an invalid group future, which does not refer to any group.
+     */
+    group_future() = default;
+
+    /**
+     * @brief Construct a group future referring to the given shared state.
+     *
+     * @param state_ A shared pointer to the state.
+     */
+    explicit group_future(std::shared_ptr<group_state<T>> state_) noexcept : state(std::move(state_)) {}
+
+    /**
+     * @brief Wait for all the tasks in the group, and then get their results, rethrowing the first exception thrown by any of them, if any. Unlike `BS::multi_future::get()`, this function can be called more than once.
+     *
+     * @return If the tasks return `void`, this function returns `void` as well. Otherwise, it returns a reference to the vector containing the results, in the order of the tasks, without copying them. The reference remains valid as long as this object (or any copy of it) exists, and the results may be moved out of it.
+     */
+    [[nodiscard]] std::conditional_t<std::is_void_v<T>, void, std::vector<T>&> get() const
+    {
+        return state->get();
+    }
+
+    /**
+     * @brief Check how many of the tasks in the group have finished. Takes constant time.
+     *
+     * @return The number of finished tasks.
+     */
+    [[nodiscard]] std::size_t ready_count() const noexcept
+    {
+        return state->ready_count();
+    }
+
+    /**
+     * @brief Get the number of tasks in the group.
+     *
+     * @return The number of tasks.
+     */
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return state->size();
+    }
+
+    /**
+     * @brief Check if this object refers to a group of tasks.
+     *
+     * @return `true` if this object refers to a group, `false` if it was default-constructed.
+     */
+    [[nodiscard]] bool valid() const noexcept
+    {
+        return state != nullptr;
+    }
+
+    /**
+     * @brief Wait for all the tasks in the group to finish.
+     */
+    void wait() const
+    {
+        state->wait();
+    }
+
+    /**
+     * @brief Wait for all the tasks in the group to finish, but stop waiting after the specified duration has passed.
+     *
+     * @tparam R An arithmetic type representing the number of ticks to wait.
+     * @tparam P An `std::ratio` representing the length of each tick in seconds.
+     * @param duration The amount of time to wait.
+     * @return `true` if all the tasks finished before the duration expired, `false` otherwise.
+     */
+    template <typename R, typename P>
+    bool wait_for(const std::chrono::duration<R, P>& duration) const
+    {
+        return state->wait_until(std::chrono::steady_clock::now() + duration);
+    }
+
+    /**
+     * @brief Wait for all the tasks in the group to finish, but stop waiting after the specified time point has been reached.
+     *
+     * @tparam C The type of the clock used to measure time.
+     * @tparam D An `std::chrono::duration` type used to indicate the time point.
+     * @param timeout_time The time point at which to stop waiting.
+     * @return `true` if all the tasks finished before the time point was reached, `false` otherwise.
+     */
+    template <typename C, typename D>
+    bool wait_until(const std::chrono::time_point<C, D>& timeout_time) const
+    {
+        return state->wait_until(timeout_time);
+    }
+
+private:
+    /**
+     * @brief A shared pointer to the state of the group.
+     */
+    std::shared_ptr<group_state<T>> state = nullptr;
+}; // class group_future
+
+/**
+ * @brief A helper class storing the shared state of a `BS::continuable_future`: a promise and the corresponding shared future, as well as the continuations waiting for the promise to be satisfied. Used by `submit_continuable()`, `BS::continuable_future::then()`, `BS::when_all()`, and `BS::task_graph`.
+ *
+ * @tparam T The type of the result (can be `void`).
+ */
+template <typename T>
+class [[nodiscard]] continuation_state
+{
+public:
+    /**
+     * @brief Construct a new state with an unsatisfied promise and no continuations.
+     */
+    continuation_state()
+    {
+        future = promise.get_future().share();
+    }
+
+    // The copy and move constructors and assignment operators are deleted. The state is only ever accessed through a shared pointer.
+    continuation_state(const continuation_state&) = delete;
+    continuation_state(continuation_state&&) = delete;
+    continuation_state& operator=(const continuation_state&) = delete;
+    continuation_state& operator=(continuation_state&&) = delete;
+    ~continuation_state() = default;
+
+    /**
+     * @brief Register a callback to be invoked once the promise is satisfied. If it is already satisfied, the callback is invoked immediately in the calling thread; otherwise, it will be invoked in the thread that satisfies the promise. Callbacks should therefore be short, and typically just submit a task to a pool.
+     *
+     * @param callback The callback.
+     */
+    void add_continuation(small_task&& callback)
+    {
+        if (!try_add_continuation(callback))
+            callback();
+    }
+
+    /**
+     * @brief Register a callback to be invoked once the promise is satisfied, unless it is already satisfied, in which case the callback is left untouched and not invoked.
+     *
+     * @param callback The callback. Will be moved from only if it was registered.
+     * @return `true` if the callback was registered, `false` if the promise is already satisfied.
+     */
+    bool try_add_continuation(small_task& callback)
+    {
+        const std::scoped_lock lock(mutex);
+        if (ready)
+            return false;
+        continuations.push_back(std::move(callback));
+        return true;
+    }
+
+    /**
+     * @brief Invoke a function, store its returned value or any exception it throws in the promise, and then invoke all of the registered continuations.
+     *
+     * @tparam F The type of the function.
+     * @param func The function to invoke.
+     */
+    template <typename F>
+    void complete(F&& func)
+    {
+#ifdef __cpp_exceptions
+        try
+        {
+#endif
+            if constexpr (std::is_void_v<T>)
+            {
+                func();
+                promise.set_value();
+            }
+            else
+            {
+                promise.set_value(func());
+            }
+#ifdef __cpp_exceptions
+        }
+        catch (...)
+        {
+            try
+            {
+                promise.set_exception(std::current_exception());
+            }
+            catch (...)
+            {
+            }
+        }
+#endif
+        std::vector<small_task> to_run;
+        {
+            const std::scoped_lock lock(mutex);
+            ready = true;
+            to_run.swap(continuations);
+        }
+        for (small_task& continuation : to_run)
+            continuation();
+    }
+
+    /**
+     * @brief A shared future for the result, obtained from the promise.
+     */
+    std::shared_future<T> future;
+
+private:
+    /**
+     * @brief The continuations to invoke once the promise is satisfied.
+     */
+    std::vector<small_task> continuations;
+
+    /**
+     * @brief A mutex to synchronize access to the continuations and the ready flag.
+     */
+    std::mutex mutex;
+
+    /**
+     * @brief The promise which will store the result.
+     */
+    std::promise<T> promise;
+
+    /**
+     * @brief A flag indicating whether the promise has been satisfied and the continuations have been taken for invocation.
+     */
+    bool ready = false;
+}; // class continuation_state
+
+/**
+ * @brief A helper struct to obtain the return type of a continuation, which takes the result of the previous task as its argument, or no arguments if the previous task has no result.
+ *
+ * @tparam T The type of the result of the previous task.
+ * @tparam F The type of the continuation.
+ */
+template <typename T, typename F>
+struct continuation_result
+{
+    using type = std::invoke_result_t<std::decay_t<F>&, const T&>;
+};
+
+/**
+ * @brief A specialization of `continuation_result` for continuations of tasks with no result.
+ *
+ * @tparam F The type of the continuation.
+ */
+template <typename F>
+struct continuation_result<void, F>
+{
+    using type = std::invoke_result_t<std::decay_t<F>&>;
+};
+
+template <typename T>
+class continuable_future;
+
+/**
+ * @brief Combine a vector of `BS::continuable_future` objects into a single `BS::continuable_future` which becomes ready once all of them are ready. No thread waits for the futures; instead, the last future to become ready completes the combined future. If any of the futures stores an exception, the combined future will store the first such exception, in the order of the vector.
+ *
+ * @tparam T The type of the results of the futures (can be `void`).
+ * @param futures The futures to combine.
+ * @return A `BS::continuable_future` for the results of all the futures, in the same order, or a `BS::continuable_future<void>` if the futures have no results.
+ */
+template <typename T>
+[[nodiscard]] continuable_future<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> when_all(std::vector<continuable_future<T>> futures);
+
+/**
+ * @brief A future which, in addition to waiting for and getting the result, can be used to attach continuations which will be submitted to a thread pool once the result is ready, so that no thread needs to block waiting for it. Obtained from `submit_continuable()`, `then()`, `BS::when_all()`, or `BS::task_graph::run()`. Like `std::shared_future`, it can be copied, and the result can be obtained more than once.
+ *
+ * @tparam T The type of the result (can be `void`).
+ */
+template <typename T>
+class [[nodiscard]] continuable_future
+{
+public:
+    /**
+     * @brief Construct an empty `BS::continuable_future` with no shared state.
+     */
+    continuable_future() = default;
+
+    /**
+     * @brief Construct a `BS::continuable_future` from a shared state.
+     *
+     * @param state_ The shared state.
+     */
+    explicit continuable_future(std::shared_ptr<continuation_state<T>> state_) noexcept : state(std::move(state_)) {}
+
+    /**
+     * @brief Get the result, waiting for it if necessary, and rethrowing any stored exception.
+     *
+     * @return A constant reference to the result, or `void` if there is no result.
+     */
+    decltype(auto) get() const
+    {
+        return state->future.get();
+    }
+
+    /**
+     * @brief Check whether the result is ready.
+     *
+     * @return `true` if the result is ready, `false` otherwise.
+     */
+    [[nodiscard]] bool ready() const
+    {
+        return state->future.wait_for(std::chrono::duration<double>::zero()) == std::future_status::ready;
+    }
+
+    /**
+     * @brief Attach a continuation, which will be submitted to the given thread pool with the given priority once the result is ready, and which takes the result as its only argument (or no arguments if there is no result). If the result is already ready, the continuation is submitted immediately. If the result is an exception, the continuation is not invoked, and the exception is propagated to the returned future instead. Several continuations can be attached to the same future. The pool must not be destroyed before the continuation is submitted.
+     *
+     * @tparam OptFlags The template parameter of the thread pool.
+     * @tparam F The type of the continuation.
+     * @tparam R The return type of the continuation (can be `void`).
+     * @param pool The thread pool which will execute the continuation.
+     * @param func The continuation. Should take exactly one argument, a constant reference to the result, or no arguments if there is no result.
+     * @param priority The priority of the continuation. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter of the pool, otherwise has no effect.
+     * @return A `BS::continuable_future` for the result of the continuation.
+     */
+    template <opt_t OptFlags, typename F, typename R = typename continuation_result<T, F>::type>
+    [[nodiscard]] continuable_future<R> then(thread_pool<OptFlags>& pool, F&& func, const priority_t priority = 0) const
+    {
+        const std::shared_ptr<continuation_state<R>> next = std::make_shared<continuation_state<R>>();
+        state->add_continuation(
+            [&pool, priority, next, previous = state->future, func = std::forward<F>(func)]() mutable
+            {
+                pool.detach_task(
+                    [next, previous = std::move(previous), func = std::move(func)]() mutable
+                    {
+                        const auto continuation = [&previous, &func]() -> R
+                        {
+                            if constexpr (std::is_void_v<T>)
+                            {
+                                previous.get();
+                                return func();
+                            }
+                            else
+                            {
+                                return func(previous.get());
+                            }
+                        };
+                        next->complete(continuation);
+                    },
+                    priority);
+            });
+        return continuable_future<R>(next);
+    }
+
+#if defined(__cpp_impl_coroutine) && defined(__cpp_lib_coroutine)
+    /**
+     * @brief Check whether the result is ready, so a coroutine awaiting this future can continue without suspending. Together with `await_suspend()` and `await_resume()`, this allows using `co_await` on a `BS::continuable_future` in a coroutine.
+     *
+     * @return `true` if the result is ready, `false` otherwise.
+     */
+    [[nodiscard]] bool await_ready() const
+    {
+        return ready();
+    }
+
+    /**
+     * @brief Get the result once a coroutine awaiting this future has been resumed, rethrowing any stored exception.
+     *
+     * @return A constant reference to the result, or `void` if there is no result.
+     */
+    decltype(auto) await_resume() const
+    {
+        return get();
+    }
+
+    /**
+     * @brief Suspend a coroutine awaiting this future, and register it to be resumed by the thread that stores the result, which is typically a thread in the pool. No thread blocks waiting for the result.
+     *
+     * @param handle The handle of the coroutine to resume.
+     * @return `true` if the coroutine was suspended, `false` if the result became ready in the meantime, in which case the coroutine continues immediately.
+     */
+    bool await_suspend(const std::coroutine_handle<> handle) const
+    {
+        small_task resume = handle;
+        return state->try_add_continuation(resume);
+    }
+#endif
+
+    /**
+     * @brief Check if this `BS::continuable_future` has a shared state.
+     *
+     * @return `true` if it has a shared state, `false` otherwise.
+     */
+    [[nodiscard]] bool valid() const noexcept
+    {
+        return state && state->future.valid();
+    }
+
+    /**
+     * @brief Wait for the result to be ready.
+     */
+    void wait() const
+    {
+        state->future.wait();
+    }
+
+    /**
+     * @brief Wait for the result to be ready, but stop waiting after the specified duration has passed.
+     *
+     * @tparam R An arithmetic type representing the number of ticks to wait.
+     * @tparam P An `std::ratio` representing the length of each tick in seconds.
+     * @param duration The amount of time to wait.
+     * @return `true` if the result is ready, `false` otherwise.
+     */
+    template <typename R, typename P>
+    bool wait_for(const std::chrono::duration<R, P>& duration) const
+    {
+        return state->future.wait_for(duration) == std::future_status::ready;
+    }
+
+    /**
+     * @brief Wait for the result to be ready, but stop waiting after the specified time point has been reached.
+     *
+     * @tparam C The type of the clock used to measure time.
+     * @tparam D An `std::chrono::duration` type used to indicate the time point.
+     * @param timeout_time The time point at which to stop waiting.
+     * @return `true` if the result is ready, `false` otherwise.
+     */
+    template <typename C, typename D>
+    bool wait_until(const std::chrono::time_point<C, D>& timeout_time) const
+    {
+        return state->future.wait_until(timeout_time) == std::future_status::ready;
+    }
+
+private:
+    // `BS::when_all()` needs to register continuations on the shared state directly, without submitting them to a pool.
+    template <typename U>
+    friend continuable_future<std::conditional_t<std::is_void_v<U>, void, std::vector<U>>> when_all(std::vector<continuable_future<U>> futures);
+
+    /**
+     * @brief The shared state.
+     */
+    std::shared_ptr<continuation_state<T>> state = nullptr;
+}; // class continuable_future
+
+template <typename T>
+continuable_future<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> when_all(std::vector<continuable_future<T>> futures)
+{
+    using R = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+    const std::shared_ptr<continuation_state<R>> combined = std::make_shared<continuation_state<R>>();
+    const std::shared_ptr<std::vector<continuable_future<T>>> inputs = std::make_shared<std::vector<continuable_future<T>>>(std::move(futures));
+    const auto collect = [inputs]() -> R
+    {
+        if constexpr (std::is_void_v<T>)
+        {
+            for (const continuable_future<T>& future : *inputs)
+                future.get();
+        }
+        else
+        {
+            R results;
+            results.reserve(inputs->size());
+            for (const continuable_future<T>& future : *inputs)
+                results.push_back(future.get());
+            return results;
+        }
+    };
+    if (inputs->empty())
+    {
+        combined->complete(collect);
+    }
+    else
+    {
+        // Each callback keeps the inputs alive through `collect`; the reference cycle between the inputs and their callbacks is broken once each input becomes ready and discards its callbacks.
+        const std::shared_ptr<std::atomic<std::size_t>> remaining = std::make_shared<std::atomic<std::size_t>>(inputs->size());
+        for (const continuable_future<T>& future : *inputs)
+        {
+            future.state->add_continuation(
+                [combined, remaining, collect]()
+                {
+                    if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        combined->complete(collect);
+                });
+        }
+    }
+    return continuable_future<R>(combined);
+}
+
+/**
+ * @brief A class used to build a directed acyclic graph of tasks, where each task runs only after all of the tasks it depends on have finished, and then run the whole graph on a thread pool. Each task has an atomic counter of unfinished dependencies; whenever a task finishes, it decrements the counters of the tasks that depend on it, and submits those whose counters reach zero, so no thread ever blocks waiting for a dependency. Since a task can only depend on tasks that were added before it, the graph is guaranteed to be acyclic.
+ */
+class [[nodiscard]] task_graph
+{
+public:
+    /**
+     * @brief The type of the identifiers of the tasks in the graph, which are consecutive indices starting from 0, in the order the tasks were added.
+     */
+    using task_id = std::size_t;
+
+    /**
+     * @brief Add a task to the graph.
+     *
+     * @tparam F The type of the task.
+     * @param task The task to add. Should take no arguments and have no return value. If the graph is run more than once, the same task object will be invoked each time.
+     * @param dependencies The identifiers of the tasks that must finish before this task starts. Each one must be the identifier of a task already added to the graph. The default is no dependencies.
+     * @return The identifier of the new task.
+     */
+    template <typename F>
+    task_id add_task(F&& task, const std::initializer_list<task_id> dependencies = {})
+    {
+        return add_task(std::forward<F>(task), std::vector<task_id>(dependencies));
+    }
+
+    /**
+     * @brief Add a task to the graph, with the dependencies given as a vector.
+     *
+     * @tparam F The type of the task.
+     * @param task The task to add. Should take no arguments and have no return value. If the graph is run more than once, the same task object will be invoked each time.
+     * @param dependencies The identifiers of the tasks that must finish before this task starts. Each one must be the identifier of a task already added to the graph.
+     * @return The identifier of the new task.
+     */
+    template <typename F>
+    task_id add_task(F&& task, const std::vector<task_id>& dependencies)
+    {
+        const task_id id = nodes->size();
+        for (const task_id dependency : dependencies)
+            (*nodes)[dependency].successors.push_back(id);
+        nodes->push_back({std::forward<F>(task), {}, dependencies.size()});
+        return id;
+    }
+
+    /**
+     * @brief Get the number of tasks in the graph.
+     *
+     * @return The number of tasks.
+     */
+    [[nodiscard]] std::size_t get_task_count() const noexcept
+    {
+        return nodes->size();
+    }
+
+    /**
+     * @brief Run the graph on a thread pool. The tasks with no dependencies are submitted immediately as a single batch, and every other task is submitted once its last dependency finishes; a task whose dependency has just finished and which is ready to run may be executed directly by the same thread, rather than submitted to the queue. If any task throws an exception, the tasks that have not yet started are skipped, and the returned future will store the first exception thrown. The graph object itself may be destroyed while it is running, but tasks must not be added to it until the returned future is ready. The graph may be run again, including concurrently, as long as its tasks can be safely invoked concurrently.
+     *
+     * @tparam OptFlags The template parameter of the thread pool.
+     * @param pool The thread pool which will execute the tasks. Must not be destroyed before the returned future is ready.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter of the pool, otherwise has no effect.
+     * @return A `BS::continuable_future<void>` which becomes ready once all the tasks have finished.
+     */
+    template <opt_t OptFlags>
+    [[nodiscard]] continuable_future<void> run(thread_pool<OptFlags>& pool, const priority_t priority = 0) const
+    {
+        const std::shared_ptr<run_state> state = std::make_shared<run_state>(nodes);
+        continuable_future<void> future(state->done);
+        if (nodes->empty())
+        {
+            state->done->complete([] {});
+            return future;
+        }
+        std::vector<task_id> roots;
+        for (task_id id = 0; id < nodes->size(); ++id)
+        {
+            if ((*nodes)[id].num_dependencies == 0)
+                roots.push_back(id);
+        }
+        pool.detach_batch(
+            roots.size(),
+            [&pool, &state, &roots, priority](const std::size_t i)
+            {
+                return [&pool, state, id = roots[i], priority]
+                {
+                    execute(pool, state, id, priority);
+                };
+            },
+            priority);
+        return future;
+    }
+
+private:
+    /**
+     * @brief A helper struct to store a task in the graph, along with the identifiers of the tasks that depend on it and its number of dependencies.
+     */
+    struct node
+    {
+        small_task task;
+        std::vector<task_id> successors;
+        std::size_t num_dependencies = 0;
+    };
+
+    /**
+     * @brief A helper struct to store the state of a single run of the graph: the counters of unfinished dependencies for each task, the number of unfinished tasks, the first exception thrown, and the shared state of the returned future.
+     */
+    struct run_state
+    {
+        explicit run_state(std::shared_ptr<std::vector<node>> nodes_) : nodes(std::move(nodes_)), remaining(nodes->size()), unfinished(nodes->size())
+        {
+            for (std::size_t id = 0; id < nodes->size(); ++id)
+                remaining[id].store((*nodes)[id].num_dependencies, std::memory_order_relaxed);
+        }
+
+        std::shared_ptr<continuation_state<void>> done = std::make_shared<continuation_state<void>>();
+#ifdef __cpp_exceptions
+        std::exception_ptr exception = nullptr;
+#endif
+        std::atomic<bool> failed = false;
+        std::shared_ptr<std::vector<node>> nodes;
+        std::vector<std::atomic<std::size_t>> remaining;
+        std::atomic<std::size_t> unfinished;
+    };
+
+    /**
+     * @brief Execute a task, and then release the tasks that depend on it. All but one of the tasks that become ready are submitted to the pool, and the last one is executed directly by the same thread, so a chain of dependent tasks runs without going through the queue. The last task to finish completes the future returned by `run()`.
+     *
+     * @tparam OptFlags The template parameter of the thread pool.
+     * @param pool The thread pool which executes the tasks.
+     * @param state The state of the run.
+     * @param id The identifier of the task to execute.
+     * @param priority The priority used to submit the tasks that become ready.
+     */
+    template <opt_t OptFlags>
+    static void execute(thread_pool<OptFlags>& pool, const std::shared_ptr<run_state>& state, task_id id, const priority_t priority)
+    {
+        while (true)
+        {
+            node& current = (*state->nodes)[id];
+            if (!state->failed.load(std::memory_order_acquire))
+            {
+#ifdef __cpp_exceptions
+                try
+                {
+#endif
+                    current.task();
+#ifdef __cpp_exceptions
+                }
+                catch (...)
+                {
+                    if (!state->failed.exchange(true, std::memory_order_acq_rel))
+                        state->exception = std::current_exception();
+                }
+#endif
+            }
+            bool has_next = false;
+            task_id next = 0;
+            for (const task_id successor : current.successors)
+            {
+                if (state->remaining[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    if (has_next)
+                    {
+                        pool.detach_task(
+                            [&pool, state, next, priority]
+                            {
+                                execute(pool, state, next, priority);
+                            },
+                            priority);
+                    }
+                    has_next = true;
+                    next = successor;
+                }
+            }
+            if (state->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                state->done->complete(
+                    [&state]
+                    {
+#ifdef __cpp_exceptions
+                        if (state->exception)
+                            std::rethrow_exception(state->exception);
+#endif
+                    });
+            }
+            if (!has_next)
+                return;
+            id = next;
+        }
+    }
+
+    /**
+     * @brief The tasks in the graph. Stored in a shared pointer so that a run can keep them alive even if the graph object is destroyed.
+     */
+    std::shared_ptr<std::vector<node>> nodes = std::make_shared<std::vector<node>>();
+}; // class task_graph
+
+#if defined(__cpp_impl_coroutine) && defined(__cpp_lib_coroutine)
+template <typename T>
+class task;
+
+/**
+ * @brief A helper class containing the parts of the promise type of `BS::task` which do not depend on the type of the result: the awaiters used when the coroutine starts and finishes, the coroutine to resume when it finishes, and the exception it threw, if any.
+ */
+class [[nodiscard]] task_promise_base
+{
+public:
+    /**
+     * @brief A helper struct used to notify a thread which called `get()` on a `BS::task` that the coroutine has finished.
+     */
+    struct waiter
+    {
+        std::condition_variable cv;
+        bool done = false;
+        std::mutex mutex;
+    };
+
+    /**
+     * @brief The awaiter used when the coroutine finishes. It resumes the coroutine awaiting the task, if any, using symmetric transfer, so that no stack space is consumed; otherwise, it notifies the thread which called `get()`.
+     */
+    struct final_awaiter
+    {
+        [[nodiscard]] bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template <typename P>
+        std::coroutine_handle<> await_suspend(const std::coroutine_handle<P> handle) const noexcept
+        {
+            task_promise_base& promise = handle.promise();
+            if (promise.continuation)
+                return promise.continuation;
+            if (promise.sync_waiter != nullptr)
+            {
+                // We notify while holding the lock, since the waiter may be destroyed as soon as the waiting thread sees that the coroutine is done.
+                const std::scoped_lock lock(promise.sync_waiter->mutex);
+                promise.sync_waiter->done = true;
+                promise.sync_waiter->cv.notify_all();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    /**
+     * @brief Suspend the coroutine when it is first created, so that it only starts running when it is awaited or when `get()` is called.
+     *
+     * @return An awaiter which always suspends.
+     */
+    [[nodiscard]] std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    /**
+     * @brief Get the awaiter used when the coroutine finishes.
+     *
+     * @return The awaiter.
+     */
+    [[nodiscard]] final_awaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    /**
+     * @brief Store an exception thrown by the coroutine, to be rethrown when the result is obtained.
+     */
+    void unhandled_exception() noexcept
+    {
+#ifdef __cpp_exceptions
+        exception = std::current_exception();
+#endif
+    }
+
+    /**
+     * @brief The coroutine to resume when this coroutine finishes, or a null handle if none.
+     */
+    std::coroutine_handle<> continuation = nullptr;
+
+#ifdef __cpp_exceptions
+    /**
+     * @brief The exception thrown by the coroutine, if any.
+     */
+    std::exception_ptr exception = nullptr;
+#endif
+
+    /**
+     * @brief A pointer to the waiter to notify when the coroutine finishes, if `get()` was called, or `nullptr` otherwise.
+     */
+    waiter* sync_waiter = nullptr;
+
+protected:
+    /**
+     * @brief Rethrow the exception thrown by the coroutine, if any.
+     */
+    void rethrow_if_exception() const
+    {
+#ifdef __cpp_exceptions
+        if (exception)
+            std::rethrow_exception(exception);
+#endif
+    }
+}; // class task_promise_base
+
+/**
+ * @brief The promise type of `BS::task<T>`, which stores the value returned by the coroutine.
+ *
+ * @tparam T The type of the result.
+ */
+template <typename T>
+class [[nodiscard]] task_promise : public task_promise_base
+{
+public:
+    /**
+     * @brief Create the `BS::task` object returned to the caller of the coroutine.
+     *
+     * @return The task.
+     */
+    task<T> get_return_object() noexcept
+    {
+        return task<T>(std::coroutine_handle<task_promise>::from_promise(*this));
+    }
+
+    /**
+     * @brief Store the value returned by the coroutine using `co_return`.
+     *
+     * @tparam U The type of the value.
+     * @param value The value.
+     */
+    template <typename U = T, typename = std::enable_if_t<std::is_convertible_v<U, T>>>
+    void return_value(U&& value)
+    {
+        result.emplace(std::forward<U>(value));
+    }
+
+    /**
+     * @brief Move the result out of the promise, rethrowing the exception thrown by the coroutine, if any.
+     *
+     * @return The result.
+     */
+    T take_result()
+    {
+        rethrow_if_exception();
+        return std::move(*result);
+    }
+
+private:
+    /**
+     * @brief The value returned by the coroutine, if it has finished without throwing an exception.
+     */
+    std::optional<T> result = std::nullopt;
+}; // class task_promise
+
+/**
+ * @brief A specialization of `task_promise` for coroutines with no result.
+ */
+template <>
+class [[nodiscard]] task_promise<void> : public task_promise_base
+{
+public:
+    /**
+     * @brief Create the `BS::task` object returned to the caller of the coroutine.
+     *
+     * @return The task.
+     */
+    task<void> get_return_object() noexcept;
+
+    /**
+     * @brief Called when the coroutine finishes using `co_return;` or by reaching the end of its body.
+     */
+    void return_void() const noexcept {}
+
+    /**
+     * @brief Rethrow the exception thrown by the coroutine, if any.
+     */
+    void take_result() const
+    {
+        rethrow_if_exception();
+    }
+}; // class task_promise<void>
+
+/**
+ * @brief A coroutine return type. A coroutine returning `BS::task<T>` does not start running when called; instead, it starts when it is awaited using `co_await` from another coroutine, or when `get()` is called from a regular function, and it then runs in the thread that started it until it suspends. Typically, the coroutine will use `co_await pool.schedule()` to continue running in one of the threads of a `BS::thread_pool`. When it finishes, the coroutine awaiting it is resumed in the same thread, without going through the queue. A task is move-only, and its result can only be obtained once. Only available if C++20 coroutines are supported.
+ *
+ * @tparam T The type of the result (can be `void`).
+ */
+template <typename T = void>
+class [[nodiscard]] task
+{
+public:
+    /**
+     * @brief The promise type of the coroutine.
+     */
+    using promise_type = task_promise<T>;
+
+    /**
+     * @brief Construct a task from a coroutine handle. Used by the promise type; not meant to be used directly.
+     *
+     * @param handle_ The handle of the coroutine.
+     */
+    explicit task(const std::coroutine_handle<promise_type> handle_) noexcept : handle(handle_) {}
+
+    // The copy constructor and copy assignment operator are deleted. A task can only be moved.
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    /**
+     * @brief Move-construct a task. The other task will be left empty.
+     *
+     * @param other The task to move.
+     */
+    task(task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    /**
+     * @brief Move-assign a task. The other task will be left empty.
+     *
+     * @param other The task to move.
+     * @return A reference to this task.
+     */
+    task& operator=(task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+                handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Destruct the task, destroying the coroutine frame. The coroutine must not be running at this point.
+     */
+    ~task()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    /**
+     * @brief Check whether the coroutine has finished, so a coroutine awaiting this task can continue without suspending. Together with `await_suspend()` and `await_resume()`, this allows using `co_await` on a `BS::task` in another coroutine.
+     *
+     * @return `true` if the coroutine has finished, `false` otherwise.
+     */
+    [[nodiscard]] bool await_ready() const noexcept
+    {
+        return handle.done();
+    }
+
+    /**
+     * @brief Get the result once the awaiting coroutine has been resumed, rethrowing any exception thrown by the coroutine.
+     *
+     * @return The result.
+     */
+    T await_resume()
+    {
+        return handle.promise().take_result();
+    }
+
+    /**
+     * @brief Start the coroutine, and register the awaiting coroutine to be resumed when it finishes. Uses symmetric transfer, so that the stack does not grow even if many tasks await each other.
+     *
+     * @param awaiting The handle of the awaiting coroutine.
+     * @return The handle of this coroutine, which will be resumed immediately.
+     */
+    std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    /**
+     * @brief Start the coroutine if it has not been started yet, block the calling thread until it finishes, and get its result, rethrowing any exception thrown by the coroutine. This is meant to be called from regular functions, such as `main()`; within a coroutine, use `co_await` instead. Must not be called from within a thread of the pool that the coroutine is running on, otherwise it may deadlock.
+     *
+     * @return The result.
+     */
+    T get()
+    {
+        if (!handle.done())
+        {
+            task_promise_base::waiter sync_waiter;
+            handle.promise().sync_waiter = &sync_waiter;
+            handle.resume();
+            std::unique_lock lock(sync_waiter.mutex);
+            sync_waiter.cv.wait(lock,
+                [&sync_waiter]
+                {
+                    return sync_waiter.done;
+                });
+        }
+        return handle.promise().take_result();
+    }
+
+    /**
+     * @brief Check if this task has a coroutine.
+     *
+     * @return `true` if it has a coroutine, `false` if it is empty.
+     */
+    [[nodiscard]] bool valid() const noexcept
+    {
+        return static_cast<bool>(handle);
+    }
+
+private:
+    /**
+     * @brief The handle of the coroutine.
+     */
+    std::coroutine_handle<promise_type> handle = nullptr;
+}; // class task
+
+inline task<void> task_promise<void>::get_return_object() noexcept
+{
+    return task<void>(std::coroutine_handle<task_promise>::from_promise(*this));
+}
+#endif
+
+/**
+ * @brief A helper class to divide a range into blocks. Used by `detach_blocks()`, `submit_blocks()`, `detach_loop()`, and `submit_loop()`.
+ *
+ * @tparam T The type of the indices. Should be a signed or unsigned integer.
+ */
+template <typename T>
+class [[nodiscard]] blocks
+{
+public:
+    /**
+     * @brief Construct a `blocks` object with the given specifications.
+     *
+     * @param first_index_ The first index in the range.
+     * @param index_after_last_ The index after the last index in the range.
+     * @param num_blocks_ The desired number of blocks to divide the range into.
+     */
+    blocks(const T first_index_, const T index_after_last_, const std::size_t num_blocks_) noexcept : first_index(first_index_), index_after_last(index_after_last_), num_blocks(num_blocks_)
+    {
+        if (index_after_last > first_index)
+        {
+            const std::size_t total_size = static_cast<std::size_t>(index_after_last - first_index);
+            num_blocks = std::min(num_blocks, total_size);
+            block_size = total_size / num_blocks;
+            remainder = total_size % num_blocks;
+            if (block_size == 0)
+            {
+                block_size = 1;
+                num_blocks = (total_size > 1) ? total_size : 1;
+            }
+        }
+        else
+        {
+            num_blocks = 0;
+        }
+    }
+
+    /**
+     * @brief Get the index after the last index of a block.
+     *
+     * @param block The block number.
+     * @return The index after the last index.
+     */
+    [[nodiscard]] T end(const std::size_t block) const noexcept
+    {
+        return (block == num_blocks - 1) ? index_after_last : start(block + 1);
+    }
+
+    /**
+     * @brief Get the number of blocks. Note that this may be different than the desired number of blocks that was passed to the constructor.
+     *
+     * @return The number of blocks.
+     */
+    [[nodiscard]] std::size_t get_num_blocks() const noexcept
+    {
+        return num_blocks;
+    }
+
+    /**
+     * @brief Get the first index of a block.
+     *
+     * @param block The block number.
+     * @return The first index.
+     */
+    [[nodiscard]] T start(const std::size_t block) const noexcept
+    {
+        return static_cast<T>(first_index + static_cast<T>(block * block_size) + static_cast<T>(block < remainder ? block : remainder));
+    }
+
+private:
+    /**
+     * @brief The size of each block (except possibly the last block).
+     */
+    std::size_t block_size = 0;
+
+    /**
+     * @brief The first index in the range.
+     */
+    T first_index = 0;
+
+    /**
+     * @brief The index after the last index in the range.
+     */
+    T index_after_last = 0;
+
+    /**
+     * @brief The number of blocks.
+     */
+    std::size_t num_blocks = 0;
+
+    /**
+     * @brief The remainder obtained after dividing the total size by the number of blocks.
+     */
+    std::size_t remainder = 0;
+}; // class blocks
+
+/**
+ * @brief The assumed size of a cache line, in bytes, used to align data that is frequently written by different threads in order to avoid false sharing. We do not use `std::hardware_destructive_interference_size`, since its value may differ between compiler flags and is therefore not safe to use in a header file (GCC warns about this explicitly).
+ */
+inline constexpr std::size_t cache_line_size = 64;
+
+/**
+ * @brief An enum containing the scheduling policies that can be used to parallelize loops, analogous to the `schedule` clause in OpenMP.
+ */
+enum class schedule : std::uint8_t
+{
+    /**
+     * @brief Divide the range into blocks of equal size in advance, and submit each block as a separate task. This is the default used by the overloads of the loop functions that do not take a scheduling policy.
+     */
+    static_blocks,
+
+    /**
+     * @brief Submit one task per thread, each of which repeatedly claims the next chunk of a fixed size from a shared counter until the range is exhausted.
+     */
+    dynamic,
+
+    /**
+     * @brief Same as `dynamic`, but the size of each chunk is proportional to the number of indices remaining, so it starts large and shrinks as the range drains, down to a minimum size.
+     */
+    guided
+};
+
+/**
+ * @brief A helper class to divide a range into chunks which are claimed by the threads one by one from a shared counter, according to the `BS::schedule::dynamic` or `BS::schedule::guided` scheduling policy. Used by the overloads of `detach_blocks()`, `submit_blocks()`, `detach_loop()`, and `submit_loop()` that take a scheduling policy.
+ *
+ * @tparam T The type of the indices. Should be a signed or unsigned integer.
+ */
+template <typename T>
+class [[nodiscard]] dynamic_blocks
+{
+public:
+    /**
+     * @brief Construct a `dynamic_blocks` object with the given specifications.
+     *
+     * @param first_index_ The first index in the range.
+     * @param index_after_last_ The index after the last index in the range.
+     * @param policy_ The scheduling policy. Should be either `BS::schedule::dynamic` or `BS::schedule::guided`.
+     * @param chunk_size_ For `BS::schedule::dynamic`, the size of each chunk. For `BS::schedule::guided`, the minimum size of each chunk. If 0, the size will be chosen automatically.
+     * @param num_threads The number of threads in the pool, used to determine the number of tasks and the automatic chunk size.
+     */
+    dynamic_blocks(const T first_index_, const T index_after_last_, const schedule policy_, const std::size_t chunk_size_, const std::size_t num_threads) noexcept : first_index(first_index_), policy(policy_)
+    {
+        if (index_after_last_ > first_index)
+        {
+            total_size = static_cast<std::size_t>(index_after_last_ - first_index);
+            chunk_size = chunk_size_;
+            if (chunk_size == 0)
+                chunk_size = (policy == schedule::dynamic) ? std::max<std::size_t>(total_size / (num_threads * 8), 1) : 1;
+            num_tasks = std::max<std::size_t>(std::min(num_threads, (total_size + chunk_size - 1) / chunk_size), 1);
+        }
+    }
+
+    // The copy and move constructors and assignment operators are deleted. The shared counter cannot be copied or moved.
+    dynamic_blocks(const dynamic_blocks&) = delete;
+    dynamic_blocks(dynamic_blocks&&) = delete;
+    dynamic_blocks& operator=(const dynamic_blocks&) = delete;
+    dynamic_blocks& operator=(dynamic_blocks&&) = delete;
+    ~dynamic_blocks() = default;
+
+    /**
+     * @brief Get the number of tasks that should be submitted to process the range, each of which will claim chunks until the range is exhausted. This will never be larger than the number of threads.
+     *
+     * @return The number of tasks.
+     */
+    [[nodiscard]] std::size_t get_num_tasks() const noexcept
+    {
+        return num_tasks;
+    }
+
+    /**
+     * @brief Claim the next chunk of the range. Can be called concurrently from multiple threads; each index in the range will be claimed exactly once.
+     *
+     * @param start A reference to the variable that will store the first index in the chunk.
+     * @param end A reference to the variable that will store the index after the last index in the chunk.
+     * @return `true` if a chunk was claimed, `false` if the range is exhausted.
+     */
+    bool next(T& start, T& end) noexcept
+    {
+        std::size_t begin = 0;
+        std::size_t size = 0;
+        if (policy == schedule::dynamic)
+        {
+            begin = cursor.fetch_add(chunk_size, std::memory_order_relaxed);
+            if (begin >= total_size)
+                return false;
+            size = std::min(chunk_size, total_size - begin);
+        }
+        else
+        {
+            begin = cursor.load(std::memory_order_relaxed);
+            do
+            {
+                if (begin >= total_size)
+                    return false;
+                const std::size_t remaining = total_size - begin;
+                size = std::min(std::max(chunk_size, remaining / (num_tasks * 2)), remaining);
+            } while (!cursor.compare_exchange_weak(begin, begin + size, std::memory_order_relaxed));
+        }
+        start = static_cast<T>(first_index + static_cast<T>(begin));
+        end = static_cast<T>(start + static_cast<T>(size));
+        return true;
+    }
+
+private:
+    /**
+     * @brief The offset, from the first index, of the next chunk to be claimed. Aligned to a cache line, since it is written by all the threads.
+     */
+    alignas(cache_line_size) std::atomic<std::size_t> cursor = 0;
+
+    /**
+     * @brief For `BS::schedule::dynamic`, the size of each chunk. For `BS::schedule::guided`, the minimum size of each chunk.
+     */
+    alignas(cache_line_size) std::size_t chunk_size = 1;
+
+    /**
+     * @brief The first index in the range.
+     */
+    T first_index = 0;
+
+    /**
+     * @brief The number of tasks that should be submitted to process the range.
+     */
+    std::size_t num_tasks = 0;
+
+    /**
+     * @brief The scheduling policy.
+     */
+    schedule policy = schedule::dynamic;
+
+    /**
+     * @brief The total number of indices in the range.
+     */
+    std::size_t total_size = 0;
+}; // class dynamic_blocks
+
+/**
+ * @brief A bounded lock-free multi-producer multi-consumer queue, implemented as a ring buffer in which each slot has its own sequence number (Dmitry Vyukov's algorithm). Used as the global task queue if the flag `BS::tp::lock_free` is enabled in the template parameter of `BS::thread_pool`.
+ *
+ * @tparam T The type of the elements. Must be default-constructible and move-assignable.
+ */
+template <typename T>
+class [[nodiscard]] mpmc_queue
+{
+public:
+    /**
+     * @brief The default capacity of the queue.
+     */
+    static constexpr std::size_t default_capacity = 4096;
+
+    /**
+     * @brief Construct a new queue with the default capacity.
+     */
+    mpmc_queue() : mpmc_queue(default_capacity) {}
+
+    /**
+     * @brief Construct a new queue with the given capacity.
+     *
+     * @param capacity_ The maximum number of elements in the queue. Will be rounded up to a power of 2.
+     */
+    explicit mpmc_queue(const std::size_t capacity_)
+    {
+        std::size_t capacity = 2;
+        while (capacity < capacity_)
+            capacity <<= 1U;
+        mask = capacity - 1;
+        slots = std::make_unique<slot[]>(capacity);
+        for (std::size_t i = 0; i < capacity; ++i)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // The copy and move constructors and assignment operators are deleted. The queue cannot be copied or moved.
+    mpmc_queue(const mpmc_queue&) = delete;
+    mpmc_queue(mpmc_queue&&) = delete;
+    mpmc_queue& operator=(const mpmc_queue&) = delete;
+    mpmc_queue& operator=(mpmc_queue&&) = delete;
+    ~mpmc_queue() = default;
+
+    /**
+     * @brief Get the maximum number of elements in the queue.
+     *
+     * @return The capacity.
+     */
+    [[nodiscard]] std::size_t capacity() const noexcept
+    {
+        return mask + 1;
+    }
+
+    /**
+     * @brief Check whether the queue is empty. The result may be outdated by the time it is used if other threads are accessing the queue concurrently.
+     *
+     * @return `true` if the queue is empty, `false` otherwise.
+     */
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    /**
+     * @brief Get the number of elements in the queue. The result may be outdated by the time it is used if other threads are accessing the queue concurrently. Elements that are in the process of being pushed are already counted.
+     *
+     * @return The number of elements.
+     */
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        const std::size_t dequeued = dequeue_pos.load();
+        const std::size_t enqueued = enqueue_pos.load();
+        return (enqueued > dequeued) ? (enqueued - dequeued) : 0;
+    }
+
+    /**
+     * @brief Try to pop an element from the front of the queue, without blocking.
+     *
+     * @param value A reference to the object that will store the element, if the queue was not empty.
+     * @return `true` if an element was popped, `false` if the queue was empty.
+     */
+    bool try_pop(T& value)
+    {
+        std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            slot& current = slots[pos & mask];
+            const std::size_t sequence = current.sequence.load(std::memory_order_acquire);
+            if (sequence == pos + 1)
+            {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(current.value);
+                    current.value = T();
+                    current.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < pos + 1)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Try to push an element to the back of the queue, without blocking. If the queue is full, the argument is left untouched, so it can still be used by the caller.
+     *
+     * @tparam U The type of the element.
+     * @param value The element to push.
+     * @return `true` if the element was pushed, `false` if the queue was full.
+     */
+    template <typename U>
+    bool try_push(U&& value)
+    {
+        std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            slot& current = slots[pos & mask];
+            const std::size_t sequence = current.sequence.load(std::memory_order_acquire);
+            if (sequence == pos)
+            {
+                // Note: This compare-exchange is sequentially consistent, which is what allows the thread pool to check for idle workers after pushing without locking a mutex.
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1))
+                {
+                    current.value = std::forward<U>(value);
+                    current.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < pos)
+            {
+                return false;
+            }
+            else
+            {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    /**
+     * @brief A helper struct to store a single slot of the ring buffer.
+     */
+    struct slot
+    {
+        /**
+         * @brief The sequence number of the slot, used to determine whether it is ready to be written to or read from.
+         */
+        std::atomic<std::size_t> sequence = 0;
+
+        /**
+         * @brief The element stored in the slot.
+         */
+        T value = T();
+    }; // struct slot
+
+    /**
+     * @brief The position of the next element to pop. Aligned to a cache line, so that consumers and producers do not contend with each other.
+     */
+    alignas(cache_line_size) std::atomic<std::size_t> dequeue_pos = 0;
+
+    /**
+     * @brief The position of the next element to push. Aligned to a cache line, so that consumers and producers do not contend with each other.
+     */
+    alignas(cache_line_size) std::atomic<std::size_t> enqueue_pos = 0;
+
+    /**
+     * @brief A bitmask used to convert positions to slot indices. Equal to the capacity minus one.
+     */
+    alignas(cache_line_size) std::size_t mask = 0;
+
+    /**
+     * @brief A smart pointer to manage the memory allocated for the slots.
+     */
+    std::unique_ptr<slot[]> slots = nullptr;
+}; // class mpmc_queue
+
+#ifdef __cpp_exceptions
+/**
+ * @brief An exception that will be thrown by `wait()`, `wait_for()`, and `wait_until()` if the user tries to call them from within a thread of the same pool, which would result in a deadlock. Only used if the flag `BS:tp::wait_deadlock_checks` is enabled in the template parameter of `BS::thread_pool`.
+ */
+struct wait_deadlock : public std::runtime_error
+{
+    wait_deadlock() : std::runtime_error("BS::wait_deadlock") {};
+};
+
+/**
+ * @brief An exception stored in the future of a task submitted with a `BS::stop_condition`, or thrown by the task itself, if the task is dropped because stop was requested or its deadline passed before it started executing.
+ */
+struct task_cancelled : public std::runtime_error
+{
+    task_cancelled() : std::runtime_error("BS::task_cancelled") {};
+};
+#endif
+
+/**
+ * @brief A class holding the conditions under which a task should stop: a deadline, and in C++20 and later, an `std::stop_token`. Tasks submitted with a stop condition are dropped without being executed if stop was requested or the deadline has passed by the time a thread takes them out of the queue, and while they are running, they can check the condition using `BS::this_thread::stop_requested()` in order to exit early. The same stop condition, or stop conditions sharing the same `std::stop_source`, can be used for many tasks, to cancel all of them at once. A default-constructed stop condition never stops.
+ */
+class [[nodiscard]] stop_condition
+{
+public:
+    /**
+     * @brief Construct a stop condition that never stops.
+     */
+    stop_condition() noexcept = default;
+
+    /**
+     * @brief Construct a stop condition with a deadline.
+     *
+     * @param deadline_ The time point after which tasks with this stop condition should stop.
+     */
+    stop_condition(const std::chrono::steady_clock::time_point deadline_) noexcept : deadline(deadline_) {} // NOLINT(google-explicit-constructor, hicpp-explicit-conversions) This constructor must be implicit so that a deadline can be passed directly wherever a stop condition is expected.
+
+#ifdef __cpp_lib_jthread
+    /**
+     * @brief Construct a stop condition with a stop token. Only available in C++20 and later.
+     *
+     * @param token_ The stop token. Tasks with this stop condition should stop once stop is requested on the associated `std::stop_source`.
+     */
+    stop_condition(std::stop_token token_) noexcept : token(std::move(token_)) {} // NOLINT(google-explicit-constructor, hicpp-explicit-conversions) This constructor must be implicit so that a stop token can be passed directly wherever a stop condition is expected.
+
+    /**
+     * @brief Construct a stop condition with a stop token and a deadline. Only available in C++20 and later.
+     *
+     * @param token_ The stop token. Tasks with this stop condition should stop once stop is requested on the associated `std::stop_source`.
+     * @param deadline_ The time point after which tasks with this stop condition should stop.
+     */
+    stop_condition(std::stop_token token_, const std::chrono::steady_clock::time_point deadline_) noexcept : deadline(deadline_), token(std::move(token_)) {}
+#endif
+
+    /**
+     * @brief Get the deadline of this stop condition.
+     *
+     * @return The deadline, or `std::chrono::steady_clock::time_point::max()` if there is no deadline.
+     */
+    [[nodiscard]] std::chrono::steady_clock::time_point get_deadline() const noexcept
+    {
+        return deadline;
+    }
+
+#ifdef __cpp_lib_jthread
+    /**
+     * @brief Get the stop token of this stop condition. Only available in C++20 and later.
+     *
+     * @return The stop token. If the stop condition was constructed without one, the token has no associated stop state.
+     */
+    [[nodiscard]] const std::stop_token& get_stop_token() const noexcept
+    {
+        return token;
+    }
+#endif
+
+    /**
+     * @brief Check whether tasks with this stop condition should stop, that is, whether stop was requested on the stop token, if any, or the deadline has passed, if there is one.
+     *
+     * @return `true` if tasks should stop, `false` otherwise.
+     */
+    [[nodiscard]] bool stop_requested() const noexcept
+    {
+#ifdef __cpp_lib_jthread
+        if (token.stop_requested())
+            return true;
+#endif
+        return (deadline != std::chrono::steady_clock::time_point::max()) && (std::chrono::steady_clock::now() >= deadline);
+    }
+
+private:
+    /**
+     * @brief The time point after which tasks should stop.
+     */
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+#ifdef __cpp_lib_jthread
+    /**
+     * @brief The stop token, if any.
+     */
+    std::stop_token token;
+#endif
+}; // class stop_condition
+
+#ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
+    #if defined(_WIN32)
+/**
+ * @brief An enum containing pre-defined OS-specific process priority values for portability.
+ */
+enum class os_process_priority
+{
+    idle = IDLE_PRIORITY_CLASS,
+    below_normal = BELOW_NORMAL_PRIORITY_CLASS,
+    normal = NORMAL_PRIORITY_CLASS,
+    above_normal = ABOVE_NORMAL_PRIORITY_CLASS,
+    high = HIGH_PRIORITY_CLASS,
+    realtime = REALTIME_PRIORITY_CLASS
+};
+
+/**
+ * @brief An enum containing pre-defined OS-specific thread priority values for portability.
+ */
+enum class os_thread_priority
+{
+    idle = THREAD_PRIORITY_IDLE,
+    lowest = THREAD_PRIORITY_LOWEST,
+    below_normal = THREAD_PRIORITY_BELOW_NORMAL,
+    normal = THREAD_PRIORITY_NORMAL,
+    above_normal = THREAD_PRIORITY_ABOVE_NORMAL,
+    highest = THREAD_PRIORITY_HIGHEST,
+    realtime = THREAD_PRIORITY_TIME_CRITICAL
+};
+    #elif defined(__linux__) || defined(__APPLE__)
+/**
+ * @brief An enum containing pre-defined OS-specific process priority values for portability.
+ */
+enum class os_process_priority
+{
+    idle = PRIO_MAX - 2,
+    below_normal = PRIO_MAX / 2,
+    normal = 0,
+    above_normal = PRIO_MIN / 3,
+    high = PRIO_MIN * 2 / 3,
+    realtime = PRIO_MIN
+};
+
+/**
+ * @brief An enum containing pre-defined OS-specific thread priority values for portability.
+ */
+enum class os_thread_priority
+{
+    idle,
+    lowest,
+    below_normal,
+    normal,
+    above_normal,
+    highest,
+    realtime
+};
+    #endif
+
+/**
+ * @brief Get the processor affinity of the current process using the current platform's native API. This should work on Windows and Linux, but is not possible on macOS as the native API does not allow it.
+ *
+ * @return An `std::optional` object, optionally containing the processor affinity of the current process as an `std::vector<bool>` where each element corresponds to a logical processor. If the returned object does not contain a value, then the affinity could not be determined. On macOS, this function always returns `std::nullopt`.
+ */
+[[nodiscard]] inline std::optional<std::vector<bool>> get_os_process_affinity()
+{
+    #if defined(_WIN32)
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR system_mask = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) == 0)
+        return std::nullopt;
+        #ifdef __cpp_lib_int_pow2
+    const std::size_t num_cpus = static_cast<std::size_t>(std::bit_width(system_mask));
+        #else
+    std::size_t num_cpus = 0;
+    if (system_mask != 0)
+    {
+        num_cpus = 1;
+        while ((system_mask >>= 1U) != 0U)
+            ++num_cpus;
+    }
+        #endif
+    std::vector<bool> affinity(num_cpus);
+    for (std::size_t i = 0; i < num_cpus; ++i)
+        affinity[i] = ((process_mask & (1ULL << i)) != 0ULL);
+    return affinity;
+    #elif defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(getpid(), sizeof(cpu_set_t), &cpu_set) != 0)
+        return std::nullopt;
+    const int num_cpus = get_nprocs();
+    if (num_cpus < 1)
+        return std::nullopt;
+    std::vector<bool> affinity(static_cast<std::size_t>(num_cpus));
+    for (std::size_t i = 0; i < affinity.size(); ++i)
+        affinity[i] = CPU_ISSET(i, &cpu_set);
+    return affinity;
+    #elif defined(__APPLE__)
+    return std::nullopt;
+    #endif
+}
+
+/**
+ * @brief Set the processor affinity of the current process using the current platform's native API. This should work on Windows and Linux, but is not possible on macOS as the native API does not allow it.
+ *
+ * @param affinity The processor affinity to set, as an `std::vector<bool>` where each element corresponds to a logical processor.
+ * @return `true` if the affinity was set successfully, `false` otherwise. On macOS, this function always returns `false`.
+ */
+inline bool set_os_process_affinity(const std::vector<bool>& affinity)
+{
+    #if defined(_WIN32)
+    DWORD_PTR process_mask = 0;
+    for (std::size_t i = 0; i < std::min<std::size_t>(affinity.size(), sizeof(DWORD_PTR) * 8); ++i)
+        process_mask |= (affinity[i] ? (1ULL << i) : 0ULL);
+    return SetProcessAffinityMask(GetCurrentProcess(), process_mask) != 0;
+    #elif defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (std::size_t i = 0; i < std::min<std::size_t>(affinity.size(), CPU_SETSIZE); ++i)
+    {
+        if (affinity[i])
+            CPU_SET(i, &cpu_set);
+    }
+    return sched_setaffinity(getpid(), sizeof(cpu_set_t), &cpu_set) == 0;
+    #elif defined(__APPLE__)
+    return affinity[0] && false; // NOLINT(readability-simplify-boolean-expr) // Using `affinity` to suppress unused parameter warning.
+    #endif
+}
+
+/**
+ * @brief Get the NUMA (non-uniform memory access) topology of the system using the current platform's native API: which logical processors belong to each NUMA node. This should work on Windows and Linux, but is not possible on macOS as the native API does not allow it. On Linux, the topology is read from `/sys/devices/system/node`. On Windows, only processors in the first processor group are taken into account, as with the other affinity functions.
+ *
+ * @return An `std::optional` object, optionally containing one `std::vector<bool>` per online NUMA node, where each element corresponds to a logical processor, in the same format used by `BS::get_os_process_affinity()`. The nodes are numbered consecutively starting from 0, even if the operating system's node numbers are not consecutive. If the returned object does not contain a value, then the topology could not be determined. On macOS, this function always returns `std::nullopt`.
+ */
+[[nodiscard]] inline std::optional<std::vector<std::vector<bool>>> get_os_numa_nodes()
+{
+    #if defined(_WIN32)
+    ULONG highest_node = 0;
+    if (GetNumaHighestNodeNumber(&highest_node) == 0)
+        return std::nullopt;
+    std::vector<std::vector<bool>> nodes;
+    nodes.reserve(static_cast<std::size_t>(highest_node) + 1);
+    for (ULONG node = 0; node <= highest_node; ++node)
+    {
+        GROUP_AFFINITY group_affinity = {};
+        std::vector<bool> affinity(sizeof(KAFFINITY) * 8);
+        if ((GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &group_affinity) != 0) && (group_affinity.Group == 0))
+        {
+            for (std::size_t i = 0; i < affinity.size(); ++i)
+                affinity[i] = ((group_affinity.Mask & (static_cast<KAFFINITY>(1) << i)) != 0);
+        }
+        nodes.push_back(std::move(affinity));
+    }
+    return nodes;
+    #elif defined(__linux__)
+    // Read a list in the format used by the files in `/sys/devices/system/node`, e.g. "0-3,8-11", and expand it into the numbers it contains.
+    const auto read_list = [](const std::string& path) -> std::optional<std::vector<std::size_t>>
+    {
+        std::ifstream file(path);
+        std::string line;
+        if (!file.is_open() || !std::getline(file, line))
+            return std::nullopt;
+        std::size_t pos = 0;
+        const auto read_number = [&line, &pos](std::size_t& number)
+        {
+            const std::size_t start = pos;
+            number = 0;
+            while ((pos < line.size()) && (line[pos] >= '0') && (line[pos] <= '9'))
+            {
+                number = (number * 10) + static_cast<std::size_t>(line[pos] - '0');
+                ++pos;
+            }
+            return pos > start;
+        };
+        std::vector<std::size_t> result;
+        while ((pos < line.size()) && (line[pos] != ' '))
+        {
+            std::size_t first = 0;
+            if (!read_number(first))
+                return std::nullopt;
+            std::size_t last = first;
+            if ((pos < line.size()) && (line[pos] == '-'))
+            {
+                ++pos;
+                if (!read_number(last) || (last < first))
+                    return std::nullopt;
+            }
+            for (std::size_t i = first; i <= last; ++i)
+                result.push_back(i);
+            if ((pos < line.size()) && (line[pos] == ','))
+                ++pos;
+        }
+        return result;
+    };
+    const std::optional<std::vector<std::size_t>> online = read_list("/sys/devices/system/node/online");
+    if (!online.has_value() || online->empty())
+        return std::nullopt;
+    const int num_cpus = get_nprocs();
+    if (num_cpus < 1)
+        return std::nullopt;
+    std::vector<std::vector<bool>> nodes;
+    nodes.reserve(online->size());
+    for (const std::size_t node : *online)
+    {
+        const std::optional<std::vector<std::size_t>> cpus = read_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!cpus.has_value())
+            return std::nullopt;
+        std::vector<bool> affinity(static_cast<std::size_t>(num_cpus));
+        for (const std::size_t cpu : *cpus)
+        {
+            if (cpu < affinity.size())
+                affinity[cpu] = true;
+        }
+        nodes.push_back(std::move(affinity));
+    }
+    return nodes;
+    #elif defined(__APPLE__)
+    return std::nullopt;
+    #endif
+}
+
+/**
+ * @brief Get the priority of the current process using the current platform's native API. This should work on Windows, Linux, and macOS.
+ *
+ * @return An `std::optional` object, optionally containing the priority of the current process, as a member of the enum `BS::os_process_priority`. If the returned object does not contain a value, then either the priority could not be determined, or it is not one of the pre-defined values and therefore cannot be represented in a portable way.
+ */
+[[nodiscard]] inline std::optional<os_process_priority> get_os_process_priority()
+{
+    #if defined(_WIN32)
+    // On Windows, this is straightforward.
+    const DWORD priority = GetPriorityClass(GetCurrentProcess());
+    if (priority == 0)
+        return std::nullopt;
+    return static_cast<os_process_priority>(priority);
+    #elif defined(__linux__) || defined(__APPLE__)
+    // On Linux/macOS there is no direct analogue of `GetPriorityClass()` on Windows, so instead we get the "nice" value. The usual range is -20 to 19 or 20, with higher values corresponding to lower priorities. However, we are only using 6 pre-defined values for portability, so if the value was set via any means other than `BS::set_os_process_priority()`, it may not match one of our pre-defined values. Note that `getpriority()` returns -1 on error, but since this does not correspond to any of our pre-defined values, this function will return `std::nullopt` anyway.
+    const int nice_val = getpriority(PRIO_PROCESS, static_cast<id_t>(getpid()));
+    switch (nice_val)
+    {
+    case static_cast<int>(os_process_priority::idle):
+        return os_process_priority::idle;
+    case static_cast<int>(os_process_priority::below_normal):
+        return os_process_priority::below_normal;
+    case static_cast<int>(os_process_priority::normal):
+        return os_process_priority::normal;
+    case static_cast<int>(os_process_priority::above_normal):
+        return os_process_priority::above_normal;
+    case static_cast<int>(os_process_priority::high):
+        return os_process_priority::high;
+    case static_cast<int>(os_process_priority::realtime):
+        return os_process_priority::realtime;
+    default:
+        return std::nullopt;
+    }
+    #endif
+}
+
+/**
+ * @brief Set the priority of the current process using the current platform's native API. This should work on Windows, Linux, and macOS. However, note that higher priorities might require elevated permissions.
+ *
+ * @param priority The priority to set. Must be a value from the enum `BS::os_process_priority`.
+ * @return `true` if the priority was set successfully, `false` otherwise. Usually, `false` means that the user does not have the necessary permissions to set the desired priority.
+ */
+inline bool set_os_process_priority(const os_process_priority priority)
+{
+    #if defined(_WIN32)
+    // On Windows, this is straightforward.
+    return SetPriorityClass(GetCurrentProcess(), static_cast<DWORD>(priority)) != 0;
+    #elif defined(__linux__) || defined(__APPLE__)
+    // On Linux/macOS there is no direct analogue of `SetPriorityClass()` on Windows, so instead we set the "nice" value. The usual range is -20 to 19 or 20, with higher values corresponding to lower priorities. However, we are only using 6 pre-defined values for portability. Note that the "nice" values are only relevant for the `SCHED_OTHER` policy, but we do not set that policy here, as it is per-thread rather than per-process.
+    // Also, it's important to note that a non-root user cannot decrease the nice value (i.e. increase the process priority), only increase it. This can cause confusing behavior. For example, if the current priority is `BS::os_process_priority::normal` and the user sets it to `BS::os_process_priority::idle`, they cannot change it back `BS::os_process_priority::normal`.
+    return setpriority(PRIO_PROCESS, static_cast<id_t>(getpid()), static_cast<int>(priority)) == 0;
+    #endif
+}
+#endif
+
+/**
+ * @brief A class used to obtain information about the current thread and, if native extensions are enabled, set its priority and affinity.
+ */
+class [[nodiscard]] this_thread
+{
+    template <opt_t>
+    friend class thread_pool;
+
+public:
+    /**
+     * @brief A guard object marking a region of code in which the current thread may block for a long time, for example while waiting for I/O. If the current thread belongs to a `BS::thread_pool` with the flag `BS::tp::elastic` enabled in its template parameter, the pool counts the thread as blocked for as long as the guard exists, and if there are tasks waiting in the queue and no idle threads to execute them, it starts another thread, up to the maximum number of threads. Otherwise, the guard does nothing. Regions may be nested, in which case only the outermost one has any effect.
+     */
+    class [[nodiscard]] blocking_region
+    {
+    public:
+        /**
+         * @brief Enter a blocking region.
+         */
+        blocking_region()
+        {
+            if (my_blocking_hook != nullptr)
+            {
+                counted = true;
+                if (my_blocking_depth++ == 0)
+                {
+                    pool = *my_pool;
+                    my_blocking_hook(pool, true);
+                }
+            }
+        }
+
+        // The copy and move constructors and assignment operators are deleted. A blocking region is tied to the scope in which it was created.
+        blocking_region(const blocking_region&) = delete;
+        blocking_region(blocking_region&&) = delete;
+        blocking_region& operator=(const blocking_region&) = delete;
+        blocking_region& operator=(blocking_region&&) = delete;
+
+        /**
+         * @brief Leave the blocking region.
+         */
+        ~blocking_region()
+        {
+            if (counted && (--my_blocking_depth == 0))
+                my_blocking_hook(pool, false);
+        }
+
+    private:
+        /**
+         * @brief A flag indicating whether this region was counted in the nesting depth, that is, whether the current thread belongs to an elastic pool.
+         */
+        bool counted = false;
+
+        /**
+         * @brief A pointer to the pool that owns the current thread, if this is the outermost region.
+         */
+        void* pool = nullptr;
+    }; // class blocking_region
+
+    /**
+     * @brief A guard object which sets the tag recorded for tasks submitted by the current thread to a `BS::thread_pool` with the flag `BS::tp::trace` enabled in its template parameter, for as long as it exists, and restores the previous tag when it is destroyed, so that tags may be nested. While a traced task is executing, its own tag is the current one, so tasks it submits inherit it unless they are given another one. The tag is stored as a pointer, so it must point to a string that outlives the trace, typically a string literal. Tasks submitted without a tag are shown as `task` in the trace.
+     */
+    class [[nodiscard]] trace_tag
+    {
+    public:
+        /**
+         * @brief Make the given tag the current one.
+         *
+         * @param tag The tag. Must point to a null-terminated string that outlives the trace, or be `nullptr` for no tag.
+         */
+        explicit trace_tag(const char* const tag) noexcept : previous(std::exchange(my_trace_tag, tag)) {}
+
+        // The copy and move constructors and assignment operators are deleted. A tag is tied to the scope in which it was created.
+        trace_tag(const trace_tag&) = delete;
+        trace_tag(trace_tag&&) = delete;
+        trace_tag& operator=(const trace_tag&) = delete;
+        trace_tag& operator=(trace_tag&&) = delete;
+
+        /**
+         * @brief Restore the previous tag.
+         */
+        ~trace_tag()
+        {
+            my_trace_tag = previous;
+        }
+
+    private:
+        /**
+         * @brief The tag that was current before this guard was created.
+         */
+        const char* previous;
+    }; // class trace_tag
+
+    /**
+     * @brief Get the index of the current thread. If this thread belongs to a `BS::thread_pool` object, the return value will be an index in the range `[0, N)` where `N == BS::thread_pool::get_thread_count()`. Otherwise, for example if this thread is the main thread or an independent thread not in any pools, `std::nullopt` will be returned.
+     *
+     * @return An `std::optional` object, optionally containing a thread index.
+     */
+    [[nodiscard]] static std::optional<std::size_t> get_index() noexcept
+    {
+        return my_index;
+    }
+
+    /**
+     * @brief Get a pointer to the thread pool that owns the current thread. If this thread belongs to a `BS::thread_pool` object, the return value will be a `void` pointer to that object. Otherwise, for example if this thread is the main thread or an independent thread not in any pools, `std::nullopt` will be returned.
+     *
+     * @return An `std::optional` object, optionally containing a pointer to a thread pool. Note that this will be a `void` pointer, so it must be cast to the desired instantiation of the `BS::thread_pool` template in order to use any member functions.
+     */
+    [[nodiscard]] static std::optional<void*> get_pool() noexcept
+    {
+        return my_pool;
+    }
+
+#ifdef __cpp_lib_jthread
+    /**
+     * @brief Get the stop token of the task currently running in this thread, if it was submitted with a `BS::stop_condition` that has one. Only available in C++20 and later.
+     *
+     * @return The stop token, or an `std::stop_token` with no associated stop state if the current task was not submitted with a stop token, or if this thread is not running such a task.
+     */
+    [[nodiscard]] static std::stop_token get_stop_token() noexcept
+    {
+        if (my_stop_condition == nullptr)
+            return {};
+        return my_stop_condition->get_stop_token();
+    }
+#endif
+
+    /**
+     * @brief Check whether the task currently running in this thread should stop, because it was submitted with a `BS::stop_condition` and either stop was requested on its stop token or its deadline has passed. Long-running tasks can call this function periodically in order to exit early.
+     *
+     * @return `true` if the current task should stop, `false` otherwise, including if it was not submitted with a stop condition, or if this thread is not running such a task.
+     */
+    [[nodiscard]] static bool stop_requested() noexcept
+    {
+        return (my_stop_condition != nullptr) && my_stop_condition->stop_requested();
+    }
+
+#ifdef __cpp_lib_memory_resource
+    /**
+     * @brief Get the arena of the current thread: a monotonic memory resource for short-lived scratch memory, which is released after the current task finishes. If this thread belongs to a `BS::thread_pool` object, each thread in the pool has its own arena, so allocating from it does not contend with other threads, and deallocating is a no-op. The first `BS::arena_buffer_size` bytes allocated by each task are served from a buffer owned by the thread, and any more are obtained from the thread's pooled memory resource. Memory allocated from the arena must not be used after the task that allocated it finishes. Each task that uses the arena must call this function, rather than use a pointer obtained by a previous task, since only tasks that call it release the arena when they finish. Otherwise, for example if this thread is the main thread or an independent thread not in any pools, the default memory resource, `std::pmr::get_default_resource()`, will be returned. Only available if `std::pmr::memory_resource` is supported.
+     *
+     * @return A pointer to the memory resource.
+     */
+    [[nodiscard]] static std::pmr::memory_resource* memory_resource() noexcept
+    {
+        if (my_arena == nullptr)
+            return std::pmr::get_default_resource();
+        my_arena_used = true;
+        return my_arena;
+    }
+
+    /**
+     * @brief Get the pooled memory resource of the current thread, for memory that must outlive the current task. If this thread belongs to a `BS::thread_pool` object, each thread in the pool has its own synchronized pool resource, which keeps freed blocks for reuse instead of returning them to the global allocator, so memory can be allocated repeatedly without contending with other threads. The memory may be deallocated by any thread, but must be deallocated before the pool is destroyed. Otherwise, for example if this thread is the main thread or an independent thread not in any pools, the default memory resource, `std::pmr::get_default_resource()`, will be returned. Only available if `std::pmr::memory_resource` is supported.
+     *
+     * @return A pointer to the memory resource.
+     */
+    [[nodiscard]] static std::pmr::memory_resource* pooled_memory_resource() noexcept
+    {
+        if (my_pooled_resource == nullptr)
+            return std::pmr::get_default_resource();
+        return my_pooled_resource;
+    }
+#endif
+
+#ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
+    /**
+     * @brief Get the processor affinity of the current thread using the current platform's native API. This should work on Windows and Linux, but is not possible on macOS as the native API does not allow it.
+     *
+     * @return An `std::optional` object, optionally containing the processor affinity of the current thread as an `std::vector<bool>` where each element corresponds to a logical processor. If the returned object does not contain a value, then the affinity could not be determined. On macOS, this function always returns `std::nullopt`.
+     */
+    [[nodiscard]] static std::optional<std::vector<bool>> get_os_thread_affinity()
+    {
+    #if defined(_WIN32)
+        // Windows does not have a `GetThreadAffinityMask()` function, but `SetThreadAffinityMask()` returns the previous affinity mask, so we can use that to get the current affinity and then restore it. It's a bit of a hack, but it works. Since the thread affinity must be a subset of the process affinity, we use the process affinity as the temporary value.
+        DWORD_PTR process_mask = 0;
+        DWORD_PTR system_mask = 0;
+        if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) == 0)
+            return std::nullopt;
+        const DWORD_PTR previous_mask = SetThreadAffinityMask(GetCurrentThread(), process_mask);
+        if (previous_mask == 0)
+            return std::nullopt;
+        SetThreadAffinityMask(GetCurrentThread(), previous_mask);
+        #ifdef __cpp_lib_int_pow2
+        const std::size_t num_cpus = static_cast<std::size_t>(std::bit_width(system_mask));
+        #else
+        std::size_t num_cpus = 0;
+        if (system_mask != 0)
+        {
+            num_cpus = 1;
+            while ((system_mask >>= 1U) != 0U)
+                ++num_cpus;
+        }
+        #endif
+        std::vector<bool> affinity(num_cpus);
+        for (std::size_t i = 0; i < num_cpus; ++i)
+            affinity[i] = ((previous_mask & (1ULL << i)) != 0ULL);
+        return affinity;
+    #elif defined(__linux__)
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set) != 0)
+            return std::nullopt;
+        const int num_cpus = get_nprocs();
+        if (num_cpus < 1)
+            return std::nullopt;
+        std::vector<bool> affinity(static_cast<std::size_t>(num_cpus));
+        for (std::size_t i = 0; i < affinity.size(); ++i)
+            affinity[i] = CPU_ISSET(i, &cpu_set);
+        return affinity;
+    #elif defined(__APPLE__)
+        return std::nullopt;
+    #endif
+    }
+
+    /**
+     * @brief Set the processor affinity of the current thread using the current platform's native API. This should work on Windows and Linux, but is not possible on macOS as the native API does not allow it. Note that the thread affinity must be a subset of the process affinity (as obtained using `BS::get_os_process_affinity()`) for the containing process of a thread.
+     *
+     * @param affinity The processor affinity to set, as an `std::vector<bool>` where each element corresponds to a logical processor.
+     * @return `true` if the affinity was set successfully, `false` otherwise. On macOS, this function always returns `false`.
+     */
+    static bool set_os_thread_affinity(const std::vector<bool>& affinity)
+    {
+    #if defined(_WIN32)
+        DWORD_PTR thread_mask = 0;
+        for (std::size_t i = 0; i < std::min<std::size_t>(affinity.size(), sizeof(DWORD_PTR) * 8); ++i)
+            thread_mask |= (affinity[i] ? (1ULL << i) : 0ULL);
+        return SetThreadAffinityMask(GetCurrentThread(), thread_mask) != 0;
+    #elif defined(__linux__)
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        for (std::size_t i = 0; i < std::min<std::size_t>(affinity.size(), CPU_SETSIZE); ++i)
+        {
+            if (affinity[i])
+                CPU_SET(i, &cpu_set);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set) == 0;
+    #elif defined(__APPLE__)
+        return affinity[0] && false; // NOLINT(readability-simplify-boolean-expr) // Using `affinity` to suppress unused parameter warning.
+    #endif
+    }
+
+    /**
+     * @brief Get the name of the current thread using the current platform's native API. This should work on Windows, Linux, and macOS.
+     *
+     * @return An `std::optional` object, optionally containing the name of the current thread. If the returned object does not contain a value, then the name could not be determined.
+     */
+    [[nodiscard]] static std::optional<std::string> get_os_thread_name()
+    {
+    #if defined(_WIN32)
+        // On Windows thread names are wide strings, so we need to convert them to normal strings.
+        PWSTR data = nullptr;
+        const HRESULT hr = GetThreadDescription(GetCurrentThread(), &data);
+        if (FAILED(hr))
+            return std::nullopt;
+        if (data == nullptr)
+            return std::nullopt;
+        const int size = WideCharToMultiByte(CP_UTF8, 0, data, -1, nullptr, 0, nullptr, nullptr);
+        if (size == 0)
+        {
+            LocalFree(data);
+            return std::nullopt;
+        }
+        std::string name(static_cast<std::size_t>(size) - 1, 0);
+        const int result = WideCharToMultiByte(CP_UTF8, 0, data, -1, name.data(), size, nullptr, nullptr);
+        LocalFree(data);
+        if (result == 0)
+            return std::nullopt;
+        return name;
+    #elif defined(__linux__) || defined(__APPLE__)
+        #ifdef __linux__
+        // On Linux thread names are limited to 16 characters, including the null terminator.
+        constexpr std::size_t buffer_size = 16;
+        #else
+        // On macOS thread names are limited to 64 characters, including the null terminator.
+        constexpr std::size_t buffer_size = 64;
+        #endif
+        char name[buffer_size] = {};
+        if (pthread_getname_np(pthread_self(), name, buffer_size) != 0)
+            return std::nullopt;
+        return std::string(name);
+    #endif
+    }
+
+    /**
+     * @brief Set the name of the current thread using the current platform's native API. This should work on Windows, Linux, and macOS. Note that on Linux thread names are limited to 16 characters, including the null terminator.
+     *
+     * @param name The name to set.
+     * @return `true` if the name was set successfully, `false` otherwise.
+     */
+    static bool set_os_thread_name(const std::string& name)
+    {
+    #if defined(_WIN32)
+        // On Windows thread names are wide strings, so we need to convert them from normal strings.
+        const int size = MultiByteToWideChar(CP_UTF8, 0, name.data(), -1, nullptr, 0);
+        if (size == 0)
+            return false;
+        std::wstring wide(static_cast<std::size_t>(size), 0);
+        if (MultiByteToWideChar(CP_UTF8, 0, name.data(), -1, wide.data(), size) == 0)
+            return false;
+        const HRESULT hr = SetThreadDescription(GetCurrentThread(), wide.data());
+        return SUCCEEDED(hr);
+    #elif defined(__linux__)
+        // On Linux this is straightforward.
+        return pthread_setname_np(pthread_self(), name.data()) == 0;
+    #elif defined(__APPLE__)
+        // On macOS, unlike Linux, a thread can only set a name for itself, so the signature is different.
+        return pthread_setname_np(name.data()) == 0;
+    #endif
+    }
+
+    /**
+     * @brief Get the priority of the current thread using the current platform's native API. This should work on Windows, Linux, and macOS.
+     *
+     * @return An `std::optional` object, optionally containing the priority of the current thread, as a member of the enum `BS::os_thread_priority`. If the returned object does not contain a value, then either the priority could not be determined, or it is not one of the pre-defined values.
+     */
+    [[nodiscard]] static std::optional<os_thread_priority> get_os_thread_priority()
+    {
+    #if defined(_WIN32)
+        // On Windows, this is straightforward.
+        const int priority = GetThreadPriority(GetCurrentThread());
+        if (priority == THREAD_PRIORITY_ERROR_RETURN)
+            return std::nullopt;
+        return static_cast<os_thread_priority>(priority);
+    #elif defined(__linux__)
+        // On Linux, we distill the choices of scheduling policy, priority, and "nice" value into 7 pre-defined levels, for simplicity and portability. The total number of possible combinations of policies and priorities is much larger, so if the value was set via any means other than `BS::this_thread::set_os_thread_priority()`, it may not match one of our pre-defined values.
+        int policy = 0;
+        struct sched_param param = {};
+        if (pthread_getschedparam(pthread_self(), &policy, &param) != 0)
+            return std::nullopt;
+        if (policy == SCHED_FIFO && param.sched_priority == sched_get_priority_max(SCHED_FIFO))
+        {
+            // The only pre-defined priority that uses SCHED_FIFO and the maximum available priority value is the "realtime" priority.
+            return os_thread_priority::realtime;
+        }
+        if (policy == SCHED_RR && param.sched_priority == sched_get_priority_min(SCHED_RR) + (sched_get_priority_max(SCHED_RR) - sched_get_priority_min(SCHED_RR)) / 2)
+        {
+            // The only pre-defined priority that uses SCHED_RR and a priority in the middle of the available range is the "highest" priority.
+            return os_thread_priority::highest;
+        }
+        #ifdef __linux__
+        if (policy == SCHED_IDLE)
+        {
+            // The only pre-defined priority that uses SCHED_IDLE is the "idle" priority. Note that this scheduling policy is not available on macOS.
+            return os_thread_priority::idle;
+        }
+        #endif
+        if (policy == SCHED_OTHER)
+        {
+            // For SCHED_OTHER, the result depends on the "nice" value. The usual range is -20 to 19 or 20, with higher values corresponding to lower priorities. Note that `getpriority()` returns -1 on error, but since this does not correspond to any of our pre-defined values, this function will return `std::nullopt` anyway.
+            const int nice_val = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+            switch (nice_val)
+            {
+            case PRIO_MIN + 2:
+                return os_thread_priority::above_normal;
+            case 0:
+                return os_thread_priority::normal;
+            case (PRIO_MAX / 2) + (PRIO_MAX % 2):
+                return os_thread_priority::below_normal;
+            case PRIO_MAX - 3:
+                return os_thread_priority::lowest;
+        #ifdef __APPLE__
+            // `SCHED_IDLE` doesn't exist on macOS, so we use the policy `SCHED_OTHER` with a "nice" value of `PRIO_MAX - 2`.
+            case PRIO_MAX - 2:
+                return os_thread_priority::idle;
+        #endif
+            default:
+                return std::nullopt;
+            }
+        }
+        return std::nullopt;
+    #elif defined(__APPLE__)
+        // On macOS, we distill the choices of scheduling policy and priority into 7 pre-defined levels, for simplicity and portability. The total number of possible combinations of policies and priorities is much larger, so if the value was set via any means other than `BS::this_thread::set_os_thread_priority()`, it may not match one of our pre-defined values.
+        int policy = 0;
+        struct sched_param param = {};
+        if (pthread_getschedparam(pthread_self(), &policy, &param) != 0)
+            return std::nullopt;
+        if (policy == SCHED_FIFO && param.sched_priority == sched_get_priority_max(SCHED_FIFO))
+        {
+            // The only pre-defined priority that uses SCHED_FIFO and the maximum available priority value is the "realtime" priority.
+            return os_thread_priority::realtime;
+        }
+        if (policy == SCHED_RR && param.sched_priority == sched_get_priority_min(SCHED_RR) + (sched_get_priority_max(SCHED_RR) - sched_get_priority_min(SCHED_RR)) / 2)
+        {
+            // The only pre-defined priority that uses SCHED_RR and a priority in the middle of the available range is the "highest" priority.
+            return os_thread_priority::highest;
+        }
+        if (policy == SCHED_OTHER)
+        {
+            // For SCHED_OTHER, the result depends on the specific value of the priority.
+            if (param.sched_priority == sched_get_priority_max(SCHED_OTHER))
+                return os_thread_priority::above_normal;
+            if (param.sched_priority == sched_get_priority_min(SCHED_OTHER) + (sched_get_priority_max(SCHED_OTHER) - sched_get_priority_min(SCHED_OTHER)) / 2)
+                return os_thread_priority::normal;
+            if (param.sched_priority == sched_get_priority_min(SCHED_OTHER) + (sched_get_priority_max(SCHED_OTHER) - sched_get_priority_min(SCHED_OTHER)) * 2 / 3)
+                return os_thread_priority::below_normal;
+            if (param.sched_priority == sched_get_priority_min(SCHED_OTHER) + (sched_get_priority_max(SCHED_OTHER) - sched_get_priority_min(SCHED_OTHER)) / 3)
+                return os_thread_priority::lowest;
+            if (param.sched_priority == sched_get_priority_min(SCHED_OTHER))
+                return os_thread_priority::idle;
+            return std::nullopt;
+        }
+        return std::nullopt;
+    #endif
+    }
+
+    /**
+     * @brief Set the priority of the current thread using the current platform's native API. This should work on Windows, Linux, and macOS. However, note that higher priorities might require elevated permissions.
+     *
+     * @param priority The priority to set. Must be a value from the enum `BS::os_thread_priority`.
+     * @return `true` if the priority was set successfully, `false` otherwise. Usually, `false` means that the user does not have the necessary permissions to set the desired priority.
+     */
+    static bool set_os_thread_priority(const os_thread_priority priority)
+    {
+    #if defined(_WIN32)
+        // On Windows, this is straightforward.
+        return SetThreadPriority(GetCurrentThread(), static_cast<int>(priority)) != 0;
+    #elif defined(__linux__)
+        // On Linux, we distill the choices of scheduling policy, priority, and "nice" value into 7 pre-defined levels, for simplicity and portability. The total number of possible combinations of policies and priorities is much larger, but allowing more fine-grained control would not be portable.
+        int policy = 0;
+        struct sched_param param = {};
+        std::optional<int> nice_val = std::nullopt;
+        switch (priority)
+        {
+        case os_thread_priority::realtime:
+            // "Realtime" pre-defined priority: We use the policy `SCHED_FIFO` with the highest possible priority.
+            policy = SCHED_FIFO;
+            param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+            break;
+        case os_thread_priority::highest:
+            // "Highest" pre-defined priority: We use the policy `SCHED_RR` ("round-robin") with a priority in the middle of the available range.
+            policy = SCHED_RR;
+            param.sched_priority = sched_get_priority_min(SCHED_RR) + (sched_get_priority_max(SCHED_RR) - sched_get_priority_min(SCHED_RR)) / 2;
+            break;
+        case os_thread_priority::above_normal:
+            // "Above normal" pre-defined priority: We use the policy `SCHED_OTHER` (the default). This policy does not accept a priority value, so priority must be 0. However, we set the "nice" value to the minimum value as given by `PRIO_MIN`, plus 2 (which should evaluate to -18). The usual range is -20 to 19 or 20, with higher values corresponding to lower priorities.
+            policy = SCHED_OTHER;
+            param.sched_priority = 0;
+            nice_val = PRIO_MIN + 2;
+            break;
+        case os_thread_priority::normal:
+            // "Normal" pre-defined priority: We use the policy `SCHED_OTHER`, priority must be 0, and we set the "nice" value to 0 (the default).
+            policy = SCHED_OTHER;
+            param.sched_priority = 0;
+            nice_val = 0;
+            break;
+        case os_thread_priority::below_normal:
+            // "Below normal" pre-defined priority: We use the policy `SCHED_OTHER`, priority must be 0, and we set the "nice" value to half the maximum value as given by `PRIO_MAX`, rounded up (which should evaluate to 10).
+            policy = SCHED_OTHER;
+            param.sched_priority = 0;
+            nice_val = (PRIO_MAX / 2) + (PRIO_MAX % 2);
+            break;
+        case os_thread_priority::lowest:
+            // "Lowest" pre-defined priority: We use the policy `SCHED_OTHER`, priority must be 0, and we set the "nice" value to the maximum value as given by `PRIO_MAX`, minus 3 (which should evaluate to 17).
+            policy = SCHED_OTHER;
+            param.sched_priority = 0;
+            nice_val = PRIO_MAX - 3;
+            break;
+        case os_thread_priority::idle:
+            // "Idle" pre-defined priority on Linux: We use the policy `SCHED_IDLE`, priority must be 0, and we don't touch the "nice" value.
+            policy = SCHED_IDLE;
+            param.sched_priority = 0;
+            break;
+        default:
+            return false;
+        }
+        bool success = (pthread_setschedparam(pthread_self(), policy, &param) == 0);
+        if (nice_val.has_value())
+            success = success && (setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), nice_val.value()) == 0);
+        return success;
+    #elif defined(__APPLE__)
+        // On macOS, unlike Linux, the "nice" value is per-process, not per-thread (in compliance with the POSIX standard). However, unlike Linux, `SCHED_OTHER` on macOS does have a range of priorities. So for `realtime` and `highest` priorities we use `SCHED_FIFO` and `SCHED_RR` respectively as for Linux, but for the other priorities we use `SCHED_OTHER` with a priority in the range given by `sched_get_priority_min(SCHED_OTHER)` to `sched_get_priority_max(SCHED_OTHER)`.
+        int policy = 0;
+        struct sched_param param = {};
+        switch (priority)
+        {
+        case os_thread_priority::realtime:
+            // "Realtime" pre-defined priority: We use the policy `SCHED_FIFO` with the highest possible priority.
+            policy = SCHED_FIFO;
+            param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+            break;
+        case os_thread_priority::highest:
+            // "Highest" pre-defined priority: We use the policy `SCHED_RR` ("round-robin") with a priority in the middle of the available range.
+            policy = SCHED_RR;
+            param.sched_priority = sched_get_priority_min(SCHED_RR) + (sched_get_priority_max(SCHED_RR) - sched_get_priority_min(SCHED_RR)) / 2;
+            break;
+        case os_thread_priority::above_normal:
+            // "Above normal" pre-defined priority: We use the policy `SCHED_OTHER` (the default) with the highest possible priority.
+            policy = SCHED_OTHER;
+            param.sched_priority = sched_get_priority_max(SCHED_OTHER);
+            break;
+        case os_thread_priority::normal:
+            // "Normal" pre-defined priority: We use the policy `SCHED_OTHER` (the default) with a priority in the middle of the available range (which appears to be the default?).
+            policy = SCHED_OTHER;
+            param.sched_priority = sched_get_priority_min(SCHED_OTHER) + (sched_get_priority_max(SCHED_OTHER) - sched_get_priority_min(SCHED_OTHER)) / 2;
+            break;
+        case os_thread_priority::below_normal:
+            // "Below normal" pre-defined priority: We use the policy `SCHED_OTHER` (the default) with a priority equal to 2/3rds of the normal value.
+            policy = SCHED_OTHER;
+            param.sched_priority = sched_get_priority_min(SCHED_OTHER) + (sched_get_priority_max(SCHED_OTHER) - sched_get_priority_min(SCHED_OTHER)) * 2 / 3;
+            break;
+        case os_thread_priority::lowest:
+            // "Lowest" pre-defined priority: We use the policy `SCHED_OTHER` (the default) with a priority equal to 1/3rd of the normal value.
+            policy = SCHED_OTHER;
+            param.sched_priority = sched_get_priority_min(SCHED_OTHER) + (sched_get_priority_max(SCHED_OTHER) - sched_get_priority_min(SCHED_OTHER)) / 3;
+            break;
+        case os_thread_priority::idle:
+            // "Idle" pre-defined priority on macOS: We use the policy `SCHED_OTHER` (the default) with the lowest possible priority.
+            policy = SCHED_OTHER;
+            param.sched_priority = sched_get_priority_min(SCHED_OTHER);
+            break;
+        default:
+            return false;
+        }
+        return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+    #endif
+    }
+#endif
+
+private:
+    inline static thread_local std::optional<std::size_t> my_index = std::nullopt;
+    inline static thread_local std::optional<void*> my_pool = std::nullopt;
+    inline static thread_local void (*my_blocking_hook)(void*, bool) = nullptr;
+    inline static thread_local std::size_t my_blocking_depth = 0;
+    inline static thread_local const stop_condition* my_stop_condition = nullptr;
+    inline static thread_local const char* my_trace_tag = nullptr;
+#ifdef __cpp_lib_memory_resource
+    inline static thread_local std::pmr::monotonic_buffer_resource* my_arena = nullptr;
+    inline static thread_local bool my_arena_used = false;
+    inline static thread_local std::pmr::memory_resource* my_pooled_resource = nullptr;
+#endif
+
+    /**
+     * @brief A guard object which makes a stop condition the one returned by `stop_requested()` for as long as it exists, and restores the previous one when it is destroyed, so that tasks can be nested.
+     */
+    class [[nodiscard]] stop_condition_scope
+    {
+    public:
+        /**
+         * @brief Make the given stop condition the current one.
+         *
+         * @param condition The stop condition.
+         */
+        explicit stop_condition_scope(const stop_condition& condition) noexcept : previous(std::exchange(my_stop_condition, &condition)) {}
+
+        // The copy and move constructors and assignment operators are deleted. A scope is tied to the task during which it was created.
+        stop_condition_scope(const stop_condition_scope&) = delete;
+        stop_condition_scope(stop_condition_scope&&) = delete;
+        stop_condition_scope& operator=(const stop_condition_scope&) = delete;
+        stop_condition_scope& operator=(stop_condition_scope&&) = delete;
+
+        /**
+         * @brief Restore the previous stop condition.
+         */
+        ~stop_condition_scope()
+        {
+            my_stop_condition = previous;
+        }
+
+    private:
+        /**
+         * @brief The stop condition that was current before this scope was created.
+         */
+        const stop_condition* previous;
+    }; // class stop_condition_scope
+}; // class this_thread
+
+/**
+ * @brief A meta-programming template to determine the common type of two integer types. Unlike `std::common_type`, this template maintains correct signedness.
+ *
+ * @tparam T1 The first type.
+ * @tparam T2 The second type.
+ * @tparam Enable A dummy parameter to enable SFINAE in specializations.
+ */
+template <typename T1, typename T2, typename Enable = void>
+struct common_index_type
+{
+    // Fallback to `std::common_type_t` if no specialization matches.
+    using type = std::common_type_t<T1, T2>;
+};
+
+// The common type of two signed integers is the larger of the integers, with the same signedness.
+template <typename T1, typename T2>
+struct common_index_type<T1, T2, std::enable_if_t<std::is_signed_v<T1> && std::is_signed_v<T2>>>
+{
+    using type = std::conditional_t<(sizeof(T1) >= sizeof(T2)), T1, T2>;
+};
+
+// The common type of two unsigned integers is the larger of the integers, with the same signedness.
+template <typename T1, typename T2>
+struct common_index_type<T1, T2, std::enable_if_t<std::is_unsigned_v<T1> && std::is_unsigned_v<T2>>>
+{
+    using type = std::conditional_t<(sizeof(T1) >= sizeof(T2)), T1, T2>;
+};
+
+// The common type of a signed and an unsigned integer is a signed integer that can hold the full ranges of both integers.
+template <typename T1, typename T2>
+struct common_index_type<T1, T2, std::enable_if_t<(std::is_signed_v<T1> && std::is_unsigned_v<T2>) || (std::is_unsigned_v<T1> && std::is_signed_v<T2>)>>
+{
+    using S = std::conditional_t<std::is_signed_v<T1>, T1, T2>;
+    using U = std::conditional_t<std::is_unsigned_v<T1>, T1, T2>;
+    static constexpr std::size_t larger_size = (sizeof(S) > sizeof(U)) ? sizeof(S) : sizeof(U);
+    using type = std::conditional_t<larger_size <= 4,
+        // If both integers are 32 bits or less, the common type should be a signed type that can hold both of them. If both are 8 bits, or the signed type is 16 bits and the unsigned type is 8 bits, the common type is `std::int16_t`. Otherwise, if both are 16 bits, or the signed type is 32 bits and the unsigned type is smaller, the common type is `std::int32_t`. Otherwise, if both are 32 bits or less, the common type is `std::int64_t`.
+        std::conditional_t<larger_size == 1 || (sizeof(S) == 2 && sizeof(U) == 1), std::int16_t, std::conditional_t<larger_size == 2 || (sizeof(S) == 4 && sizeof(U) < 4), std::int32_t, std::int64_t>>,
+        // If the unsigned integer is 64 bits, the common type should also be an unsigned 64-bit integer, that is, `std::uint64_t`. The reason is that the most common scenario where this might happen is where the indices go from 0 to `x` where `x` has been previously defined as `std::size_t`, e.g. the size of a vector. Note that this will fail if the first index is negative; in that case, the user must cast the indices explicitly to the desired common type. If the unsigned integer is not 64 bits, then the signed integer must be 64 bits, hence the common type is `std::int64_t`.
+        std::conditional_t<sizeof(U) == 8, std::uint64_t, std::int64_t>>;
+};
+
+/**
+ * @brief A helper type alias to obtain the common type from the template `BS::common_index_type`.
+ *
+ * @tparam T1 The first type.
+ * @tparam T2 The second type.
+ */
+template <typename T1, typename T2>
+using common_index_type_t = typename common_index_type<T1, T2>::type;
+
+/**
+ * @brief An enumeration of flags to be used in the bitmask template parameter of `BS::thread_pool` to enable optional features.
+ */
+enum tp : opt_t
+{
+    /**
+     * @brief No optional features enabled.
+     */
+    none = 0,
+
+    /**
+     * @brief Enable task priority.
+     */
+    priority = 1 << 0,
+
+    /**
+     * @brief Enable statistics collection.
+     */
+    statistics = 1 << 1,
+
+    /**
+     * @brief Enable pausing.
+     */
+    pause = 1 << 2,
+
+    /**
+     * @brief Enable wait deadlock checks.
+     */
+    wait_deadlock_checks = 1 << 3,
+
+    /**
+     * @brief Enable work stealing.
+     */
+    work_stealing = 1 << 4,
+
+    /**
+     * @brief Enable the lock-free global queue.
+     */
+    lock_free = 1 << 5,
+
+    /**
+     * @brief Enable NUMA-aware scheduling. Implies work stealing.
+     */
+    numa = 1 << 6,
+
+    /**
+     * @brief Enable the elastic thread count.
+     */
+    elastic = 1 << 7,
+
+    /**
+     * @brief Enable task tracing.
+     */
+    trace = 1 << 8
+};
+
+/**
+ * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with all optional features disabled.
+ */
+using light_thread_pool = thread_pool<tp::none>;
+
+/**
+ * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with task priority enabled.
+ */
+using priority_thread_pool = thread_pool<tp::priority>;
+
+/**
+ * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with statistics collection enabled.
+ */
+using stats_thread_pool = thread_pool<tp::statistics>;
+
+/**
+ * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with pausing enabled.
+ */
+using pause_thread_pool = thread_pool<tp::pause>;
+
+/**
+ * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with wait deadlock checks enabled.
+ */
+using wdc_thread_pool = thread_pool<tp::wait_deadlock_checks>;
+
+/**
+ * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with work stealing enabled.
+ */
+using ws_thread_pool = thread_pool<tp::work_stealing>;
+
+/**
+ * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with the lock-free global queue enabled.
+ */
+using lf_thread_pool = thread_pool<tp::lock_free>;
+
+/**
+ * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with NUMA-aware scheduling (and therefore also work stealing) enabled.
+ */
+using numa_thread_pool = thread_pool<tp::numa>;
+
+/**
+ * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with the elastic thread count enabled.
+ */
+using elastic_thread_pool = thread_pool<tp::elastic>;
+
+/**
+ * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with task tracing enabled.
+ */
+using trace_thread_pool = thread_pool<tp::trace>;
+
+/**
+ * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class.
+ *
+ * @tparam OptFlags A bitmask of flags which can be used to enable optional features. The flags are members of the `BS::tp` enumeration: `BS::tp::priority`, `BS::tp::statistics`, `BS::tp::pause`, `BS::tp::wait_deadlock_checks`, `BS::tp::work_stealing`, `BS::tp::lock_free`, `BS::tp::numa`, `BS::tp::elastic`, and `BS::tp::trace`. The default is `BS::tp::none`, which disables all optional features. To enable multiple features, use the bitwise OR operator `|`, e.g. `BS::tp::priority | BS::tp::pause`.
+ */
+template <opt_t OptFlags = tp::none>
+class [[nodiscard]] thread_pool
+{
+public:
+    /**
+     * @brief A flag indicating whether task priority is enabled.
+     */
+    static constexpr bool priority_enabled = (OptFlags & tp::priority) != 0;
+
+    /**
+     * @brief A flag indicating whether statistics collection is enabled.
+     */
+    static constexpr bool statistics_enabled = (OptFlags & tp::statistics) != 0;
+
+    /**
+     * @brief A flag indicating whether pausing is enabled.
+     */
+    static constexpr bool pause_enabled = (OptFlags & tp::pause) != 0;
+
+    /**
+     * @brief A flag indicating whether wait deadlock checks are enabled.
+     */
+    static constexpr bool wait_deadlock_checks_enabled = (OptFlags & tp::wait_deadlock_checks) != 0;
+
+    /**
+     * @brief A flag indicating whether NUMA-aware scheduling is enabled.
+     */
+    static constexpr bool numa_enabled = (OptFlags & tp::numa) != 0;
+
+    /**
+     * @brief A flag indicating whether work stealing is enabled. Also enabled if NUMA-aware scheduling is enabled, since it is built on top of the local queues.
+     */
+    static constexpr bool work_stealing_enabled = ((OptFlags & tp::work_stealing) != 0) || numa_enabled;
+
+    /**
+     * @brief A flag indicating whether the lock-free global queue is enabled.
+     */
+    static constexpr bool lock_free_enabled = (OptFlags & tp::lock_free) != 0;
+
+    /**
+     * @brief A flag indicating whether the elastic thread count is enabled.
+     */
+    static constexpr bool elastic_enabled = (OptFlags & tp::elastic) != 0;
+
+    /**
+     * @brief A flag indicating whether task tracing is enabled.
+     */
+    static constexpr bool trace_enabled = (OptFlags & tp::trace) != 0;
+
+    /**
+     * @brief The number of spin iterations after which a spinning worker yields to the operating system's scheduler instead of executing a CPU pause instruction, so that spinning workers do not starve other threads if the system is oversubscribed. See `set_spin_budget()`.
+     */
+    static constexpr std::size_t spin_yield_interval = 64;
+
+    /**
+     * @brief The minimum time between two threads being started because tasks are backing up in the queue, if the elastic thread count is enabled. This prevents a short burst of tasks from starting many threads at once. Threads started to replace blocked threads are not subject to this limit.
+     */
+    static constexpr std::chrono::milliseconds elastic_grow_interval = std::chrono::milliseconds(1);
+
+#ifndef __cpp_exceptions
+    static_assert(!wait_deadlock_checks_enabled, "Wait deadlock checks cannot be enabled if exception handling is disabled.");
+#endif
+    static_assert(!(lock_free_enabled && priority_enabled), "The lock-free global queue cannot be enabled together with task priority, since it is strictly first-in, first-out.");
+
+    // ============================
+    // Constructors and destructors
+    // ============================
+
+    /**
+     * @brief Construct a new thread pool. The number of threads will be the total number of hardware threads available, as reported by the implementation. This is usually determined by the number of cores in the CPU. If a core is hyperthreaded, it will count as two threads.
+     */
+    thread_pool() : thread_pool(0, [] {}) {}
+
+    /**
+     * @brief Construct a new thread pool with the specified number of threads.
+     *
+     * @param num_threads The number of threads to use.
+     */
+    explicit thread_pool(const std::size_t num_threads) : thread_pool(num_threads, [] {}) {}
+
+    /**
+     * @brief Construct a new thread pool with the specified initialization function.
+     *
+     * @param init An initialization function to run in each thread before it starts executing any submitted tasks. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. It will be executed exactly once per thread, when the thread is first constructed. The initialization function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function.
+     */
+    template <BS_THREAD_POOL_INIT_FUNC_CONCEPT(F)>
+    explicit thread_pool(F&& init) : thread_pool(0, std::forward<F>(init))
+    {
+    }
+
+    /**
+     * @brief Construct a new thread pool with the specified number of threads and initialization function.
+     *
+     * @param num_threads The number of threads to use.
+     * @param init An initialization function to run in each thread before it starts executing any submitted tasks. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. It will be executed exactly once per thread, when the thread is first constructed. The initialization function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function.
+     */
+    template <BS_THREAD_POOL_INIT_FUNC_CONCEPT(F)>
+    thread_pool(const std::size_t num_threads, F&& init)
+    {
+        create_threads(num_threads, std::forward<F>(init));
+    }
+
+    // The copy and move constructors and assignment operators are deleted. The thread pool cannot be copied or moved.
+    thread_pool(const thread_pool&) = delete;
+    thread_pool(thread_pool&&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    thread_pool& operator=(thread_pool&&) = delete;
+
+    /**
+     * @brief Destruct the thread pool. Waits for all tasks to complete, then destroys all threads. If a cleanup function was set, it will run in each thread right before it is destroyed. Note that if the pool is paused, then any tasks still in the queue will never be executed.
+     */
+    ~thread_pool() noexcept
+    {
+#ifdef __cpp_exceptions
+        try
+        {
+#endif
+            wait();
+#ifndef __cpp_lib_jthread
+            destroy_threads();
+#endif
+#ifdef __cpp_exceptions
+        }
+        catch (...)
+        {
+        }
+#endif
+    }
+
+    // =======================
+    // Public member functions
+    // =======================
+
+    /**
+     * @brief Discard all the events recorded so far in the trace buffers of the threads, so that `get_trace()` and `write_chrome_trace()` only return events recorded from now on. Does not lock any mutexes other than briefly locking the global mutex, and does not disturb the threads recording events at the same time. Only enabled if the flag `BS:tp::trace` is enabled in the template parameter.
+     */
+    BS_THREAD_POOL_IF_TRACE_ENABLED
+    void clear_trace()
+    {
+        for (trace_buffer* const buffer : get_trace_buffers())
+            buffer->clear();
+    }
+
+    /**
+     * @brief Submit a batch of functions with no arguments and no return values into the task queue, with the specified priority, given as a range of iterators. All of the tasks are pushed into the queue while locking the global mutex only once, and at most one idle thread is woken up per task, which is much faster than calling `detach_task()` separately for each function if the batch is large. Does not return a future, so the user must use `wait()` or some other method to ensure that the tasks finish executing, otherwise bad things will happen.
+     *
+     * @tparam It The type of the iterators. Must be a forward iterator.
+     * @param first An iterator to the first function in the range.
+     * @param last An iterator to the element after the last function in the range. Note that the functions are copied into the queue; to move them instead, use `std::make_move_iterator()`.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename It>
+    void detach_batch(It first, const It last, const priority_t priority = 0)
+    {
+        std::vector<task_t> batch;
+        batch.reserve(static_cast<std::size_t>(std::distance(first, last)));
+        for (; first != last; ++first)
+            batch.emplace_back(stamp_task(*first, priority));
+        push_batch(batch, priority);
+    }
+
+    /**
+     * @brief Submit a batch of functions with no arguments and no return values into the task queue, with the specified priority, given as a generator function. All of the tasks are pushed into the queue while locking the global mutex only once, and at most one idle thread is woken up per task, which is much faster than calling `detach_task()` separately for each function if the batch is large. Does not return a future, so the user must use `wait()` or some other method to ensure that the tasks finish executing, otherwise bad things will happen.
+     *
+     * @tparam G The type of the generator function.
+     * @param count The number of tasks in the batch.
+     * @param generator A function that takes a single argument, the index of the task in the batch (from 0 to `count - 1`), and returns the function to submit. The generator is called for all indices before any of the tasks are pushed into the queue, and is not called while holding any locks.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename G, typename = std::enable_if_t<std::is_invocable_v<G&, std::size_t>>>
+    void detach_batch(const std::size_t count, G&& generator, const priority_t priority = 0)
+    {
+        std::vector<task_t> batch;
+        batch.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+            batch.emplace_back(stamp_task(generator(i), priority));
+        push_batch(batch, priority);
+    }
+
+    /**
+     * @brief Parallelize a loop by automatically splitting it into blocks and submitting each block separately to the queue, with the specified priority. The block function takes two arguments, the start and end of the block, so that it is only called once per block, but it is up to the user make sure the block function correctly deals with all the indices in each block. Does not return a `BS::multi_future`, so the user must use `wait()` or some other method to ensure that the loop finishes executing, otherwise bad things will happen.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no blocks will be submitted.
+     * @param block A function that will be called once per block. Should take exactly two arguments: the first index in the block and the index after the last index in the block. `block(start, end)` should typically involve a loop of the form `for (T i = start; i < end; ++i)`.
+     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
+    void detach_blocks(const T1 first_index, const T2 index_after_last, F&& block, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    {
+        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        {
+            const blocks blks(static_cast<T>(first_index), static_cast<T>(index_after_last), num_blocks ? num_blocks : thread_count);
+            typename loop_state<std::decay_t<F>>::issuer block_refs(blks.get_num_blocks(), *this, std::forward<F>(block));
+            detach_batch(
+                blks.get_num_blocks(),
+                [&block_refs, &blks](const std::size_t blk)
+                {
+                    return [block_ref = block_refs.next(), start = blks.start(blk), end = blks.end(blk)]
+                    {
+                        (*block_ref)(start, end);
+                    };
+                },
+                priority);
+        }
+    }
+
+    /**
+     * @brief Parallelize a loop by automatically splitting it into blocks and submitting each block separately to the queue, with the specified priority, exactly like the overload that takes the number of blocks, but with a stop condition shared by all the blocks. Blocks that have not started yet when stop is requested or the deadline passes are dropped without being executed, and blocks that are already running can check for this using `BS::this_thread::stop_requested()` in order to exit early. Does not return a `BS::multi_future`, so the user must use `wait()` or some other method to ensure that the loop finishes executing, otherwise bad things will happen.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no blocks will be submitted.
+     * @param block A function that will be called once per block. Should take exactly two arguments: the first index in the block and the index after the last index in the block. `block(start, end)` should typically involve a loop of the form `for (T i = start; i < end; ++i)`.
+     * @param stop The stop condition: an `std::stop_token` (in C++20 and later), a deadline, or both.
+     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
+    void detach_blocks(const T1 first_index, const T2 index_after_last, F&& block, const stop_condition& stop, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    {
+        detach_blocks(static_cast<T>(first_index), static_cast<T>(index_after_last), make_stoppable_task(stop, std::forward<F>(block)), num_blocks, priority);
+    }
+
+    /**
+     * @brief Parallelize a loop by splitting it into chunks according to the specified scheduling policy, with the specified priority. The block function takes two arguments, the start and end of a chunk. With `BS::schedule::static_blocks`, the range is divided into blocks in advance and each block is submitted separately to the queue, as in the overload that takes the number of blocks. With `BS::schedule::dynamic` or `BS::schedule::guided`, one task is submitted per thread, and each task repeatedly claims the next chunk of the range from a shared counter until the range is exhausted, which avoids leaving threads idle when the time it takes to process each index varies. Note that in the latter case the block function may be called several times by the same task. Does not return a `BS::multi_future`, so the user must use `wait()` or some other method to ensure that the loop finishes executing, otherwise bad things will happen.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no tasks will be submitted.
+     * @param block A function that will be called once per chunk. Should take exactly two arguments: the first index in the chunk and the index after the last index in the chunk. `block(start, end)` should typically involve a loop of the form `for (T i = start; i < end; ++i)`.
+     * @param policy The scheduling policy: `BS::schedule::static_blocks`, `BS::schedule::dynamic`, or `BS::schedule::guided`.
+     * @param chunk_size For `BS::schedule::static_blocks` and `BS::schedule::dynamic`, the size of each chunk. For `BS::schedule::guided`, the minimum size of each chunk. The default is 0, which means the size will be chosen automatically: for `BS::schedule::static_blocks`, the range will be split into as many blocks as there are threads in the pool; for `BS::schedule::dynamic`, each thread will claim 8 chunks on average; for `BS::schedule::guided`, the minimum size will be 1.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
+    void detach_blocks(const T1 first_index, const T2 index_after_last, F&& block, const BS::schedule policy, const std::size_t chunk_size = 0, const priority_t priority = 0)
+    {
+        if (policy == BS::schedule::static_blocks)
+        {
+            detach_blocks(static_cast<T>(first_index), static_cast<T>(index_after_last), std::forward<F>(block), num_blocks_for_chunk_size(static_cast<T>(first_index), static_cast<T>(index_after_last), chunk_size), priority);
+        }
+        else if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        {
+            const std::shared_ptr<dynamic_loop<T, std::decay_t<F>>> loop_ptr = std::make_shared<dynamic_loop<T, std::decay_t<F>>>(static_cast<T>(first_index), static_cast<T>(index_after_last), policy, chunk_size, thread_count, std::forward<F>(block));
+            detach_batch(
+                loop_ptr->blks.get_num_tasks(),
+                [&loop_ptr](std::size_t)
+                {
+                    return [loop_ptr]
+                    {
+                        T start = 0;
+                        T end = 0;
+                        while (loop_ptr->blks.next(start, end))
+                            loop_ptr->func(start, end);
+                    };
+                },
+                priority);
+        }
+    }
+
+    /**
+     * @brief Parallelize a loop by automatically splitting it into blocks and submitting each block separately to the queue, with the specified priority. The loop function takes one argument, the loop index, so that it is called many times per block. Does not return a `BS::multi_future`, so the user must use `wait()` or some other method to ensure that the loop finishes executing, otherwise bad things will happen.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no blocks will be submitted.
+     * @param loop The function to loop through. Will be called once per index, many times per block. Should take exactly one argument: the loop index.
+     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
+    void detach_loop(const T1 first_index, const T2 index_after_last, F&& loop, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    {
+        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        {
+            const blocks blks(static_cast<T>(first_index), static_cast<T>(index_after_last), num_blocks ? num_blocks : thread_count);
+            typename loop_state<std::decay_t<F>>::issuer loop_refs(blks.get_num_blocks(), *this, std::forward<F>(loop));
+            detach_batch(
+                blks.get_num_blocks(),
+                [&loop_refs, &blks](const std::size_t blk)
+                {
+                    return [loop_ref = loop_refs.next(), start = blks.start(blk), end = blks.end(blk)]
+                    {
+                        for (T i = start; i < end; ++i)
+                            (*loop_ref)(i);
+                    };
+                },
+                priority);
+        }
+    }
+
+    /**
+     * @brief Parallelize a loop by automatically splitting it into blocks and submitting each block separately to the queue, with the specified priority, exactly like the overload that takes the number of blocks, but with a stop condition shared by all the blocks. Blocks that have not started yet when stop is requested or the deadline passes are dropped without being executed, and the loop function can check for this using `BS::this_thread::stop_requested()` in order to exit early. Does not return a `BS::multi_future`, so the user must use `wait()` or some other method to ensure that the loop finishes executing, otherwise bad things will happen.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no blocks will be submitted.
+     * @param loop The function to loop through. Will be called once per index, many times per block. Should take exactly one argument: the loop index.
+     * @param stop The stop condition: an `std::stop_token` (in C++20 and later), a deadline, or both.
+     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
+    void detach_loop(const T1 first_index, const T2 index_after_last, F&& loop, const stop_condition& stop, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    {
+        detach_blocks(static_cast<T>(first_index), static_cast<T>(index_after_last), make_loop_block<T>(std::forward<F>(loop)), stop, num_blocks, priority);
+    }
+
+    /**
+     * @brief Parallelize a loop by splitting it into chunks according to the specified scheduling policy, with the specified priority. The loop function takes one argument, the loop index, so that it is called many times per chunk. With `BS::schedule::static_blocks`, the range is divided into blocks in advance and each block is submitted separately to the queue, as in the overload that takes the number of blocks. With `BS::schedule::dynamic` or `BS::schedule::guided`, one task is submitted per thread, and each task repeatedly claims the next chunk of the range from a shared counter until the range is exhausted, which avoids leaving threads idle when the time it takes to process each index varies. Does not return a `BS::multi_future`, so the user must use `wait()` or some other method to ensure that the loop finishes executing, otherwise bad things will happen.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no tasks will be submitted.
+     * @param loop The function to loop through. Will be called once per index. Should take exactly one argument: the loop index. It cannot have a return value.
+     * @param policy The scheduling policy: `BS::schedule::static_blocks`, `BS::schedule::dynamic`, or `BS::schedule::guided`.
+     * @param chunk_size For `BS::schedule::static_blocks` and `BS::schedule::dynamic`, the size of each chunk. For `BS::schedule::guided`, the minimum size of each chunk. The default is 0, which means the size will be chosen automatically: for `BS::schedule::static_blocks`, the range will be split into as many blocks as there are threads in the pool; for `BS::schedule::dynamic`, each thread will claim 8 chunks on average; for `BS::schedule::guided`, the minimum size will be 1.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
+    void detach_loop(const T1 first_index, const T2 index_after_last, F&& loop, const BS::schedule policy, const std::size_t chunk_size = 0, const priority_t priority = 0)
+    {
+        if (policy == BS::schedule::static_blocks)
+        {
+            detach_loop(static_cast<T>(first_index), static_cast<T>(index_after_last), std::forward<F>(loop), num_blocks_for_chunk_size(static_cast<T>(first_index), static_cast<T>(index_after_last), chunk_size), priority);
+        }
+        else if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        {
+            const std::shared_ptr<dynamic_loop<T, std::decay_t<F>>> loop_ptr = std::make_shared<dynamic_loop<T, std::decay_t<F>>>(static_cast<T>(first_index), static_cast<T>(index_after_last), policy, chunk_size, thread_count, std::forward<F>(loop));
+            detach_batch(
+                loop_ptr->blks.get_num_tasks(),
+                [&loop_ptr](std::size_t)
+                {
+                    return [loop_ptr]
+                    {
+                        T start = 0;
+                        T end = 0;
+                        while (loop_ptr->blks.next(start, end))
+                        {
+                            for (T i = start; i < end; ++i)
+                                loop_ptr->func(i);
+                        }
+                    };
+                },
+                priority);
+        }
+    }
+
+    /**
+     * @brief Submit a sequence of tasks enumerated by indices to the queue, with the specified priority. The sequence function takes one argument, the task index, and will be called once per index. Does not return a `BS::multi_future`, so the user must use `wait()` or some other method to ensure that the sequence finishes executing, otherwise bad things will happen.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function used to define the sequence.
+     * @param first_index The first index in the sequence.
+     * @param index_after_last The index after the last index in the sequence. The sequence will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no tasks will be submitted.
+     * @param sequence The function used to define the sequence. Will be called once per index. Should take exactly one argument, the index.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
+    void detach_sequence(const T1 first_index, const T2 index_after_last, F&& sequence, const priority_t priority = 0)
+    {
+        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        {
+            const std::size_t count = static_cast<std::size_t>(static_cast<T>(index_after_last) - static_cast<T>(first_index));
+            typename loop_state<std::decay_t<F>>::issuer sequence_refs(count, *this, std::forward<F>(sequence));
+            detach_batch(
+                count,
+                [&sequence_refs, first = static_cast<T>(first_index)](const std::size_t idx)
+                {
+                    return [sequence_ref = sequence_refs.next(), i = static_cast<T>(first + static_cast<T>(idx))]
+                    {
+                        (*sequence_ref)(i);
+                    };
+                },
+                priority);
+        }
+    }
+
+    /**
+     * @brief Submit a sequence of tasks enumerated by indices to the queue, with the specified priority, exactly like the overload without a stop condition, but with a stop condition shared by all the tasks. Tasks that have not started yet when stop is requested or the deadline passes are dropped without being executed, and tasks that are already running can check for this using `BS::this_thread::stop_requested()` in order to exit early. Does not return a `BS::multi_future`, so the user must use `wait()` or some other method to ensure that the sequence finishes executing, otherwise bad things will happen.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function used to define the sequence.
+     * @param first_index The first index in the sequence.
+     * @param index_after_last The index after the last index in the sequence. The sequence will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no tasks will be submitted.
+     * @param sequence The function used to define the sequence. Will be called once per index. Should take exactly one argument, the index.
+     * @param stop The stop condition: an `std::stop_token` (in C++20 and later), a deadline, or both.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
+    void detach_sequence(const T1 first_index, const T2 index_after_last, F&& sequence, const stop_condition& stop, const priority_t priority = 0)
+    {
+        detach_sequence(static_cast<T>(first_index), static_cast<T>(index_after_last), make_stoppable_task(stop, std::forward<F>(sequence)), priority);
+    }
+
+    /**
+     * @brief Submit a function with no arguments and no return value into the task queue, with the specified priority. To submit a function with arguments, enclose it in a lambda expression. Does not return a future, so the user must use `wait()` or some other method to ensure that the task finishes executing, otherwise bad things will happen. If the flag `BS::tp::work_stealing` is enabled in the template parameter and this function is called from within a thread of the same pool, the task is placed in that thread's local queue instead of the global queue (unless task priority is enabled and the priority is not 0). If the flag `BS::tp::lock_free` is enabled, the task is placed in the lock-free queue, unless it is full. If a queue capacity was set using `set_queue_capacity()` and the queue is full, blocks until there is room in the queue, unless this function is called from within a thread of the same pool.
+     *
+     * @tparam F The type of the function.
+     * @param task The function to submit.
+     * @param priority The priority of the task. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename F>
+    void detach_task(F&& task, const priority_t priority = 0)
+    {
+        enqueue_task(std::forward<F>(task), priority, std::chrono::steady_clock::time_point::max());
+    }
+
+    /**
+     * @brief Submit a function with no arguments and no return value into the task queue, with the specified priority and stop condition. If stop is requested or the deadline passes before a thread takes the task out of the queue, the task is dropped without being executed; while it is running, it can check for this using `BS::this_thread::stop_requested()` in order to exit early. Otherwise, behaves exactly like the overload without a stop condition.
+     *
+     * @tparam F The type of the function.
+     * @param task The function to submit.
+     * @param stop The stop condition: an `std::stop_token` (in C++20 and later), a deadline, or both.
+     * @param priority The priority of the task. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename F>
+    void detach_task(F&& task, const stop_condition& stop, const priority_t priority = 0)
+    {
+        detach_task(make_stoppable_task(stop, std::forward<F>(task)), priority);
+    }
+
+    /**
+     * @brief Submit a function with no arguments and no return value into the task queue, with the specified priority, waiting for at most the given duration for room in the queue if a queue capacity was set using `set_queue_capacity()` and the queue is full. Otherwise, behaves exactly like `detach_task()`. If the task could not be submitted, it is left untouched, so the caller may try again later.
+     *
+     * @tparam F The type of the function.
+     * @tparam R An arithmetic type representing the number of ticks to wait.
+     * @tparam P An `std::ratio` representing the length of each tick in seconds.
+     * @param task The function to submit.
+     * @param duration The maximum time to wait for room in the queue.
+     * @param priority The priority of the task. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return `true` if the task was submitted, `false` if the queue was still full when the duration expired.
+     */
+    template <typename F, typename R, typename P>
+    bool detach_task_for(F&& task, const std::chrono::duration<R, P>& duration, const priority_t priority = 0)
+    {
+        return enqueue_task(std::forward<F>(task), priority, std::chrono::steady_clock::now() + std::chrono::ceil<std::chrono::steady_clock::duration>(duration));
+    }
+
+    /**
+     * @brief Submit a function with no arguments and no return value into the queue of a specific NUMA node. To submit a function with arguments, enclose it in a lambda expression. Does not return a future, so the user must use `wait()` or some other method to ensure that the task finishes executing, otherwise bad things will happen. The threads assigned to the given node take tasks from its queue before any other tasks except those in their own local queues, and threads on other nodes only take them once they have run out of tasks on their own node. Task priority is not taken into account. If a queue capacity was set using `set_queue_capacity()` and the queue is full, blocks until there is room in the queue, unless this function is called from within a thread of the same pool. Only enabled if the flag `BS:tp::numa` is enabled in the template parameter.
+     *
+     * @tparam F The type of the function.
+     * @param node The index of the NUMA node, in the range `[0, N)` where `N == get_numa_node_count()`. Larger values wrap around.
+     * @param task The function to submit.
+     */
+    template <typename F>
+    void detach_task_on_node(const std::size_t node, F&& task)
+    {
+        static_assert(numa_enabled, "detach_task_on_node() is only available if the flag BS::tp::numa is enabled.");
+        const bool bounded = (queue_capacity.load(std::memory_order_relaxed) != 0) && (this_thread::get_pool() != this);
+        push_node_task(node % numa_nodes.size(), stamp_task(std::forward<F>(task)), bounded);
+    }
+
+    /**
+     * @brief Submit a function with no arguments and no return value into the mailbox of a specific thread in the pool. To submit a function with arguments, enclose it in a lambda expression. Does not return a future, so the user must use `wait()` or some other method to ensure that the task finishes executing, otherwise bad things will happen. Each thread takes the tasks in its mailbox before any other tasks, in the order they were submitted, and other threads never take tasks out of it, unless mailbox stealing is enabled using `set_mailbox_stealing()`. Therefore, tasks submitted to the same thread from the same thread are executed one after the other, in order, by that thread, which can be used together with `BS::this_thread::set_os_thread_affinity()` to keep the data used by the tasks in the cache of a specific core. Task priority is not taken into account. If a queue capacity was set using `set_queue_capacity()` and the queue is full, blocks until there is room in the queue, unless this function is called from within a thread of the same pool. Only enabled if the flag `BS:tp::work_stealing` or `BS:tp::numa` is enabled in the template parameter, and not available if the flag `BS:tp::elastic` is enabled, since the thread may have retired.
+     *
+     * @tparam F The type of the function.
+     * @param worker The index of the thread, in the range `[0, N)` where `N == get_thread_count()`. Larger values wrap around.
+     * @param task The function to submit.
+     */
+    template <typename F>
+    void detach_task_to(const std::size_t worker, F&& task)
+    {
+        static_assert(work_stealing_enabled && !elastic_enabled, "detach_task_to() is only available if the flag BS::tp::work_stealing or BS::tp::numa is enabled, and the flag BS::tp::elastic is not enabled.");
+        const bool bounded = (queue_capacity.load(std::memory_order_relaxed) != 0) && (this_thread::get_pool() != this);
+        push_mailbox_task(worker % thread_count, stamp_task(std::forward<F>(task)), bounded);
+    }
+
+    /**
+     * @brief Submit a function with no arguments and no return value into the mailbox of one of a subset of the threads in the pool, given as a mask. Of the selected threads, the task is submitted to the one with the fewest tasks in its mailbox, or the first one if there is a tie. Otherwise, behaves exactly like the overload that takes the index of a thread. If the mask does not select any of the threads, the task is submitted as if using `detach_task()`. Only enabled if the flag `BS:tp::work_stealing` or `BS:tp::numa` is enabled in the template parameter, and not available if the flag `BS:tp::elastic` is enabled.
+     *
+     * @tparam F The type of the function.
+     * @param workers A mask of the threads to choose from: thread `i` may be chosen if `workers[i]` is `true`. Elements beyond the number of threads are ignored.
+     * @param task The function to submit.
+     */
+    template <typename F>
+    void detach_task_to(const std::vector<bool>& workers, F&& task)
+    {
+        const std::optional<std::size_t> worker = select_worker(workers);
+        if (worker.has_value())
+            detach_task_to(*worker, std::forward<F>(task));
+        else
+            detach_task(std::forward<F>(task));
+    }
+
+    /**
+     * @brief Get the number of threads currently running in the pool. This is at least the minimum number of threads set using `set_min_threads()`, and at most the maximum number of threads, `get_thread_count()`. Only enabled if the flag `BS:tp::elastic` is enabled in the template parameter.
+     *
+     * @return The number of running threads.
+     */
+    BS_THREAD_POOL_IF_ELASTIC_ENABLED
+    [[nodiscard]] std::size_t get_active_thread_count() const noexcept
+    {
+        return active_threads.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the number of threads currently inside a `BS::this_thread::blocking_region`. Only enabled if the flag `BS:tp::elastic` is enabled in the template parameter.
+     *
+     * @return The number of blocked threads.
+     */
+    BS_THREAD_POOL_IF_ELASTIC_ENABLED
+    [[nodiscard]] std::size_t get_blocked_thread_count() const noexcept
+    {
+        return blocked_threads.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the idle timeout: how long a thread waits for a new task before it retires, if there are more than the minimum number of threads. Only enabled if the flag `BS:tp::elastic` is enabled in the template parameter.
+     *
+     * @return The idle timeout.
+     */
+    BS_THREAD_POOL_IF_ELASTIC_ENABLED
+    [[nodiscard]] std::chrono::milliseconds get_idle_timeout() const
+    {
+        const std::scoped_lock tasks_lock(tasks_mutex);
+        return idle_timeout;
+    }
+
+    /**
+     * @brief Check whether mailbox stealing is enabled, that is, whether idle threads may take tasks out of the mailboxes of other threads. Only enabled if the flag `BS:tp::work_stealing` or `BS:tp::numa` is enabled in the template parameter.
+     *
+     * @return `true` if mailbox stealing is enabled, `false` otherwise.
+     */
+    BS_THREAD_POOL_IF_WORK_STEALING_ENABLED
+    [[nodiscard]] bool get_mailbox_stealing() const noexcept
+    {
+        return mailbox_stealing.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the minimum number of threads. Only enabled if the flag `BS:tp::elastic` is enabled in the template parameter.
+     *
+     * @return The minimum number of threads.
+     */
+    BS_THREAD_POOL_IF_ELASTIC_ENABLED
+    [[nodiscard]] std::size_t get_min_threads() const
+    {
+        const std::scoped_lock tasks_lock(tasks_mutex);
+        return min_threads;
+    }
+
+#ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
+    /**
+     * @brief Get a vector containing the underlying implementation-defined thread handles for each of the pool's threads, as obtained by `std::thread::native_handle()` (or `std::jthread::native_handle()` in C++20 and later). If the flag `BS::tp::elastic` is enabled in the template parameter, the vector has one element per thread index up to the maximum number of threads, and elements for indices that currently have no running thread are value-initialized.
+     *
+     * @return The native thread handles.
+     */
+    [[nodiscard]] std::vector<thread_t::native_handle_type> get_native_handles() const
+    {
+        // In an elastic pool, the threads are replaced by the workers while holding the global mutex, so it must be locked to read them.
+        const std::scoped_lock tasks_lock(tasks_mutex);
+        std::vector<thread_t::native_handle_type> native_handles(thread_count);
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            if constexpr (elastic_enabled)
+            {
+                if (!thread_active[i])
+                    continue;
+            }
+            native_handles[i] = threads[i].native_handle();
+        }
+        return native_handles;
+    }
+#endif
+
+    /**
+     * @brief Get the number of NUMA nodes used by the pool: the nodes that contain at least one logical processor available to the process. If the topology could not be determined, for example because native extensions are disabled or the platform is macOS, the pool treats the whole system as a single node. Only enabled if the flag `BS:tp::numa` is enabled in the template parameter.
+     *
+     * @return The number of NUMA nodes.
+     */
+    BS_THREAD_POOL_IF_NUMA_ENABLED
+    [[nodiscard]] std::size_t get_numa_node_count() const noexcept
+    {
+        return numa_nodes.size();
+    }
+
+    /**
+     * @brief Get the queue capacity: the maximum number of tasks that may be waiting in the queues before submitting a task from outside the pool blocks or fails. See `set_queue_capacity()` for more details.
+     *
+     * @return The queue capacity, or 0 if the queue is unbounded.
+     */
+    [[nodiscard]] std::size_t get_queue_capacity() const noexcept
+    {
+        return queue_capacity.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the spin budget: the number of iterations an idle worker spins, looking for a new task, before going to sleep. See `set_spin_budget()` for more details.
+     *
+     * @return The spin budget.
+     */
+    [[nodiscard]] std::size_t get_spin_budget() const noexcept
+    {
+        return spin_budget.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get the number of workers that are currently spinning, looking for a new task before going to sleep. Always 0 if the spin budget is 0.
+     *
+     * @return The number of spinning workers.
+     */
+    [[nodiscard]] std::size_t get_spinning_workers() const noexcept
+    {
+        return spinning_workers.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get a snapshot of the statistics collected by all the threads in the pool since it was created, including threads that no longer exist because the pool was reset. Only enabled if the flag `BS:tp::statistics` is enabled in the template parameter.
+     *
+     * @return The statistics.
+     */
+    BS_THREAD_POOL_IF_STATISTICS_ENABLED
+    [[nodiscard]] pool_statistics get_statistics() const
+    {
+        const std::scoped_lock tasks_lock(tasks_mutex);
+        pool_statistics result = retired_statistics;
+        for (std::size_t i = 0; i < thread_count; ++i)
+            result.merge(thread_statistics[i].snapshot());
+        return result;
+    }
+
+    /**
+     * @brief Get the number of tasks currently waiting in the queue to be executed by the threads. This function only reads atomic counters and does not lock the global mutex, so it is wait-free and can be called as often as needed, for example by a monitoring thread, without slowing down the pool. If tasks are being submitted or executed at the same time, the result may already be outdated when it is returned.
+     *
+     * @return The number of queued tasks.
+     */
+    [[nodiscard]] std::size_t get_tasks_queued() const noexcept
+    {
+        return load_queued_tasks();
+    }
+
+    /**
+     * @brief Get the number of tasks currently being executed by the threads. If work stealing is enabled, this also counts threads that are in the process of looking for a task in the local queues. This function only reads an atomic counter and does not lock the global mutex, so it is wait-free.
+     *
+     * @return The number of running tasks.
+     */
+    [[nodiscard]] std::size_t get_tasks_running() const noexcept
+    {
+        return tasks_running.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Get the total number of unfinished tasks: either still waiting in the queue, or running in a thread. Note that `get_tasks_total() == get_tasks_queued() + get_tasks_running()`, except for tasks that are submitted, taken out of the queue, or finished while the counters are being read. This function only reads atomic counters and does not lock the global mutex, so it is wait-free.
+     *
+     * @return The total number of tasks.
+     */
+    [[nodiscard]] std::size_t get_tasks_total() const noexcept
+    {
+        // The queued tasks are read first: a worker is counted as running before it takes a task out of the queue, so a task in transit may be counted twice, but is never missed.
+        const std::size_t queued = load_queued_tasks();
+        return queued + tasks_running.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Get the number of threads in the pool. If the flag `BS::tp::elastic` is enabled in the template parameter, this is the maximum number of threads; use `get_active_thread_count()` to get the number of threads currently running.
+     *
+     * @return The number of threads.
+     */
+    [[nodiscard]] std::size_t get_thread_count() const noexcept
+    {
+        return thread_count;
+    }
+
+    /**
+     * @brief Get a vector containing the unique identifiers for each of the pool's threads, as obtained by `std::thread::get_id()` (or `std::jthread::get_id()` in C++20 and later). If the flag `BS::tp::elastic` is enabled in the template parameter, the vector has one element per thread index up to the maximum number of threads, and elements for indices that currently have no running thread are default-constructed.
+     *
+     * @return The unique thread identifiers.
+     */
+    [[nodiscard]] std::vector<thread_t::id> get_thread_ids() const
+    {
+        // In an elastic pool, the threads are replaced by the workers while holding the global mutex, so it must be locked to read them.
+        const std::scoped_lock tasks_lock(tasks_mutex);
+        std::vector<thread_t::id> thread_ids(thread_count);
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            if constexpr (elastic_enabled)
+            {
+                if (!thread_active[i])
+                    continue;
+            }
+            thread_ids[i] = threads[i].get_id();
+        }
+        return thread_ids;
+    }
+
+    /**
+     * @brief Get the NUMA node that a thread in the pool is assigned to. The threads are divided evenly between the nodes, in order of their indices, and if there is more than one node, each thread is pinned to the logical processors of its node when it starts, before the initialization function runs. Only enabled if the flag `BS:tp::numa` is enabled in the template parameter.
+     *
+     * @param thread_idx The index of the thread, in the range `[0, N)` where `N == get_thread_count()`.
+     * @return The index of the node, in the range `[0, N)` where `N == get_numa_node_count()`.
+     */
+    BS_THREAD_POOL_IF_NUMA_ENABLED
+    [[nodiscard]] std::size_t get_thread_numa_node(const std::size_t thread_idx) const noexcept
+    {
+        return thread_nodes[thread_idx];
+    }
+
+    /**
+     * @brief Get a snapshot of the statistics collected by a single thread in the pool since the thread was created, that is, since the pool was created or last reset. Only enabled if the flag `BS:tp::statistics` is enabled in the template parameter.
+     *
+     * @param thread_idx The index of the thread, in the range `[0, N)` where `N == get_thread_count()`.
+     * @return The statistics.
+     */
+    BS_THREAD_POOL_IF_STATISTICS_ENABLED
+    [[nodiscard]] pool_statistics get_thread_statistics(const std::size_t thread_idx) const
+    {
+        const std::scoped_lock tasks_lock(tasks_mutex);
+        return thread_statistics[thread_idx].snapshot();
+    }
+
+    /**
+     * @brief Get the events recorded in the trace buffers of the threads, one per task executed, ordered by thread index and then by the time at which each thread started executing the task. Each thread only keeps the last `BS::trace_buffer_size` events; older events are overwritten. The buffers are read without stopping the threads, so events recorded while this function is running may or may not be included, and the global mutex is only locked briefly. The buffers of threads that no longer exist because the pool was reset with fewer threads are included as well. Only enabled if the flag `BS:tp::trace` is enabled in the template parameter.
+     *
+     * @return The events.
+     */
+    BS_THREAD_POOL_IF_TRACE_ENABLED
+    [[nodiscard]] std::vector<trace_event> get_trace() const
+    {
+        std::vector<trace_event> events;
+        const std::vector<trace_buffer*> buffers = get_trace_buffers();
+        for (std::size_t i = 0; i < buffers.size(); ++i)
+            buffers[i]->read(i, events);
+        return events;
+    }
+
+    /**
+     * @brief Check whether the pool is currently paused. Only enabled if the flag `BS:tp::pause` is enabled in the template parameter.
+     *
+     * @return `true` if the pool is paused, `false` if it is not paused.
+     */
+    BS_THREAD_POOL_IF_PAUSE_ENABLED
+    [[nodiscard]] bool is_paused() const
+    {
+        const std::scoped_lock tasks_lock(tasks_mutex);
+        return paused;
+    }
+
+    /**
+     * @brief Pause the pool. The workers will temporarily stop retrieving new tasks out of the queue, although any tasks already executed will keep running until they are finished. Only enabled if the flag `BS:tp::pause` is enabled in the template parameter.
+     */
+    BS_THREAD_POOL_IF_PAUSE_ENABLED
+    void pause()
+    {
+        const std::scoped_lock tasks_lock(tasks_mutex);
+        paused = true;
+    }
+
+    /**
+     * @brief Purge all the tasks waiting in the queue. Tasks that are currently running will not be affected, but any tasks still waiting in the queue will be discarded, and will never be executed by the threads. If work stealing, NUMA-aware scheduling, or the lock-free queue are enabled, the local queues and mailboxes, node queues, and/or the lock-free queue are purged as well. Please note that there is no way to restore the purged tasks.
+     */
+    void purge()
+    {
+        const std::scoped_lock tasks_lock(tasks_mutex);
+        tasks = {};
+        global_tasks_queued.store(0, std::memory_order_relaxed);
+        if constexpr (work_stealing_enabled)
+        {
+            for (std::size_t i = 0; i < thread_count; ++i)
+            {
+                const std::scoped_lock local_lock(local_queues[i].mutex);
+                local_tasks_queued -= local_queues[i].tasks.size();
+                local_queues[i].tasks.clear();
+                mailbox_tasks_queued -= local_queues[i].mailbox.size();
+                local_queues[i].mailbox.clear();
+                local_queues[i].mailbox_size.store(0, std::memory_order_relaxed);
+            }
+        }
+        if constexpr (numa_enabled)
+        {
+            for (std::size_t i = 0; i < numa_nodes.size(); ++i)
+            {
+                const std::scoped_lock node_lock(node_queues[i].mutex);
+                local_tasks_queued -= node_queues[i].tasks.size();
+                node_queues[i].tasks.clear();
+            }
+        }
+        if constexpr (lock_free_enabled)
+        {
+            task_t task;
+            while (lock_free_tasks.try_pop(task))
+                task = {};
+        }
+        if (space_waiters > 0)
+            task_space_cv.notify_all();
+    }
+
+    /**
+     * @brief Reset the pool with the total number of hardware threads available, as reported by the implementation. Waits for all currently running tasks to be completed, then destroys all threads in the pool and creates a new thread pool with the new number of threads. Any tasks that were waiting in the queue before the pool was reset will then be executed by the new threads. If the pool was paused before resetting it, the new pool will be paused as well.
+     */
+    void reset()
+    {
+        reset(0, [](std::size_t) {});
+    }
+
+    /**
+     * @brief Reset the pool with a new number of threads. Waits for all currently running tasks to be completed, then destroys all threads in the pool and creates a new thread pool with the new number of threads. Any tasks that were waiting in the queue before the pool was reset will then be executed by the new threads. If the pool was paused before resetting it, the new pool will be paused as well.
+     *
+     * @param num_threads The number of threads to use.
+     */
+    void reset(const std::size_t num_threads)
+    {
+        reset(num_threads, [](std::size_t) {});
+    }
+
+    /**
+     * @brief Reset the pool with the total number of hardware threads available, as reported by the implementation, and a new initialization function. Waits for all currently running tasks to be completed, then destroys all threads in the pool and creates a new thread pool with the new number of threads and initialization function. Any tasks that were waiting in the queue before the pool was reset will then be executed by the new threads. If the pool was paused before resetting it, the new pool will be paused as well.
+     *
+     * @param init An initialization function to run in each thread before it starts executing any submitted tasks. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. It will be executed exactly once per thread, when the thread is first constructed. The initialization function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function.
+     */
+    template <BS_THREAD_POOL_INIT_FUNC_CONCEPT(F)>
+    void reset(F&& init)
+    {
+        reset(0, std::forward<F>(init));
+    }
+
+    /**
+     * @brief Reset the pool with a new number of threads and a new initialization function. Waits for all currently running tasks to be completed, then destroys all threads in the pool and creates a new thread pool with the new number of threads and initialization function. Any tasks that were waiting in the queue before the pool was reset will then be executed by the new threads. If the pool was paused before resetting it, the new pool will be paused as well.
+     *
+     * @param num_threads The number of threads to use.
+     * @param init An initialization function to run in each thread before it starts executing any submitted tasks. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. It will be executed exactly once per thread, when the thread is first constructed. The initialization function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function.
+     */
+    template <BS_THREAD_POOL_INIT_FUNC_CONCEPT(F)>
+    void reset(const std::size_t num_threads, F&& init)
+    {
+        if constexpr (pause_enabled)
+        {
+            std::unique_lock tasks_lock(tasks_mutex);
+            const bool was_paused = paused;
+            paused = true;
+            tasks_lock.unlock();
+            reset_pool(num_threads, std::forward<F>(init));
+            tasks_lock.lock();
+            paused = was_paused;
+        }
+        else
+        {
+            reset_pool(num_threads, std::forward<F>(init));
+        }
+    }
+
+    /**
+     * @brief Parallelize a loop by automatically splitting it into blocks, and execute the blocks both in the pool and in the calling thread, returning only when all the blocks have finished. The calling thread claims and executes blocks alongside the threads of the pool, instead of sitting idle while waiting for them, and only the blocks claimed by other threads need to finish before the function returns. If the function is called from within a thread of the same pool, for example to parallelize an inner loop, that thread takes part in the loop, so this cannot deadlock even if all the other threads are busy; in the worst case, the calling thread executes all the blocks itself. The block function is not copied or moved, and all the bookkeeping is done using a single control block.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, the function returns immediately.
+     * @param block A function that will be called once per block. Should take exactly two arguments: the first index in the block and the index after the last index in the block, and have no return value. `block(start, end)` should typically involve a loop of the form `for (T i = start; i < end; ++i)`. If exceptions are enabled and any of the blocks throws an exception, the blocks that have not started yet are skipped, and the first exception is rethrown by this function once the blocks that already started have finished.
+     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
+     * @param priority The priority of the helper tasks submitted to the queue. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
+    void run_blocks(const T1 first_index, const T2 index_after_last, F&& block, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    {
+        static_assert(std::is_void_v<std::invoke_result_t<std::remove_reference_t<F>&, T, T>>, "The block function passed to run_blocks() cannot have a return value. Please use submit_blocks() instead.");
+        if (static_cast<T>(index_after_last) <= static_cast<T>(first_index))
+            return;
+        const blocks blks(static_cast<T>(first_index), static_cast<T>(index_after_last), num_blocks ? num_blocks : thread_count);
+        const std::size_t other_threads = (this_thread::get_pool() == this) ? thread_count - 1 : thread_count;
+        const std::size_t num_helpers = std::min(blks.get_num_blocks() - 1, other_threads);
+        using state_t = fork_join_state<T, std::remove_reference_t<F>>;
+        typename loop_state<state_t>::issuer refs(num_helpers + 1, *this, blks, block);
+        const typename loop_state<state_t>::ref caller_ref = refs.next();
+        if (num_helpers > 0)
+        {
+            detach_batch(
+                num_helpers,
+                [&refs](const std::size_t)
+                {
+                    return [ref = refs.next()]
+                    {
+                        (*ref).help();
+                    };
+                },
+                priority);
+        }
+        (*caller_ref).help();
+        (*caller_ref).wait();
+    }
+
+    /**
+     * @brief Parallelize a loop by automatically splitting it into blocks, and execute the blocks both in the pool and in the calling thread, returning only when all the blocks have finished, exactly like `run_blocks()`, but with a function that is called once per index. The calling thread takes part in the loop, so this can be safely used to parallelize an inner loop from within a thread of the same pool.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, the function returns immediately.
+     * @param loop The function to loop through. Will be called once per index, many times per block. Should take exactly one argument: the loop index. If exceptions are enabled and the function throws an exception, the blocks that have not started yet are skipped, and the first exception is rethrown by this function once the blocks that already started have finished.
+     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
+     * @param priority The priority of the helper tasks submitted to the queue. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
+    void run_loop(const T1 first_index, const T2 index_after_last, F&& loop, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    {
+        run_blocks(
+            static_cast<T>(first_index), static_cast<T>(index_after_last),
+            [&loop](const T start, const T end)
+            {
+                for (T i = start; i < end; ++i)
+                    loop(i);
+            },
+            num_blocks, priority);
+    }
+
+    /**
+     * @brief Set the thread pool's cleanup function.
+     *
+     * @param cleanup A cleanup function to run in each thread right before it is destroyed, which will happen when the pool is destructed or reset. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. The cleanup function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function.
+     */
+    template <BS_THREAD_POOL_INIT_FUNC_CONCEPT(F)>
+    void set_cleanup_func(F&& cleanup)
+    {
+        if constexpr (std::is_invocable_v<F, std::size_t>)
+        {
+            cleanup_func = std::forward<F>(cleanup);
+        }
+        else
+        {
+            cleanup_func = [cleanup = std::forward<F>(cleanup)](std::size_t)
+            {
+                cleanup();
+            };
+        }
+    }
+
+    /**
+     * @brief Set the idle timeout: how long a thread waits for a new task before it retires, if there are more than the minimum number of threads running that are not blocked. The default is 1 second. Threads that are already waiting use the new timeout the next time they wait. Only enabled if the flag `BS:tp::elastic` is enabled in the template parameter.
+     *
+     * @param timeout The idle timeout.
+     */
+    BS_THREAD_POOL_IF_ELASTIC_ENABLED
+    void set_idle_timeout(const std::chrono::milliseconds timeout)
+    {
+        const std::scoped_lock tasks_lock(tasks_mutex);
+        idle_timeout = timeout;
+    }
+
+    /**
+     * @brief Enable or disable mailbox stealing. If enabled, a thread that has run out of tasks in its own mailbox, its local queue, the global queue, and the local queues of the other threads, takes the oldest task from the mailbox of another thread, so that tasks submitted using `detach_task_to()` or `submit_task_to()` can still be executed by another thread if their thread is busy, at the cost of no longer being guaranteed to run on that thread, or in order. The default is `false`. Only enabled if the flag `BS:tp::work_stealing` or `BS:tp::numa` is enabled in the template parameter.
+     *
+     * @param enable `true` to enable mailbox stealing, `false` to disable it.
+     */
+    BS_THREAD_POOL_IF_WORK_STEALING_ENABLED
+    void set_mailbox_stealing(const bool enable)
+    {
+        {
+            const std::scoped_lock tasks_lock(tasks_mutex);
+            mailbox_stealing.store(enable, std::memory_order_relaxed);
+        }
+        // Idle threads may now be able to take tasks out of the mailboxes of other threads.
+        if (enable)
+            task_available_cv.notify_all();
+    }
+
+    /**
+     * @brief Set the minimum number of threads: the pool keeps at least this many threads running that are not blocked, even when there are no tasks, and starts new threads right away when they get blocked. If the minimum is raised, new threads are started immediately; if it is lowered, the extra threads retire once they have been idle for the idle timeout. Values larger than `get_thread_count()` are treated as equal to it. The default is 1. The minimum is kept when the pool is reset. Only enabled if the flag `BS:tp::elastic` is enabled in the template parameter.
+     *
+     * @param num_threads The minimum number of threads.
+     */
+    BS_THREAD_POOL_IF_ELASTIC_ENABLED
+    void set_min_threads(const std::size_t num_threads)
+    {
+        std::vector<std::size_t> new_threads;
+        {
+            const std::scoped_lock tasks_lock(tasks_mutex);
+            min_threads = num_threads;
+            std::size_t idx = 0;
+            while ((active_threads.load(std::memory_order_relaxed) - blocked_threads.load(std::memory_order_relaxed) < std::min(min_threads, thread_count)) && claim_thread_slot(idx))
+                new_threads.push_back(idx);
+        }
+        for (const std::size_t idx : new_threads)
+            start_thread(idx);
+    }
+
+    /**
+     * @brief Set the queue capacity: the maximum number of tasks that may be waiting in the queues, including the local queues, node queues, and lock-free queue, before submitting a task from outside the pool blocks or fails. When the queue is full, `detach_task()`, `submit_task()`, and the functions that submit several tasks at once block until there is room, while `try_detach_task()` and `detach_task_for()` give up immediately or after a timeout, respectively. This provides flow control: producers that outrun the workers are slowed down, instead of the queue growing without limit. Tasks submitted from within a thread of the same pool are never blocked or rejected, since a worker waiting for room in the queue could deadlock the pool, but they do count towards the capacity. The default is 0, which means the queue is unbounded. If the capacity is raised, blocked submissions resume.
+     *
+     * @param capacity The queue capacity, or 0 to make the queue unbounded.
+     */
+    void set_queue_capacity(const std::size_t capacity)
+    {
+        {
+            const std::scoped_lock tasks_lock(tasks_mutex);
+            queue_capacity.store(capacity, std::memory_order_relaxed);
+        }
+        task_space_cv.notify_all();
+    }
+
+    /**
+     * @brief Set the spin budget: the number of iterations an idle worker spins, looking for a new task, before going to sleep on the condition variable. A spinning worker is not counted as running a task, so it does not delay `wait()`. In each iteration the worker executes a CPU pause instruction, and every `spin_yield_interval` iterations it yields to the operating system's scheduler instead. While at least one worker is spinning, submitting a task does not wake up a sleeping worker, since the spinning worker will pick it up, which avoids the latency of waking up a thread at the cost of keeping a CPU busy. The default is 0, which means idle workers go to sleep immediately. The new budget takes effect the next time a worker runs out of tasks.
+     *
+     * @param budget The number of iterations to spin.
+     */
+    void set_spin_budget(const std::size_t budget) noexcept
+    {
+        spin_budget.store(budget, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Submit a batch of functions with no arguments into the task queue, with the specified priority, given as a range of iterators. All of the tasks are pushed into the queue while locking the global mutex only once, and at most one idle thread is woken up per task, which is much faster than calling `submit_task()` separately for each function if the batch is large. Returns a `BS::multi_future` that contains the futures for all of the tasks.
+     *
+     * @tparam It The type of the iterators. Must be a forward iterator.
+     * @tparam R The return type of the functions (can be `void`).
+     * @param first An iterator to the first function in the range.
+     * @param last An iterator to the element after the last function in the range. Note that the functions are copied into the queue; to move them instead, use `std::make_move_iterator()`.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A `BS::multi_future` that can be used to wait for all the tasks to finish. If the functions return a value, the `BS::multi_future` can also be used to obtain the values returned by each task.
+     */
+    template <typename It, typename R = std::invoke_result_t<std::decay_t<decltype(*std::declval<It&>())>>>
+    [[nodiscard]] multi_future<R> submit_batch(It first, const It last, const priority_t priority = 0)
+    {
+        std::vector<task_t> batch;
+        multi_future<R> future;
+        const std::size_t count = static_cast<std::size_t>(std::distance(first, last));
+        batch.reserve(count);
+        future.reserve(count);
+        for (; first != last; ++first)
+            batch.emplace_back(stamp_task(make_promise_task<R>(*first, future), priority));
+        push_batch(batch, priority);
+        return future;
+    }
+
+    /**
+     * @brief Submit a batch of functions with no arguments into the task queue, with the specified priority, given as a generator function. All of the tasks are pushed into the queue while locking the global mutex only once, and at most one idle thread is woken up per task, which is much faster than calling `submit_task()` separately for each function if the batch is large. Returns a `BS::multi_future` that contains the futures for all of the tasks.
+     *
+     * @tparam G The type of the generator function.
+     * @tparam R The return type of the generated functions (can be `void`).
+     * @param count The number of tasks in the batch.
+     * @param generator A function that takes a single argument, the index of the task in the batch (from 0 to `count - 1`), and returns the function to submit. The generator is called for all indices before any of the tasks are pushed into the queue, and is not called while holding any locks.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A `BS::multi_future` that can be used to wait for all the tasks to finish. If the generated functions return a value, the `BS::multi_future` can also be used to obtain the values returned by each task.
+     */
+    template <typename G, typename R = std::invoke_result_t<std::decay_t<std::invoke_result_t<G&, std::size_t>>>>
+    [[nodiscard]] multi_future<R> submit_batch(const std::size_t count, G&& generator, const priority_t priority = 0)
+    {
+        std::vector<task_t> batch;
+        multi_future<R> future;
+        batch.reserve(count);
+        future.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+            batch.emplace_back(stamp_task(make_promise_task<R>(generator(i), future), priority));
+        push_batch(batch, priority);
+        return future;
+    }
+
+    /**
+     * @brief Parallelize a loop by automatically splitting it into blocks and submitting each block separately to the queue, with the specified priority. The block function takes two arguments, the start and end of the block, so that it is only called once per block, but it is up to the user make sure the block function correctly deals with all the indices in each block. Returns a `BS::multi_future` that contains the futures for all of the blocks.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @tparam R The return type of the function to loop through (can be `void`).
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no blocks will be submitted, and an empty `BS::multi_future` will be returned.
+     * @param block A function that will be called once per block. Should take exactly two arguments: the first index in the block and the index after the last index in the block. `block(start, end)` should typically involve a loop of the form `for (T i = start; i < end; ++i)`.
+     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A `BS::multi_future` that can be used to wait for all the blocks to finish. If the block function returns a value, the `BS::multi_future` can also be used to obtain the values returned by each block.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F, typename R = std::invoke_result_t<std::decay_t<F>, T, T>>
+    [[nodiscard]] multi_future<R> submit_blocks(const T1 first_index, const T2 index_after_last, F&& block, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    {
+        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        {
+            const blocks blks(static_cast<T>(first_index), static_cast<T>(index_after_last), num_blocks ? num_blocks : thread_count);
+            typename loop_state<std::decay_t<F>>::issuer block_refs(blks.get_num_blocks(), *this, std::forward<F>(block));
+            return submit_batch(
+                blks.get_num_blocks(),
+                [&block_refs, &blks](const std::size_t blk)
+                {
+                    return [block_ref = block_refs.next(), start = blks.start(blk), end = blks.end(blk)]
+                    {
+                        return (*block_ref)(start, end);
+                    };
+                },
+                priority);
+        }
+        return {};
+    }
+
+    /**
+     * @brief Parallelize a loop by automatically splitting it into blocks and submitting each block separately to the queue, with the specified priority, exactly like the overload that takes the number of blocks, but with a stop condition shared by all the blocks. Blocks that have not started yet when stop is requested or the deadline passes are dropped without being executed, and their futures will throw `BS::task_cancelled`. Blocks that are already running can check for this using `BS::this_thread::stop_requested()` in order to exit early.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @tparam R The return type of the function to loop through (can be `void`). If exception handling is disabled, must be `void`, since a dropped block would have no value to return.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no blocks will be submitted, and an empty `BS::multi_future` will be returned.
+     * @param block A function that will be called once per block. Should take exactly two arguments: the first index in the block and the index after the last index in the block. `block(start, end)` should typically involve a loop of the form `for (T i = start; i < end; ++i)`.
+     * @param stop The stop condition: an `std::stop_token` (in C++20 and later), a deadline, or both.
+     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A `BS::multi_future` that can be used to wait for all the blocks to finish. If the block function returns a value, the `BS::multi_future` can also be used to obtain the values returned by each block.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F, typename R = std::invoke_result_t<std::decay_t<F>, T, T>>
+    [[nodiscard]] multi_future<R> submit_blocks(const T1 first_index, const T2 index_after_last, F&& block, const stop_condition& stop, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    {
+        return submit_blocks(static_cast<T>(first_index), static_cast<T>(index_after_last), make_stoppable_task(stop, std::forward<F>(block)), num_blocks, priority);
+    }
+
+    /**
+     * @brief Parallelize a loop by splitting it into chunks according to the specified scheduling policy, with the specified priority. The block function takes two arguments, the start and end of a chunk. It must have no return value, since it may be called several times by the same task; to obtain a return value from each block, use the overload that takes the number of blocks instead. With `BS::schedule::static_blocks`, the range is divided into blocks in advance and each block is submitted separately to the queue, as in the overload that takes the number of blocks. With `BS::schedule::dynamic` or `BS::schedule::guided`, one task is submitted per thread, and each task repeatedly claims the next chunk of the range from a shared counter until the range is exhausted, which avoids leaving threads idle when the time it takes to process each index varies. Returns a `BS::multi_future` that contains the futures for all of the submitted tasks.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @tparam R The return type of the function to loop through. Must be `void`.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no tasks will be submitted.
+     * @param block A function that will be called once per chunk. Should take exactly two arguments: the first index in the chunk and the index after the last index in the chunk. `block(start, end)` should typically involve a loop of the form `for (T i = start; i < end; ++i)`. It cannot have a return value.
+     * @param policy The scheduling policy: `BS::schedule::static_blocks`, `BS::schedule::dynamic`, or `BS::schedule::guided`.
+     * @param chunk_size For `BS::schedule::static_blocks` and `BS::schedule::dynamic`, the size of each chunk. For `BS::schedule::guided`, the minimum size of each chunk. The default is 0, which means the size will be chosen automatically: for `BS::schedule::static_blocks`, the range will be split into as many blocks as there are threads in the pool; for `BS::schedule::dynamic`, each thread will claim 8 chunks on average; for `BS::schedule::guided`, the minimum size will be 1.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A `BS::multi_future` that can be used to wait for all the tasks to finish.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F, typename R = std::invoke_result_t<std::decay_t<F>, T, T>>
+    [[nodiscard]] multi_future<void> submit_blocks(const T1 first_index, const T2 index_after_last, F&& block, const BS::schedule policy, const std::size_t chunk_size = 0, const priority_t priority = 0)
+    {
+        static_assert(std::is_void_v<R>, "The block function passed to the overload of submit_blocks() that takes a scheduling policy cannot have a return value, since it may be called several times by the same task.");
+        if (policy == BS::schedule::static_blocks)
+            return submit_blocks(static_cast<T>(first_index), static_cast<T>(index_after_last), std::forward<F>(block), num_blocks_for_chunk_size(static_cast<T>(first_index), static_cast<T>(index_after_last), chunk_size), priority);
+        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        {
+            const std::shared_ptr<dynamic_loop<T, std::decay_t<F>>> loop_ptr = std::make_shared<dynamic_loop<T, std::decay_t<F>>>(static_cast<T>(first_index), static_cast<T>(index_after_last), policy, chunk_size, thread_count, std::forward<F>(block));
+            return submit_batch(
+                loop_ptr->blks.get_num_tasks(),
+                [&loop_ptr](std::size_t)
+                {
+                    return [loop_ptr]
+                    {
+                        T start = 0;
+                        T end = 0;
+                        while (loop_ptr->blks.next(start, end))
+                            loop_ptr->func(start, end);
+                    };
+                },
+                priority);
+        }
+        return {};
+    }
+
+    /**
+     * @brief Parallelize a loop by automatically splitting it into blocks and submitting each block separately to the queue, with the specified priority, exactly like `submit_blocks()`, but get a `BS::group_future` instead of a `BS::multi_future`. All the blocks share a single state, with one counter of unfinished blocks and one vector for the results, so no promise or future is created per block, waiting for the blocks and checking how many are ready take constant time, and the results can be read without copying them.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @tparam R The return type of the function to loop through (can be `void`). If not `void`, must be default-constructible and move-assignable, and cannot be `bool`.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no blocks will be submitted, and the returned `BS::group_future` will be ready and have a size of 0.
+     * @param block A function that will be called once per block. Should take exactly two arguments: the first index in the block and the index after the last index in the block. `block(start, end)` should typically involve a loop of the form `for (T i = start; i < end; ++i)`.
+     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A `BS::group_future` that can be used to wait for all the blocks to finish. If the block function returns a value, the `BS::group_future` can also be used to obtain the values returned by each block. If any of the blocks throws an exception, `get()` will rethrow the first one.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F, typename R = std::invoke_result_t<std::decay_t<F>, T, T>>
+    [[nodiscard]] group_future<R> submit_blocks_grouped(const T1 first_index, const T2 index_after_last, F&& block, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    {
+        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        {
+            const blocks blks(static_cast<T>(first_index), static_cast<T>(index_after_last), num_blocks ? num_blocks : thread_count);
+            using state_t = group_task_state<R, std::decay_t<F>>;
+            const std::shared_ptr<state_t> state = std::make_shared<state_t>(blks.get_num_blocks(), std::forward<F>(block));
+            detach_batch(
+                blks.get_num_blocks(),
+                [&state, &blks](const std::size_t blk)
+                {
+                    return [state, blk, start = blks.start(blk), end = blks.end(blk)]
+                    {
+                        state->complete(blk,
+                            [&state, start, end]
+                            {
+                                return state->func(start, end);
+                            });
+                    };
+                },
+                priority);
+            return group_future<R>(state);
+        }
+        return group_future<R>(std::make_shared<group_state<R>>(0));
+    }
+
+#if defined(__cpp_impl_coroutine) && defined(__cpp_lib_coroutine)
+    /**
+     * @brief An awaitable type returned by `schedule()`. Awaiting it using `co_await` suspends the coroutine and submits its handle to the queue as a task, so that the coroutine is resumed by one of the threads in the pool. The handle is only the size of a pointer, so it is stored inline in the task, without allocating any memory.
+     */
+    class [[nodiscard]] schedule_awaiter
+    {
+    public:
+        /**
+         * @brief Construct an awaiter for the given pool and priority.
+         *
+         * @param pool_ The pool to resume the coroutine in.
+         * @param priority_ The priority of the task that resumes the coroutine.
+         */
+        schedule_awaiter(thread_pool& pool_, const priority_t priority_) noexcept : pool(&pool_), priority(priority_) {}
+
+        /**
+         * @brief Always suspend the coroutine, even if it is already running in a thread of the pool, so that awaiting `schedule()` can also be used to yield to other tasks.
+         *
+         * @return `false`.
+         */
+        [[nodiscard]] bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        /**
+         * @brief Submit the handle of the suspended coroutine to the queue.
+         *
+         * @param handle The handle of the coroutine.
+         */
+        void await_suspend(const std::coroutine_handle<> handle) const
+        {
+            pool->detach_task(handle, priority);
+        }
+
+        void await_resume() const noexcept {}
+
+    private:
+        /**
+         * @brief A pointer to the pool to resume the coroutine in.
+         */
+        thread_pool* pool;
+
+        /**
+         * @brief The priority of the task that resumes the coroutine.
+         */
+        priority_t priority;
+    }; // class schedule_awaiter
+
+    /**
+     * @brief Get an awaitable object which, when awaited in a coroutine using `co_await pool.schedule()`, suspends the coroutine and resumes it in one of the threads of this pool, with the specified priority. Only available if C++20 coroutines are supported.
+     *
+     * @param priority The priority of the task that resumes the coroutine. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return The awaitable object.
+     */
+    [[nodiscard]] schedule_awaiter schedule(const priority_t priority = 0) noexcept
+    {
+        return schedule_awaiter(*this, priority);
+    }
+#endif
+
+    /**
+     * @brief Submit a function with no arguments into the task queue, with the specified priority, and get a `BS::continuable_future` for its result. Unlike the `std::future` returned by `submit_task()`, a `BS::continuable_future` can be used to attach continuations using `then()`, which are submitted to a pool once the result is ready, without any thread blocking to wait for it, and can be combined with other `BS::continuable_future` objects using `BS::when_all()`.
+     *
+     * @tparam F The type of the function.
+     * @tparam R The return type of the function (can be `void`).
+     * @param task The function to submit.
+     * @param priority The priority of the task. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A `BS::continuable_future` to be used later to wait for the function to finish executing, obtain its returned value if it has one, and/or attach continuations.
+     */
+    template <typename F, typename R = std::invoke_result_t<std::decay_t<F>>>
+    [[nodiscard]] continuable_future<R> submit_continuable(F&& task, const priority_t priority = 0)
+    {
+        const std::shared_ptr<continuation_state<R>> state = std::make_shared<continuation_state<R>>();
+        detach_task(
+            [state, task = std::forward<F>(task)]() mutable
+            {
+                state->complete(task);
+            },
+            priority);
+        return continuable_future<R>(state);
+    }
+
+    /**
+     * @brief Parallelize a loop by automatically splitting it into blocks and submitting each block separately to the queue, with the specified priority. The loop function takes one argument, the loop index, so that it is called many times per block. It must have no return value. Returns a `BS::multi_future` that contains the futures for all of the blocks.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no tasks will be submitted, and an empty `BS::multi_future` will be returned.
+     * @param loop The function to loop through. Will be called once per index, many times per block. Should take exactly one argument: the loop index. It cannot have a return value.
+     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A `BS::multi_future` that can be used to wait for all the blocks to finish.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
+    [[nodiscard]] multi_future<void> submit_loop(const T1 first_index, const T2 index_after_last, F&& loop, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    {
+        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        {
+            const blocks blks(static_cast<T>(first_index), static_cast<T>(index_after_last), num_blocks ? num_blocks : thread_count);
+            typename loop_state<std::decay_t<F>>::issuer loop_refs(blks.get_num_blocks(), *this, std::forward<F>(loop));
+            return submit_batch(
+                blks.get_num_blocks(),
+                [&loop_refs, &blks](const std::size_t blk)
+                {
+                    return [loop_ref = loop_refs.next(), start = blks.start(blk), end = blks.end(blk)]
+                    {
+                        for (T i = start; i < end; ++i)
+                            (*loop_ref)(i);
+                    };
+                },
+                priority);
+        }
+        return {};
+    }
+
+    /**
+     * @brief Parallelize a loop by automatically splitting it into blocks and submitting each block separately to the queue, with the specified priority, exactly like the overload that takes the number of blocks, but with a stop condition shared by all the blocks. Blocks that have not started yet when stop is requested or the deadline passes are dropped without being executed, and their futures will throw `BS::task_cancelled`. The loop function can check for this using `BS::this_thread::stop_requested()` in order to exit early.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no blocks will be submitted, and an empty `BS::multi_future` will be returned.
+     * @param loop The function to loop through. Will be called once per index, many times per block. Should take exactly one argument: the loop index. It cannot have a return value.
+     * @param stop The stop condition: an `std::stop_token` (in C++20 and later), a deadline, or both.
+     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A `BS::multi_future` that can be used to wait for all the blocks to finish.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
+    [[nodiscard]] multi_future<void> submit_loop(const T1 first_index, const T2 index_after_last, F&& loop, const stop_condition& stop, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    {
+        return submit_blocks(static_cast<T>(first_index), static_cast<T>(index_after_last), make_loop_block<T>(std::forward<F>(loop)), stop, num_blocks, priority);
+    }
+
+    /**
+     * @brief Parallelize a loop by splitting it into chunks according to the specified scheduling policy, with the specified priority. The loop function takes one argument, the loop index, so that it is called many times per chunk. It must have no return value. With `BS::schedule::static_blocks`, the range is divided into blocks in advance and each block is submitted separately to the queue, as in the overload that takes the number of blocks. With `BS::schedule::dynamic` or `BS::schedule::guided`, one task is submitted per thread, and each task repeatedly claims the next chunk of the range from a shared counter until the range is exhausted, which avoids leaving threads idle when the time it takes to process each index varies. Returns a `BS::multi_future` that contains the futures for all of the submitted tasks.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function to loop through.
+     * @param first_index The first index in the loop.
+     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no tasks will be submitted.
+     * @param loop The function to loop through. Will be called once per index. Should take exactly one argument: the loop index. It cannot have a return value.
+     * @param policy The scheduling policy: `BS::schedule::static_blocks`, `BS::schedule::dynamic`, or `BS::schedule::guided`.
+     * @param chunk_size For `BS::schedule::static_blocks` and `BS::schedule::dynamic`, the size of each chunk. For `BS::schedule::guided`, the minimum size of each chunk. The default is 0, which means the size will be chosen automatically: for `BS::schedule::static_blocks`, the range will be split into as many blocks as there are threads in the pool; for `BS::schedule::dynamic`, each thread will claim 8 chunks on average; for `BS::schedule::guided`, the minimum size will be 1.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A `BS::multi_future` that can be used to wait for all the tasks to finish.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
+    [[nodiscard]] multi_future<void> submit_loop(const T1 first_index, const T2 index_after_last, F&& loop, const BS::schedule policy, const std::size_t chunk_size = 0, const priority_t priority = 0)
+    {
+        if (policy == BS::schedule::static_blocks)
+            return submit_loop(static_cast<T>(first_index), static_cast<T>(index_after_last), std::forward<F>(loop), num_blocks_for_chunk_size(static_cast<T>(first_index), static_cast<T>(index_after_last), chunk_size), priority);
+        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        {
+            const std::shared_ptr<dynamic_loop<T, std::decay_t<F>>> loop_ptr = std::make_shared<dynamic_loop<T, std::decay_t<F>>>(static_cast<T>(first_index), static_cast<T>(index_after_last), policy, chunk_size, thread_count, std::forward<F>(loop));
+            return submit_batch(
+                loop_ptr->blks.get_num_tasks(),
+                [&loop_ptr](std::size_t)
+                {
+                    return [loop_ptr]
+                    {
+                        T start = 0;
+                        T end = 0;
+                        while (loop_ptr->blks.next(start, end))
+                        {
+                            for (T i = start; i < end; ++i)
+                                loop_ptr->func(i);
+                        }
+                    };
+                },
+                priority);
+        }
+        return {};
+    }
+
+    /**
+     * @brief Parallelize a reduction by automatically splitting the range into blocks and submitting each block separately to the queue, with the specified priority. Each block computes a partial result in its own accumulator, padded to a cache line to avoid false sharing, and the partial results are then combined in a binary tree inside the pool, with each pair of partial results combined by whichever task finishes second, so no thread has to wait for another. Returns a single future for the final result.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam M The type of the map function.
+     * @tparam F The type of the reduction function.
+     * @tparam R The type of the result, deduced from the identity element.
+     * @param first_index The first index in the range.
+     * @param index_after_last The index after the last index in the range. The reduction will iterate from `first_index` to `(index_after_last - 1)` inclusive. Note that if `index_after_last <= first_index`, no tasks will be submitted, and the returned future will contain `identity`.
+     * @param map The map function. Either takes one argument, an index, and returns the value to reduce for that index, in which case each block starts from `identity` and reduces the values for all the indices in the block in order; or takes two arguments, the first index in the block and the index after the last index in the block, and returns the partial result for the entire block, which is useful for results such as histograms which are more efficient to accumulate in place.
+     * @param reduce The reduction function. Should take two arguments of type `R` and return their combination as an `R`, and must be associative. It does not have to be commutative, since the partial results are always combined in order.
+     * @param identity The identity element of the reduction, for example 0 for a sum. Also determines the type of the result, so make sure to use the correct type, e.g. `0.0` instead of `0` for a sum of `double`s.
+     * @param num_blocks The maximum number of blocks to split the range into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A future for the result of the reduction. If the map or reduction function throws an exception, the future will contain the first exception that was thrown.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename M, typename F, typename R>
+    [[nodiscard]] std::future<R> submit_reduce(const T1 first_index, const T2 index_after_last, M&& map, F&& reduce, R identity, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    {
+        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        {
+            using state_t = reduce_state<T, R, std::decay_t<M>, std::decay_t<F>>;
+            const std::shared_ptr<state_t> state = std::make_shared<state_t>(static_cast<T>(first_index), static_cast<T>(index_after_last), num_blocks ? num_blocks : thread_count, std::forward<M>(map), std::forward<F>(reduce), std::move(identity));
+            std::future<R> future = state->promise.get_future();
+            detach_batch(
+                state->blks.get_num_blocks(),
+                [&state](const std::size_t blk)
+                {
+                    return [state, blk]
+                    {
+                        state->run_block(blk);
+                    };
+                },
+                priority);
+            return future;
+        }
+        std::promise<R> promise;
+        promise.set_value(std::move(identity));
+        return promise.get_future();
+    }
+
+    /**
+     * @brief Submit a sequence of tasks enumerated by indices to the queue, with the specified priority. The sequence function takes one argument, the task index, and will be called once per index. Returns a `BS::multi_future` that contains the futures for all of the tasks.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function used to define the sequence.
+     * @tparam R The return type of the function used to define the sequence (can be `void`).
+     * @param first_index The first index in the sequence.
+     * @param index_after_last The index after the last index in the sequence. The sequence will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no tasks will be submitted, and an empty `BS::multi_future` will be returned.
+     * @param sequence The function used to define the sequence. Will be called once per index. Should take exactly one argument, the index.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A `BS::multi_future` that can be used to wait for all the tasks to finish. If the sequence function returns a value, the `BS::multi_future` can also be used to obtain the values returned by each task.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F, typename R = std::invoke_result_t<std::decay_t<F>, T>>
+    [[nodiscard]] multi_future<R> submit_sequence(const T1 first_index, const T2 index_after_last, F&& sequence, const priority_t priority = 0)
+    {
+        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        {
+            const std::size_t count = static_cast<std::size_t>(static_cast<T>(index_after_last) - static_cast<T>(first_index));
+            typename loop_state<std::decay_t<F>>::issuer sequence_refs(count, *this, std::forward<F>(sequence));
+            return submit_batch(
+                count,
+                [&sequence_refs, first = static_cast<T>(first_index)](const std::size_t idx)
+                {
+                    return [sequence_ref = sequence_refs.next(), i = static_cast<T>(first + static_cast<T>(idx))]
+                    {
+                        return (*sequence_ref)(i);
+                    };
+                },
+                priority);
+        }
+        return {};
+    }
+
+    /**
+     * @brief Submit a sequence of tasks enumerated by indices to the queue, with the specified priority, exactly like the overload without a stop condition, but with a stop condition shared by all the tasks. Tasks that have not started yet when stop is requested or the deadline passes are dropped without being executed, and their futures will throw `BS::task_cancelled`. Tasks that are already running can check for this using `BS::this_thread::stop_requested()` in order to exit early.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function used to define the sequence.
+     * @tparam R The return type of the function used to define the sequence (can be `void`). If exception handling is disabled, must be `void`, since a dropped task would have no value to return.
+     * @param first_index The first index in the sequence.
+     * @param index_after_last The index after the last index in the sequence. The sequence will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no tasks will be submitted, and an empty `BS::multi_future` will be returned.
+     * @param sequence The function used to define the sequence. Will be called once per index. Should take exactly one argument, the index.
+     * @param stop The stop condition: an `std::stop_token` (in C++20 and later), a deadline, or both.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A `BS::multi_future` that can be used to wait for all the tasks to finish. If the sequence function returns a value, the `BS::multi_future` can also be used to obtain the values returned by each task.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F, typename R = std::invoke_result_t<std::decay_t<F>, T>>
+    [[nodiscard]] multi_future<R> submit_sequence(const T1 first_index, const T2 index_after_last, F&& sequence, const stop_condition& stop, const priority_t priority = 0)
+    {
+        return submit_sequence(static_cast<T>(first_index), static_cast<T>(index_after_last), make_stoppable_task(stop, std::forward<F>(sequence)), priority);
+    }
+
+    /**
+     * @brief Submit a sequence of tasks enumerated by indices to the queue, with the specified priority, exactly like `submit_sequence()`, but get a `BS::group_future` instead of a `BS::multi_future`. All the tasks share a single state, with one counter of unfinished tasks and one vector for the results, so no promise or future is created per task, waiting for the tasks and checking how many are ready take constant time, and the results can be read without copying them. This makes a big difference for long sequences of short tasks.
+     *
+     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
+     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
+     * @tparam F The type of the function used to define the sequence.
+     * @tparam R The return type of the function used to define the sequence (can be `void`). If not `void`, must be default-constructible and move-assignable, and cannot be `bool`.
+     * @param first_index The first index in the sequence.
+     * @param index_after_last The index after the last index in the sequence. The sequence will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no tasks will be submitted, and the returned `BS::group_future` will be ready and have a size of 0.
+     * @param sequence The function used to define the sequence. Will be called once per index. Should take exactly one argument, the index.
+     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A `BS::group_future` that can be used to wait for all the tasks to finish. If the sequence function returns a value, the `BS::group_future` can also be used to obtain the values returned by each task, in the order of the indices. If any of the tasks throws an exception, `get()` will rethrow the first one.
+     */
+    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F, typename R = std::invoke_result_t<std::decay_t<F>, T>>
+    [[nodiscard]] group_future<R> submit_sequence_grouped(const T1 first_index, const T2 index_after_last, F&& sequence, const priority_t priority = 0)
+    {
+        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        {
+            const std::size_t count = static_cast<std::size_t>(static_cast<T>(index_after_last) - static_cast<T>(first_index));
+            using state_t = group_task_state<R, std::decay_t<F>>;
+            const std::shared_ptr<state_t> state = std::make_shared<state_t>(count, std::forward<F>(sequence));
+            detach_batch(
+                count,
+                [&state, first = static_cast<T>(first_index)](const std::size_t idx)
+                {
+                    return [state, idx, i = static_cast<T>(first + static_cast<T>(idx))]
+                    {
+                        state->complete(idx,
+                            [&state, i]
+                            {
+                                return state->func(i);
+                            });
+                    };
+                },
+                priority);
+            return group_future<R>(state);
+        }
+        return group_future<R>(std::make_shared<group_state<R>>(0));
+    }
+
+    /**
+     * @brief Submit a function with no arguments into the task queue, with the specified priority. To submit a function with arguments, enclose it in a lambda expression. If the function has a return value, get a future for the eventual returned value. If the function has no return value, get an `std::future<void>` which can be used to wait until the task finishes.
+     *
+     * @tparam F The type of the function.
+     * @tparam R The return type of the function (can be `void`).
+     * @param task The function to submit.
+     * @param priority The priority of the task. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A future to be used later to wait for the function to finish executing and/or obtain its returned value if it has one.
+     */
+    template <typename F, typename R = std::invoke_result_t<std::decay_t<F>>>
+    [[nodiscard]] std::future<R> submit_task(F&& task, const priority_t priority = 0)
+    {
+        std::promise<R> promise;
+        std::future<R> future = promise.get_future();
+        detach_task(make_promise_task<R>(std::forward<F>(task), std::move(promise)), priority);
+        return future;
+    }
+
+    /**
+     * @brief Submit a function with no arguments into the task queue, with the specified priority and stop condition, and get a future for its returned value. If stop is requested or the deadline passes before a thread takes the task out of the queue, the task is dropped without being executed, and the future will throw `BS::task_cancelled`; while it is running, it can check for this using `BS::this_thread::stop_requested()` in order to exit early. Otherwise, behaves exactly like the overload without a stop condition.
+     *
+     * @tparam F The type of the function.
+     * @tparam R The return type of the function (can be `void`). If exception handling is disabled, must be `void`, since a dropped task would have no value to return.
+     * @param task The function to submit.
+     * @param stop The stop condition: an `std::stop_token` (in C++20 and later), a deadline, or both.
+     * @param priority The priority of the task. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return A future to be used later to wait for the function to finish executing and/or obtain its returned value if it has one.
+     */
+    template <typename F, typename R = std::invoke_result_t<std::decay_t<F>>>
+    [[nodiscard]] std::future<R> submit_task(F&& task, const stop_condition& stop, const priority_t priority = 0)
+    {
+        return submit_task(make_stoppable_task(stop, std::forward<F>(task)), priority);
+    }
+
+    /**
+     * @brief Submit a function with no arguments into the queue of a specific NUMA node. To submit a function with arguments, enclose it in a lambda expression. If the function has a return value, get a future for the eventual returned value. If the function has no return value, get an `std::future<void>` which can be used to wait until the task finishes. See `detach_task_on_node()` for how the node is taken into account. Only enabled if the flag `BS:tp::numa` is enabled in the template parameter.
+     *
+     * @tparam F The type of the function.
+     * @tparam R The return type of the function (can be `void`).
+     * @param node The index of the NUMA node, in the range `[0, N)` where `N == get_numa_node_count()`. Larger values wrap around.
+     * @param task The function to submit.
+     * @return A future to be used later to wait for the function to finish executing and/or obtain its returned value if it has one.
+     */
+    template <typename F, typename R = std::invoke_result_t<std::decay_t<F>>>
+    [[nodiscard]] std::future<R> submit_task_on_node(const std::size_t node, F&& task)
+    {
+        static_assert(numa_enabled, "submit_task_on_node() is only available if the flag BS::tp::numa is enabled.");
+        std::promise<R> promise;
+        std::future<R> future = promise.get_future();
+        detach_task_on_node(node, make_promise_task<R>(std::forward<F>(task), std::move(promise)));
+        return future;
+    }
+
+    /**
+     * @brief Submit a function with no arguments into the mailbox of a specific thread in the pool. To submit a function with arguments, enclose it in a lambda expression. If the function has a return value, get a future for the eventual returned value. If the function has no return value, get an `std::future<void>` which can be used to wait until the task finishes. See `detach_task_to()` for how the mailboxes work. Only enabled if the flag `BS:tp::work_stealing` or `BS:tp::numa` is enabled in the template parameter, and not available if the flag `BS:tp::elastic` is enabled.
+     *
+     * @tparam F The type of the function.
+     * @tparam R The return type of the function (can be `void`).
+     * @param worker The index of the thread, in the range `[0, N)` where `N == get_thread_count()`. Larger values wrap around.
+     * @param task The function to submit.
+     * @return A future to be used later to wait for the function to finish executing and/or obtain its returned value if it has one.
+     */
+    template <typename F, typename R = std::invoke_result_t<std::decay_t<F>>>
+    [[nodiscard]] std::future<R> submit_task_to(const std::size_t worker, F&& task)
+    {
+        std::promise<R> promise;
+        std::future<R> future = promise.get_future();
+        detach_task_to(worker, make_promise_task<R>(std::forward<F>(task), std::move(promise)));
+        return future;
+    }
+
+    /**
+     * @brief Submit a function with no arguments into the mailbox of one of a subset of the threads in the pool, given as a mask, and get a future for the eventual returned value, if any. See `detach_task_to()` for how the thread is chosen. Only enabled if the flag `BS:tp::work_stealing` or `BS:tp::numa` is enabled in the template parameter, and not available if the flag `BS:tp::elastic` is enabled.
+     *
+     * @tparam F The type of the function.
+     * @tparam R The return type of the function (can be `void`).
+     * @param workers A mask of the threads to choose from: thread `i` may be chosen if `workers[i]` is `true`. Elements beyond the number of threads are ignored. If the mask does not select any of the threads, the task is submitted as if using `submit_task()`.
+     * @param task The function to submit.
+     * @return A future to be used later to wait for the function to finish executing and/or obtain its returned value if it has one.
+     */
+    template <typename F, typename R = std::invoke_result_t<std::decay_t<F>>>
+    [[nodiscard]] std::future<R> submit_task_to(const std::vector<bool>& workers, F&& task)
+    {
+        std::promise<R> promise;
+        std::future<R> future = promise.get_future();
+        detach_task_to(workers, make_promise_task<R>(std::forward<F>(task), std::move(promise)));
+        return future;
+    }
+
+    /**
+     * @brief Submit a function with no arguments and no return value into the task queue, with the specified priority, but only if there is room in the queue. If no queue capacity was set using `set_queue_capacity()`, or this function is called from within a thread of the same pool, there is always room, and it behaves exactly like `detach_task()`. If the task could not be submitted, it is left untouched, so the caller may try again later.
+     *
+     * @tparam F The type of the function.
+     * @param task The function to submit.
+     * @param priority The priority of the task. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @return `true` if the task was submitted, `false` if the queue was full.
+     */
+    template <typename F>
+    bool try_detach_task(F&& task, const priority_t priority = 0)
+    {
+        return enqueue_task(std::forward<F>(task), priority, std::chrono::steady_clock::time_point::min());
+    }
+
+    /**
+     * @brief Unpause the pool. The workers will resume retrieving new tasks out of the queue. Only enabled if the flag `BS:tp::pause` is enabled in the template parameter.
+     */
+    BS_THREAD_POOL_IF_PAUSE_ENABLED
+    void unpause()
+    {
+        {
+            const std::scoped_lock tasks_lock(tasks_mutex);
+            paused = false;
+        }
+        task_available_cv.notify_all();
+    }
+
+    /**
+     * @brief Wait for tasks to be completed. Normally, this function waits for all tasks, both those that are currently running in the threads and those that are still waiting in the queue. However, if the pool is paused, this function only waits for the currently running tasks (otherwise it would wait forever). Note: To wait for just one specific task, use `submit_task()` instead, and call the `wait()` member function of the generated future.
+     *
+     * @throws `wait_deadlock` if called from within a thread of the same pool, which would result in a deadlock. Only enabled if the flag `BS:tp::wait_deadlock_checks` is enabled in the template parameter.
+     */
+    void wait()
+    {
+#ifdef __cpp_exceptions
+        if constexpr (wait_deadlock_checks_enabled)
+        {
+            if (this_thread::get_pool() == this)
+                throw wait_deadlock();
+        }
+#endif
+        std::unique_lock tasks_lock(tasks_mutex);
+        if (tasks_done())
+            return;
+        const std::uint32_t epoch = register_waiter();
+#ifdef __cpp_lib_atomic_wait
+        // In C++20 and later, the thread sleeps on the epoch itself, without the global mutex, so when it is woken up it does not contend for the mutex with the workers.
+        tasks_lock.unlock();
+        idle_epoch.wait(epoch, std::memory_order_acquire);
+#else
+        tasks_done_cv.wait(tasks_lock,
+            [this, epoch]
+            {
+                return idle_epoch.load(std::memory_order_relaxed) != epoch;
+            });
+#endif
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Wait for tasks to be completed, but stop waiting after the specified duration has passed.
+     *
+     * @tparam R An arithmetic type representing the number of ticks to wait.
+     * @tparam P An `std::ratio` representing the length of each tick in seconds.
+     * @param duration The amount of time to wait.
+     * @return `true` if all tasks finished running, `false` if the duration expired but some tasks are still running.
+     * @throws `wait_deadlock` if called from within a thread of the same pool, which would result in a deadlock. Only enabled if the flag `BS:tp::wait_deadlock_checks` is enabled in the template parameter.
+     */
+    template <typename R, typename P>
+    bool wait_for(const std::chrono::duration<R, P>& duration)
+    {
+#ifdef __cpp_exceptions
+        if constexpr (wait_deadlock_checks_enabled)
+        {
+            if (this_thread::get_pool() == this)
+                throw wait_deadlock();
+        }
+#endif
+        std::unique_lock tasks_lock(tasks_mutex);
+        if (tasks_done())
+            return true;
+        const std::uint32_t epoch = register_waiter();
+        const bool status = tasks_done_cv.wait_for(tasks_lock, duration,
+            [this, epoch]
+            {
+                return idle_epoch.load(std::memory_order_relaxed) != epoch;
+            });
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return status;
+    }
+
+    /**
+     * @brief Wait for tasks to be completed, but stop waiting after the specified time point has been reached.
+     *
+     * @tparam C The type of the clock used to measure time.
+     * @tparam D An `std::chrono::duration` type used to indicate the time point.
+     * @param timeout_time The time point at which to stop waiting.
+     * @return `true` if all tasks finished running, `false` if the time point was reached but some tasks are still running.
+     * @throws `wait_deadlock` if called from within a thread of the same pool, which would result in a deadlock. Only enabled if the flag `BS:tp::wait_deadlock_checks` is enabled in the template parameter.
+     */
+    template <typename C, typename D>
+    bool wait_until(const std::chrono::time_point<C, D>& timeout_time)
+    {
+#ifdef __cpp_exceptions
+        if constexpr (wait_deadlock_checks_enabled)
+        {
+            if (this_thread::get_pool() == this)
+                throw wait_deadlock();
+        }
+#endif
+        std::unique_lock tasks_lock(tasks_mutex);
+        if (tasks_done())
+            return true;
+        const std::uint32_t epoch = register_waiter();
+        const bool status = tasks_done_cv.wait_until(tasks_lock, timeout_time,
+            [this, epoch]
+            {
+                return idle_epoch.load(std::memory_order_relaxed) != epoch;
+            });
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return status;
+    }
+
+    /**
+     * @brief Write the events returned by `get_trace()` to a stream in the JSON trace event format used by Chrome's `about:tracing` and by Perfetto (https://ui.perfetto.dev), where each thread of the pool is shown as a separate track. Each task is shown as a slice in the track of the thread that executed it, named after its tag, with its priority and the time it spent waiting in the queue as arguments. The time each task spent waiting in the queue is also shown as an asynchronous slice in a separate track with the same name, so queueing delays, stragglers, and idle gaps can be seen on the same timeline. The threads are named after the names given to them by the initialization function using `BS::this_thread::set_os_thread_name()`, if native extensions are enabled, or `Thread <index>` otherwise. Only enabled if the flag `BS:tp::trace` is enabled in the template parameter.
+     *
+     * @param stream The output stream.
+     */
+    BS_THREAD_POOL_IF_TRACE_ENABLED
+    void write_chrome_trace(std::ostream& stream) const
+    {
+        const std::vector<trace_buffer*> buffers = get_trace_buffers();
+        stream << "{\"traceEvents\":[\n";
+        stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"BS::thread_pool\"}}";
+        for (std::size_t i = 0; i < buffers.size(); ++i)
+        {
+            std::string name = buffers[i]->get_name();
+            if (name.empty())
+                name = "Thread " + std::to_string(i);
+            stream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":";
+            write_json_string(stream, name);
+            stream << "}}";
+            stream << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"sort_index\":" << i << "}}";
+        }
+        std::vector<trace_event> events;
+        std::uint64_t id = 0;
+        for (std::size_t i = 0; i < buffers.size(); ++i)
+        {
+            events.clear();
+            buffers[i]->read(i, events);
+            for (const trace_event& event : events)
+            {
+                const std::string_view name = (event.tag != nullptr) ? event.tag : "task";
+                stream << ",\n{\"name\":";
+                write_json_string(stream, name);
+                stream << ",\"cat\":\"task\",\"ph\":\"X\",\"pid\":1,\"tid\":" << i << ",\"ts\":";
+                write_trace_time(stream, event.dequeued);
+                stream << ",\"dur\":";
+                write_trace_time(stream, event.completed - event.dequeued);
+                stream << ",\"args\":{\"priority\":" << static_cast<int>(event.priority) << ",\"queue_delay_us\":";
+                write_trace_time(stream, event.dequeued - event.enqueued);
+                stream << "}}";
+                for (const bool begin : {true, false})
+                {
+                    stream << ",\n{\"name\":";
+                    write_json_string(stream, name);
+                    stream << ",\"cat\":\"queue\",\"ph\":\"" << (begin ? 'b' : 'e') << "\",\"id\":" << id << ",\"pid\":1,\"tid\":" << i << ",\"ts\":";
+                    write_trace_time(stream, begin ? event.enqueued : event.dequeued);
+                    stream << '}';
+                }
+                ++id;
+            }
+        }
+        stream << "\n]}\n";
+    }
+
+private:
+    // `BS::task_group` and `BS::fair_queue` use `make_promise_task()` to wrap the tasks submitted using their own `submit_task()`.
+    template <opt_t>
+    friend class fair_queue;
+
+    template <opt_t>
+    friend class task_group;
+
+    /**
+     * @brief A flag indicating whether the workers may take tasks out of a queue without locking the global mutex, which is the case if work stealing or the lock-free queue are enabled. In that case, idle workers must be tracked explicitly, so they can be woken up when a task becomes available.
+     */
+    static constexpr bool unlocked_pop = work_stealing_enabled || lock_free_enabled;
+
+    /**
+     * @brief A flag indicating whether the callable object of a task of a given type is allocated from the pooled memory resource of the submitting thread, if it is a thread of this pool, which is the case if the callable object is too large to be stored inline in a task and `std::pmr::memory_resource` is supported.
+     *
+     * @tparam F The type of the callable object.
+     */
+    template <typename F>
+#ifdef __cpp_lib_memory_resource
+    static constexpr bool allocated_from_worker = !std::is_same_v<std::decay_t<F>, task_t> && !task_t::stored_inline<std::decay_t<F>>;
+#else
+    static constexpr bool allocated_from_worker = false;
+#endif
+
+    /**
+     * @brief The number of times a worker tries to pop a task from the lock-free queue, yielding in between, before going to sleep on the condition variable. Only used if the flag `BS:tp::lock_free` is enabled in the template parameter.
+     */
+    static constexpr std::size_t lock_free_spin_count = 64;
+
+    /**
+     * @brief The type of the time points used to collect statistics. If the flag `BS:tp::statistics` is disabled in the template parameter, this is an empty type, so the workers do not even query the clock.
+     */
+    using statistics_time_point = std::conditional_t<statistics_enabled, std::chrono::steady_clock::time_point, std::monostate>;
+
+    // ========================
+    // Private member functions
+    // ========================
+
+    /**
+     * @brief Create the threads in the pool and assign a worker to each thread.
+     *
+     * @param num_threads The number of threads to use.
+     * @param init An initialization function to run in each thread before it starts executing any submitted tasks.
+     */
+    template <typename F>
+    void create_threads(const std::size_t num_threads, F&& init)
+    {
+        if constexpr (std::is_invocable_v<F, std::size_t>)
+        {
+            init_func = std::forward<F>(init);
+        }
+        else
+        {
+            init_func = [init = std::forward<F>(init)](std::size_t)
+            {
+                init();
+            };
+        }
+        const std::size_t new_thread_count = determine_thread_count(num_threads);
+        std::size_t num_started = new_thread_count;
+        // Note: In C++20 and later, this also stops and joins any previously existing threads, so we only update the thread count afterwards.
+        threads = std::make_unique<thread_t[]>(new_thread_count);
+        {
+            const std::scoped_lock tasks_lock(tasks_mutex);
+#ifdef __cpp_lib_memory_resource
+            while (worker_memories.size() < new_thread_count)
+                worker_memories.push_back(std::make_unique<worker_memory>());
+#endif
+            if constexpr (work_stealing_enabled)
+                create_local_queues(new_thread_count);
+            if constexpr (numa_enabled)
+                assign_numa_nodes(new_thread_count);
+            if constexpr (statistics_enabled)
+            {
+                // The statistics of the previous threads are kept, so that the totals are not lost when the pool is reset.
+                for (std::size_t i = 0; i < thread_count; ++i)
+                    retired_statistics.merge(thread_statistics[i].snapshot());
+                thread_statistics = std::make_unique<worker_statistics[]>(new_thread_count);
+            }
+            if constexpr (trace_enabled)
+            {
+                // The trace buffers are kept when the pool is reset, like the memory resources, so that events recorded before the reset are not lost.
+                while (thread_traces.size() < new_thread_count)
+                    thread_traces.push_back(std::make_unique<trace_buffer>());
+            }
+            if constexpr (elastic_enabled)
+            {
+                // Only the minimum number of threads is started; the rest of the slots are filled on demand.
+                num_started = std::min(min_threads, new_thread_count);
+                thread_active = std::make_unique<bool[]>(new_thread_count);
+                for (std::size_t i = 0; i < num_started; ++i)
+                    thread_active[i] = true;
+                active_threads.store(num_started, std::memory_order_relaxed);
+                last_growth = {};
+            }
+            thread_count = new_thread_count;
+            tasks_running.store(num_started, std::memory_order_relaxed);
+#ifndef __cpp_lib_jthread
+            workers_running = true;
+#endif
+        }
+        for (std::size_t i = 0; i < num_started; ++i)
+            threads[i] = make_thread(i);
+    }
+
+    /**
+     * @brief Create a new thread running a worker with the given thread index.
+     *
+     * @param idx The index of the thread.
+     * @return The new thread.
+     */
+    [[nodiscard]] thread_t make_thread(const std::size_t idx)
+    {
+        return thread_t(
+            [this, idx]
+#ifdef __cpp_lib_jthread
+            (const std::stop_token& stop_token)
+            {
+                worker(stop_token, idx);
+            }
+#else
+            {
+                worker(idx);
+            }
+#endif
+        );
+    }
+
+#ifndef __cpp_lib_jthread
+    /**
+     * @brief Destroy the threads in the pool.
+     */
+    void destroy_threads()
+    {
+        {
+            const std::scoped_lock tasks_lock(tasks_mutex);
+            workers_running = false;
+        }
+        task_available_cv.notify_all();
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            // If the elastic thread count is enabled, some of the slots may have never had a thread.
+            if (threads[i].joinable())
+                threads[i].join();
+        }
+    }
+#endif
+
+    /**
+     * @brief The function called by `BS::this_thread::blocking_region` when a thread in the pool enters or leaves its outermost blocking region, to be used if the elastic thread count is enabled. When a thread enters a blocking region, another thread may be started to execute the queued tasks in its place.
+     *
+     * @param pool A pointer to the pool.
+     * @param entering `true` if the thread is entering a blocking region, `false` if it is leaving it.
+     */
+    static void blocking_region_hook(void* const pool, const bool entering)
+    {
+        thread_pool* const self = static_cast<thread_pool*>(pool);
+        if (entering)
+        {
+            ++self->blocked_threads;
+            self->grow_if_needed();
+        }
+        else
+        {
+            --self->blocked_threads;
+        }
+    }
+
+    /**
+     * @brief Check whether an idle thread may retire, which is the case if there are more running threads that are not blocked than the minimum number of threads, to be used if the elastic thread count is enabled. Must be called with the global mutex locked.
+     *
+     * @return `true` if the thread may retire, `false` otherwise.
+     */
+    [[nodiscard]] bool can_retire() const noexcept
+    {
+        return active_threads.load(std::memory_order_relaxed) - blocked_threads.load(std::memory_order_relaxed) > std::min(min_threads, thread_count);
+    }
+
+    /**
+     * @brief Claim a free thread slot for a new thread, to be used if the elastic thread count is enabled. The new thread is counted as active and as running a task right away, so `wait()` does not return before it has started and looked for a task; it must then be started using `start_thread()`. A slot is only free once its previous thread has finished running its cleanup function, so there may be no free slot even if fewer than the maximum number of threads are active. Must be called with the global mutex locked.
+     *
+     * @param idx A reference to the variable in which the index of the slot will be stored.
+     * @return `true` if a slot was claimed, `false` if there are no free slots.
+     */
+    [[nodiscard]] bool claim_thread_slot(std::size_t& idx)
+    {
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            if (!thread_active[i])
+            {
+                thread_active[i] = true;
+                active_threads.store(active_threads.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                tasks_running.store(tasks_running.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+                last_growth = std::chrono::steady_clock::now();
+                idx = i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Start a new thread if one is needed, after a task has been pushed into a queue without locking the global mutex or after a thread entered a blocking region, to be used if the elastic thread count is enabled. The counters are checked first without locking, so the global mutex is only locked if there are no idle threads and not all of the threads are running.
+     */
+    void grow_if_needed()
+    {
+        if ((idle_workers > 0) || (active_threads.load(std::memory_order_relaxed) == thread_count))
+            return;
+        std::size_t idx = 0;
+        {
+            const std::scoped_lock tasks_lock(tasks_mutex);
+            if (!should_grow() || !claim_thread_slot(idx))
+                return;
+        }
+        start_thread(idx);
+    }
+
+    /**
+     * @brief Check whether a new thread should be started, to be used if the elastic thread count is enabled. A new thread is needed if there are tasks in the queue, no threads are idle or spinning, the pool is not paused, and fewer than the maximum number of threads are running, and either fewer than the minimum number of threads are running that are not blocked, or the number of queued tasks exceeds the number of threads that are not blocked and no thread was started in the last `elastic_grow_interval`. Must be called with the global mutex locked.
+     *
+     * @return `true` if a new thread should be started, `false` otherwise.
+     */
+    [[nodiscard]] bool should_grow() const
+    {
+        const std::size_t active = active_threads.load(std::memory_order_relaxed);
+        if ((active >= thread_count) || (idle_workers > 0) || (spinning_workers > 0))
+            return false;
+        if constexpr (pause_enabled)
+        {
+            if (paused)
+                return false;
+        }
+        const std::size_t queued = count_queued_tasks();
+        if (queued == 0)
+            return false;
+        const std::size_t runnable = active - blocked_threads.load(std::memory_order_relaxed);
+        if (runnable < std::min(min_threads, thread_count))
+            return true;
+        return (queued > runnable) && (std::chrono::steady_clock::now() - last_growth >= elastic_grow_interval);
+    }
+
+    /**
+     * @brief Start a new thread in a slot claimed using `claim_thread_slot()`, to be used if the elastic thread count is enabled. Must be called without the global mutex locked. The previous thread in the slot, if any, has already finished, so it is moved out of the slot while holding the global mutex, so that `get_thread_ids()` and `get_native_handles()` do not read it while it is being joined, and then joined without the mutex. The new thread is then assigned to the slot while holding the global mutex, so that it cannot retire and free the slot before the assignment is complete. If the thread cannot be created, the slot is freed again and the queued tasks are left to the existing threads.
+     *
+     * @param idx The index of the slot.
+     */
+    void start_thread(const std::size_t idx)
+    {
+        thread_t previous;
+        {
+            const std::scoped_lock previous_lock(tasks_mutex);
+            previous = std::move(threads[idx]);
+        }
+        if (previous.joinable())
+            previous.join();
+        const std::scoped_lock tasks_lock(tasks_mutex);
+#ifdef __cpp_exceptions
+        try
+        {
+#endif
+            threads[idx] = make_thread(idx);
+#ifdef __cpp_exceptions
+        }
+        catch (...)
+        {
+            thread_active[idx] = false;
+            active_threads.store(active_threads.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+            tasks_running.store(tasks_running.load(std::memory_order_relaxed) - 1, std::memory_order_release);
+            notify_if_done();
+        }
+#endif
+    }
+
+    /**
+     * @brief Check whether all the tasks are done: no tasks are running, and no tasks are waiting in the queues, unless the pool is paused, in which case only the running tasks are taken into account. Must be called with the global mutex locked.
+     *
+     * @return `true` if the tasks are done, `false` otherwise.
+     */
+    [[nodiscard]] bool tasks_done() const noexcept
+    {
+        if constexpr (pause_enabled)
+            return (tasks_running.load(std::memory_order_relaxed) == 0) && (paused || !has_queued_tasks());
+        else
+            return (tasks_running.load(std::memory_order_relaxed) == 0) && !has_queued_tasks();
+    }
+
+    /**
+     * @brief Register the current thread as waiting for the tasks to be done. Must be called with the global mutex locked, after checking that they are not done yet; the thread must then wait until `idle_epoch` changes from the returned value, and decrement `waiters` afterwards.
+     *
+     * @return The current value of `idle_epoch`.
+     */
+    [[nodiscard]] std::uint32_t register_waiter() noexcept
+    {
+        waiters.fetch_add(1, std::memory_order_relaxed);
+        return idle_epoch.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief If all the tasks are done, increment `idle_epoch` and, if any threads are waiting, wake them up. Called by a worker after it stops counting itself in `tasks_running`, so that the waiting threads are only woken up once when the pool becomes idle, rather than whenever a task finishes. Must be called with the global mutex locked.
+     */
+    void notify_if_done()
+    {
+        if (!tasks_done())
+            return;
+        // Release ordering ensures that a thread woken up in `wait()`, which does not lock the mutex, sees the effects of all the tasks.
+        idle_epoch.store(idle_epoch.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        if (waiters.load(std::memory_order_relaxed) > 0)
+        {
+#ifdef __cpp_lib_atomic_wait
+            idle_epoch.notify_all();
+#endif
+            tasks_done_cv.notify_all();
+        }
+    }
+
+    /**
+     * @brief Count the tasks waiting to be executed, either in the global queue or, if enabled, in the local queues or the lock-free queue. Must be called with the global mutex locked.
+     *
+     * @return The number of queued tasks.
+     */
+    [[nodiscard]] std::size_t count_queued_tasks() const noexcept
+    {
+        std::size_t result = tasks.size();
+        if constexpr (work_stealing_enabled)
+            result += local_tasks_queued + mailbox_tasks_queued;
+        if constexpr (lock_free_enabled)
+            result += lock_free_tasks.size();
+        return result;
+    }
+
+    /**
+     * @brief Count the tasks waiting to be executed, like `count_queued_tasks()`, but using only the atomic counters, without locking the global mutex. The result may be momentarily inaccurate if tasks are being submitted or taken out of the queues at the same time.
+     *
+     * @return The number of queued tasks.
+     */
+    [[nodiscard]] std::size_t load_queued_tasks() const noexcept
+    {
+        std::size_t result = global_tasks_queued.load(std::memory_order_acquire);
+        if constexpr (work_stealing_enabled)
+            result += local_tasks_queued.load(std::memory_order_acquire) + mailbox_tasks_queued.load(std::memory_order_acquire);
+        if constexpr (lock_free_enabled)
+            result += lock_free_tasks.size();
+        return result;
+    }
+
+    /**
+     * @brief Create a new local queue and mailbox for each thread, to be used if work stealing is enabled. Any tasks remaining in the previous local queues and mailboxes (for example, if the pool was reset while paused) are moved to the global queue, so they will not be lost. Must be called after the previous threads have been destroyed, and with the global mutex locked.
+     *
+     * @param num_threads The number of threads that will be created.
+     */
+    void create_local_queues(const std::size_t num_threads)
+    {
+        if (local_queues)
+        {
+            for (std::size_t i = 0; i < thread_count; ++i)
+            {
+                for (task_t& task : local_queues[i].tasks)
+                    tasks.emplace(std::move(task));
+                for (task_t& task : local_queues[i].mailbox)
+                    tasks.emplace(std::move(task));
+            }
+            global_tasks_queued.store(tasks.size(), std::memory_order_relaxed);
+        }
+        // If NUMA-aware scheduling is enabled, the node queues are kept when the pool is reset, so the tasks remaining in them are still counted.
+        std::size_t node_tasks_queued = 0;
+        if constexpr (numa_enabled)
+        {
+            for (std::size_t i = 0; i < numa_nodes.size(); ++i)
+            {
+                const std::scoped_lock node_lock(node_queues[i].mutex);
+                node_tasks_queued += node_queues[i].tasks.size();
+            }
+        }
+        local_tasks_queued = node_tasks_queued;
+        mailbox_tasks_queued = 0;
+        local_queues = std::make_unique<local_queue[]>(num_threads);
+    }
+
+    /**
+     * @brief Assign each thread to a NUMA node, to be used if NUMA-aware scheduling is enabled. The first time this function is called, it also determines the topology, using only the logical processors available to the process and discarding nodes that have none, and creates the node queues. Must be called after the previous threads have been destroyed, and with the global mutex locked.
+     *
+     * @param num_threads The number of threads that will be created.
+     */
+    void assign_numa_nodes(const std::size_t num_threads)
+    {
+        if (numa_nodes.empty())
+        {
+#ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
+            std::optional<std::vector<std::vector<bool>>> nodes = get_os_numa_nodes();
+            if (nodes.has_value())
+            {
+                const std::optional<std::vector<bool>> process_affinity = get_os_process_affinity();
+                for (std::vector<bool>& node : *nodes)
+                {
+                    if (process_affinity.has_value())
+                    {
+                        for (std::size_t i = 0; i < node.size(); ++i)
+                            node[i] = node[i] && (i < process_affinity->size()) && (*process_affinity)[i];
+                    }
+                    if (std::find(node.begin(), node.end(), true) != node.end())
+                        numa_nodes.push_back(std::move(node));
+                }
+            }
+#endif
+            // If the topology could not be determined, treat the whole system as a single node, with an empty affinity so the threads are not pinned.
+            if (numa_nodes.empty())
+                numa_nodes.emplace_back();
+            node_queues = std::make_unique<local_queue[]>(numa_nodes.size());
+        }
+        thread_nodes = std::make_unique<std::size_t[]>(num_threads);
+        for (std::size_t i = 0; i < num_threads; ++i)
+            thread_nodes[i] = i * numa_nodes.size() / num_threads;
+    }
+
+    /**
+     * @brief Determine how many threads the pool should have, based on the parameter passed to the constructor or reset().
+     *
+     * @param num_threads The parameter passed to the constructor or `reset()`. If the parameter is a positive number, then the pool will be created with this number of threads. If the parameter is non-positive, or a parameter was not supplied (in which case it will have the default value of 0), then the pool will be created with the total number of hardware threads available, as obtained from `thread_t::hardware_concurrency()`. If the latter returns zero for some reason, then the pool will be created with just one thread.
+     * @return The number of threads to use for constructing the pool.
+     */
+    [[nodiscard]] static std::size_t determine_thread_count(const std::size_t num_threads) noexcept
+    {
+        if (num_threads > 0)
+            return num_threads;
+        if (thread_t::hardware_concurrency() > 0)
+            return thread_t::hardware_concurrency();
+        return 1;
+    }
+
+    /**
+     * @brief Check whether there are any tasks waiting to be executed, either in the global queue or, if enabled, in the local queues or the lock-free queue. Must be called with the global mutex locked.
+     *
+     * @return `true` if there are queued tasks, `false` otherwise.
+     */
+    [[nodiscard]] bool has_queued_tasks() const noexcept
+    {
+        bool result = !tasks.empty();
+        if constexpr (work_stealing_enabled)
+            result = result || (local_tasks_queued > 0) || (mailbox_tasks_queued > 0);
+        if constexpr (lock_free_enabled)
+            result = result || !lock_free_tasks.empty();
+        return result;
+    }
+
+    /**
+     * @brief Check whether there are any tasks waiting to be executed that a specific thread may take, like `has_queued_tasks()`, but only counting the tasks in the mailbox of that thread and not those in the mailboxes of other threads, unless mailbox stealing is enabled. Used by the workers to decide whether to go to sleep, so that a worker is not kept awake by tasks it is not allowed to take.
+     *
+     * @param idx The index of the thread.
+     * @return `true` if there are tasks the thread may take, `false` otherwise.
+     */
+    [[nodiscard]] bool has_tasks_for([[maybe_unused]] const std::size_t idx) const noexcept
+    {
+        if constexpr (work_stealing_enabled)
+        {
+            bool result = !tasks.empty() || (local_tasks_queued > 0) || (local_queues[idx].mailbox_size > 0);
+            if (mailbox_stealing.load(std::memory_order_relaxed))
+                result = result || (mailbox_tasks_queued > 0);
+            if constexpr (lock_free_enabled)
+                result = result || !lock_free_tasks.empty();
+            return result;
+        }
+        else
+        {
+            return has_queued_tasks();
+        }
+    }
+
+    /**
+     * @brief A helper class to store the function shared by the blocks of a loop or the tasks of a sequence, submitted using `detach_blocks()`, `submit_blocks()`, `detach_loop()`, `submit_loop()`, `detach_sequence()`, or `submit_sequence()`, or the state of a loop executed using `run_blocks()` or `run_loop()`, together with a single counter of the tasks that still refer to it. The counter starts at the number of tasks and is only decremented, once by each task when it is destroyed, so the tasks do not pay for the reference counting of an `std::shared_ptr`. The state is allocated from the pooled memory resource of the submitting thread if it belongs to this pool, and on the heap otherwise.
+     *
+     * @tparam F The type of the function.
+     */
+    template <typename F>
+    class loop_state
+    {
+    public:
+        /**
+         * @brief A reference to the state held by one task, consisting of a plain pointer, so that a task with an index range fits inline in a `BS::small_task`. Releases the reference when destroyed.
+         */
+        class [[nodiscard]] ref
+        {
+        public:
+            /**
+             * @brief Construct a reference to a state.
+             *
+             * @param state_ The state.
+             */
+            explicit ref(loop_state* const state_) noexcept : state(state_) {}
+
+            /**
+             * @brief Move-construct a reference, leaving the other reference empty.
+             *
+             * @param other The reference to move.
+             */
+            ref(ref&& other) noexcept : state(std::exchange(other.state, nullptr)) {}
+
+            // The copy constructor and the assignment operators are deleted. Each reference is counted exactly once.
+            ref(const ref&) = delete;
+            ref& operator=(const ref&) = delete;
+            ref& operator=(ref&&) = delete;
+
+            /**
+             * @brief Release the reference, destroying the state if this was the last one.
+             */
+            ~ref()
+            {
+                if (state != nullptr)
+                    state->release(1);
+            }
+
+            /**
+             * @brief Get the shared function.
+             *
+             * @return A reference to the function.
+             */
+            [[nodiscard]] F& operator*() const noexcept
+            {
+                return state->func;
+            }
+
+        private:
+            /**
+             * @brief A pointer to the state.
+             */
+            loop_state* state;
+        }; // class ref
+
+        /**
+         * @brief A helper class used by the submitting thread to hand out the references to a newly created state, one per task. Any references that were not handed out, for example because an exception was thrown while creating the tasks, are released when this object is destroyed.
+         */
+        class [[nodiscard]] issuer
+        {
+        public:
+            /**
+             * @brief Create a new state with the given number of references, and take ownership of all the references.
+             *
+             * @tparam A The types of the arguments used to construct the function.
+             * @param count_ The number of tasks that will refer to the state. Must be positive.
+             * @param pool The pool the tasks will be submitted to.
+             * @param args The arguments used to construct the function.
+             */
+            template <typename... A>
+            issuer(const std::size_t count_, const thread_pool& pool, A&&... args) : state(create(count_, pool, std::forward<A>(args)...)), count(count_) {}
+
+            // The copy and move constructors and assignment operators are deleted. Only the submitting thread uses this object.
+            issuer(const issuer&) = delete;
+            issuer(issuer&&) = delete;
+            issuer& operator=(const issuer&) = delete;
+            issuer& operator=(issuer&&) = delete;
+
+            /**
+             * @brief Release the references that were not handed out.
+             */
+            ~issuer()
+            {
+                if (count != 0)
+                    state->release(count);
+            }
+
+            /**
+             * @brief Hand out the next reference. Must be called at most as many times as the number of tasks passed to the constructor.
+             *
+             * @return The reference.
+             */
+            [[nodiscard]] ref next() noexcept
+            {
+                --count;
+                return ref(state);
+            }
+
+        private:
+            /**
+             * @brief A pointer to the state.
+             */
+            loop_state* state;
+
+            /**
+             * @brief The number of references that have not been handed out yet.
+             */
+            std::size_t count;
+        }; // class issuer
+
+    private:
+        /**
+         * @brief Construct a state.
+         *
+         * @tparam A The types of the arguments used to construct the function.
+         * @param count The number of references.
+         * @param args The arguments used to construct the function.
+         */
+        template <typename... A>
+        loop_state(const std::size_t count, A&&... args) : refs(count), func(std::forward<A>(args)...)
+        {
+        }
+
+        /**
+         * @brief Allocate and construct a new state.
+         *
+         * @tparam A The types of the arguments used to construct the function.
+         * @param count The number of references.
+         * @param pool The pool the tasks will be submitted to.
+         * @param args The arguments used to construct the function.
+         * @return A pointer to the new state.
+         */
+        template <typename... A>
+        [[nodiscard]] static loop_state* create(const std::size_t count, [[maybe_unused]] const thread_pool& pool, A&&... args)
+        {
+#ifdef __cpp_lib_memory_resource
+            std::pmr::memory_resource* const mem = (this_thread::get_pool() == &pool) ? this_thread::my_pooled_resource : std::pmr::new_delete_resource();
+            void* const storage = mem->allocate(sizeof(loop_state), alignof(loop_state));
+    #ifdef __cpp_exceptions
+            try
+            {
+    #endif
+                loop_state* const state = ::new (storage) loop_state(count, std::forward<A>(args)...);
+                state->resource = mem;
+                return state;
+    #ifdef __cpp_exceptions
+            }
+            catch (...)
+            {
+                mem->deallocate(storage, sizeof(loop_state), alignof(loop_state));
+                throw;
+            }
+    #endif
+#else
+            return new loop_state(count, std::forward<A>(args)...);
+#endif
+        }
+
+        /**
+         * @brief Release some of the references, destroying and deallocating the state if no references remain.
+         *
+         * @param num The number of references to release.
+         */
+        void release(const std::size_t num) noexcept
+        {
+            if (refs.fetch_sub(num, std::memory_order_acq_rel) == num)
+            {
+#ifdef __cpp_lib_memory_resource
+                std::pmr::memory_resource* const mem = resource;
+                this->~loop_state();
+                mem->deallocate(this, sizeof(loop_state), alignof(loop_state));
+#else
+                delete this;
+#endif
+            }
+        }
+
+        /**
+         * @brief The number of references that have not been released yet.
+         */
+        std::atomic<std::size_t> refs;
+
+        /**
+         * @brief The shared function.
+         */
+        F func;
+
+#ifdef __cpp_lib_memory_resource
+        /**
+         * @brief The memory resource the state was allocated from.
+         */
+        std::pmr::memory_resource* resource = nullptr;
+#endif
+    }; // class loop_state
+
+    /**
+     * @brief A helper class to store the state of a loop executed using `run_blocks()` or `run_loop()`: the blocks, a pointer to the block function, which stays on the stack of the calling thread, the counter used to claim blocks, and the counter of finished blocks. The calling thread and the helper tasks claim blocks one by one until none remain, and the calling thread then waits only for the blocks that were claimed by other threads, so helper tasks that have not started yet do not need to run before it can return. The state is kept alive by the helper tasks using `loop_state`, since they may start after all the blocks are done.
+     *
+     * @tparam T The type of the indices.
+     * @tparam F The type of the block function.
+     */
+    template <typename T, typename F>
+    class fork_join_state
+    {
+    public:
+        /**
+         * @brief Construct the state of a loop.
+         *
+         * @param blks_ The blocks.
+         * @param func_ The block function.
+         */
+        fork_join_state(const blocks<T>& blks_, F& func_) noexcept : blks(blks_), func(&func_) {}
+
+        /**
+         * @brief Claim and execute blocks until none remain. If exceptions are enabled and a block throws an exception, the exception is stored to be rethrown by `wait()`, and the blocks that have not been claimed yet are skipped.
+         */
+        void help()
+        {
+            const std::size_t num_blocks = blks.get_num_blocks();
+            std::size_t blk = 0;
+            while ((blk = cursor.fetch_add(1, std::memory_order_relaxed)) < num_blocks)
+            {
+#ifdef __cpp_exceptions
+                if (!failed.load(std::memory_order_relaxed))
+                {
+                    try
+                    {
+                        (*func)(blks.start(blk), blks.end(blk));
+                    }
+                    catch (...)
+                    {
+                        if (!failed.exchange(true, std::memory_order_relaxed))
+                            exception = std::current_exception();
+                    }
+                }
+#else
+                (*func)(blks.start(blk), blks.end(blk));
+#endif
+                if (finished.fetch_add(1, std::memory_order_acq_rel) + 1 == num_blocks)
+                {
+                    const std::scoped_lock lock(mutex);
+                    done_cv.notify_all();
+                }
+            }
+        }
+
+        /**
+         * @brief Wait until all the blocks have finished. If exceptions are enabled and any of the blocks threw an exception, rethrow the first one.
+         */
+        void wait()
+        {
+            if (finished.load(std::memory_order_acquire) != blks.get_num_blocks())
+            {
+                std::unique_lock lock(mutex);
+                done_cv.wait(lock,
+                    [this]
+                    {
+                        return finished.load(std::memory_order_acquire) == blks.get_num_blocks();
+                    });
+            }
+#ifdef __cpp_exceptions
+            if (exception)
+                std::rethrow_exception(exception);
+#endif
+        }
+
+    private:
+        /**
+         * @brief The blocks.
+         */
+        const blocks<T> blks;
+
+        /**
+         * @brief A pointer to the block function.
+         */
+        F* const func;
+
+        /**
+         * @brief The index of the next block to be claimed. Aligned to a cache line, since it is written by all the threads.
+         */
+        alignas(cache_line_size) std::atomic<std::size_t> cursor = 0;
+
+        /**
+         * @brief The number of blocks that have finished, including skipped blocks. Aligned to its own cache line, so that finishing a block does not interfere with claiming the next one.
+         */
+        alignas(cache_line_size) std::atomic<std::size_t> finished = 0;
+
+        /**
+         * @brief A mutex used together with `done_cv`.
+         */
+        std::mutex mutex;
+
+        /**
+         * @brief A condition variable used to notify the calling thread that all the blocks have finished.
+         */
+        std::condition_variable done_cv;
+
+#ifdef __cpp_exceptions
+        /**
+         * @brief A flag indicating whether any of the blocks threw an exception.
+         */
+        std::atomic<bool> failed = false;
+
+        /**
+         * @brief The first exception thrown by any of the blocks.
+         */
+        std::exception_ptr exception = nullptr;
+#endif
+    }; // class fork_join_state
+
+    /**
+     * @brief A helper struct to store the shared state of a loop parallelized using the `BS::schedule::dynamic` or `BS::schedule::guided` scheduling policy: the counter used to claim chunks and the function to loop through.
+     *
+     * @tparam T The type of the indices.
+     * @tparam F The type of the function to loop through.
+     */
+    template <typename T, typename F>
+    struct dynamic_loop
+    {
+        /**
+         * @brief Construct the shared state of a loop.
+         *
+         * @tparam G The type of the function to loop through, before decaying.
+         * @param first_index The first index in the loop.
+         * @param index_after_last The index after the last index in the loop.
+         * @param policy The scheduling policy.
+         * @param chunk_size The size, or minimum size, of each chunk.
+         * @param num_threads The number of threads in the pool.
+         * @param func_ The function to loop through.
+         */
+        template <typename G>
+        dynamic_loop(const T first_index, const T index_after_last, const BS::schedule policy, const std::size_t chunk_size, const std::size_t num_threads, G&& func_) : blks(first_index, index_after_last, policy, chunk_size, num_threads), func(std::forward<G>(func_))
+        {
+        }
+
+        /**
+         * @brief The object used to claim chunks of the range.
+         */
+        dynamic_blocks<T> blks;
+
+        /**
+         * @brief The function to loop through.
+         */
+        F func;
+    }; // struct dynamic_loop
+
+    /**
+     * @brief A helper struct to store the shared state of a group of tasks submitted using `submit_blocks_grouped()` or `submit_sequence_grouped()`: the state shared with the `BS::group_future`, and the function called by the tasks, so that both are allocated together.
+     *
+     * @tparam R The return type of the function.
+     * @tparam F The type of the function.
+     */
+    template <typename R, typename F>
+    struct group_task_state : public group_state<R>
+    {
+        /**
+         * @brief Construct the shared state of a group of tasks.
+         *
+         * @tparam FF The type of the function, before decaying.
+         * @param count The number of tasks.
+         * @param func_ The function.
+         */
+        template <typename FF>
+        group_task_state(const std::size_t count, FF&& func_) : group_state<R>(count), func(std::forward<FF>(func_))
+        {
+        }
+
+        /**
+         * @brief The function called by the tasks.
+         */
+        F func;
+    }; // struct group_task_state
+
+    /**
+     * @brief A helper struct to store the shared state of a reduction submitted using `submit_reduce()`: the blocks, the functions, the padded partial results, the flags used to combine them in a tree, and the promise for the final result.
+     *
+     * @tparam T The type of the indices.
+     * @tparam R The type of the result.
+     * @tparam M The type of the map function.
+     * @tparam F The type of the reduction function.
+     */
+    template <typename T, typename R, typename M, typename F>
+    struct reduce_state
+    {
+        /**
+         * @brief A helper struct to store a partial result, padded to a cache line to avoid false sharing between blocks that finish at the same time.
+         */
+        struct alignas(cache_line_size) partial
+        {
+            /**
+             * @brief The partial result.
+             */
+            R value;
+        }; // struct partial
+
+        /**
+         * @brief Construct the shared state of a reduction.
+         *
+         * @tparam MM The type of the map function, before decaying.
+         * @tparam FF The type of the reduction function, before decaying.
+         * @param first_index The first index in the range.
+         * @param index_after_last The index after the last index in the range.
+         * @param num_blocks The desired number of blocks.
+         * @param map_ The map function.
+         * @param reduce_ The reduction function.
+         * @param identity_ The identity element of the reduction.
+         */
+        template <typename MM, typename FF>
+        reduce_state(const T first_index, const T index_after_last, const std::size_t num_blocks, MM&& map_, FF&& reduce_, R&& identity_) : blks(first_index, index_after_last, num_blocks), map(std::forward<MM>(map_)), reduce(std::forward<FF>(reduce_)), identity(std::move(identity_)), partials(blks.get_num_blocks(), partial{identity}), arrived(std::make_unique<std::atomic<bool>[]>(blks.get_num_blocks()))
+        {
+        }
+
+        /**
+         * @brief Compute the partial result of a block, and then combine it with the partial results of the neighboring blocks as far up the tree as possible. At each node of the tree, the task that arrives first stores its result and returns, and the task that arrives second combines the two results and continues up the tree. The task that reaches the root sets the value of the promise.
+         *
+         * @param blk The block number.
+         */
+        void run_block(const std::size_t blk)
+        {
+#ifdef __cpp_exceptions
+            try
+            {
+#endif
+                if constexpr (std::is_invocable_v<M&, T, T>)
+                {
+                    partials[blk].value = map(blks.start(blk), blks.end(blk));
+                }
+                else
+                {
+                    R acc = identity;
+                    const T end = blks.end(blk);
+                    for (T i = blks.start(blk); i < end; ++i)
+                        acc = reduce(std::move(acc), map(i));
+                    partials[blk].value = std::move(acc);
+                }
+#ifdef __cpp_exceptions
+            }
+            catch (...)
+            {
+                store_exception();
+            }
+#endif
+            const std::size_t n = blks.get_num_blocks();
+            // The node we are at covers the blocks `[node << level, (node + 1) << level)`, and its partial result is stored at index `node << level`.
+            std::size_t node = blk;
+            std::size_t level = 0;
+            while ((static_cast<std::size_t>(1) << level) < n)
+            {
+                const std::size_t left = (node & ~static_cast<std::size_t>(1)) << level;
+                const std::size_t right = left + (static_cast<std::size_t>(1) << level);
+                if (right < n)
+                {
+                    // The index `right - 1` uniquely identifies the parent node, since each index is the last block in the left half of exactly one node.
+                    if (!arrived[right - 1].exchange(true, std::memory_order_acq_rel))
+                        return;
+#ifdef __cpp_exceptions
+                    try
+                    {
+                        if (!has_exception.load(std::memory_order_relaxed))
+                            partials[left].value = reduce(std::move(partials[left].value), std::move(partials[right].value));
+                    }
+                    catch (...)
+                    {
+                        store_exception();
+                    }
+#else
+                    partials[left].value = reduce(std::move(partials[left].value), std::move(partials[right].value));
+#endif
+                }
+                node >>= 1U;
+                ++level;
+            }
+#ifdef __cpp_exceptions
+            if (has_exception.load(std::memory_order_relaxed))
+            {
+                promise.set_exception(exception);
+                return;
+            }
+#endif
+            promise.set_value(std::move(partials[0].value));
+        }
+
+#ifdef __cpp_exceptions
+        /**
+         * @brief Store the current exception, if no other exception has been stored yet.
+         */
+        void store_exception() noexcept
+        {
+            if (!has_exception.exchange(true, std::memory_order_relaxed))
+                exception = std::current_exception();
+        }
+#endif
+
+        /**
+         * @brief The blocks that the range is divided into.
+         */
+        const blocks<T> blks;
+
+        /**
+         * @brief The map function.
+         */
+        M map;
+
+        /**
+         * @brief The reduction function.
+         */
+        F reduce;
+
+        /**
+         * @brief The identity element of the reduction.
+         */
+        R identity;
+
+        /**
+         * @brief The padded partial results of the blocks, which are also used to store the partial results of the internal nodes of the tree.
+         */
+        std::vector<partial> partials;
+
+        /**
+         * @brief Flags indicating whether the first of the two children of each internal node of the tree has arrived.
+         */
+        std::unique_ptr<std::atomic<bool>[]> arrived;
+
+#ifdef __cpp_exceptions
+        /**
+         * @brief The first exception thrown by the map or reduction function, if any.
+         */
+        std::exception_ptr exception = nullptr;
+
+        /**
+         * @brief A flag indicating whether an exception has been stored.
+         */
+        std::atomic<bool> has_exception = false;
+#endif
+
+        /**
+         * @brief The promise for the final result.
+         */
+        std::promise<R> promise;
+    }; // struct reduce_state
+
+    /**
+     * @brief Determine the number of blocks to divide a range into, given the desired size of each block, to be used with the `BS::schedule::static_blocks` scheduling policy.
+     *
+     * @tparam T The type of the indices.
+     * @param first_index The first index in the range.
+     * @param index_after_last The index after the last index in the range.
+     * @param chunk_size The desired size of each block. If 0, the function returns 0, which means the number of blocks will be equal to the number of threads in the pool.
+     * @return The number of blocks.
+     */
+    template <typename T>
+    [[nodiscard]] static std::size_t num_blocks_for_chunk_size(const T first_index, const T index_after_last, const std::size_t chunk_size) noexcept
+    {
+        if ((chunk_size == 0) || (index_after_last <= first_index))
+            return 0;
+        const std::size_t total_size = static_cast<std::size_t>(index_after_last - first_index);
+        return (total_size + chunk_size - 1) / chunk_size;
+    }
+
+    /**
+     * @brief Turn a function that takes a single index into a block function that calls it for every index in a block, to be used by the overloads of `detach_loop()` and `submit_loop()` that take a stop condition.
+     *
+     * @tparam T The type of the indices.
+     * @tparam F The type of the function.
+     * @param loop The function to call for every index.
+     * @return The block function.
+     */
+    template <typename T, typename F>
+    [[nodiscard]] static auto make_loop_block(F&& loop)
+    {
+        return [loop = std::forward<F>(loop)](const T start, const T end) mutable
+        {
+            for (T i = start; i < end; ++i)
+                loop(i);
+        };
+    }
+
+    /**
+     * @brief Wrap a function in a task which stores the function's returned value, or any exception it throws, in a promise. Since tasks do not need to be copyable, the promise is moved directly into the task, instead of being shared with it through a separate heap allocation.
+     *
+     * @tparam R The return type of the function (can be `void`).
+     * @tparam F The type of the function.
+     * @param task The function to wrap.
+     * @param promise The promise to store the result in.
+     * @return The wrapped task.
+     */
+    template <typename R, typename F>
+    [[nodiscard]] static auto make_promise_task(F&& task, std::promise<R>&& promise)
+    {
+        return [task = std::forward<F>(task), promise = std::move(promise)]() mutable
+        {
+#ifdef __cpp_exceptions
+            try
+            {
+#endif
+                if constexpr (std::is_void_v<R>)
+                {
+                    task();
+                    promise.set_value();
+                }
+                else
+                {
+                    promise.set_value(task());
+                }
+#ifdef __cpp_exceptions
+            }
+            catch (...)
+            {
+                try
+                {
+                    promise.set_exception(std::current_exception());
+                }
+                catch (...)
+                {
+                }
+            }
+#endif
+        };
+    }
+
+    /**
+     * @brief Wrap a function in a task which stores the function's returned value in a new promise, and add the corresponding future to a `BS::multi_future`.
+     *
+     * @tparam R The return type of the function (can be `void`).
+     * @tparam F The type of the function.
+     * @param task The function to wrap.
+     * @param future The `BS::multi_future` to add the future to.
+     * @return The wrapped task.
+     */
+    template <typename R, typename F>
+    [[nodiscard]] static auto make_promise_task(F&& task, multi_future<R>& future)
+    {
+        std::promise<R> promise;
+        future.push_back(promise.get_future());
+        return make_promise_task<R>(std::forward<F>(task), std::move(promise));
+    }
+
+    /**
+     * @brief Wrap a function so that it is skipped if the given stop condition says it should stop by the time it is called, and so that `BS::this_thread::stop_requested()` checks the stop condition while it runs. The wrapper takes the same arguments as the function. If the function is skipped, the wrapper throws `BS::task_cancelled`, which ends up in the future of the task if it has one; if exception handling is disabled, the wrapper returns instead, so the function must not have a return value.
+     *
+     * @tparam F The type of the function.
+     * @param stop The stop condition.
+     * @param task The function to wrap.
+     * @return The wrapped function.
+     */
+    template <typename F>
+    [[nodiscard]] static auto make_stoppable_task(const stop_condition& stop, F&& task)
+    {
+        return [stop, task = std::forward<F>(task)](auto&&... args) mutable -> decltype(auto)
+        {
+            if (stop.stop_requested())
+            {
+#ifdef __cpp_exceptions
+                throw task_cancelled();
+#else
+                using R = decltype(task(std::forward<decltype(args)>(args)...));
+                static_assert(std::is_void_v<R>, "Tasks with a stop condition must not have a return value if exception handling is disabled.");
+                if constexpr (std::is_void_v<R>)
+                    return;
+#endif
+            }
+            const this_thread::stop_condition_scope scope(stop);
+            return task(std::forward<decltype(args)>(args)...);
+        };
+    }
+
+#ifdef __cpp_lib_memory_resource
+    /**
+     * @brief Construct a task whose callable object is allocated from the pooled memory resource of the current thread, if it is a thread of this pool, so that tasks submitted from within the pool do not allocate from the global heap in steady state. The resource belongs to the pool, and outlives all the tasks in its queues. If the current thread is not a thread of this pool, the callable object is allocated on the heap as usual.
+     *
+     * @tparam F The type of the callable object.
+     * @param task The callable object.
+     * @return The task.
+     */
+    template <typename F>
+    [[nodiscard]] task_t make_worker_task(F&& task)
+    {
+        return task_t(std::allocator_arg, (this_thread::get_pool() == this) ? this_thread::my_pooled_resource : nullptr, std::forward<F>(task));
+    }
+#endif
+
+    /**
+     * @brief Pop a task from the queue.
+     *
+     * @return The task.
+     */
+    [[nodiscard]] task_t pop_task()
+    {
+        if constexpr (priority_enabled)
+        {
+            return tasks.pop();
+        }
+        else
+        {
+            task_t task = std::move(tasks.front());
+            tasks.pop();
+            return task;
+        }
+    }
+
+    /**
+     * @brief Try to pop a task from the local queue of a thread, to be used if work stealing is enabled. The thread that owns the queue takes the most recently pushed task, since it is the most likely to still be in the cache.
+     *
+     * @param idx The index of the thread that owns the queue.
+     * @param task A reference to the object that will store the task, if one was found.
+     * @return `true` if a task was found, `false` otherwise.
+     */
+    bool pop_local_task(const std::size_t idx, task_t& task)
+    {
+        local_queue& queue = local_queues[idx];
+        const std::scoped_lock local_lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        --local_tasks_queued;
+        return true;
+    }
+
+    /**
+     * @brief Push a task into the local queue of a thread, to be used if work stealing is enabled. If any workers are idle, one of them is woken up so it can steal the task.
+     *
+     * @tparam F The type of the function.
+     * @param idx The index of the thread that owns the queue.
+     * @param task The function to push.
+     */
+    template <typename F>
+    void push_local_task(const std::size_t idx, F&& task)
+    {
+        {
+            local_queue& queue = local_queues[idx];
+            const std::scoped_lock local_lock(queue.mutex);
+            queue.tasks.emplace_back(std::forward<F>(task));
+            // The counter must be incremented while the mutex is still locked, since otherwise another thread could take the task and decrement the counter first, making it wrap around to the maximum value of std::size_t.
+            ++local_tasks_queued;
+        }
+        notify_idle_worker();
+    }
+
+    /**
+     * @brief Try to pop a task from the mailbox of a thread, to be used if work stealing is enabled. Tasks are taken from the mailbox in the order they were submitted, both by the owner thread and, if mailbox stealing is enabled, by other threads.
+     *
+     * @param idx The index of the thread that owns the mailbox.
+     * @param task A reference to the object that will store the task, if one was found.
+     * @return `true` if a task was found, `false` otherwise.
+     */
+    bool pop_mailbox_task(const std::size_t idx, task_t& task)
+    {
+        local_queue& queue = local_queues[idx];
+        // Checking the size first avoids locking the mutex of the local queue, which is also used for the local tasks, if the mailbox is empty, which is usually the case.
+        if (queue.mailbox_size.load(std::memory_order_relaxed) == 0)
+            return false;
+        const std::scoped_lock local_lock(queue.mutex);
+        if (queue.mailbox.empty())
+            return false;
+        task = std::move(queue.mailbox.front());
+        queue.mailbox.pop_front();
+        queue.mailbox_size.store(queue.mailbox.size(), std::memory_order_relaxed);
+        --mailbox_tasks_queued;
+        return true;
+    }
+
+    /**
+     * @brief Push a task into the mailbox of a thread, to be used if work stealing is enabled. Since a condition variable cannot wake up a specific thread, all the idle workers are woken up if there are any, and only the owner of the mailbox (or any idle worker, if mailbox stealing is enabled) will find the task; the others go back to sleep. If the owner is not idle, it will find the task before it goes to sleep, so no worker is woken up.
+     *
+     * @tparam F The type of the function.
+     * @param idx The index of the thread that owns the mailbox.
+     * @param task The function to push.
+     * @param bounded Whether to wait for room in the queue first, if a queue capacity was set and this function is called from outside the pool.
+     */
+    template <typename F>
+    void push_mailbox_task(const std::size_t idx, F&& task, const bool bounded)
+    {
+        {
+            // As in `push_node_task()`, the global mutex stays locked until the task is counted, so the capacity is never exceeded.
+            std::unique_lock<std::mutex> tasks_lock;
+            if (bounded)
+            {
+                tasks_lock = std::unique_lock(tasks_mutex);
+                wait_for_space(tasks_lock, std::chrono::steady_clock::time_point::max());
+            }
+            local_queue& queue = local_queues[idx];
+            const std::scoped_lock local_lock(queue.mutex);
+            queue.mailbox.emplace_back(std::forward<F>(task));
+            queue.mailbox_size = queue.mailbox.size();
+            // Incremented while the mutex is locked, for the same reason as in `push_local_task()`, since with mailbox stealing another thread may take the task as soon as the mutex is released.
+            ++mailbox_tasks_queued;
+        }
+        // The same reasoning as in `notify_idle_worker()` applies, since both the size of the mailbox and `idle_workers` are sequentially consistent, except that a spinning worker may not be the owner of the mailbox, so idle workers are woken up even if a worker is spinning.
+        if (idle_workers > 0)
+        {
+            {
+                const std::scoped_lock tasks_lock(tasks_mutex);
+            }
+            task_available_cv.notify_all();
+        }
+    }
+
+    /**
+     * @brief Choose a thread from a mask to submit a task to using `detach_task_to()`: the selected thread with the fewest tasks in its mailbox, or the first one if there is a tie.
+     *
+     * @param workers The mask of threads.
+     * @return The index of the chosen thread, or an empty `std::optional` if the mask does not select any of the threads.
+     */
+    [[nodiscard]] std::optional<std::size_t> select_worker(const std::vector<bool>& workers) const
+    {
+        static_assert(work_stealing_enabled && !elastic_enabled, "detach_task_to() is only available if the flag BS::tp::work_stealing or BS::tp::numa is enabled, and the flag BS::tp::elastic is not enabled.");
+        std::optional<std::size_t> result;
+        std::size_t fewest = 0;
+        const std::size_t num_workers = std::min(workers.size(), thread_count);
+        for (std::size_t i = 0; i < num_workers; ++i)
+        {
+            if (!workers[i])
+                continue;
+            const std::size_t size = local_queues[i].mailbox_size.load(std::memory_order_relaxed);
+            if (!result.has_value() || (size < fewest))
+            {
+                result = i;
+                fewest = size;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Push a task into the queue of a NUMA node, to be used if NUMA-aware scheduling is enabled. If any workers are idle, one of them is woken up so it can take the task.
+     *
+     * @tparam F The type of the function.
+     * @param node The index of the node.
+     * @param task The function to push.
+     * @param bounded Whether to wait for room in the queue first, if a queue capacity was set and this function is called from outside the pool.
+     */
+    template <typename F>
+    void push_node_task(const std::size_t node, F&& task, const bool bounded)
+    {
+        {
+            // With a queue capacity, the task is placed in the node's queue while the global mutex is still locked, so the capacity is never exceeded, as in `enqueue_task()`.
+            std::unique_lock<std::mutex> tasks_lock;
+            if (bounded)
+            {
+                tasks_lock = std::unique_lock(tasks_mutex);
+                wait_for_space(tasks_lock, std::chrono::steady_clock::time_point::max());
+            }
+            local_queue& queue = node_queues[node];
+            const std::scoped_lock node_lock(queue.mutex);
+            queue.tasks.emplace_back(std::forward<F>(task));
+            // Incremented while the mutex is locked, for the same reason as in `push_local_task()`.
+            ++local_tasks_queued;
+        }
+        notify_idle_worker();
+    }
+
+    /**
+     * @brief Submit a task into the appropriate queue, as described in `detach_task()`. If a queue capacity was set and this function is called from outside the pool, the task is always placed in the global queue, after waiting for room in the queue until the deadline. Otherwise, there is always room. The task is only moved out of the argument if it is submitted.
+     *
+     * @tparam F The type of the function.
+     * @param task The function to submit.
+     * @param priority The priority of the task.
+     * @param deadline The latest time to wait for room in the queue. `std::chrono::steady_clock::time_point::max()` means wait indefinitely, and `std::chrono::steady_clock::time_point::min()` means do not wait at all.
+     * @return `true` if the task was submitted, `false` if the queue was still full at the deadline.
+     */
+    template <typename F>
+    bool enqueue_task(F&& task, const priority_t priority, const std::chrono::steady_clock::time_point deadline)
+    {
+        [[maybe_unused]] bool grow = false;
+        [[maybe_unused]] std::size_t new_thread = 0;
+        if ((queue_capacity.load(std::memory_order_relaxed) == 0) || (this_thread::get_pool() == this))
+        {
+            auto&& stamped = stamp_task(std::forward<F>(task), priority);
+            using S = decltype(stamped);
+            if constexpr (work_stealing_enabled)
+            {
+                if ((!priority_enabled || priority == 0) && this_thread::get_pool() == this)
+                {
+                    push_local_task(*this_thread::get_index(), std::forward<S>(stamped));
+                    return true;
+                }
+            }
+            if constexpr (lock_free_enabled)
+            {
+                // If the lock-free queue is full, fall back to the global queue protected by the mutex.
+                if (lock_free_tasks.try_push(std::forward<S>(stamped)))
+                {
+                    notify_idle_worker();
+                    return true;
+                }
+            }
+            const std::scoped_lock tasks_lock(tasks_mutex);
+            grow = push_global_task(std::forward<S>(stamped), priority, new_thread);
+        }
+        else
+        {
+            // With a queue capacity, the task is placed in the global queue while the mutex is still locked, so the capacity is never exceeded.
+            std::unique_lock tasks_lock(tasks_mutex);
+            if (!wait_for_space(tasks_lock, deadline))
+                return false;
+            grow = push_global_task(stamp_task(std::forward<F>(task), priority), priority, new_thread);
+        }
+        // If a worker is spinning, it will pick up the task without being woken up.
+        if (spinning_workers == 0)
+            task_available_cv.notify_one();
+        if constexpr (elastic_enabled)
+        {
+            if (grow)
+                start_thread(new_thread);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Push a batch of tasks into the queue, locking the global mutex only once, and wake up as many idle workers as there are tasks, or all of them if there are fewer idle workers than tasks. If work stealing is enabled and this function is called from within a thread of the same pool, the tasks are placed in that thread's local queue instead (unless task priority is enabled and the priority is not 0). If the lock-free queue is enabled, the tasks are placed in it, and only those that do not fit are placed in the global queue. If a queue capacity was set and this function is called from outside the pool, the tasks are all placed in the global queue, in chunks as large as the room left in the queue, waiting for room in between.
+     *
+     * @param batch The tasks to push. They will be moved out of the vector.
+     * @param priority The priority of the tasks.
+     */
+    void push_batch(std::vector<task_t>& batch, const priority_t priority)
+    {
+        const std::size_t count = batch.size();
+        if (count == 0)
+            return;
+        std::size_t first = 0;
+        if ((queue_capacity.load(std::memory_order_relaxed) != 0) && (this_thread::get_pool() != this))
+        {
+            while (first < count)
+                first = push_global_batch(batch, first, 0, priority, true);
+            return;
+        }
+        if constexpr (work_stealing_enabled)
+        {
+            if ((!priority_enabled || priority == 0) && this_thread::get_pool() == this)
+            {
+                local_queue& queue = local_queues[*this_thread::get_index()];
+                {
+                    const std::scoped_lock queue_lock(queue.mutex);
+                    for (task_t& task : batch)
+                        queue.tasks.push_back(std::move(task));
+                    // Incremented while the mutex is locked, for the same reason as in `push_local_task()`.
+                    local_tasks_queued += count;
+                }
+                first = count;
+            }
+        }
+        if constexpr (lock_free_enabled)
+        {
+            while ((first < count) && lock_free_tasks.try_push(std::move(batch[first])))
+                ++first;
+        }
+        push_global_batch(batch, first, first, priority, false);
+    }
+
+    /**
+     * @brief Push the tasks in a batch, starting from the given index, into the global queue, and wake up as many idle workers as needed. Used by `push_batch()`.
+     *
+     * @param batch The tasks to push. They will be moved out of the vector.
+     * @param first The index of the first task to push.
+     * @param num_unlocked The number of tasks already pushed into other queues without locking the global mutex, which also need a worker to execute them.
+     * @param priority The priority of the tasks.
+     * @param bounded Whether to wait for room in the queue first, and push only as many tasks as fit.
+     * @return The index after the last task that was pushed.
+     */
+    std::size_t push_global_batch(std::vector<task_t>& batch, const std::size_t first, const std::size_t num_unlocked, const priority_t priority, const bool bounded)
+    {
+        std::size_t last = batch.size();
+        std::size_t num_to_wake = 0;
+        [[maybe_unused]] bool grow = false;
+        [[maybe_unused]] std::size_t new_thread = 0;
+        {
+            std::unique_lock tasks_lock(tasks_mutex);
+            if (bounded)
+            {
+                wait_for_space(tasks_lock, std::chrono::steady_clock::time_point::max());
+                // The capacity may have been set to 0 in the meantime, in which case the rest of the batch fits.
+                const std::size_t capacity = queue_capacity.load(std::memory_order_relaxed);
+                if (capacity != 0)
+                    last = std::min(last, first + (capacity - count_queued_tasks()));
+            }
+            for (std::size_t i = first; i < last; ++i)
+            {
+                if constexpr (priority_enabled)
+                    tasks.emplace(std::move(batch[i]), priority);
+                else
+                    tasks.emplace(std::move(batch[i]));
+            }
+            global_tasks_queued.store(tasks.size(), std::memory_order_relaxed);
+            // Spinning workers will pick up some of the tasks without being woken up.
+            const std::size_t spinning = spinning_workers;
+            const std::size_t num_new = (last - first) + num_unlocked;
+            num_to_wake = (num_new > spinning) ? std::min<std::size_t>(num_new - spinning, idle_workers) : 0;
+            if constexpr (elastic_enabled)
+                grow = should_grow() && claim_thread_slot(new_thread);
+        }
+        for (std::size_t i = 0; i < num_to_wake; ++i)
+            task_available_cv.notify_one();
+        if constexpr (elastic_enabled)
+        {
+            if (grow)
+                start_thread(new_thread);
+        }
+        return last;
+    }
+
+    /**
+     * @brief Push a task into the global queue. Must be called with the global mutex locked.
+     *
+     * @tparam F The type of the function.
+     * @param task The function to push.
+     * @param priority The priority of the task.
+     * @param new_thread A reference to the variable in which the index of a new thread to start will be stored, if the elastic thread count is enabled.
+     * @return `true` if a new thread must be started using `start_thread()` once the global mutex is released, `false` otherwise.
+     */
+    template <typename F>
+    bool push_global_task(F&& task, const priority_t priority, [[maybe_unused]] std::size_t& new_thread)
+    {
+        if constexpr (priority_enabled)
+            tasks.emplace(std::forward<F>(task), priority);
+        else
+            tasks.emplace(std::forward<F>(task));
+        global_tasks_queued.store(tasks.size(), std::memory_order_relaxed);
+        if constexpr (elastic_enabled)
+            return should_grow() && claim_thread_slot(new_thread);
+        else
+            return false;
+    }
+
+    /**
+     * @brief Wake up one idle worker, if there are any, after a task has been pushed into a queue without locking the global mutex. The task must be counted (in `local_tasks_queued` or the lock-free queue) before calling this function, and the workers increment `idle_workers` before checking for tasks, so at least one side is guaranteed to see the other's update. This prevents a lost wakeup without having to lock the global mutex on every push. If a worker is spinning, no worker is woken up, since a spinning worker does not go to sleep without checking for tasks first. If there are no idle workers and the elastic thread count is enabled, a new thread may be started instead.
+     */
+    void notify_idle_worker()
+    {
+        if ((idle_workers > 0) && (spinning_workers == 0))
+        {
+            {
+                const std::scoped_lock tasks_lock(tasks_mutex);
+            }
+            task_available_cv.notify_one();
+        }
+        else if constexpr (elastic_enabled)
+        {
+            grow_if_needed();
+        }
+    }
+
+    /**
+     * @brief Wake up one thread waiting for room in the queue, if there are any, after a task has been taken out of a queue without locking the global mutex. The waiting thread increments `space_waiters` before checking for room, and the worker reads it using a read-modify-write operation after taking the task out of the queue. Since both are read-modify-write operations on the same variable, either the worker sees the increment, or the waiting thread sees the task leave the queue, so no wakeup is lost. If no queue capacity is set, no thread can be waiting, so this is skipped.
+     */
+    void notify_space_available()
+    {
+        if (queue_capacity.load(std::memory_order_relaxed) == 0)
+            return;
+        if (space_waiters.fetch_add(0, std::memory_order_acq_rel) > 0)
+        {
+            {
+                const std::scoped_lock tasks_lock(tasks_mutex);
+            }
+            task_space_cv.notify_one();
+        }
+    }
+
+    /**
+     * @brief Wait until there is room in the queue for at least one more task, or until the deadline. Must be called with the global mutex locked through the given lock, which remains locked when this function returns.
+     *
+     * @param tasks_lock The lock on the global mutex.
+     * @param deadline The latest time to wait. `std::chrono::steady_clock::time_point::max()` means wait indefinitely, and `std::chrono::steady_clock::time_point::min()` means do not wait at all.
+     * @return `true` if there is room in the queue, `false` if the queue was still full at the deadline.
+     */
+    bool wait_for_space(std::unique_lock<std::mutex>& tasks_lock, const std::chrono::steady_clock::time_point deadline)
+    {
+        const auto has_space = [this]
+        {
+            const std::size_t capacity = queue_capacity.load(std::memory_order_relaxed);
+            return (capacity == 0) || (count_queued_tasks() < capacity);
+        };
+        if (has_space())
+            return true;
+        if (deadline == std::chrono::steady_clock::time_point::min())
+            return false;
+        ++space_waiters;
+        bool result = true;
+        if (deadline == std::chrono::steady_clock::time_point::max())
+            task_space_cv.wait(tasks_lock, has_space);
+        else
+            result = task_space_cv.wait_until(tasks_lock, deadline, has_space);
+        --space_waiters;
+        return result;
+    }
+
+    /**
+     * @brief Execute a CPU instruction that tells the processor the current thread is spinning, such as `pause` on x86 or `yield` on ARM. This reduces power consumption and the penalty for leaving the spin loop, and lets a hyperthreaded sibling run. If no such instruction is available, yields to the operating system's scheduler instead.
+     */
+    static void cpu_relax() noexcept
+    {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        _mm_pause();
+#elif defined(_MSC_VER) && (defined(_M_ARM64) || defined(_M_ARM))
+        __yield();
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_ia32_pause();
+#elif defined(__GNUC__) && (defined(__aarch64__) || defined(__arm__))
+        __asm__ __volatile__("yield");
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    /**
+     * @brief Spin for up to `spin_budget` iterations, or until a task that this worker may take becomes available, before going to sleep. The worker only checks whether there are any tasks in the queues, without taking them, and then locks the global mutex to proceed as usual. While the worker is spinning, it is counted in `spinning_workers`, so threads submitting tasks know they do not need to wake up a sleeping worker.
+     *
+     * @param idx The index of the worker.
+     */
+    void spin_for_task([[maybe_unused]] const std::size_t idx)
+    {
+        const std::size_t budget = spin_budget.load(std::memory_order_relaxed);
+        ++spinning_workers;
+        for (std::size_t i = 0; i < budget; ++i)
+        {
+            bool available = global_tasks_queued.load(std::memory_order_relaxed) > 0;
+            if constexpr (work_stealing_enabled)
+                available = available || (local_tasks_queued > 0) || (local_queues[idx].mailbox_size.load(std::memory_order_relaxed) > 0) || (mailbox_stealing.load(std::memory_order_relaxed) && (mailbox_tasks_queued > 0));
+            if constexpr (lock_free_enabled)
+                available = available || !lock_free_tasks.empty();
+            if (available)
+                break;
+            if ((i + 1) % spin_yield_interval == 0)
+                std::this_thread::yield();
+            else
+                cpu_relax();
+        }
+        --spinning_workers;
+    }
+
+    /**
+     * @brief Prepare a task to be pushed into a queue. If tracing is enabled, the task is wrapped in a lambda that stores the current trace tag of the submitting thread, the priority, and the time at which it was submitted, and passes them to the trace buffer of the thread that executes it, which records the event when the task finishes. The result is then passed to `stamp_statistics()`.
+     *
+     * @tparam F The type of the function.
+     * @param task The function to prepare.
+     * @param priority The priority with which the task is submitted, to be recorded if tracing is enabled.
+     * @return The wrapped function if tracing or statistics are enabled or a task was allocated, otherwise a forwarding reference to the original function.
+     */
+    template <typename F>
+    decltype(auto) stamp_task(F&& task, [[maybe_unused]] const priority_t priority = 0)
+    {
+        if constexpr (trace_enabled)
+        {
+            auto traced = [this, tag = this_thread::my_trace_tag, priority, enqueued = trace_now(), task = std::forward<F>(task)]() mutable
+            {
+                thread_traces[*this_thread::get_index()]->begin(tag, enqueued, priority);
+                const this_thread::trace_tag task_tag(tag);
+                task();
+            };
+            // The wrapper is a local variable, so it must be returned by value, not as a forwarding reference.
+            if constexpr (statistics_enabled || allocated_from_worker<decltype(traced)>)
+                return stamp_statistics(std::move(traced));
+            else
+                return traced;
+        }
+        else
+        {
+            return stamp_statistics(std::forward<F>(task));
+        }
+    }
+
+    /**
+     * @brief Prepare a task to be pushed into a queue, after it was prepared for tracing by `stamp_task()`. If statistics are enabled, the task is wrapped in a lambda that stores the time at which it was submitted, and records how long it waited in the queue when a thread starts executing it. If the resulting callable object is too large to be stored inline in a task and the task is submitted from within a thread of this pool, it is allocated from the thread's pooled memory resource, using `make_worker_task()`. Otherwise, the task is forwarded unchanged.
+     *
+     * @tparam F The type of the function.
+     * @param task The function to prepare.
+     * @return The wrapped function if statistics are enabled or a task was allocated, otherwise a forwarding reference to the original function.
+     */
+    template <typename F>
+    decltype(auto) stamp_statistics(F&& task)
+    {
+        if constexpr (statistics_enabled)
+        {
+            auto stamped = [this, submitted = std::chrono::steady_clock::now(), task = std::forward<F>(task)]() mutable
+            {
+                thread_statistics[*this_thread::get_index()].wait_time.record(nanoseconds_since(submitted));
+                task();
+            };
+            if constexpr (allocated_from_worker<decltype(stamped)>)
+                return make_worker_task(std::move(stamped));
+            else
+                return stamped;
+        }
+        else if constexpr (allocated_from_worker<F>)
+        {
+            return make_worker_task(std::forward<F>(task));
+        }
+        else
+        {
+            return std::forward<F>(task);
+        }
+    }
+
+    /**
+     * @brief Get the number of nanoseconds that have passed since a given time point, to be used if statistics or tracing are enabled.
+     *
+     * @param start The time point.
+     * @return The number of nanoseconds.
+     */
+    [[nodiscard]] static std::uint64_t nanoseconds_since(const std::chrono::steady_clock::time_point start) noexcept
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    /**
+     * @brief Get the initial value of `trace_epoch`: the current time if tracing is enabled, or an empty placeholder otherwise.
+     *
+     * @return The initial value.
+     */
+    [[nodiscard]] static auto initial_trace_epoch() noexcept
+    {
+        if constexpr (trace_enabled)
+            return std::chrono::steady_clock::now();
+        else
+            return std::monostate();
+    }
+
+    /**
+     * @brief Get the current time in nanoseconds since the pool was created, to be used if tracing is enabled.
+     *
+     * @return The number of nanoseconds.
+     */
+    [[nodiscard]] std::uint64_t trace_now() const noexcept
+    {
+        return nanoseconds_since(trace_epoch);
+    }
+
+    /**
+     * @brief Get pointers to the trace buffers of all the thread indices that were ever used, to be used if tracing is enabled. The global mutex is only locked while the pointers are copied; the buffers themselves are never deallocated while the pool exists, so they can be read afterwards without locking.
+     *
+     * @return The pointers.
+     */
+    [[nodiscard]] auto get_trace_buffers() const
+    {
+        const std::scoped_lock tasks_lock(tasks_mutex);
+        std::vector<trace_buffer*> buffers;
+        buffers.reserve(thread_traces.size());
+        for (const std::unique_ptr<trace_buffer>& buffer : thread_traces)
+            buffers.push_back(buffer.get());
+        return buffers;
+    }
+
+    /**
+     * @brief Write a string to a stream as a JSON string literal, enclosed in quotation marks and with the necessary characters escaped.
+     *
+     * @param stream The output stream.
+     * @param str The string.
+     */
+    static void write_json_string(std::ostream& stream, const std::string_view str)
+    {
+        static constexpr std::string_view hex_digits = "0123456789abcdef";
+        stream << '"';
+        for (const char c : str)
+        {
+            const auto byte = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\')
+                stream << '\\' << c;
+            else if (byte < 0x20)
+                stream << "\\u00" << hex_digits[byte >> 4U] << hex_digits[byte & 0xFU];
+            else
+                stream << c;
+        }
+        stream << '"';
+    }
+
+    /**
+     * @brief Write a time or duration given in nanoseconds to a stream in microseconds, with three decimal places, as used by the JSON trace event format.
+     *
+     * @param stream The output stream.
+     * @param nanoseconds The time or duration in nanoseconds.
+     */
+    static void write_trace_time(std::ostream& stream, const std::uint64_t nanoseconds)
+    {
+        const std::uint64_t fraction = nanoseconds % 1000;
+        stream << nanoseconds / 1000 << '.' << static_cast<char>('0' + (fraction / 100)) << static_cast<char>('0' + (fraction / 10 % 10)) << static_cast<char>('0' + (fraction % 10));
+    }
+
+    /**
+     * @brief Try to steal a task from the local queue of another thread, to be used if work stealing is enabled. The victims are visited in order, starting from the thread after the current one, and the oldest task in the victim's queue is taken. If NUMA-aware scheduling is enabled, the thread first takes a task from the queue of its own node, then tries to steal from the threads on its own node, and only then crosses to the queues of the other nodes and finally to the threads on the other nodes. If mailbox stealing is enabled, the mailboxes of the other threads are visited last.
+     *
+     * @param idx The index of the thread that is stealing.
+     * @param task A reference to the object that will store the task, if one was found.
+     * @return `true` if a task was found, `false` otherwise.
+     */
+    bool steal_task(const std::size_t idx, task_t& task)
+    {
+        const auto take_oldest_task = [this](local_queue& queue, task_t& stolen)
+        {
+            const std::scoped_lock local_lock(queue.mutex);
+            if (queue.tasks.empty())
+                return false;
+            stolen = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            --local_tasks_queued;
+            return true;
+        };
+        // Taking a task from the queue of the thread's own node does not count as stealing.
+        const auto steal_oldest_task = [this, idx, &take_oldest_task](local_queue& queue, task_t& stolen)
+        {
+            if (!take_oldest_task(queue, stolen))
+                return false;
+            if constexpr (statistics_enabled)
+            {
+                std::atomic<std::uint64_t>& steals = thread_statistics[idx].steals;
+                steals.store(steals.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+            return true;
+        };
+        if constexpr (numa_enabled)
+        {
+            const std::size_t node = thread_nodes[idx];
+            const std::size_t num_nodes = numa_nodes.size();
+            if (take_oldest_task(node_queues[node], task))
+                return true;
+            for (std::size_t i = 1; i < thread_count; ++i)
+            {
+                const std::size_t victim = (idx + i) % thread_count;
+                if ((thread_nodes[victim] == node) && steal_oldest_task(local_queues[victim], task))
+                    return true;
+            }
+            for (std::size_t i = 1; i < num_nodes; ++i)
+            {
+                if (steal_oldest_task(node_queues[(node + i) % num_nodes], task))
+                    return true;
+            }
+            for (std::size_t i = 1; i < thread_count; ++i)
+            {
+                const std::size_t victim = (idx + i) % thread_count;
+                if ((thread_nodes[victim] != node) && steal_oldest_task(local_queues[victim], task))
+                    return true;
+            }
+        }
+        else
+        {
+            for (std::size_t i = 1; i < thread_count; ++i)
+            {
+                if (steal_oldest_task(local_queues[(idx + i) % thread_count], task))
+                    return true;
+            }
+        }
+        if (mailbox_stealing.load(std::memory_order_relaxed) && (mailbox_tasks_queued > 0))
+        {
+            for (std::size_t i = 1; i < thread_count; ++i)
+            {
+                if (pop_mailbox_task((idx + i) % thread_count, task))
+                {
+                    if constexpr (statistics_enabled)
+                    {
+                        std::atomic<std::uint64_t>& steals = thread_statistics[idx].steals;
+                        steals.store(steals.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    }
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Reset the pool with a new number of threads and a new initialization function. This member function implements the actual reset, while the public member function `reset()` also handles the case where the pool is paused.
+     *
+     * @param num_threads The number of threads to use.
+     * @param init An initialization function to run in each thread before it starts executing any submitted tasks.
+     */
+    template <typename F>
+    void reset_pool(const std::size_t num_threads, F&& init)
+    {
+        wait();
+#ifndef __cpp_lib_jthread
+        destroy_threads();
+#endif
+        create_threads(num_threads, std::forward<F>(init));
+    }
+
+    /**
+     * @brief A worker function to be assigned to each thread in the pool. Waits until it is notified by `detach_task()` that a task is available, and then retrieves the task from the queue and executes it. Once the task finishes, the worker notifies `wait()` in case it is waiting.
+     *
+     * @param idx The index of this thread.
+     */
+    void worker(BS_THREAD_POOL_WORKER_TOKEN const std::size_t idx)
+    {
+        this_thread::my_pool = this;
+        this_thread::my_index = idx;
+#ifdef __cpp_lib_memory_resource
+        this_thread::my_arena = &worker_memories[idx]->arena;
+        this_thread::my_pooled_resource = &worker_memories[idx]->pooled;
+#endif
+#ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
+        if constexpr (numa_enabled)
+        {
+            // Pin the thread to the logical processors of its node, so that memory it allocates and touches stays local. There is no point in doing this if there is only one node.
+            if (numa_nodes.size() > 1)
+                this_thread::set_os_thread_affinity(numa_nodes[thread_nodes[idx]]);
+        }
+#endif
+        if constexpr (elastic_enabled)
+            this_thread::my_blocking_hook = &blocking_region_hook;
+#ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
+        // If tracing is enabled, the name of the thread is recorded if the initialization function changed it, since otherwise it is just inherited from the thread that created the pool.
+        [[maybe_unused]] std::optional<std::string> initial_name = std::nullopt;
+        if constexpr (trace_enabled)
+            initial_name = this_thread::get_os_thread_name();
+#endif
+        init_func(idx);
+#ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
+        if constexpr (trace_enabled)
+        {
+            std::optional<std::string> name = this_thread::get_os_thread_name();
+            thread_traces[idx]->set_name((name.has_value() && name != initial_name) ? std::move(*name) : std::string());
+        }
+#endif
+        while (true)
+        {
+            task_t task; // NOLINT(misc-const-correctness) In C++23 this cannot be const since `std::move_only_function::operator()` is not a const member function.
+            if constexpr (work_stealing_enabled)
+            {
+                // If work stealing is enabled, first try to get a task from the thread's mailbox and then from the local queues without locking the global mutex. While the worker keeps finding tasks this way, it is still counted in `tasks_running`, so `wait()` cannot return prematurely.
+                bool can_take = true;
+                if constexpr (pause_enabled)
+                    can_take = !paused;
+                if (can_take && !pop_mailbox_task(idx, task) && !pop_local_task(idx, task))
+                    steal_task(idx, task);
+            }
+            if constexpr (lock_free_enabled)
+            {
+                // If the lock-free queue is enabled, keep trying to pop a task from it for a while, yielding in between, before going to sleep on the condition variable. While the worker does this, it is still counted in `tasks_running`, so `wait()` cannot return prematurely.
+                bool can_take = true;
+                if constexpr (pause_enabled)
+                    can_take = !paused;
+                for (std::size_t i = 0; can_take && !task && !lock_free_tasks.try_pop(task) && (i < lock_free_spin_count); ++i)
+                    std::this_thread::yield();
+            }
+            if constexpr (unlocked_pop)
+            {
+                if (task)
+                    notify_space_available();
+            }
+            if (!task)
+            {
+                std::unique_lock tasks_lock(tasks_mutex);
+                tasks_running.store(tasks_running.load(std::memory_order_relaxed) - 1, std::memory_order_release);
+                notify_if_done();
+                const auto task_or_stop = [this, idx]
+                {
+                    if constexpr (pause_enabled)
+                        return !(paused || !has_tasks_for(idx)) BS_THREAD_POOL_OR_STOP_CONDITION;
+                    else
+                        return has_tasks_for(idx) BS_THREAD_POOL_OR_STOP_CONDITION;
+                };
+                // If statistics are enabled, only the periods in which the worker actually has to wait for a task are counted as idle time.
+                [[maybe_unused]] statistics_time_point idle_start = {};
+                if constexpr (statistics_enabled)
+                {
+                    if (!task_or_stop())
+                        idle_start = std::chrono::steady_clock::now();
+                }
+                // If spinning is enabled, spin for a while before going to sleep, without holding the mutex. The worker is no longer counted in `tasks_running`, so `wait()` does not have to wait for it to stop spinning.
+                if ((spin_budget.load(std::memory_order_relaxed) > 0) && !task_or_stop())
+                {
+                    tasks_lock.unlock();
+                    spin_for_task(idx);
+                    tasks_lock.lock();
+                }
+                ++idle_workers;
+                [[maybe_unused]] bool timed_out = false;
+                if constexpr (elastic_enabled)
+                {
+                    // If the elastic thread count is enabled, the worker wakes up after the idle timeout to check whether it may retire. It waits with a timeout even if it may not retire right now, since the minimum number of threads may be lowered in the meantime.
+                    timed_out = !task_available_cv.wait_for(tasks_lock BS_THREAD_POOL_WAIT_TOKEN, idle_timeout, task_or_stop);
+                }
+                else
+                {
+                    task_available_cv.wait(tasks_lock BS_THREAD_POOL_WAIT_TOKEN, task_or_stop);
+                }
+                --idle_workers;
+                if (BS_THREAD_POOL_STOP_CONDITION)
+                    break;
+                if constexpr (elastic_enabled)
+                {
+                    // The worker is not counted in `tasks_running`, and its local queue is empty, so it can retire without leaving any tasks behind. Its slot is only freed once the cleanup function has finished.
+                    if (timed_out && can_retire())
+                    {
+                        active_threads.store(active_threads.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+                tasks_running.store(tasks_running.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+                if constexpr (statistics_enabled)
+                {
+                    if (idle_start != statistics_time_point{})
+                        thread_statistics[idx].idle_time.record(nanoseconds_since(idle_start));
+                }
+                // If work stealing is enabled, the worker may have been woken up because a task was pushed into a local queue, in which case the global queue may be empty, and the worker goes back to looking for tasks in the local queues.
+                if (!tasks.empty())
+                {
+                    task = pop_task();
+                    // Release ordering ensures that `get_tasks_total()` cannot see the task leave the queue before seeing this worker counted in `tasks_running`.
+                    global_tasks_queued.store(tasks.size(), std::memory_order_release);
+                }
+                if constexpr (lock_free_enabled)
+                {
+                    if (!task)
+                        lock_free_tasks.try_pop(task);
+                }
+                // Producers waiting for room in the queue lock the global mutex before checking for room, so the worker can notify one of them while holding it.
+                if (task && (space_waiters > 0))
+                    task_space_cv.notify_one();
+                // Submitting a task does not wake up a sleeping worker while another worker is spinning, so if there are more tasks left than this worker is about to take and no other worker is spinning, it passes the baton on to a sleeping worker.
+                const bool wake_another = (spin_budget.load(std::memory_order_relaxed) > 0) && (spinning_workers == 0) && (idle_workers > 0) && (count_queued_tasks() > (task ? 0 : 1));
+                // If the elastic thread count is enabled and tasks are still backing up in the queue, start another thread.
+                [[maybe_unused]] bool grow = false;
+                [[maybe_unused]] std::size_t new_thread = 0;
+                if constexpr (elastic_enabled)
+                    grow = should_grow() && claim_thread_slot(new_thread);
+                tasks_lock.unlock();
+                if (wake_another)
+                    task_available_cv.notify_one();
+                if constexpr (elastic_enabled)
+                {
+                    if (grow)
+                        start_thread(new_thread);
+                }
+                if (!task)
+                    continue;
+            }
+            [[maybe_unused]] statistics_time_point task_start = {};
+            if constexpr (statistics_enabled)
+                task_start = std::chrono::steady_clock::now();
+            [[maybe_unused]] std::uint64_t trace_start = 0;
+            if constexpr (trace_enabled)
+                trace_start = trace_now();
+#ifdef __cpp_exceptions
+            try
+            {
+#endif
+                task();
+#ifdef __cpp_exceptions
+            }
+            catch (...)
+            {
+            }
+#endif
+            if constexpr (statistics_enabled)
+                thread_statistics[idx].execution_time.record(nanoseconds_since(task_start));
+            if constexpr (trace_enabled)
+                thread_traces[idx]->end(trace_start, trace_now());
+#ifdef __cpp_lib_memory_resource
+            if (this_thread::my_arena_used)
+            {
+                this_thread::my_arena_used = false;
+                this_thread::my_arena->release();
+            }
+#endif
+        }
+        cleanup_func(idx);
+        this_thread::my_index = std::nullopt;
+        this_thread::my_pool = std::nullopt;
+#ifdef __cpp_lib_memory_resource
+        this_thread::my_arena = nullptr;
+        this_thread::my_arena_used = false;
+        this_thread::my_pooled_resource = nullptr;
+#endif
+        if constexpr (elastic_enabled)
+        {
+            this_thread::my_blocking_hook = nullptr;
+            const std::scoped_lock tasks_lock(tasks_mutex);
+            thread_active[idx] = false;
+        }
+    }
+
+    // ============
+    // Private data
+    // ============
+
+    /**
+     * @brief A helper struct to store the local queue of a single thread, to be used if work stealing is enabled. Aligned to a cache line, so that the owner thread pushing and popping its own queue does not slow down the threads working on the neighboring queues in the array.
+     */
+    struct alignas(cache_line_size) local_queue
+    {
+        /**
+         * @brief A mutex to synchronize access to the local queue by the owner thread and by threads stealing from it.
+         */
+        std::mutex mutex;
+
+        /**
+         * @brief The tasks in the local queue. The owner thread pushes and pops at the back, while other threads steal from the front.
+         */
+        std::deque<task_t> tasks;
+
+        /**
+         * @brief The tasks in the mailbox of the thread, submitted using `detach_task_to()` or `submit_task_to()`. Tasks are pushed at the back and popped from the front, by the owner thread or, if mailbox stealing is enabled, by other threads.
+         */
+        std::deque<task_t> mailbox;
+
+        /**
+         * @brief The number of tasks in the mailbox. Only modified while the mutex is locked, but atomic, so that the owner thread can check whether it has any tasks in its mailbox, and submitting threads can choose the least loaded mailbox, without locking the mutex.
+         */
+        std::atomic<std::size_t> mailbox_size = 0;
+    }; // struct local_queue
+
+#ifdef __cpp_lib_memory_resource
+    /**
+     * @brief A helper struct to store the memory resources of a single thread, returned by `BS::this_thread::memory_resource()` and `BS::this_thread::pooled_memory_resource()`. Aligned to a cache line, so that neighboring threads do not write to the same cache line when they allocate memory.
+     */
+    struct alignas(cache_line_size) worker_memory
+    {
+        /**
+         * @brief The pooled memory resource, which is also the upstream resource of the arena.
+         */
+        std::pmr::synchronized_pool_resource pooled;
+
+        /**
+         * @brief The initial buffer of the arena.
+         */
+        std::byte buffer[arena_buffer_size]; // NOLINT(cppcoreguidelines-avoid-c-arrays, hicpp-avoid-c-arrays, modernize-avoid-c-arrays) This is raw storage for the arena.
+
+        /**
+         * @brief The arena, which is released after every task that uses it.
+         */
+        std::pmr::monotonic_buffer_resource arena{buffer, arena_buffer_size, &pooled};
+    }; // struct worker_memory
+#endif
+
+    /**
+     * @brief A helper struct to store the statistics collected by a single thread, to be used if statistics are enabled. Only the thread itself writes to it, so no locking is needed, and any other thread can take a snapshot at any time. Aligned to a cache line, so that neighboring threads in the array do not write to the same cache line.
+     */
+    struct alignas(cache_line_size) worker_statistics
+    {
+        /**
+         * @brief Take a snapshot of the statistics.
+         *
+         * @return The snapshot.
+         */
+        [[nodiscard]] pool_statistics snapshot() const noexcept
+        {
+            pool_statistics result;
+            result.wait_time = wait_time.snapshot();
+            result.execution_time = execution_time.snapshot();
+            result.idle_time = idle_time.snapshot();
+            result.steals = steals.load(std::memory_order_relaxed);
+            return result;
+        }
+
+        /**
+         * @brief The time each task executed by the thread spent waiting in a queue.
+         */
+        histogram_recorder wait_time;
+
+        /**
+         * @brief The time each task executed by the thread took to execute.
+         */
+        histogram_recorder execution_time;
+
+        /**
+         * @brief The duration of each period in which the thread had to wait for a task.
+         */
+        histogram_recorder idle_time;
+
+        /**
+         * @brief The number of tasks the thread stole from other threads or nodes.
+         */
+        std::atomic<std::uint64_t> steals = 0;
+    }; // struct worker_statistics
+
+    /**
+     * @brief A helper struct to store the trace buffer of a single thread, to be used if tracing is enabled: a ring of preallocated slots, each storing one event. Only the thread itself writes to it, without locking or allocating memory, and any other thread can read it at any time. Each slot is written using relaxed atomic operations, and two counters, incremented before and after a slot is written, allow a reader to discard any slots that were overwritten while it was reading them. Aligned to a cache line, so that neighboring threads do not write to the same cache line.
+     */
+    struct alignas(cache_line_size) trace_buffer
+    {
+        /**
+         * @brief A single slot in the ring, storing the fields of a `BS::trace_event` other than the thread index.
+         */
+        struct slot
+        {
+            std::atomic<const char*> tag = nullptr;
+            std::atomic<std::uint64_t> enqueued = 0;
+            std::atomic<std::uint64_t> dequeued = 0;
+            std::atomic<std::uint64_t> completed = 0;
+            std::atomic<priority_t> priority = 0;
+        }; // struct slot
+
+        /**
+         * @brief Store the details of the task that the thread is about to execute. Called by the task's wrapper when it starts executing.
+         *
+         * @param task_tag The tag of the task.
+         * @param task_enqueued The time at which the task was submitted.
+         * @param task_priority The priority of the task.
+         */
+        void begin(const char* const task_tag, const std::uint64_t task_enqueued, const priority_t task_priority) noexcept
+        {
+            tag = task_tag;
+            enqueued = task_enqueued;
+            priority = task_priority;
+            pending = true;
+        }
+
+        /**
+         * @brief Record an event for the task whose details were stored by `begin()`, if any, overwriting the oldest event if the ring is full. Called by the thread after the task finishes. Tasks with no details, which were pushed into a queue without being wrapped, are not recorded.
+         *
+         * @param dequeued The time at which the thread started executing the task.
+         * @param completed The time at which the task finished executing.
+         */
+        void end(const std::uint64_t dequeued, const std::uint64_t completed) noexcept
+        {
+            if (!pending)
+                return;
+            pending = false;
+            const std::size_t index = written.load(std::memory_order_relaxed);
+            started.store(index + 1, std::memory_order_relaxed);
+            // This fence ensures that a reader that sees any of the values written to the slot below also sees the incremented value of `started`.
+            std::atomic_thread_fence(std::memory_order_release);
+            slot& event = slots[index % trace_buffer_size];
+            event.tag.store(tag, std::memory_order_relaxed);
+            event.enqueued.store(enqueued, std::memory_order_relaxed);
+            event.dequeued.store(dequeued, std::memory_order_relaxed);
+            event.completed.store(completed, std::memory_order_relaxed);
+            event.priority.store(priority, std::memory_order_relaxed);
+            written.store(index + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Discard the events recorded so far.
+         */
+        void clear() noexcept
+        {
+            cleared.store(written.load(std::memory_order_acquire), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Append the events in the ring, from oldest to newest, to a vector.
+         *
+         * @param thread_idx The index of the thread, to be stored in the events.
+         * @param events The vector.
+         */
+        void read(const std::size_t thread_idx, std::vector<trace_event>& events) const
+        {
+            const std::size_t last = written.load(std::memory_order_acquire);
+            const std::size_t first = std::max(cleared.load(std::memory_order_relaxed), (last > trace_buffer_size) ? last - trace_buffer_size : 0);
+            const std::size_t old_size = events.size();
+            for (std::size_t index = first; index < last; ++index)
+            {
+                const slot& event = slots[index % trace_buffer_size];
+                trace_event& copy = events.emplace_back();
+                copy.tag = event.tag.load(std::memory_order_relaxed);
+                copy.thread_idx = thread_idx;
+                copy.enqueued = event.enqueued.load(std::memory_order_relaxed);
+                copy.dequeued = event.dequeued.load(std::memory_order_relaxed);
+                copy.completed = event.completed.load(std::memory_order_relaxed);
+                copy.priority = event.priority.load(std::memory_order_relaxed);
+            }
+            // If the thread started overwriting any of the slots while they were being read, the events read from them may be torn, so they are discarded. This fence pairs with the one in `end()`.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const std::size_t overwritten = started.load(std::memory_order_relaxed);
+            if (overwritten > first + trace_buffer_size)
+            {
+                const std::size_t torn = std::min(overwritten - first - trace_buffer_size, last - first);
+                events.erase(events.begin() + static_cast<std::ptrdiff_t>(old_size), events.begin() + static_cast<std::ptrdiff_t>(old_size + torn));
+            }
+        }
+
+        /**
+         * @brief Get the name of the thread, as recorded by `set_name()`.
+         *
+         * @return The name, or an empty string if no name was recorded.
+         */
+        [[nodiscard]] std::string get_name() const
+        {
+            const std::scoped_lock name_lock(name_mutex);
+            return name;
+        }
+
+        /**
+         * @brief Record the name of the thread. Called by the thread when it starts, after the initialization function.
+         *
+         * @param new_name The name.
+         */
+        void set_name(std::string new_name)
+        {
+            const std::scoped_lock name_lock(name_mutex);
+            name = std::move(new_name);
+        }
+
+        /**
+         * @brief The slots of the ring.
+         */
+        std::unique_ptr<slot[]> slots = std::make_unique<slot[]>(trace_buffer_size); // NOLINT(cppcoreguidelines-avoid-c-arrays, hicpp-avoid-c-arrays, modernize-avoid-c-arrays)
+
+        /**
+         * @brief The number of events whose slot the thread started writing, since the pool was created.
+         */
+        std::atomic<std::size_t> started = 0;
+
+        /**
+         * @brief The number of events the thread finished writing, since the pool was created. The newest event is in the slot before this one.
+         */
+        std::atomic<std::size_t> written = 0;
+
+        /**
+         * @brief The number of events discarded by `clear()`.
+         */
+        std::atomic<std::size_t> cleared = 0;
+
+        /**
+         * @brief The tag of the task currently being executed. Only accessed by the thread itself.
+         */
+        const char* tag = nullptr;
+
+        /**
+         * @brief The time at which the task currently being executed was submitted. Only accessed by the thread itself.
+         */
+        std::uint64_t enqueued = 0;
+
+        /**
+         * @brief The priority of the task currently being executed. Only accessed by the thread itself.
+         */
+        priority_t priority = 0;
+
+        /**
+         * @brief Whether the details of the task currently being executed were stored by `begin()`. Only accessed by the thread itself.
+         */
+        bool pending = false;
+
+        /**
+         * @brief A mutex to synchronize access to the name of the thread.
+         */
+        mutable std::mutex name_mutex;
+
+        /**
+         * @brief The name of the thread, or an empty string if it has none.
+         */
+        std::string name;
+    }; // struct trace_buffer
+
+#ifdef __cpp_lib_memory_resource
+    /**
+     * @brief The memory resources of each thread index. The callable objects of tasks submitted from within the pool may be allocated from them, so they are declared before all the queues, to be destroyed after all the tasks. For the same reason, the vector only ever grows, even if the pool is reset with fewer threads.
+     */
+    std::vector<std::unique_ptr<worker_memory>> worker_memories;
+#endif
+
+    // The members below are divided into groups according to which threads write to them and how often, and each group starts on a new cache line, so that a thread writing to one group does not invalidate the cache lines of threads reading another group. The first group is the global mutex and the state it protects, which are only accessed by the thread holding the mutex, so they can share cache lines with each other, but not with anything else.
+
+    /**
+     * @brief A mutex to synchronize access to the task queue by different threads.
+     */
+    alignas(cache_line_size) mutable std::mutex tasks_mutex;
+
+    /**
+     * @brief A queue of tasks to be executed by the threads.
+     */
+    std::conditional_t<priority_enabled, priority_task_queue, std::queue<task_t>> tasks;
+
+    /**
+     * @brief A flag indicating whether the workers should pause. When set to `true`, the workers temporarily stop retrieving new tasks out of the queue, although any tasks already executed will keep running until they are finished. When set to `false` again, the workers resume retrieving tasks. Only enabled if the flag `BS:tp::pause` is enabled in the template parameter. If work stealing or the lock-free queue are enabled, this flag is atomic, since the workers check it before taking tasks out of the local queues or the lock-free queue without locking the global mutex.
+     */
+    std::conditional_t<pause_enabled, std::conditional_t<unlocked_pop, std::atomic<bool>, bool>, std::monostate> paused = {};
+
+    /**
+     * @brief The number of times the pool has become idle, that is, the number of times the last running task finished while there were no tasks left in the queue (or the pool was paused). Only incremented while the global mutex is locked, but atomic, so that in C++20 and later `wait()` can sleep on it using `std::atomic::wait()` without holding the mutex. Waiting threads record the epoch when they start waiting, and return once it changes, so they are only woken up when the pool actually becomes idle, and each of them returns even if new tasks were submitted in the meantime. A 32-bit integer is used, since it can be waited on directly using the operating system's native API on most platforms; it would take billions of idle periods for the counter to wrap around while a thread is still waiting.
+     */
+    std::atomic<std::uint32_t> idle_epoch = 0;
+
+    /**
+     * @brief The number of threads currently in `wait()`, `wait_for()`, or `wait_until()`. Only incremented while the global mutex is locked, so a worker making the pool idle always sees a thread that started waiting before it, but atomic, since waiting threads decrement it without locking the mutex when they stop waiting. If it is 0, the worker does not have to notify anyone.
+     */
+    std::atomic<std::size_t> waiters = 0;
+
+#ifndef __cpp_lib_jthread
+    /**
+     * @brief A flag indicating to the workers to keep running. When set to `false`, the workers terminate permanently.
+     */
+    bool workers_running = false;
+#endif
+
+    /**
+     * @brief A counter for the number of workers currently waiting for a new task to become available. Used to determine how many workers need to be woken up when a batch of tasks is submitted, and whether a worker needs to be woken up when a task is pushed into a local queue or the lock-free queue. Only modified while the global mutex is locked, but if the flag `BS:tp::work_stealing`, `BS:tp::lock_free`, or `BS:tp::elastic` is enabled in the template parameter, it is atomic, since it is also read without locking the mutex.
+     */
+    std::conditional_t<unlocked_pop || elastic_enabled, std::atomic<std::size_t>, std::size_t> idle_workers = 0;
+
+/**
+ * @brief A condition variable to notify `worker()` that a new task has become available.
+ */
+#ifdef __cpp_lib_jthread
+    std::condition_variable_any
+#else
+    std::condition_variable
+#endif
+        task_available_cv;
+
+    /**
+     * @brief A condition variable to notify `wait_for()` and `wait_until()`, as well as `wait()` in C++17, that the tasks are done.
+     */
+    std::condition_variable tasks_done_cv;
+
+    /**
+     * @brief A condition variable to notify threads waiting for room in the queue that a task has been taken out of the queue.
+     */
+    std::condition_variable task_space_cv;
+
+    /**
+     * @brief The statistics of the threads that were destroyed when the pool was reset. Only used if the flag `BS:tp::statistics` is enabled in the template parameter.
+     */
+    std::conditional_t<statistics_enabled, pool_statistics, std::monostate> retired_statistics = {};
+
+    /**
+     * @brief The time at which the last thread was started on demand. Only used if the flag `BS:tp::elastic` is enabled in the template parameter.
+     */
+    std::conditional_t<elastic_enabled, std::chrono::steady_clock::time_point, std::monostate> last_growth = {};
+
+    // The counters that the workers update whenever they take a task out of the global queue, and that the monitoring functions read without locking the mutex.
+
+    /**
+     * @brief A counter for the total number of currently running tasks. Only modified while the global mutex is locked, so a relaxed load followed by a release store is enough to update it, but atomic, so that `get_tasks_running()` and `get_tasks_total()` can read it without locking the mutex.
+     */
+    alignas(cache_line_size) std::atomic<std::size_t> tasks_running = 0;
+
+    /**
+     * @brief The number of tasks in the global queue. Only modified while the global mutex is locked, but atomic, so that spinning workers can check whether a task is available, and `get_tasks_queued()` and `get_tasks_total()` can count the tasks, without locking the mutex.
+     */
+    std::atomic<std::size_t> global_tasks_queued = 0;
+
+    // The counters that the workers update whenever they push a task into or take a task out of a local queue, node queue, or mailbox, without locking the mutex.
+
+    /**
+     * @brief A counter for the total number of tasks currently waiting in the local queues and, if the flag `BS:tp::numa` is enabled, the node queues. Only used if the flag `BS:tp::work_stealing` or `BS:tp::numa` is enabled in the template parameter.
+     */
+    alignas(cache_line_size) std::conditional_t<work_stealing_enabled, std::atomic<std::size_t>, std::monostate> local_tasks_queued = {};
+
+    /**
+     * @brief A counter for the total number of tasks currently waiting in the mailboxes of the threads. Kept separately from `local_tasks_queued`, since a worker may only take the tasks in its own mailbox, unless mailbox stealing is enabled. Only used if the flag `BS:tp::work_stealing` or `BS:tp::numa` is enabled in the template parameter.
+     */
+    std::conditional_t<work_stealing_enabled, std::atomic<std::size_t>, std::monostate> mailbox_tasks_queued = {};
+
+    // The counter that the workers update whenever they start or stop spinning, without locking the mutex.
+
+    /**
+     * @brief A counter for the number of workers currently spinning, looking for a new task before going to sleep. If it is non-zero, threads submitting tasks do not need to wake up a sleeping worker.
+     */
+    alignas(cache_line_size) std::atomic<std::size_t> spinning_workers = 0;
+
+    // The counters that are updated less often, without locking the mutex.
+
+    /**
+     * @brief The number of threads currently waiting for room in the queue. Only modified while the global mutex is locked, but atomic, since it is also read without locking the mutex.
+     */
+    alignas(cache_line_size) std::atomic<std::size_t> space_waiters = 0;
+
+    /**
+     * @brief The number of threads currently running. Only modified while the global mutex is locked, but atomic, since it is also read without locking the mutex. Only used if the flag `BS:tp::elastic` is enabled in the template parameter.
+     */
+    std::conditional_t<elastic_enabled, std::atomic<std::size_t>, std::monostate> active_threads = {};
+
+    /**
+     * @brief The number of threads currently inside a `BS::this_thread::blocking_region`. Only used if the flag `BS:tp::elastic` is enabled in the template parameter.
+     */
+    std::conditional_t<elastic_enabled, std::atomic<std::size_t>, std::monostate> blocked_threads = {};
+
+    // The lock-free queue, which aligns its own fields to separate cache lines.
+
+    /**
+     * @brief A lock-free queue of tasks to be executed by the threads. Tasks which do not fit in this queue are placed in the global queue protected by the mutex instead. Only used if the flag `BS:tp::lock_free` is enabled in the template parameter.
+     */
+    std::conditional_t<lock_free_enabled, mpmc_queue<task_t>, std::monostate> lock_free_tasks = {};
+
+    // The configuration and the per-thread arrays, which are read on every submission or by every worker but only written when the pool is created, reset, or reconfigured. The threads must be declared last, so that in C++20 and later they are stopped and joined before any other member is destroyed.
+
+    /**
+     * @brief The maximum number of tasks that may be waiting in the queues before submitting a task from outside the pool blocks or fails, or 0 if the queue is unbounded. Only modified while the global mutex is locked, but atomic, since it is also read without locking the mutex.
+     */
+    alignas(cache_line_size) std::atomic<std::size_t> queue_capacity = 0;
+
+    /**
+     * @brief The number of iterations an idle worker spins, looking for a new task, before going to sleep. The default is 0, which disables spinning.
+     */
+    std::atomic<std::size_t> spin_budget = 0;
+
+    /**
+     * @brief A flag indicating whether idle threads may take tasks out of the mailboxes of other threads. Only modified while the global mutex is locked, but atomic, since it is also read without locking the mutex. Only used if the flag `BS:tp::work_stealing` or `BS:tp::numa` is enabled in the template parameter.
+     */
+    std::conditional_t<work_stealing_enabled, std::atomic<bool>, std::monostate> mailbox_stealing = {};
+
+    /**
+     * @brief The number of threads in the pool.
+     */
+    std::size_t thread_count = 0;
+
+    /**
+     * @brief How long a thread waits for a new task before it retires, if there are more than the minimum number of threads. Only used if the flag `BS:tp::elastic` is enabled in the template parameter.
+     */
+    std::chrono::milliseconds idle_timeout = std::chrono::seconds(1);
+
+    /**
+     * @brief The minimum number of threads to keep running that are not blocked. Only used if the flag `BS:tp::elastic` is enabled in the template parameter.
+     */
+    std::size_t min_threads = 1;
+
+    /**
+     * @brief A cleanup function to run in each thread right before it is destroyed, which will happen when the pool is destructed or reset. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. The cleanup function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function. The default is an empty function, i.e., no cleanup will be performed.
+     */
+    function_t<void(std::size_t)> cleanup_func = [](std::size_t) {};
+
+    /**
+     * @brief An initialization function to run in each thread before it starts executing any submitted tasks. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. It will be executed exactly once per thread, when the thread is first constructed. The initialization function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function. The default is an empty function, i.e., no initialization will be performed.
+     */
+    function_t<void(std::size_t)> init_func = [](std::size_t) {};
+
+    /**
+     * @brief A smart pointer to manage the memory allocated for the local queues, one per thread. Only used if the flag `BS:tp::work_stealing` is enabled in the template parameter.
+     */
+    std::conditional_t<work_stealing_enabled, std::unique_ptr<local_queue[]>, std::monostate> local_queues = {};
+
+    /**
+     * @brief A smart pointer to manage the memory allocated for the node queues, one per NUMA node. Only used if the flag `BS:tp::numa` is enabled in the template parameter.
+     */
+    std::conditional_t<numa_enabled, std::unique_ptr<local_queue[]>, std::monostate> node_queues = {};
+
+    /**
+     * @brief The logical processors of each NUMA node used by the pool, in the format used by `BS::get_os_process_affinity()`. Contains a single empty vector if the topology could not be determined. Only used if the flag `BS:tp::numa` is enabled in the template parameter.
+     */
+    std::conditional_t<numa_enabled, std::vector<std::vector<bool>>, std::monostate> numa_nodes = {};
+
+    /**
+     * @brief A smart pointer to manage the memory allocated for the index of the NUMA node of each thread. Only used if the flag `BS:tp::numa` is enabled in the template parameter.
+     */
+    std::conditional_t<numa_enabled, std::unique_ptr<std::size_t[]>, std::monostate> thread_nodes = {};
+
+    /**
+     * @brief A smart pointer to manage the memory allocated for the statistics of each thread. Only used if the flag `BS:tp::statistics` is enabled in the template parameter.
+     */
+    std::conditional_t<statistics_enabled, std::unique_ptr<worker_statistics[]>, std::monostate> thread_statistics = {};
+
+    /**
+     * @brief The trace buffers of each thread index. The vector only ever grows, even if the pool is reset with fewer threads, so that events are not lost and the buffers can be read without locking. Only used if the flag `BS:tp::trace` is enabled in the template parameter.
+     */
+    std::conditional_t<trace_enabled, std::vector<std::unique_ptr<trace_buffer>>, std::monostate> thread_traces = {};
+
+    /**
+     * @brief The time at which the pool was created, used as the origin of the times recorded in the trace. Only used if the flag `BS:tp::trace` is enabled in the template parameter.
+     */
+    std::conditional_t<trace_enabled, std::chrono::steady_clock::time_point, std::monostate> trace_epoch = initial_trace_epoch();
+
+    /**
+     * @brief A smart pointer to manage the memory allocated for the flags indicating which thread slots are occupied by a thread, one per slot. Only used if the flag `BS:tp::elastic` is enabled in the template parameter.
+     */
+    std::conditional_t<elastic_enabled, std::unique_ptr<bool[]>, std::monostate> thread_active = {};
+
+    /**
+     * @brief A smart pointer to manage the memory allocated for the threads.
+     */
+    std::unique_ptr<thread_t[]> threads = nullptr;
+}; // class thread_pool
+
+/**
+ * @brief A struct to store a snapshot of the statistics of a `BS::task_group`, obtained using `BS::task_group::get_statistics()`.
+ */
+struct task_group_statistics
+{
+    /**
+     * @brief The total time spent executing the tasks of the group that have finished.
+     */
+    std::chrono::nanoseconds execution_time = std::chrono::nanoseconds::zero();
+
+    /**
+     * @brief The number of tasks that were discarded using `cancel()` before they started executing.
+     */
+    std::size_t tasks_cancelled = 0;
+
+    /**
+     * @brief The number of tasks that have finished executing, including those that threw an exception.
+     */
+    std::size_t tasks_completed = 0;
+
+    /**
+     * @brief The number of detached tasks that threw an exception. Exceptions thrown by tasks submitted using `submit_task()` are stored in their futures instead, and are not counted.
+     */
+    std::size_t tasks_failed = 0;
+
+    /**
+     * @brief The number of tasks that were executed by a thread waiting for the group, rather than by a thread that picked up the task from the pool's queue.
+     */
+    std::size_t tasks_helped = 0;
+
+    /**
+     * @brief The number of tasks that have been submitted to the group.
+     */
+    std::size_t tasks_submitted = 0;
+}; // struct task_group_statistics
+
+/**
+ * @brief A helper class storing the shared state of a `BS::task_group`: the tasks of the group that have not started yet, the counters of the tasks, and a condition variable to wait on. Each task of the group is stored here, and a separate lightweight task is submitted to the pool for each of them, which runs the oldest task of the group that has not started yet, if any. This way, a thread waiting for the group can run the group's tasks itself, and the tasks submitted to the pool do nothing if they find that the task was already run. Only accessed through a shared pointer, so the tasks submitted to the pool can outlive the group.
+ */
+class [[nodiscard]] task_group_state
+{
+public:
+    task_group_state() = default;
+
+    // The copy and move constructors and assignment operators are deleted. The state is only ever accessed through a shared pointer.
+    task_group_state(const task_group_state&) = delete;
+    task_group_state(task_group_state&&) = delete;
+    task_group_state& operator=(const task_group_state&) = delete;
+    task_group_state& operator=(task_group_state&&) = delete;
+    ~task_group_state() = default;
+
+    /**
+     * @brief Discard all the tasks of the group that have not started yet. The tasks are destroyed after the mutex is unlocked, so any destructors they run, such as those of broken promises, do not block the group.
+     *
+     * @return The number of discarded tasks.
+     */
+    std::size_t cancel()
+    {
+        std::deque<small_task> discarded;
+        {
+            const std::scoped_lock lock(mutex);
+            discarded.swap(pending);
+            outstanding -= discarded.size();
+            stats.tasks_cancelled += discarded.size();
+            if (outstanding == 0)
+                done_cv.notify_all();
+        }
+        return discarded.size();
+    }
+
+    /**
+     * @brief Get a snapshot of the statistics of the group.
+     *
+     * @return The statistics.
+     */
+    [[nodiscard]] task_group_statistics get_statistics() const
+    {
+        const std::scoped_lock lock(mutex);
+        return stats;
+    }
+
+    /**
+     * @brief Get the number of tasks of the group that have not started yet.
+     *
+     * @return The number of queued tasks.
+     */
+    [[nodiscard]] std::size_t get_tasks_queued() const
+    {
+        const std::scoped_lock lock(mutex);
+        return pending.size();
+    }
+
+    /**
+     * @brief Get the number of tasks of the group that are currently running.
+     *
+     * @return The number of running tasks.
+     */
+    [[nodiscard]] std::size_t get_tasks_running() const
+    {
+        const std::scoped_lock lock(mutex);
+        return outstanding - pending.size();
+    }
+
+    /**
+     * @brief Get the total number of unfinished tasks of the group: either still waiting to start, or running.
+     *
+     * @return The total number of tasks.
+     */
+    [[nodiscard]] std::size_t get_tasks_total() const
+    {
+        const std::scoped_lock lock(mutex);
+        return outstanding;
+    }
+
+    /**
+     * @brief Add a task to the group, and wake up any threads waiting for the group that may run it.
+     *
+     * @param task The task.
+     */
+    void push(small_task&& task)
+    {
+        const std::scoped_lock lock(mutex);
+        pending.push_back(std::move(task));
+        ++outstanding;
+        ++stats.tasks_submitted;
+        if (helpers_waiting > 0)
+            done_cv.notify_all();
+    }
+
+    /**
+     * @brief Remove the most recently added task from the group without running it, if it has not started yet. Used to undo `push()` if the corresponding task could not be submitted to the pool.
+     */
+    void pop_back() noexcept
+    {
+        const std::scoped_lock lock(mutex);
+        if (!pending.empty())
+        {
+            pending.pop_back();
+            --outstanding;
+            --stats.tasks_submitted;
+            if (outstanding == 0)
+                done_cv.notify_all();
+        }
+    }
+
+    /**
+     * @brief Run the oldest task of the group that has not started yet, if there is one.
+     */
+    void run_one()
+    {
+        small_task task;
+        {
+            const std::scoped_lock lock(mutex);
+            if (pending.empty())
+                return;
+            task = take_task();
+        }
+        execute(task, false);
+    }
+
+    /**
+     * @brief Wait for all the tasks of the group to finish.
+     *
+     * @tparam B The type of the function used to block.
+     * @param help Whether to run the tasks of the group that have not started yet while waiting, instead of blocking.
+     * @param block A function that takes the locked `std::unique_lock` of the mutex, blocks on it using `done_cv`, and returns `false` if it timed out, or `true` otherwise.
+     * @return `true` if all the tasks finished, `false` if `block` timed out first.
+     */
+    template <typename B>
+    bool wait(const bool help, B&& block)
+    {
+        std::unique_lock lock(mutex);
+        while (outstanding != 0)
+        {
+            if (help && !pending.empty())
+            {
+                small_task task = take_task();
+                lock.unlock();
+                execute(task, true);
+                lock.lock();
+                continue;
+            }
+            if (help)
+                ++helpers_waiting;
+            const bool awakened = block(lock);
+            if (help)
+                --helpers_waiting;
+            if (!awakened)
+                return outstanding == 0;
+        }
+        return true;
+    }
+
+    /**
+     * @brief A condition variable used to notify the threads waiting for the group that all the tasks have finished, or that a task has been added which they may run.
+     */
+    std::condition_variable done_cv;
+
+private:
+    /**
+     * @brief Execute a task of the group, update the statistics, and notify the waiting threads if it was the last unfinished task.
+     *
+     * @param task The task.
+     * @param helped Whether the task is executed by a thread waiting for the group.
+     */
+    void execute(small_task& task, const bool helped)
+    {
+        bool failed = false;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#ifdef __cpp_exceptions
+        try
+        {
+#endif
+            task();
+#ifdef __cpp_exceptions
+        }
+        catch (...)
+        {
+            failed = true;
+        }
+#endif
+        const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+        // Destroy the task before marking it as finished, so that anything it captured is released by the time `wait()` returns.
+        task = small_task();
+        const std::scoped_lock lock(mutex);
+        stats.execution_time += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+        ++stats.tasks_completed;
+        if (failed)
+            ++stats.tasks_failed;
+        if (helped)
+            ++stats.tasks_helped;
+        if (--outstanding == 0)
+            done_cv.notify_all();
+    }
 
-/**
- * @brief An enumeration of flags to be used in the bitmask template parameter of `BS::thread_pool` to enable optional features.
- */
-enum tp : opt_t
-{
     /**
-     * @brief No optional features enabled.
+     * @brief Take the oldest task of the group that has not started yet out of the queue. The mutex must be locked and the queue must not be empty.
+     *
+     * @return The task.
      */
-    none = 0,
+    [[nodiscard]] small_task take_task()
+    {
+        small_task task = std::move(pending.front());
+        pending.pop_front();
+        return task;
+    }
 
     /**
-     * @brief Enable task priority.
+     * @brief The number of threads waiting for the group that are ready to run tasks of the group, which must be woken up when a new task is added.
      */
-    priority = 1 << 0,
+    std::size_t helpers_waiting = 0;
 
     /**
-     * @brief Enable pausing.
+     * @brief A mutex to synchronize access to the queue and the counters.
      */
-    pause = 1 << 2,
+    mutable std::mutex mutex;
 
     /**
-     * @brief Enable wait deadlock checks.
+     * @brief The number of unfinished tasks of the group: either still waiting in `pending`, or running.
      */
-    wait_deadlock_checks = 1 << 3
-};
-
-/**
- * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with all optional features disabled.
- */
-using light_thread_pool = thread_pool<tp::none>;
-
-/**
- * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with task priority enabled.
- */
-using priority_thread_pool = thread_pool<tp::priority>;
+    std::size_t outstanding = 0;
 
-/**
- * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with pausing enabled.
- */
-using pause_thread_pool = thread_pool<tp::pause>;
+    /**
+     * @brief The tasks of the group that have not started yet, in the order they were submitted.
+     */
+    std::deque<small_task> pending;
 
-/**
- * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class. This alias defines a thread pool with wait deadlock checks enabled.
- */
-using wdc_thread_pool = thread_pool<tp::wait_deadlock_checks>;
+    /**
+     * @brief The statistics of the group.
+     */
+    task_group_statistics stats;
+}; // class task_group_state
 
 /**
- * @brief A fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool class.
+ * @brief A class used to submit a group of tasks to a thread pool and wait only for the tasks of that group, rather than for all the tasks in the pool as `BS::thread_pool::wait()` does. Each group keeps its own queue of tasks that have not started yet, and submits one lightweight task to the pool for each of them, which runs the oldest task of the group that has not started yet. If `wait()` is called from a thread of the same pool, for example by a task which splits its work into subtasks and waits for them, the waiting thread runs the group's queued tasks itself instead of blocking, so the pool cannot run out of threads while waiting. Within a group, tasks start in the order they were submitted. The destructor waits for all the tasks of the group to finish.
  *
- * @tparam OptFlags A bitmask of flags which can be used to enable optional features. The flags are members of the `BS::tp` enumeration: `BS::tp::priority`, `BS::tp::pause`, and `BS::tp::wait_deadlock_checks`. The default is `BS::tp::none`, which disables all optional features. To enable multiple features, use the bitwise OR operator `|`, e.g. `BS::tp::priority | BS::tp::pause`.
+ * @tparam OptFlags The template parameter of the thread pool.
  */
 template <opt_t OptFlags = tp::none>
-class [[nodiscard]] thread_pool
+class [[nodiscard]] task_group
 {
 public:
     /**
-     * @brief A flag indicating whether task priority is enabled.
+     * @brief Construct a new task group which submits its tasks to the given pool.
+     *
+     * @param pool_ The thread pool which will execute the tasks. Must not be destroyed before the group.
+     * @param priority_ The priority of the tasks submitted to the pool on behalf of the group. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter of the pool, otherwise has no effect.
      */
-    static constexpr bool priority_enabled = (OptFlags & tp::priority) != 0;
+    explicit task_group(thread_pool<OptFlags>& pool_, const priority_t priority_ = 0) : pool(pool_), priority(priority_) {}
+
+    // The copy and move constructors and assignment operators are deleted. A task group is tied to the place where it is waited for.
+    task_group(const task_group&) = delete;
+    task_group(task_group&&) = delete;
+    task_group& operator=(const task_group&) = delete;
+    task_group& operator=(task_group&&) = delete;
 
     /**
-     * @brief A flag indicating whether pausing is enabled.
+     * @brief Destruct the task group, waiting for all of its tasks to finish first, so that tasks which captured local variables by reference do not outlive them.
      */
-    static constexpr bool pause_enabled = (OptFlags & tp::pause) != 0;
+    ~task_group()
+    {
+        wait();
+    }
 
     /**
-     * @brief A flag indicating whether wait deadlock checks are enabled.
+     * @brief Discard all the tasks of the group that have not started yet. Tasks that are currently running are not affected, and the group can still be used to submit new tasks afterwards. The futures of discarded tasks submitted using `submit_task()` will throw `std::future_error` with the error code `std::future_errc::broken_promise`.
+     *
+     * @return The number of discarded tasks.
      */
-    static constexpr bool wait_deadlock_checks_enabled = (OptFlags & tp::wait_deadlock_checks) != 0;
+    std::size_t cancel()
+    {
+        return state->cancel();
+    }
 
-#ifndef __cpp_exceptions
-    static_assert(!wait_deadlock_checks_enabled, "Wait deadlock checks cannot be enabled if exception handling is disabled.");
+    /**
+     * @brief Submit a function with no arguments and no return value to the group. To submit a function with arguments, enclose it in a lambda expression. Any exception thrown by the function is caught and counted in the statistics of the group.
+     *
+     * @tparam F The type of the function.
+     * @param task The function to submit.
+     */
+    template <typename F>
+    void detach_task(F&& task)
+    {
+        state->push(small_task(std::forward<F>(task)));
+#ifdef __cpp_exceptions
+        try
+        {
 #endif
-
-    // ============================
-    // Constructors and destructors
-    // ============================
+            pool.detach_task(
+                [group_state = state]
+                {
+                    group_state->run_one();
+                },
+                priority);
+#ifdef __cpp_exceptions
+        }
+        catch (...)
+        {
+            state->pop_back();
+            throw;
+        }
+#endif
+    }
 
     /**
-     * @brief Construct a new thread pool. The number of threads will be the total number of hardware threads available, as reported by the implementation. This is usually determined by the number of cores in the CPU. If a core is hyperthreaded, it will count as two threads.
+     * @brief Get a snapshot of the statistics of the group: the number of tasks submitted, completed, failed, cancelled, and run by waiting threads, and the total time spent executing them.
+     *
+     * @return The statistics.
      */
-    thread_pool() : thread_pool(0, [] {}) {}
+    [[nodiscard]] task_group_statistics get_statistics() const
+    {
+        return state->get_statistics();
+    }
 
     /**
-     * @brief Construct a new thread pool with the specified number of threads.
+     * @brief Get the number of tasks of the group that have not started yet.
      *
-     * @param num_threads The number of threads to use.
+     * @return The number of queued tasks.
      */
-    explicit thread_pool(const std::size_t num_threads) : thread_pool(num_threads, [] {}) {}
+    [[nodiscard]] std::size_t get_tasks_queued() const
+    {
+        return state->get_tasks_queued();
+    }
 
     /**
-     * @brief Construct a new thread pool with the specified initialization function.
+     * @brief Get the number of tasks of the group that are currently running.
      *
-     * @param init An initialization function to run in each thread before it starts executing any submitted tasks. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. It will be executed exactly once per thread, when the thread is first constructed. The initialization function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function.
+     * @return The number of running tasks.
      */
-    template <BS_THREAD_POOL_INIT_FUNC_CONCEPT(F)>
-    explicit thread_pool(F&& init) : thread_pool(0, std::forward<F>(init))
+    [[nodiscard]] std::size_t get_tasks_running() const
     {
+        return state->get_tasks_running();
     }
 
     /**
-     * @brief Construct a new thread pool with the specified number of threads and initialization function.
+     * @brief Get the total number of unfinished tasks of the group: either still waiting to start, or running.
      *
-     * @param num_threads The number of threads to use.
-     * @param init An initialization function to run in each thread before it starts executing any submitted tasks. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. It will be executed exactly once per thread, when the thread is first constructed. The initialization function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function.
+     * @return The total number of tasks.
      */
-    template <BS_THREAD_POOL_INIT_FUNC_CONCEPT(F)>
-    thread_pool(const std::size_t num_threads, F&& init)
+    [[nodiscard]] std::size_t get_tasks_total() const
     {
-        create_threads(num_threads, std::forward<F>(init));
+        return state->get_tasks_total();
     }
 
-    // The copy and move constructors and assignment operators are deleted. The thread pool cannot be copied or moved.
-    thread_pool(const thread_pool&) = delete;
-    thread_pool(thread_pool&&) = delete;
-    thread_pool& operator=(const thread_pool&) = delete;
-    thread_pool& operator=(thread_pool&&) = delete;
+    /**
+     * @brief Submit a function with no arguments to the group, and get a future for its returned value. To submit a function with arguments, enclose it in a lambda expression.
+     *
+     * @tparam F The type of the function.
+     * @tparam R The return type of the function (can be `void`).
+     * @param task The function to submit.
+     * @return A future to be used later to wait for the function to finish executing and/or obtain its returned value if it has one.
+     */
+    template <typename F, typename R = std::invoke_result_t<std::decay_t<F>>>
+    [[nodiscard]] std::future<R> submit_task(F&& task)
+    {
+        std::promise<R> promise;
+        std::future<R> future = promise.get_future();
+        detach_task(thread_pool<OptFlags>::template make_promise_task<R>(std::forward<F>(task), std::move(promise)));
+        return future;
+    }
 
     /**
-     * @brief Destruct the thread pool. Waits for all tasks to complete, then destroys all threads. If a cleanup function was set, it will run in each thread right before it is destroyed. Note that if the pool is paused, then any tasks still in the queue will never be executed.
+     * @brief Wait for all the tasks of the group to finish, including tasks submitted while waiting. Tasks submitted to the pool by other means are not waited for. If called from a thread of the same pool, the calling thread runs the tasks of the group that have not started yet, and only blocks once all of them have started; if the flag `BS::tp::elastic` is enabled, it blocks inside a `BS::this_thread::blocking_region`. Must not be called from a task of the same group, as that task would wait for itself.
      */
-    ~thread_pool() noexcept
+    void wait()
     {
-#ifdef __cpp_exceptions
-        try
-        {
-#endif
-            wait();
-#ifndef __cpp_lib_jthread
-            destroy_threads();
-#endif
-#ifdef __cpp_exceptions
-        }
-        catch (...)
-        {
-        }
-#endif
+        const bool help = this_thread::get_pool() == &pool;
+        state->wait(help,
+            [this, help](std::unique_lock<std::mutex>& lock)
+            {
+                block(help,
+                    [this, &lock]
+                    {
+                        state->done_cv.wait(lock);
+                    });
+                return true;
+            });
     }
 
-    // =======================
-    // Public member functions
-    // =======================
+    /**
+     * @brief Wait for all the tasks of the group to finish, but stop waiting after the specified duration has passed. If called from a thread of the same pool, the calling thread runs the tasks of the group that have not started yet while waiting, as in `wait()`, so it may return later than the specified duration if such a task takes longer.
+     *
+     * @tparam R An arithmetic type representing the number of ticks to wait.
+     * @tparam P An `std::ratio` representing the length of each tick in seconds.
+     * @param duration The amount of time to wait.
+     * @return `true` if all the tasks finished before the duration expired, `false` otherwise.
+     */
+    template <typename R, typename P>
+    bool wait_for(const std::chrono::duration<R, P>& duration)
+    {
+        return wait_until(std::chrono::steady_clock::now() + duration);
+    }
 
     /**
-     * @brief Parallelize a loop by automatically splitting it into blocks and submitting each block separately to the queue, with the specified priority. The block function takes two arguments, the start and end of the block, so that it is only called once per block, but it is up to the user make sure the block function correctly deals with all the indices in each block. Does not return a `BS::multi_future`, so the user must use `wait()` or some other method to ensure that the loop finishes executing, otherwise bad things will happen.
+     * @brief Wait for all the tasks of the group to finish, but stop waiting after the specified time point has been reached. If called from a thread of the same pool, the calling thread runs the tasks of the group that have not started yet while waiting, as in `wait()`, so it may return later than the specified time point if such a task takes longer.
      *
-     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
-     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
-     * @tparam F The type of the function to loop through.
-     * @param first_index The first index in the loop.
-     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no blocks will be submitted.
-     * @param block A function that will be called once per block. Should take exactly two arguments: the first index in the block and the index after the last index in the block. `block(start, end)` should typically involve a loop of the form `for (T i = start; i < end; ++i)`.
-     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
-     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @tparam C The type of the clock used to measure time.
+     * @tparam D An `std::chrono::duration` type used to indicate the time point.
+     * @param timeout_time The time point at which to stop waiting.
+     * @return `true` if all the tasks finished before the time point was reached, `false` otherwise.
      */
-    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
-    void detach_blocks(const T1 first_index, const T2 index_after_last, F&& block, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    template <typename C, typename D>
+    bool wait_until(const std::chrono::time_point<C, D>& timeout_time)
     {
-        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
-        {
-            const std::shared_ptr<std::decay_t<F>> block_ptr = std::make_shared<std::decay_t<F>>(std::forward<F>(block));
-            const blocks blks(static_cast<T>(first_index), static_cast<T>(index_after_last), num_blocks ? num_blocks : thread_count);
-            for (std::size_t blk = 0; blk < blks.get_num_blocks(); ++blk)
+        const bool help = this_thread::get_pool() == &pool;
+        return state->wait(help,
+            [this, help, &timeout_time](std::unique_lock<std::mutex>& lock)
             {
-                detach_task(
-                    [block_ptr, start = blks.start(blk), end = blks.end(blk)]
+                bool awakened = true;
+                block(help,
+                    [this, &lock, &timeout_time, &awakened]
                     {
-                        (*block_ptr)(start, end);
-                    },
-                    priority);
-            }
-        }
+                        awakened = state->done_cv.wait_until(lock, timeout_time) == std::cv_status::no_timeout;
+                    });
+                return awakened;
+            });
     }
 
+private:
     /**
-     * @brief Parallelize a loop by automatically splitting it into blocks and submitting each block separately to the queue, with the specified priority. The loop function takes one argument, the loop index, so that it is called many times per block. Does not return a `BS::multi_future`, so the user must use `wait()` or some other method to ensure that the loop finishes executing, otherwise bad things will happen.
+     * @brief Block the calling thread, inside a `BS::this_thread::blocking_region` if it is a thread of the pool, so that an elastic pool can start another thread to replace it.
      *
-     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
-     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
-     * @tparam F The type of the function to loop through.
-     * @param first_index The first index in the loop.
-     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no blocks will be submitted.
-     * @param loop The function to loop through. Will be called once per index, many times per block. Should take exactly one argument: the loop index.
-     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
-     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @tparam F The type of the function that blocks.
+     * @param in_pool Whether the calling thread is a thread of the pool.
+     * @param func The function that blocks.
      */
-    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
-    void detach_loop(const T1 first_index, const T2 index_after_last, F&& loop, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    template <typename F>
+    static void block(const bool in_pool, F&& func)
     {
-        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        if (in_pool)
         {
-            const std::shared_ptr<std::decay_t<F>> loop_ptr = std::make_shared<std::decay_t<F>>(std::forward<F>(loop));
-            const blocks blks(static_cast<T>(first_index), static_cast<T>(index_after_last), num_blocks ? num_blocks : thread_count);
-            for (std::size_t blk = 0; blk < blks.get_num_blocks(); ++blk)
-            {
-                detach_task(
-                    [loop_ptr, start = blks.start(blk), end = blks.end(blk)]
-                    {
-                        for (T i = start; i < end; ++i)
-                            (*loop_ptr)(i);
-                    },
-                    priority);
-            }
+            const this_thread::blocking_region region;
+            func();
+        }
+        else
+        {
+            func();
         }
     }
 
     /**
-     * @brief Submit a sequence of tasks enumerated by indices to the queue, with the specified priority. The sequence function takes one argument, the task index, and will be called once per index. Does not return a `BS::multi_future`, so the user must use `wait()` or some other method to ensure that the sequence finishes executing, otherwise bad things will happen.
+     * @brief The thread pool which executes the tasks.
+     */
+    thread_pool<OptFlags>& pool;
+
+    /**
+     * @brief The priority of the tasks submitted to the pool on behalf of the group.
+     */
+    priority_t priority;
+
+    /**
+     * @brief A shared pointer to the state of the group, shared with the tasks submitted to the pool.
+     */
+    std::shared_ptr<task_group_state> state = std::make_shared<task_group_state>();
+}; // class task_group
+
+/**
+ * @brief A helper struct storing the state of a single queue of a `BS::fair_scheduler`: its tasks that have not started yet, its weight, and its share of the scheduler's time. All the members are protected by the mutex of the scheduler.
+ */
+struct fair_queue_state
+{
+    /**
+     * @brief Construct the state of a new queue with the given weight.
+     *
+     * @param weight_ The weight of the queue.
+     * @param initial_cost The initial estimate of the execution time of a task, in nanoseconds.
+     */
+    fair_queue_state(const std::uint32_t weight_, const std::int64_t initial_cost) : cost_estimate(initial_cost), weight(weight_) {}
+
+    /**
+     * @brief Whether the queue is in the list of queues which have tasks ready to be dispatched.
+     */
+    bool active = false;
+
+    /**
+     * @brief The estimated execution time of the next task, in nanoseconds. Updated with a moving average of the measured execution times.
+     */
+    std::int64_t cost_estimate;
+
+    /**
+     * @brief The deficit counter of the queue, in nanoseconds: the amount of time its tasks may still use in the current round. Each dispatched task is charged its estimated execution time in advance, and the estimate is corrected once it finishes.
+     */
+    std::int64_t deficit = 0;
+
+    /**
+     * @brief A condition variable used to notify the threads waiting for the queue that its tasks have finished, or that a task has been added which they may run.
+     */
+    std::condition_variable done_cv;
+
+    /**
+     * @brief The number of threads waiting for the queue that are ready to run its tasks, which must be woken up when a new task is added.
+     */
+    std::size_t helpers_waiting = 0;
+
+    /**
+     * @brief Whether the queue is paused.
+     */
+    bool paused = false;
+
+    /**
+     * @brief The tasks of the queue that have not started yet, in the order they were submitted.
+     */
+    std::deque<small_task> pending;
+
+    /**
+     * @brief The number of tasks of the queue that are currently running.
+     */
+    std::size_t running = 0;
+
+    /**
+     * @brief The weight of the queue.
+     */
+    std::uint32_t weight;
+}; // struct fair_queue_state
+
+/**
+ * @brief A helper class storing the shared state of a `BS::fair_scheduler`. The tasks of all the queues are stored here, and for each task that is ready to run, one lightweight dispatch task is submitted to the pool, which runs the task chosen by deficit round-robin among all the queues, rather than the task it was submitted for. Only accessed through a shared pointer, so the dispatch tasks can outlive the scheduler.
+ */
+class [[nodiscard]] fair_scheduler_state
+{
+public:
+    /**
+     * @brief Construct the shared state of a new scheduler.
+     *
+     * @param quantum_ The amount of execution time given to a queue of weight 1 in each round, in nanoseconds.
+     */
+    explicit fair_scheduler_state(const std::int64_t quantum_) : quantum(quantum_) {}
+
+    // The copy and move constructors and assignment operators are deleted. The state is only ever accessed through a shared pointer.
+    fair_scheduler_state(const fair_scheduler_state&) = delete;
+    fair_scheduler_state(fair_scheduler_state&&) = delete;
+    fair_scheduler_state& operator=(const fair_scheduler_state&) = delete;
+    fair_scheduler_state& operator=(fair_scheduler_state&&) = delete;
+    ~fair_scheduler_state() = default;
+
+    /**
+     * @brief Create the state of a new queue.
      *
-     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
-     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
-     * @tparam F The type of the function used to define the sequence.
-     * @param first_index The first index in the sequence.
-     * @param index_after_last The index after the last index in the sequence. The sequence will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no tasks will be submitted.
-     * @param sequence The function used to define the sequence. Will be called once per index. Should take exactly one argument, the index.
-     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @param weight The weight of the queue.
+     * @return A shared pointer to the state.
      */
-    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
-    void detach_sequence(const T1 first_index, const T2 index_after_last, F&& sequence, const priority_t priority = 0)
+    [[nodiscard]] std::shared_ptr<fair_queue_state> add_queue(const std::uint32_t weight) const
     {
-        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
-        {
-            const std::shared_ptr<std::decay_t<F>> sequence_ptr = std::make_shared<std::decay_t<F>>(std::forward<F>(sequence));
-            for (T i = static_cast<T>(first_index); i < static_cast<T>(index_after_last); ++i)
-            {
-                detach_task(
-                    [sequence_ptr, i]
-                    {
-                        (*sequence_ptr)(i);
-                    },
-                    priority);
-            }
-        }
+        return std::make_shared<fair_queue_state>(weight, quantum);
     }
 
     /**
-     * @brief Submit a function with no arguments and no return value into the task queue, with the specified priority. To submit a function with arguments, enclose it in a lambda expression. Does not return a future, so the user must use `wait()` or some other method to ensure that the task finishes executing, otherwise bad things will happen.
+     * @brief Forget about dispatch tasks which were requested by `push()` or `unpause()`, but could not be submitted to the pool.
      *
-     * @tparam F The type of the function.
-     * @param task The function to submit.
-     * @param priority The priority of the task. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
+     * @param count The number of dispatch tasks.
      */
-    template <typename F>
-    void detach_task(F&& task, const priority_t priority = 0)
+    void cancel_dispatches(const std::size_t count) noexcept
     {
-        {
-            const std::scoped_lock tasks_lock(tasks_mutex);
-            if constexpr (priority_enabled)
-                tasks.emplace(std::forward<F>(task), priority);
-            else
-                tasks.emplace(std::forward<F>(task));
-        }
-        task_available_cv.notify_one();
+        const std::scoped_lock lock(mutex);
+        dispatches -= count;
+    }
+
+    /**
+     * @brief Record that a dispatch task was destroyed without running, for example because the pool was purged. The mutex is not locked, since this may be called while the pool holds its own mutex, and the pool's mutex may be locked while the scheduler's mutex is held if a waiting thread enters a blocking region; the count is corrected by the next call to `add_dispatches()` instead.
+     */
+    void discard_dispatch() noexcept
+    {
+        discarded_dispatches.fetch_add(1, std::memory_order_relaxed);
     }
 
-#ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
     /**
-     * @brief Get a vector containing the underlying implementation-defined thread handles for each of the pool's threads, as obtained by `std::thread::native_handle()` (or `std::jthread::native_handle()` in C++20 and later).
+     * @brief Get the total number of unfinished tasks of a queue: either still waiting to start, or running.
      *
-     * @return The native thread handles.
+     * @param queue The queue.
+     * @return The total number of tasks.
      */
-    [[nodiscard]] std::vector<thread_t::native_handle_type> get_native_handles() const
+    [[nodiscard]] std::size_t get_tasks_total(const fair_queue_state& queue) const
     {
-        std::vector<thread_t::native_handle_type> native_handles(thread_count);
-        for (std::size_t i = 0; i < thread_count; ++i)
-            native_handles[i] = threads[i].native_handle();
-        return native_handles;
+        const std::scoped_lock lock(mutex);
+        return queue.pending.size() + queue.running;
     }
-#endif
 
     /**
-     * @brief Get the number of tasks currently waiting in the queue to be executed by the threads.
+     * @brief Check whether a queue is paused.
      *
-     * @return The number of queued tasks.
+     * @param queue The queue.
+     * @return `true` if the queue is paused, `false` otherwise.
      */
-    [[nodiscard]] std::size_t get_tasks_queued() const
+    [[nodiscard]] bool is_paused(const fair_queue_state& queue) const
     {
-        const std::scoped_lock tasks_lock(tasks_mutex);
-        return tasks.size();
+        const std::scoped_lock lock(mutex);
+        return queue.paused;
     }
 
     /**
-     * @brief Get the number of tasks currently being executed by the threads.
+     * @brief Get the number of tasks of a queue that have not started yet.
      *
-     * @return The number of running tasks.
+     * @param queue The queue.
+     * @return The number of queued tasks.
      */
-    [[nodiscard]] std::size_t get_tasks_running() const
+    [[nodiscard]] std::size_t get_tasks_queued(const fair_queue_state& queue) const
     {
-        const std::scoped_lock tasks_lock(tasks_mutex);
-        return tasks_running;
+        const std::scoped_lock lock(mutex);
+        return queue.pending.size();
     }
 
     /**
-     * @brief Get the total number of unfinished tasks: either still waiting in the queue, or running in a thread. Note that `get_tasks_total() == get_tasks_queued() + get_tasks_running()`.
+     * @brief Get the number of tasks of a queue that are currently running.
      *
-     * @return The total number of tasks.
+     * @param queue The queue.
+     * @return The number of running tasks.
      */
-    [[nodiscard]] std::size_t get_tasks_total() const
+    [[nodiscard]] std::size_t get_tasks_running(const fair_queue_state& queue) const
     {
-        const std::scoped_lock tasks_lock(tasks_mutex);
-        return tasks_running + tasks.size();
+        const std::scoped_lock lock(mutex);
+        return queue.running;
     }
 
     /**
-     * @brief Get the number of threads in the pool.
+     * @brief Get the weight of a queue.
      *
-     * @return The number of threads.
+     * @param queue The queue.
+     * @return The weight.
      */
-    [[nodiscard]] std::size_t get_thread_count() const noexcept
+    [[nodiscard]] std::uint32_t get_weight(const fair_queue_state& queue) const
     {
-        return thread_count;
+        const std::scoped_lock lock(mutex);
+        return queue.weight;
     }
 
     /**
-     * @brief Get a vector containing the unique identifiers for each of the pool's threads, as obtained by `std::thread::get_id()` (or `std::jthread::get_id()` in C++20 and later).
+     * @brief Pause a queue. Its tasks that have not started yet are no longer dispatched until it is unpaused.
      *
-     * @return The unique thread identifiers.
+     * @param queue The queue.
      */
-    [[nodiscard]] std::vector<thread_t::id> get_thread_ids() const
+    void pause(fair_queue_state& queue)
     {
-        std::vector<thread_t::id> thread_ids(thread_count);
-        for (std::size_t i = 0; i < thread_count; ++i)
-            thread_ids[i] = threads[i].get_id();
-        return thread_ids;
+        const std::scoped_lock lock(mutex);
+        if (queue.paused)
+            return;
+        queue.paused = true;
+        ready -= queue.pending.size();
+        deactivate(queue);
+        // Threads waiting for a paused queue only wait for its running tasks.
+        if (queue.running == 0)
+            queue.done_cv.notify_all();
     }
 
     /**
-     * @brief Check whether the pool is currently paused. Only enabled if the flag `BS:tp::pause` is enabled in the template parameter.
+     * @brief Discard all the tasks of a queue that have not started yet. The tasks are destroyed after the mutex is unlocked, so any destructors they run, such as those of broken promises, do not block the scheduler.
      *
-     * @return `true` if the pool is paused, `false` if it is not paused.
+     * @param queue The queue.
+     * @return The number of discarded tasks.
      */
-    BS_THREAD_POOL_IF_PAUSE_ENABLED
-    [[nodiscard]] bool is_paused() const
+    std::size_t purge(fair_queue_state& queue)
     {
-        const std::scoped_lock tasks_lock(tasks_mutex);
-        return paused;
+        std::deque<small_task> discarded;
+        {
+            const std::scoped_lock lock(mutex);
+            discarded.swap(queue.pending);
+            if (!queue.paused)
+                ready -= discarded.size();
+            deactivate(queue);
+            if (queue.running == 0)
+                queue.done_cv.notify_all();
+        }
+        return discarded.size();
     }
 
     /**
-     * @brief Pause the pool. The workers will temporarily stop retrieving new tasks out of the queue, although any tasks already executed will keep running until they are finished. Only enabled if the flag `BS:tp::pause` is enabled in the template parameter.
+     * @brief Add a task to a queue, and wake up any threads waiting for the queue that may run it.
+     *
+     * @param queue The queue.
+     * @param task The task.
+     * @return The number of new dispatch tasks that must be submitted to the pool.
      */
-    BS_THREAD_POOL_IF_PAUSE_ENABLED
-    void pause()
+    [[nodiscard]] std::size_t push(fair_queue_state& queue, small_task&& task)
     {
-        const std::scoped_lock tasks_lock(tasks_mutex);
-        paused = true;
+        const std::scoped_lock lock(mutex);
+        queue.pending.push_back(std::move(task));
+        if (queue.helpers_waiting > 0)
+            queue.done_cv.notify_all();
+        if (queue.paused)
+            return 0;
+        ++ready;
+        activate(queue);
+        return add_dispatches();
     }
 
     /**
-     * @brief Purge all the tasks waiting in the queue. Tasks that are currently running will not be affected, but any tasks still waiting in the queue will be discarded, and will never be executed by the threads. Please note that there is no way to restore the purged tasks.
+     * @brief Remove the most recently added task from a queue without running it, if it has not started yet. Used to undo `push()` if the dispatch task could not be submitted to the pool, after the dispatch itself has been cancelled using `cancel_dispatches()`.
+     *
+     * @param queue The queue.
      */
-    void purge()
+    void pop_back(fair_queue_state& queue) noexcept
     {
-        const std::scoped_lock tasks_lock(tasks_mutex);
-        tasks = {};
+        const std::scoped_lock lock(mutex);
+        if (queue.pending.empty())
+            return;
+        queue.pending.pop_back();
+        if (!queue.paused)
+            --ready;
+        if (queue.pending.empty())
+        {
+            deactivate(queue);
+            if (queue.running == 0)
+                queue.done_cv.notify_all();
+        }
     }
 
     /**
-     * @brief Reset the pool with the total number of hardware threads available, as reported by the implementation. Waits for all currently running tasks to be completed, then destroys all threads in the pool and creates a new thread pool with the new number of threads. Any tasks that were waiting in the queue before the pool was reset will then be executed by the new threads. If the pool was paused before resetting it, the new pool will be paused as well.
+     * @brief The body of a dispatch task: choose the next task using deficit round-robin among the queues which have tasks ready to run, and run it. Does nothing if no task is ready, which happens if the task this dispatch was submitted for was purged, paused, or already run by a waiting thread.
      */
-    void reset()
+    void run_next()
     {
-        reset(0, [](std::size_t) {});
+        fair_queue_state* queue = nullptr;
+        small_task task;
+        std::int64_t charged = 0;
+        {
+            const std::scoped_lock lock(mutex);
+            --dispatches;
+            queue = choose();
+            if (queue == nullptr)
+                return;
+            charged = queue->cost_estimate;
+            queue->deficit -= charged;
+            task = take_task(*queue);
+        }
+        execute(*queue, task, charged);
     }
 
     /**
-     * @brief Reset the pool with a new number of threads. Waits for all currently running tasks to be completed, then destroys all threads in the pool and creates a new thread pool with the new number of threads. Any tasks that were waiting in the queue before the pool was reset will then be executed by the new threads. If the pool was paused before resetting it, the new pool will be paused as well.
+     * @brief Change the weight of a queue. Takes effect from the next round.
      *
-     * @param num_threads The number of threads to use.
+     * @param queue The queue.
+     * @param weight The new weight.
      */
-    void reset(const std::size_t num_threads)
+    void set_weight(fair_queue_state& queue, const std::uint32_t weight)
     {
-        reset(num_threads, [](std::size_t) {});
+        const std::scoped_lock lock(mutex);
+        queue.weight = weight;
     }
 
     /**
-     * @brief Reset the pool with the total number of hardware threads available, as reported by the implementation, and a new initialization function. Waits for all currently running tasks to be completed, then destroys all threads in the pool and creates a new thread pool with the new number of threads and initialization function. Any tasks that were waiting in the queue before the pool was reset will then be executed by the new threads. If the pool was paused before resetting it, the new pool will be paused as well.
+     * @brief Unpause a queue, so that its tasks that have not started yet are dispatched again.
      *
-     * @param init An initialization function to run in each thread before it starts executing any submitted tasks. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. It will be executed exactly once per thread, when the thread is first constructed. The initialization function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function.
+     * @param queue The queue.
+     * @return The number of new dispatch tasks that must be submitted to the pool.
      */
-    template <BS_THREAD_POOL_INIT_FUNC_CONCEPT(F)>
-    void reset(F&& init)
+    [[nodiscard]] std::size_t unpause(fair_queue_state& queue)
     {
-        reset(0, std::forward<F>(init));
+        const std::scoped_lock lock(mutex);
+        if (!queue.paused)
+            return 0;
+        queue.paused = false;
+        if (queue.pending.empty())
+            return 0;
+        ready += queue.pending.size();
+        activate(queue);
+        return add_dispatches();
     }
 
     /**
-     * @brief Reset the pool with a new number of threads and a new initialization function. Waits for all currently running tasks to be completed, then destroys all threads in the pool and creates a new thread pool with the new number of threads and initialization function. Any tasks that were waiting in the queue before the pool was reset will then be executed by the new threads. If the pool was paused before resetting it, the new pool will be paused as well.
+     * @brief Replace any dispatch tasks which were discarded without running, for example by `purge()` of the pool, so that the tasks which are ready to run do not wait forever.
      *
-     * @param num_threads The number of threads to use.
-     * @param init An initialization function to run in each thread before it starts executing any submitted tasks. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. It will be executed exactly once per thread, when the thread is first constructed. The initialization function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function.
+     * @return The number of new dispatch tasks that must be submitted to the pool.
      */
-    template <BS_THREAD_POOL_INIT_FUNC_CONCEPT(F)>
-    void reset(const std::size_t num_threads, F&& init)
+    [[nodiscard]] std::size_t replace_dispatches()
     {
-        if constexpr (pause_enabled)
-        {
-            std::unique_lock tasks_lock(tasks_mutex);
-            const bool was_paused = paused;
-            paused = true;
-            tasks_lock.unlock();
-            reset_pool(num_threads, std::forward<F>(init));
-            tasks_lock.lock();
-            paused = was_paused;
-        }
-        else
-        {
-            reset_pool(num_threads, std::forward<F>(init));
-        }
+        const std::scoped_lock lock(mutex);
+        return add_dispatches();
     }
 
     /**
-     * @brief Set the thread pool's cleanup function.
+     * @brief Wait for the tasks of a queue to finish: all of them, or if the queue is paused, only the running ones.
      *
-     * @param cleanup A cleanup function to run in each thread right before it is destroyed, which will happen when the pool is destructed or reset. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. The cleanup function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function.
+     * @tparam B The type of the function used to block.
+     * @param queue The queue.
+     * @param help Whether to run the tasks of the queue that have not started yet while waiting, instead of blocking.
+     * @param block A function that takes the locked `std::unique_lock` of the mutex, blocks on it using the condition variable of the queue, and returns `false` if it timed out, or `true` otherwise.
+     * @return `true` if the tasks finished, `false` if `block` timed out first.
      */
-    template <BS_THREAD_POOL_INIT_FUNC_CONCEPT(F)>
-    void set_cleanup_func(F&& cleanup)
+    template <typename B>
+    bool wait(fair_queue_state& queue, const bool help, B&& block)
     {
-        if constexpr (std::is_invocable_v<F, std::size_t>)
-        {
-            cleanup_func = std::forward<F>(cleanup);
-        }
-        else
+        std::unique_lock lock(mutex);
+        while (!is_done(queue))
         {
-            cleanup_func = [cleanup = std::forward<F>(cleanup)](std::size_t)
+            if (help && !queue.paused && !queue.pending.empty())
             {
-                cleanup();
-            };
+                const std::int64_t charged = queue.cost_estimate;
+                queue.deficit -= charged;
+                small_task task = take_task(queue);
+                lock.unlock();
+                execute(queue, task, charged);
+                lock.lock();
+                continue;
+            }
+            if (help)
+                ++queue.helpers_waiting;
+            const bool awakened = block(lock, queue.done_cv);
+            if (help)
+                --queue.helpers_waiting;
+            if (!awakened)
+                return is_done(queue);
         }
+        return true;
     }
 
+private:
     /**
-     * @brief Parallelize a loop by automatically splitting it into blocks and submitting each block separately to the queue, with the specified priority. The block function takes two arguments, the start and end of the block, so that it is only called once per block, but it is up to the user make sure the block function correctly deals with all the indices in each block. Returns a `BS::multi_future` that contains the futures for all of the blocks.
+     * @brief Add a queue to the end of the list of queues which have tasks ready to run, if it is not already there. The mutex must be locked.
      *
-     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
-     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
-     * @tparam F The type of the function to loop through.
-     * @tparam R The return type of the function to loop through (can be `void`).
-     * @param first_index The first index in the loop.
-     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no blocks will be submitted, and an empty `BS::multi_future` will be returned.
-     * @param block A function that will be called once per block. Should take exactly two arguments: the first index in the block and the index after the last index in the block. `block(start, end)` should typically involve a loop of the form `for (T i = start; i < end; ++i)`.
-     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
-     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
-     * @return A `BS::multi_future` that can be used to wait for all the blocks to finish. If the block function returns a value, the `BS::multi_future` can also be used to obtain the values returned by each block.
+     * @param queue The queue.
      */
-    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F, typename R = std::invoke_result_t<std::decay_t<F>, T, T>>
-    [[nodiscard]] multi_future<R> submit_blocks(const T1 first_index, const T2 index_after_last, F&& block, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    void activate(fair_queue_state& queue)
     {
-        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
-        {
-            const std::shared_ptr<std::decay_t<F>> block_ptr = std::make_shared<std::decay_t<F>>(std::forward<F>(block));
-            const blocks blks(static_cast<T>(first_index), static_cast<T>(index_after_last), num_blocks ? num_blocks : thread_count);
-            multi_future<R> future;
-            future.reserve(blks.get_num_blocks());
-            for (std::size_t blk = 0; blk < blks.get_num_blocks(); ++blk)
-            {
-                future.push_back(submit_task(
-                    [block_ptr, start = blks.start(blk), end = blks.end(blk)]
-                    {
-                        return (*block_ptr)(start, end);
-                    },
-                    priority));
-            }
-            return future;
-        }
-        return {};
+        if (queue.active)
+            return;
+        queue.active = true;
+        active.push_back(&queue);
     }
 
     /**
-     * @brief Parallelize a loop by automatically splitting it into blocks and submitting each block separately to the queue, with the specified priority. The loop function takes one argument, the loop index, so that it is called many times per block. It must have no return value. Returns a `BS::multi_future` that contains the futures for all of the blocks.
+     * @brief Increase the number of dispatch tasks in the pool to match the number of tasks ready to run. This also replaces any dispatch tasks which were discarded without running since the last call. The mutex must be locked.
      *
-     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
-     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
-     * @tparam F The type of the function to loop through.
-     * @param first_index The first index in the loop.
-     * @param index_after_last The index after the last index in the loop. The loop will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no tasks will be submitted, and an empty `BS::multi_future` will be returned.
-     * @param loop The function to loop through. Will be called once per index, many times per block. Should take exactly one argument: the loop index. It cannot have a return value.
-     * @param num_blocks The maximum number of blocks to split the loop into. The default is 0, which means the number of blocks will be equal to the number of threads in the pool.
-     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
-     * @return A `BS::multi_future` that can be used to wait for all the blocks to finish.
+     * @return The number of new dispatch tasks that must be submitted.
      */
-    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F>
-    [[nodiscard]] multi_future<void> submit_loop(const T1 first_index, const T2 index_after_last, F&& loop, const std::size_t num_blocks = 0, const priority_t priority = 0)
+    [[nodiscard]] std::size_t add_dispatches()
     {
-        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
-        {
-            const std::shared_ptr<std::decay_t<F>> loop_ptr = std::make_shared<std::decay_t<F>>(std::forward<F>(loop));
-            const blocks blks(static_cast<T>(first_index), static_cast<T>(index_after_last), num_blocks ? num_blocks : thread_count);
-            multi_future<void> future;
-            future.reserve(blks.get_num_blocks());
-            for (std::size_t blk = 0; blk < blks.get_num_blocks(); ++blk)
-            {
-                future.push_back(submit_task(
-                    [loop_ptr, start = blks.start(blk), end = blks.end(blk)]
-                    {
-                        for (T i = start; i < end; ++i)
-                            (*loop_ptr)(i);
-                    },
-                    priority));
-            }
-            return future;
-        }
-        return {};
+        dispatches -= discarded_dispatches.exchange(0, std::memory_order_relaxed);
+        const std::size_t needed = (ready > dispatches) ? (ready - dispatches) : 0;
+        dispatches += needed;
+        return needed;
     }
 
     /**
-     * @brief Submit a sequence of tasks enumerated by indices to the queue, with the specified priority. The sequence function takes one argument, the task index, and will be called once per index. Returns a `BS::multi_future` that contains the futures for all of the tasks.
+     * @brief Choose the queue to run the next task from, using deficit round-robin. Starting from the current queue, the first queue whose deficit counter is positive is chosen; the current queue keeps being chosen until it runs out of time or tasks. If all the deficit counters are exhausted, a new round starts, in which every queue is given its weight times the quantum, as many times as needed for at least one of them to become positive. The mutex must be locked.
      *
-     * @tparam T1 The type of the first index. Should be a signed or unsigned integer.
-     * @tparam T2 The type of the index after the last index. Should be a signed or unsigned integer.
-     * @tparam F The type of the function used to define the sequence.
-     * @tparam R The return type of the function used to define the sequence (can be `void`).
-     * @param first_index The first index in the sequence.
-     * @param index_after_last The index after the last index in the sequence. The sequence will iterate from `first_index` to `(index_after_last - 1)` inclusive. In other words, it will be equivalent to `for (T i = first_index; i < index_after_last; ++i)`. Note that if `index_after_last <= first_index`, no tasks will be submitted, and an empty `BS::multi_future` will be returned.
-     * @param sequence The function used to define the sequence. Will be called once per index. Should take exactly one argument, the index.
-     * @param priority The priority of the tasks. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
-     * @return A `BS::multi_future` that can be used to wait for all the tasks to finish. If the sequence function returns a value, the `BS::multi_future` can also be used to obtain the values returned by each task.
+     * @return A pointer to the chosen queue, or `nullptr` if no queue has tasks ready to run.
      */
-    template <typename T1, typename T2, typename T = common_index_type_t<T1, T2>, typename F, typename R = std::invoke_result_t<std::decay_t<F>, T>>
-    [[nodiscard]] multi_future<R> submit_sequence(const T1 first_index, const T2 index_after_last, F&& sequence, const priority_t priority = 0)
+    [[nodiscard]] fair_queue_state* choose()
     {
-        if (static_cast<T>(index_after_last) > static_cast<T>(first_index))
+        while (!active.empty())
         {
-            const std::shared_ptr<std::decay_t<F>> sequence_ptr = std::make_shared<std::decay_t<F>>(std::forward<F>(sequence));
-            multi_future<R> future;
-            future.reserve(static_cast<std::size_t>(static_cast<T>(index_after_last) > static_cast<T>(first_index)));
-            for (T i = static_cast<T>(first_index); i < static_cast<T>(index_after_last); ++i)
+            for (std::size_t i = 0; i < active.size(); ++i)
             {
-                future.push_back(submit_task(
-                    [sequence_ptr, i]
-                    {
-                        return (*sequence_ptr)(i);
-                    },
-                    priority));
+                if (cursor >= active.size())
+                    cursor = 0;
+                fair_queue_state* const queue = active[cursor];
+                if (queue->deficit > 0)
+                    return queue;
+                ++cursor;
             }
-            return future;
+            std::int64_t rounds = std::numeric_limits<std::int64_t>::max();
+            for (const fair_queue_state* const queue : active)
+            {
+                const std::int64_t share = quantum * static_cast<std::int64_t>(queue->weight);
+                rounds = std::min(rounds, (-queue->deficit / share) + 1);
+            }
+            for (fair_queue_state* const queue : active)
+                queue->deficit += rounds * quantum * static_cast<std::int64_t>(queue->weight);
         }
-        return {};
+        return nullptr;
     }
 
     /**
-     * @brief Submit a function with no arguments into the task queue, with the specified priority. To submit a function with arguments, enclose it in a lambda expression. If the function has a return value, get a future for the eventual returned value. If the function has no return value, get an `std::future<void>` which can be used to wait until the task finishes.
+     * @brief Remove a queue from the list of queues which have tasks ready to run, if it is there. A queue which goes idle does not keep any unused time for the next time it has tasks, but does keep any time it overused. The mutex must be locked.
      *
-     * @tparam F The type of the function.
-     * @tparam R The return type of the function (can be `void`).
-     * @param task The function to submit.
-     * @param priority The priority of the task. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter, otherwise has no effect.
-     * @return A future to be used later to wait for the function to finish executing and/or obtain its returned value if it has one.
+     * @param queue The queue.
      */
-    template <typename F, typename R = std::invoke_result_t<std::decay_t<F>>>
-    [[nodiscard]] std::future<R> submit_task(F&& task, const priority_t priority = 0)
+    void deactivate(fair_queue_state& queue)
     {
-#ifdef __cpp_lib_move_only_function
-        std::promise<R> promise;
-    #define BS_THREAD_POOL_PROMISE_MEMBER_ACCESS promise.
-#else
-        const std::shared_ptr<std::promise<R>> promise = std::make_shared<std::promise<R>>();
-    #define BS_THREAD_POOL_PROMISE_MEMBER_ACCESS promise->
-#endif
-        std::future<R> future = BS_THREAD_POOL_PROMISE_MEMBER_ACCESS get_future();
-        detach_task(
-            [task = std::forward<F>(task), promise = std::move(promise)]() mutable
-            {
-#ifdef __cpp_exceptions
-                try
-                {
-#endif
-                    if constexpr (std::is_void_v<R>)
-                    {
-                        task();
-                        BS_THREAD_POOL_PROMISE_MEMBER_ACCESS set_value();
-                    }
-                    else
-                    {
-                        BS_THREAD_POOL_PROMISE_MEMBER_ACCESS set_value(task());
-                    }
-#ifdef __cpp_exceptions
-                }
-                catch (...)
-                {
-                    try
-                    {
-                        BS_THREAD_POOL_PROMISE_MEMBER_ACCESS set_exception(std::current_exception());
-                    }
-                    catch (...)
-                    {
-                    }
-                }
-#endif
-            },
-            priority);
-        return future;
+        if (!queue.active)
+            return;
+        queue.active = false;
+        queue.deficit = std::min<std::int64_t>(queue.deficit, 0);
+        const std::size_t index = static_cast<std::size_t>(std::find(active.begin(), active.end(), &queue) - active.begin());
+        active.erase(active.begin() + static_cast<std::ptrdiff_t>(index));
+        if (cursor > index)
+            --cursor;
     }
 
     /**
-     * @brief Unpause the pool. The workers will resume retrieving new tasks out of the queue. Only enabled if the flag `BS:tp::pause` is enabled in the template parameter.
+     * @brief Execute a task of a queue, correct the deficit counter and the cost estimate of the queue using the measured execution time, and notify the waiting threads if the queue is done. Any exception thrown by the task is caught and discarded.
+     *
+     * @param queue The queue.
+     * @param task The task.
+     * @param charged The execution time the queue was charged in advance, in nanoseconds.
      */
-    BS_THREAD_POOL_IF_PAUSE_ENABLED
-    void unpause()
+    void execute(fair_queue_state& queue, small_task& task, const std::int64_t charged)
     {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#ifdef __cpp_exceptions
+        try
+        {
+#endif
+            task();
+#ifdef __cpp_exceptions
+        }
+        catch (...)
         {
-            const std::scoped_lock tasks_lock(tasks_mutex);
-            paused = false;
         }
-        task_available_cv.notify_all();
+#endif
+        const std::int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        // Destroy the task before marking it as finished, so that anything it captured is released by the time `wait()` returns.
+        task = small_task();
+        const std::scoped_lock lock(mutex);
+        queue.deficit += charged - elapsed;
+        queue.cost_estimate = std::max<std::int64_t>(((queue.cost_estimate * 7) + elapsed) / 8, 1);
+        --queue.running;
+        if (is_done(queue))
+            queue.done_cv.notify_all();
     }
 
     /**
-     * @brief Wait for tasks to be completed. Normally, this function waits for all tasks, both those that are currently running in the threads and those that are still waiting in the queue. However, if the pool is paused, this function only waits for the currently running tasks (otherwise it would wait forever). Note: To wait for just one specific task, use `submit_task()` instead, and call the `wait()` member function of the generated future.
+     * @brief Check whether a queue is done: none of its tasks are running, and either it has no tasks that have not started yet, or it is paused. The mutex must be locked.
      *
-     * @throws `wait_deadlock` if called from within a thread of the same pool, which would result in a deadlock. Only enabled if the flag `BS:tp::wait_deadlock_checks` is enabled in the template parameter.
+     * @param queue The queue.
+     * @return `true` if the queue is done, `false` otherwise.
      */
-    void wait()
+    [[nodiscard]] static bool is_done(const fair_queue_state& queue) noexcept
     {
-#ifdef __cpp_exceptions
-        if constexpr (wait_deadlock_checks_enabled)
-        {
-            if (this_thread::get_pool() == this)
-                throw wait_deadlock();
-        }
-#endif
-        std::unique_lock tasks_lock(tasks_mutex);
-        waiting = true;
-        tasks_done_cv.wait(tasks_lock,
-            [this]
-            {
-                if constexpr (pause_enabled)
-                    return (tasks_running == 0) && (paused || tasks.empty());
-                else
-                    return (tasks_running == 0) && tasks.empty();
-            });
-        waiting = false;
+        return (queue.running == 0) && (queue.paused || queue.pending.empty());
     }
 
     /**
-     * @brief Wait for tasks to be completed, but stop waiting after the specified duration has passed.
+     * @brief Take the oldest task of a queue that has not started yet out of the queue, and remove the queue from the list of active queues if it has no more tasks. The mutex must be locked, and the queue must be unpaused and not empty.
      *
-     * @tparam R An arithmetic type representing the number of ticks to wait.
-     * @tparam P An `std::ratio` representing the length of each tick in seconds.
-     * @param duration The amount of time to wait.
-     * @return `true` if all tasks finished running, `false` if the duration expired but some tasks are still running.
-     * @throws `wait_deadlock` if called from within a thread of the same pool, which would result in a deadlock. Only enabled if the flag `BS:tp::wait_deadlock_checks` is enabled in the template parameter.
+     * @param queue The queue.
+     * @return The task.
      */
-    template <typename R, typename P>
-    bool wait_for(const std::chrono::duration<R, P>& duration)
+    [[nodiscard]] small_task take_task(fair_queue_state& queue)
     {
-#ifdef __cpp_exceptions
-        if constexpr (wait_deadlock_checks_enabled)
-        {
-            if (this_thread::get_pool() == this)
-                throw wait_deadlock();
-        }
-#endif
-        std::unique_lock tasks_lock(tasks_mutex);
-        waiting = true;
-        const bool status = tasks_done_cv.wait_for(tasks_lock, duration,
-            [this]
-            {
-                if constexpr (pause_enabled)
-                    return (tasks_running == 0) && (paused || tasks.empty());
-                else
-                    return (tasks_running == 0) && tasks.empty();
-            });
-        waiting = false;
-        return status;
+        small_task task = std::move(queue.pending.front());
+        queue.pending.pop_front();
+        --ready;
+        ++queue.running;
+        if (queue.pending.empty())
+            deactivate(queue);
+        return task;
     }
 
     /**
-     * @brief Wait for tasks to be completed, but stop waiting after the specified time point has been reached.
+     * @brief The queues which have tasks ready to run, in round-robin order. A queue is always removed from this list before its state is destroyed, since `BS::fair_queue` purges its tasks when it is destructed.
+     */
+    std::vector<fair_queue_state*> active;
+
+    /**
+     * @brief The index in `active` of the queue whose turn it is.
+     */
+    std::size_t cursor = 0;
+
+    /**
+     * @brief The number of dispatch tasks destroyed without running which have not yet been subtracted from `dispatches`.
+     */
+    std::atomic<std::size_t> discarded_dispatches = 0;
+
+    /**
+     * @brief The number of dispatch tasks submitted to the pool that have not started yet. Kept at least equal to `ready`, so that every task which is ready to run has a thread of the pool coming for it.
+     */
+    std::size_t dispatches = 0;
+
+    /**
+     * @brief A mutex to synchronize access to all the queues and the counters.
+     */
+    mutable std::mutex mutex;
+
+    /**
+     * @brief The amount of execution time given to a queue of weight 1 in each round, in nanoseconds.
+     */
+    std::int64_t quantum;
+
+    /**
+     * @brief The number of tasks in unpaused queues that have not started yet.
+     */
+    std::size_t ready = 0;
+}; // class fair_scheduler_state
+
+/**
+ * @brief A class used to share the threads of a single thread pool between several `BS::fair_queue` objects, each representing a separate subsystem or tenant, instead of giving each of them its own pool and oversubscribing the CPU. The queues are scheduled using deficit round-robin weighted by execution time: whenever a thread of the pool becomes free, it runs the next task of the queue whose turn it is, and each queue's turn lasts until its tasks have used up its weight times the quantum, so when all the queues have tasks waiting, each of them receives a share of the threads' time proportional to its weight, regardless of how many tasks it submits or how long they take. Tasks submitted to the pool directly are scheduled by the pool as usual, alongside the scheduler's tasks.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
+ */
+template <opt_t OptFlags = tp::none>
+class [[nodiscard]] fair_scheduler
+{
+public:
+    /**
+     * @brief The default amount of execution time given to a queue of weight 1 in each round.
+     */
+    static constexpr std::chrono::nanoseconds default_quantum = std::chrono::milliseconds(1);
+
+    /**
+     * @brief Construct a new scheduler which runs the tasks of its queues in the given pool.
      *
-     * @tparam C The type of the clock used to measure time.
-     * @tparam D An `std::chrono::duration` type used to indicate the time point.
-     * @param timeout_time The time point at which to stop waiting.
-     * @return `true` if all tasks finished running, `false` if the time point was reached but some tasks are still running.
-     * @throws `wait_deadlock` if called from within a thread of the same pool, which would result in a deadlock. Only enabled if the flag `BS:tp::wait_deadlock_checks` is enabled in the template parameter.
+     * @param pool_ The thread pool which will execute the tasks. Must not be destroyed before the scheduler and its queues.
+     * @param quantum The amount of execution time given to a queue of weight 1 in each round. Smaller values interleave the queues more finely, larger values let each queue run longer stretches of tasks in a row. The default is `BS::fair_scheduler::default_quantum`, which is 1 millisecond.
+     * @param priority_ The priority of the tasks submitted to the pool on behalf of the scheduler. Should be between -128 and +127 (a signed 8-bit integer). The default is 0. Only taken into account if the flag `BS:tp::priority` is enabled in the template parameter of the pool, otherwise has no effect.
      */
-    template <typename C, typename D>
-    bool wait_until(const std::chrono::time_point<C, D>& timeout_time)
+    explicit fair_scheduler(thread_pool<OptFlags>& pool_, const std::chrono::nanoseconds quantum = default_quantum, const priority_t priority_ = 0) : pool(pool_), priority(priority_), state(std::make_shared<fair_scheduler_state>(std::max<std::int64_t>(quantum.count(), 1))) {}
+
+    // The copy and move constructors and assignment operators are deleted. The queues refer to the scheduler.
+    fair_scheduler(const fair_scheduler&) = delete;
+    fair_scheduler(fair_scheduler&&) = delete;
+    fair_scheduler& operator=(const fair_scheduler&) = delete;
+    fair_scheduler& operator=(fair_scheduler&&) = delete;
+    ~fair_scheduler() = default;
+
+    /**
+     * @brief Get the thread pool which executes the tasks of the scheduler.
+     *
+     * @return A reference to the pool.
+     */
+    [[nodiscard]] thread_pool<OptFlags>& get_pool() const noexcept
     {
-#ifdef __cpp_exceptions
-        if constexpr (wait_deadlock_checks_enabled)
-        {
-            if (this_thread::get_pool() == this)
-                throw wait_deadlock();
-        }
-#endif
-        std::unique_lock tasks_lock(tasks_mutex);
-        waiting = true;
-        const bool status = tasks_done_cv.wait_until(tasks_lock, timeout_time,
-            [this]
-            {
-                if constexpr (pause_enabled)
-                    return (tasks_running == 0) && (paused || tasks.empty());
-                else
-                    return (tasks_running == 0) && tasks.empty();
-            });
-        waiting = false;
-        return status;
+        return pool;
     }
 
 private:
-    // ========================
-    // Private member functions
-    // ========================
+    // `BS::fair_queue` uses the private members to add its tasks to the scheduler.
+    template <opt_t>
+    friend class fair_queue;
 
     /**
-     * @brief Create the threads in the pool and assign a worker to each thread.
-     *
-     * @param num_threads The number of threads to use.
-     * @param init An initialization function to run in each thread before it starts executing any submitted tasks.
+     * @brief A dispatch task submitted to the pool on behalf of the scheduler. If it is destroyed without having run, for example because the pool was purged, its destructor records that it was discarded, so that a replacement is submitted the next time a task is added to the scheduler, a queue is unpaused, or a queue is waited for.
      */
-    template <typename F>
-    void create_threads(const std::size_t num_threads, F&& init)
+    class [[nodiscard]] dispatch_task
     {
-        if constexpr (std::is_invocable_v<F, std::size_t>)
+    public:
+        /**
+         * @brief Construct a new dispatch task.
+         *
+         * @param state_ A shared pointer to the state of the scheduler.
+         */
+        explicit dispatch_task(std::shared_ptr<fair_scheduler_state> state_) noexcept : state(std::move(state_)) {}
+
+        // The copy constructor and assignment operators are deleted, and the move constructor leaves the moved-from object empty, so that each dispatch is counted exactly once.
+        dispatch_task(const dispatch_task&) = delete;
+        dispatch_task(dispatch_task&&) noexcept = default;
+        dispatch_task& operator=(const dispatch_task&) = delete;
+        dispatch_task& operator=(dispatch_task&&) = delete;
+
+        /**
+         * @brief Destruct the dispatch task. If it never ran, it is no longer counted.
+         */
+        ~dispatch_task()
         {
-            init_func = std::forward<F>(init);
+            if (state)
+                state->discard_dispatch();
         }
-        else
+
+        /**
+         * @brief Run the next task of the scheduler. `run_next()` removes the dispatch from the count itself.
+         */
+        void operator()()
         {
-            init_func = [init = std::forward<F>(init)](std::size_t)
-            {
-                init();
-            };
+            const std::shared_ptr<fair_scheduler_state> scheduler_state = std::move(state);
+            scheduler_state->run_next();
         }
-        thread_count = determine_thread_count(num_threads);
-        threads = std::make_unique<thread_t[]>(thread_count);
+
+    private:
+        /**
+         * @brief A shared pointer to the state of the scheduler, or an empty pointer once the dispatch has run or was moved from.
+         */
+        std::shared_ptr<fair_scheduler_state> state;
+    }; // class dispatch_task
+
+    /**
+     * @brief Submit dispatch tasks to the pool. If submitting one of them fails, the ones that were not submitted are cancelled and the exception is rethrown.
+     *
+     * @param count The number of dispatch tasks.
+     */
+    void submit_dispatches(const std::size_t count)
+    {
+        std::size_t submitted = 0;
+#ifdef __cpp_exceptions
+        try
         {
-            const std::scoped_lock tasks_lock(tasks_mutex);
-            tasks_running = thread_count;
-#ifndef __cpp_lib_jthread
-            workers_running = true;
 #endif
+            for (; submitted < count; ++submitted)
+            {
+                pool.detach_task(dispatch_task(state), priority);
+            }
+#ifdef __cpp_exceptions
         }
-        for (std::size_t i = 0; i < thread_count; ++i)
+        catch (...)
         {
-            threads[i] = thread_t(
-                [this, i]
-#ifdef __cpp_lib_jthread
-                (const std::stop_token& stop_token)
-                {
-                    worker(stop_token, i);
-                }
-#else
-                {
-                    worker(i);
-                }
-#endif
-            );
+            // The dispatch task that failed to be submitted has already been discarded in its destructor.
+            state->cancel_dispatches(count - submitted - 1);
+            throw;
         }
+#endif
     }
 
-#ifndef __cpp_lib_jthread
     /**
-     * @brief Destroy the threads in the pool.
+     * @brief The thread pool which executes the tasks.
      */
-    void destroy_threads()
-    {
-        {
-            const std::scoped_lock tasks_lock(tasks_mutex);
-            workers_running = false;
-        }
-        task_available_cv.notify_all();
-        for (std::size_t i = 0; i < thread_count; ++i)
-            threads[i].join();
-    }
-#endif
+    thread_pool<OptFlags>& pool;
 
     /**
-     * @brief Determine how many threads the pool should have, based on the parameter passed to the constructor or reset().
+     * @brief The priority of the tasks submitted to the pool on behalf of the scheduler.
+     */
+    priority_t priority;
+
+    /**
+     * @brief A shared pointer to the state of the scheduler, shared with the tasks submitted to the pool.
+     */
+    std::shared_ptr<fair_scheduler_state> state;
+}; // class fair_scheduler
+
+/**
+ * @brief A class representing one logical executor sharing the threads of a pool with other executors through a `BS::fair_scheduler`. Each queue keeps its own tasks, and has its own `wait()`, `purge()`, `pause()`, and `unpause()`, which only affect the tasks of that queue, as well as a weight which determines its share of the threads' time when several queues have tasks waiting. Within a queue, tasks start in the order they were submitted. If `wait()` is called from a thread of the same pool, the waiting thread runs the queue's tasks itself instead of blocking, as with `BS::task_group`. The destructor waits for all the tasks of the queue to finish, and discards any tasks left in a paused queue.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
+ */
+template <opt_t OptFlags = tp::none>
+class [[nodiscard]] fair_queue
+{
+public:
+    /**
+     * @brief Construct a new queue in the given scheduler.
      *
-     * @param num_threads The parameter passed to the constructor or `reset()`. If the parameter is a positive number, then the pool will be created with this number of threads. If the parameter is non-positive, or a parameter was not supplied (in which case it will have the default value of 0), then the pool will be created with the total number of hardware threads available, as obtained from `thread_t::hardware_concurrency()`. If the latter returns zero for some reason, then the pool will be created with just one thread.
-     * @return The number of threads to use for constructing the pool.
+     * @param scheduler_ The scheduler which dispatches the tasks of the queue. Must not be destroyed before the queue.
+     * @param weight The weight of the queue. A queue with weight 2 receives twice as much of the threads' time as a queue with weight 1, when both have tasks waiting. A weight of 0 is treated as 1. The default is 1.
      */
-    [[nodiscard]] static std::size_t determine_thread_count(const std::size_t num_threads) noexcept
+    explicit fair_queue(fair_scheduler<OptFlags>& scheduler_, const std::uint32_t weight = 1) : scheduler(scheduler_), queue(scheduler_.state->add_queue(std::max<std::uint32_t>(weight, 1))) {}
+
+    // The copy and move constructors and assignment operators are deleted. The scheduler refers to the state of the queue.
+    fair_queue(const fair_queue&) = delete;
+    fair_queue(fair_queue&&) = delete;
+    fair_queue& operator=(const fair_queue&) = delete;
+    fair_queue& operator=(fair_queue&&) = delete;
+
+    /**
+     * @brief Destruct the queue, waiting for all of its tasks to finish first, or if it is paused, waiting for its running tasks to finish and discarding the rest.
+     */
+    ~fair_queue()
     {
-        if (num_threads > 0)
-            return num_threads;
-        if (thread_t::hardware_concurrency() > 0)
-            return thread_t::hardware_concurrency();
-        return 1;
+        wait();
+        purge();
     }
 
     /**
-     * @brief Pop a task from the queue.
+     * @brief Submit a function with no arguments and no return value to the queue. To submit a function with arguments, enclose it in a lambda expression. Any exception thrown by the function is caught and discarded.
      *
-     * @return The task.
+     * @tparam F The type of the function.
+     * @param task The function to submit.
      */
-    [[nodiscard]] task_t pop_task()
+    template <typename F>
+    void detach_task(F&& task)
     {
-        task_t task;
-        if constexpr (priority_enabled)
-            task = std::move(const_cast<pr_task&>(tasks.top()).task);
-        else
-            task = std::move(tasks.front());
-        tasks.pop();
-        return task;
+        const std::size_t needed = scheduler.state->push(*queue, small_task(std::forward<F>(task)));
+        if (needed == 0)
+            return;
+#ifdef __cpp_exceptions
+        try
+        {
+#endif
+            scheduler.submit_dispatches(needed);
+#ifdef __cpp_exceptions
+        }
+        catch (...)
+        {
+            scheduler.state->pop_back(*queue);
+            throw;
+        }
+#endif
     }
 
     /**
-     * @brief Reset the pool with a new number of threads and a new initialization function. This member function implements the actual reset, while the public member function `reset()` also handles the case where the pool is paused.
+     * @brief Get the number of tasks of the queue that have not started yet.
      *
-     * @param num_threads The number of threads to use.
-     * @param init An initialization function to run in each thread before it starts executing any submitted tasks.
+     * @return The number of queued tasks.
      */
-    template <typename F>
-    void reset_pool(const std::size_t num_threads, F&& init)
+    [[nodiscard]] std::size_t get_tasks_queued() const
     {
-        wait();
-#ifndef __cpp_lib_jthread
-        destroy_threads();
-#endif
-        create_threads(num_threads, std::forward<F>(init));
+        return scheduler.state->get_tasks_queued(*queue);
     }
 
     /**
-     * @brief A worker function to be assigned to each thread in the pool. Waits until it is notified by `detach_task()` that a task is available, and then retrieves the task from the queue and executes it. Once the task finishes, the worker notifies `wait()` in case it is waiting.
+     * @brief Get the number of tasks of the queue that are currently running.
      *
-     * @param idx The index of this thread.
+     * @return The number of running tasks.
      */
-    void worker(BS_THREAD_POOL_WORKER_TOKEN const std::size_t idx)
+    [[nodiscard]] std::size_t get_tasks_running() const
     {
-        this_thread::my_pool = this;
-        this_thread::my_index = idx;
-        init_func(idx);
-        while (true)
-        {
-            std::unique_lock tasks_lock(tasks_mutex);
-            --tasks_running;
-            if constexpr (pause_enabled)
-            {
-                if (waiting && (tasks_running == 0) && (paused || tasks.empty()))
-                    tasks_done_cv.notify_all();
-            }
-            else
-            {
-                if (waiting && (tasks_running == 0) && tasks.empty())
-                    tasks_done_cv.notify_all();
-            }
-            task_available_cv.wait(tasks_lock BS_THREAD_POOL_WAIT_TOKEN,
-                [this]
-                {
-                    if constexpr (pause_enabled)
-                        return !(paused || tasks.empty()) BS_THREAD_POOL_OR_STOP_CONDITION;
-                    else
-                        return !tasks.empty() BS_THREAD_POOL_OR_STOP_CONDITION;
-                });
-            if (BS_THREAD_POOL_STOP_CONDITION)
-                break;
-            {
-                task_t task = pop_task(); // NOLINT(misc-const-correctness) In C++23 this cannot be const since `std::move_only_function::operator()` is not a const member function.
-                ++tasks_running;
-                tasks_lock.unlock();
-#ifdef __cpp_exceptions
-                try
-                {
-#endif
-                    task();
-#ifdef __cpp_exceptions
-                }
-                catch (...)
-                {
-                }
-#endif
-            }
-        }
-        cleanup_func(idx);
-        this_thread::my_index = std::nullopt;
-        this_thread::my_pool = std::nullopt;
+        return scheduler.state->get_tasks_running(*queue);
     }
 
-    // ============
-    // Private data
-    // ============
+    /**
+     * @brief Get the total number of unfinished tasks of the queue: either still waiting to start, or running.
+     *
+     * @return The total number of tasks.
+     */
+    [[nodiscard]] std::size_t get_tasks_total() const
+    {
+        return scheduler.state->get_tasks_total(*queue);
+    }
 
     /**
-     * @brief A cleanup function to run in each thread right before it is destroyed, which will happen when the pool is destructed or reset. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. The cleanup function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function. The default is an empty function, i.e., no cleanup will be performed.
+     * @brief Get the weight of the queue.
+     *
+     * @return The weight.
      */
-    function_t<void(std::size_t)> cleanup_func = [](std::size_t) {};
+    [[nodiscard]] std::uint32_t get_weight() const
+    {
+        return scheduler.state->get_weight(*queue);
+    }
 
     /**
-     * @brief An initialization function to run in each thread before it starts executing any submitted tasks. The function must have no return value, and can either take one argument, the thread index of type `std::size_t`, or zero arguments. It will be executed exactly once per thread, when the thread is first constructed. The initialization function must not throw any exceptions, as that will result in program termination. Any exceptions must be handled explicitly within the function. The default is an empty function, i.e., no initialization will be performed.
+     * @brief Check whether the queue is currently paused.
+     *
+     * @return `true` if the queue is paused, `false` if it is not paused.
      */
-    function_t<void(std::size_t)> init_func = [](std::size_t) {};
+    [[nodiscard]] bool is_paused() const
+    {
+        return scheduler.state->is_paused(*queue);
+    }
 
     /**
-     * @brief A flag indicating whether the workers should pause. When set to `true`, the workers temporarily stop retrieving new tasks out of the queue, although any tasks already executed will keep running until they are finished. When set to `false` again, the workers resume retrieving tasks. Only enabled if the flag `BS:tp::pause` is enabled in the template parameter.
+     * @brief Pause the queue. Its tasks that have not started yet will not be started until the queue is unpaused, although any tasks already running will keep running until they are finished. The other queues of the scheduler are not affected, and receive the threads' time that the paused queue would otherwise use.
      */
-    std::conditional_t<pause_enabled, bool, std::monostate> paused = {};
+    void pause()
+    {
+        scheduler.state->pause(*queue);
+    }
 
-/**
- * @brief A condition variable to notify `worker()` that a new task has become available.
- */
-#ifdef __cpp_lib_jthread
-    std::condition_variable_any
-#else
-    std::condition_variable
-#endif
-        task_available_cv;
+    /**
+     * @brief Discard all the tasks of the queue that have not started yet. Tasks that are currently running are not affected. The futures of discarded tasks submitted using `submit_task()` will throw `std::future_error` with the error code `std::future_errc::broken_promise`.
+     *
+     * @return The number of discarded tasks.
+     */
+    std::size_t purge()
+    {
+        return scheduler.state->purge(*queue);
+    }
 
     /**
-     * @brief A condition variable to notify `wait()` that the tasks are done.
+     * @brief Change the weight of the queue. Takes effect from the next round.
+     *
+     * @param weight The new weight. A weight of 0 is treated as 1.
      */
-    std::condition_variable tasks_done_cv;
+    void set_weight(const std::uint32_t weight)
+    {
+        scheduler.state->set_weight(*queue, std::max<std::uint32_t>(weight, 1));
+    }
 
     /**
-     * @brief A queue of tasks to be executed by the threads.
+     * @brief Submit a function with no arguments to the queue, and get a future for its returned value. To submit a function with arguments, enclose it in a lambda expression.
+     *
+     * @tparam F The type of the function.
+     * @tparam R The return type of the function (can be `void`).
+     * @param task The function to submit.
+     * @return A future to be used later to wait for the function to finish executing and/or obtain its returned value if it has one.
      */
-    std::conditional_t<priority_enabled, std::priority_queue<pr_task>, std::queue<task_t>> tasks;
+    template <typename F, typename R = std::invoke_result_t<std::decay_t<F>>>
+    [[nodiscard]] std::future<R> submit_task(F&& task)
+    {
+        std::promise<R> promise;
+        std::future<R> future = promise.get_future();
+        detach_task(thread_pool<OptFlags>::template make_promise_task<R>(std::forward<F>(task), std::move(promise)));
+        return future;
+    }
 
     /**
-     * @brief A mutex to synchronize access to the task queue by different threads.
+     * @brief Unpause the queue. Its tasks that have not started yet will be scheduled again.
      */
-    mutable std::mutex tasks_mutex;
+    void unpause()
+    {
+        scheduler.submit_dispatches(scheduler.state->unpause(*queue));
+    }
 
     /**
-     * @brief A counter for the total number of currently running tasks.
+     * @brief Wait for the tasks of the queue to finish, including tasks submitted while waiting. If the queue is paused, only waits for the currently running tasks. Tasks of other queues, or submitted to the pool directly, are not waited for. If called from a thread of the same pool, the calling thread runs the tasks of the queue that have not started yet, and only blocks once all of them have started; if the flag `BS::tp::elastic` is enabled, it blocks inside a `BS::this_thread::blocking_region`. Must not be called from a task of the same queue, as that task would wait for itself.
      */
-    std::size_t tasks_running = 0;
+    void wait()
+    {
+        const bool help = this_thread::get_pool() == &scheduler.pool;
+        scheduler.submit_dispatches(scheduler.state->replace_dispatches());
+        scheduler.state->wait(*queue, help,
+            [help](std::unique_lock<std::mutex>& lock, std::condition_variable& done_cv)
+            {
+                block(help,
+                    [&lock, &done_cv]
+                    {
+                        done_cv.wait(lock);
+                    });
+                return true;
+            });
+    }
 
     /**
-     * @brief The number of threads in the pool.
+     * @brief Wait for the tasks of the queue to finish, but stop waiting after the specified duration has passed. If called from a thread of the same pool, the calling thread runs the tasks of the queue that have not started yet while waiting, as in `wait()`, so it may return later than the specified duration if such a task takes longer.
+     *
+     * @tparam R An arithmetic type representing the number of ticks to wait.
+     * @tparam P An `std::ratio` representing the length of each tick in seconds.
+     * @param duration The amount of time to wait.
+     * @return `true` if the tasks finished before the duration expired, `false` otherwise.
      */
-    std::size_t thread_count = 0;
+    template <typename R, typename P>
+    bool wait_for(const std::chrono::duration<R, P>& duration)
+    {
+        return wait_until(std::chrono::steady_clock::now() + duration);
+    }
 
     /**
-     * @brief A smart pointer to manage the memory allocated for the threads.
+     * @brief Wait for the tasks of the queue to finish, but stop waiting after the specified time point has been reached. If called from a thread of the same pool, the calling thread runs the tasks of the queue that have not started yet while waiting, as in `wait()`, so it may return later than the specified time point if such a task takes longer.
+     *
+     * @tparam C The type of the clock used to measure time.
+     * @tparam D An `std::chrono::duration` type used to indicate the time point.
+     * @param timeout_time The time point at which to stop waiting.
+     * @return `true` if the tasks finished before the time point was reached, `false` otherwise.
      */
-    std::unique_ptr<thread_t[]> threads = nullptr;
+    template <typename C, typename D>
+    bool wait_until(const std::chrono::time_point<C, D>& timeout_time)
+    {
+        const bool help = this_thread::get_pool() == &scheduler.pool;
+        scheduler.submit_dispatches(scheduler.state->replace_dispatches());
+        return scheduler.state->wait(*queue, help,
+            [help, &timeout_time](std::unique_lock<std::mutex>& lock, std::condition_variable& done_cv)
+            {
+                bool awakened = true;
+                block(help,
+                    [&lock, &done_cv, &timeout_time, &awakened]
+                    {
+                        awakened = done_cv.wait_until(lock, timeout_time) == std::cv_status::no_timeout;
+                    });
+                return awakened;
+            });
+    }
+
+private:
+    /**
+     * @brief Block the calling thread, inside a `BS::this_thread::blocking_region` if it is a thread of the pool, so that an elastic pool can start another thread to replace it.
+     *
+     * @tparam F The type of the function that blocks.
+     * @param in_pool Whether the calling thread is a thread of the pool.
+     * @param func The function that blocks.
+     */
+    template <typename F>
+    static void block(const bool in_pool, F&& func)
+    {
+        if (in_pool)
+        {
+            const this_thread::blocking_region region;
+            func();
+        }
+        else
+        {
+            func();
+        }
+    }
 
     /**
-     * @brief A flag indicating that `wait()` is active and expects to be notified whenever a task is done.
+     * @brief The scheduler which dispatches the tasks of the queue.
      */
-    bool waiting = false;
+    fair_scheduler<OptFlags>& scheduler;
 
-#ifndef __cpp_lib_jthread
     /**
-     * @brief A flag indicating to the workers to keep running. When set to `false`, the workers terminate permanently.
+     * @brief A shared pointer to the state of the queue.
      */
-    bool workers_running = false;
-#endif
-}; // class thread_pool
+    std::shared_ptr<fair_queue_state> queue;
+}; // class fair_queue
 
 /**
- * @brief A utility class to synchronize printing to an output stream by different threads.
+ * @brief A utility class to synchronize printing to an output stream by different threads. By default, each call to `print()` or `println()` locks a mutex and writes directly to the streams. In buffered mode, enabled using `start_buffering()`, each call instead formats the items into a buffer owned by the calling thread, and appends the result to a shared buffer of pending output, which a background thread writes to the streams in batches, so that threads printing at the same time only contend for the short time it takes to append their output.
  */
 class [[nodiscard]] synced_stream
 {
 public:
+    /**
+     * @brief The policies for what to do in buffered mode if the pending output does not have room for more, because the streams cannot keep up with the threads printing to them.
+     */
+    enum class overflow_policy
+    {
+        /**
+         * @brief Block the printing thread until the background thread makes room.
+         */
+        block,
+
+        /**
+         * @brief Discard the output of the printing thread, and count it using `get_dropped()`.
+         */
+        drop
+    };
+
+    /**
+     * @brief The default maximum number of bytes of pending output in buffered mode.
+     */
+    static constexpr std::size_t default_buffer_capacity = static_cast<std::size_t>(1) << 20U;
+
     /**
      * @brief Construct a new synced stream which prints to `std::cout`.
      */
@@ -2141,6 +9725,20 @@ public:
         (add_stream(streams), ...);
     }
 
+    // The copy and move constructors and assignment operators are deleted. The synced stream may own a background thread which refers to it.
+    synced_stream(const synced_stream&) = delete;
+    synced_stream(synced_stream&&) = delete;
+    synced_stream& operator=(const synced_stream&) = delete;
+    synced_stream& operator=(synced_stream&&) = delete;
+
+    /**
+     * @brief Destruct the synced stream. If buffered mode is enabled, all the pending output is written to the streams first.
+     */
+    ~synced_stream()
+    {
+        stop_buffering();
+    }
+
     /**
      * @brief Add a stream to the list of output streams to print to.
      *
@@ -2151,6 +9749,39 @@ public:
         out_streams.push_back(&stream);
     }
 
+    /**
+     * @brief Write all the output printed so far to the streams, and flush them. In buffered mode, blocks until the background thread has written and flushed all the output that was pending when this function was called. Otherwise, just flushes the streams. (This function is not named `flush()`, since that name is used by the stream manipulator `BS::synced_stream::flush`.)
+     */
+    void flush_buffers()
+    {
+        if (!buffered.load(std::memory_order_acquire))
+        {
+            const std::scoped_lock stream_lock(stream_mutex);
+            for (std::ostream* const stream : out_streams)
+                stream->flush();
+            return;
+        }
+        std::unique_lock buffer_lock(buffer_mutex);
+        const std::uint64_t request = ++flush_requests;
+        flusher_cv.notify_one();
+        space_cv.wait(buffer_lock,
+            [this, request]
+            {
+                return flushes_done >= request;
+            });
+    }
+
+    /**
+     * @brief Get the number of calls to `print()` or `println()` whose output was discarded in buffered mode because the pending output was full and the overflow policy is `BS::synced_stream::overflow_policy::drop`.
+     *
+     * @return The number of discarded calls.
+     */
+    [[nodiscard]] std::size_t get_dropped() const
+    {
+        const std::scoped_lock buffer_lock(buffer_mutex);
+        return dropped;
+    }
+
     /**
      * @brief Get a reference to a vector containing pointers to the output streams to print to.
      *
@@ -2162,7 +9793,17 @@ public:
     }
 
     /**
-     * @brief Print any number of items into the output stream. Ensures that no other threads print to this stream simultaneously, as long as they all exclusively use the same `BS::synced_stream` object to print.
+     * @brief Check whether buffered mode is enabled.
+     *
+     * @return `true` if buffered mode is enabled, `false` otherwise.
+     */
+    [[nodiscard]] bool is_buffered() const noexcept
+    {
+        return buffered.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Print any number of items into the output stream. Ensures that no other threads print to this stream simultaneously, as long as they all exclusively use the same `BS::synced_stream` object to print. In buffered mode, the items are formatted into a buffer owned by the calling thread, and the output is then written to the streams as one piece by the background thread; any formatting state set by manipulators such as `std::setprecision` applies to the calling thread's later calls, in all buffered synced streams, rather than to the streams themselves. If one of the items is `BS::synced_stream::endl` or `BS::synced_stream::flush`, the background thread flushes the streams after writing the output, but this function does not wait for it; use `flush_buffers()` to wait.
      *
      * @tparam T The types of the items.
      * @param items The items to print.
@@ -2170,6 +9811,16 @@ public:
     template <typename... T>
     void print(const T&... items)
     {
+        if (buffered.load(std::memory_order_acquire))
+        {
+            line_formatter& formatter = get_formatter();
+            // The output is appended to the end of the thread's buffer, and removed once it has been pushed, so that an item whose `operator<<` prints to a synced stream itself does not overwrite the output of this call.
+            const std::size_t start = formatter.buffer.text.size();
+            (formatter.stream << ... << items);
+            push_output(std::string_view(formatter.buffer.text).substr(start), (is_flush_manipulator(items) || ...));
+            formatter.buffer.text.resize(start);
+            return;
+        }
         const std::scoped_lock stream_lock(stream_mutex);
         for (std::ostream* const stream : out_streams)
             (*stream << ... << items);
@@ -2197,6 +9848,55 @@ public:
         out_streams.erase(std::remove(out_streams.begin(), out_streams.end(), &stream), out_streams.end());
     }
 
+    /**
+     * @brief Enable buffered mode, starting the background thread which writes the pending output to the streams, or change the capacity and overflow policy if it is already enabled. The output of each call to `print()` or `println()` is still written to the streams as one piece, in the order in which the calls appended it, but the calls return without waiting for it to be written. Streams must not be added or removed while buffered mode is enabled. Enabling buffered mode while other threads are printing is allowed, but their calls may end up on either side of the transition.
+     *
+     * @param capacity The maximum number of bytes of pending output. The output of a single call is always accepted if nothing else is pending, even if it is larger than the capacity. The default is `BS::synced_stream::default_buffer_capacity`, which is 1 MiB.
+     * @param policy What to do if the pending output is full. The default is `BS::synced_stream::overflow_policy::block`.
+     */
+    void start_buffering(const std::size_t capacity = default_buffer_capacity, const overflow_policy policy = overflow_policy::block)
+    {
+        {
+            const std::scoped_lock buffer_lock(buffer_mutex);
+            buffer_capacity = capacity;
+            buffer_policy = policy;
+        }
+        if (buffered.load(std::memory_order_acquire))
+        {
+            // Threads blocked waiting for room may now have room.
+            space_cv.notify_all();
+            return;
+        }
+        // Any output printed directly before buffered mode is enabled is written before the background thread starts writing.
+        const std::scoped_lock stream_lock(stream_mutex);
+        flusher = std::thread(
+            [this]
+            {
+                flush_pending();
+            });
+        buffered.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Disable buffered mode: write all the pending output to the streams, flush them, and stop the background thread. Does nothing if buffered mode is not enabled. Must not be called while other threads are printing.
+     */
+    void stop_buffering()
+    {
+        if (!buffered.load(std::memory_order_acquire))
+            return;
+        {
+            const std::scoped_lock buffer_lock(buffer_mutex);
+            stopping = true;
+        }
+        flusher_cv.notify_one();
+        flusher.join();
+        buffered.store(false, std::memory_order_release);
+        const std::scoped_lock buffer_lock(buffer_mutex);
+        stopping = false;
+        flushes_done = flush_requests;
+        space_cv.notify_all();
+    }
+
     /**
      * @brief A stream manipulator to pass to a `BS::synced_stream` (an explicit cast of `std::endl`). Prints a newline character to the stream, and then flushes it. Should only be used if flushing is desired, otherwise a newline character should be used instead.
      */
@@ -2208,15 +9908,222 @@ public:
     inline static std::ostream& (&flush)(std::ostream&) = static_cast<std::ostream& (&)(std::ostream&)>(std::flush);
 
 private:
+    /**
+     * @brief A stream buffer which appends everything written to it to a string, used to format the output of a thread in buffered mode without allocating memory once the string is large enough.
+     */
+    class line_buffer : public std::streambuf
+    {
+    public:
+        /**
+         * @brief The formatted output.
+         */
+        std::string text;
+
+    protected:
+        /**
+         * @brief Append a single character.
+         *
+         * @param ch The character.
+         * @return The character, or `traits_type::eof()` if it is the end-of-file marker.
+         */
+        int_type overflow(const int_type ch) override
+        {
+            if (traits_type::eq_int_type(ch, traits_type::eof()))
+                return traits_type::eof();
+            text.push_back(traits_type::to_char_type(ch));
+            return ch;
+        }
+
+        /**
+         * @brief Append a sequence of characters.
+         *
+         * @param str A pointer to the characters.
+         * @param count The number of characters.
+         * @return The number of characters appended.
+         */
+        std::streamsize xsputn(const char* const str, const std::streamsize count) override
+        {
+            text.append(str, static_cast<std::size_t>(count));
+            return count;
+        }
+    }; // class line_buffer
+
+    /**
+     * @brief The buffer and stream used by a thread to format its output in buffered mode.
+     */
+    struct line_formatter
+    {
+        line_buffer buffer;
+        std::ostream stream{&buffer};
+    }; // struct line_formatter
+
+    /**
+     * @brief Get the formatter of the current thread. There is one per thread, shared by all the synced streams, since it is only used while a call to `print()` is formatting its items.
+     *
+     * @return A reference to the formatter.
+     */
+    [[nodiscard]] static line_formatter& get_formatter()
+    {
+        thread_local line_formatter formatter;
+        return formatter;
+    }
+
+    /**
+     * @brief Check whether an item passed to `print()` is one of the manipulators `BS::synced_stream::endl` or `BS::synced_stream::flush`.
+     *
+     * @tparam T The type of the item.
+     * @param item The item.
+     * @return `true` if the item is a flushing manipulator, `false` otherwise.
+     */
+    template <typename T>
+    [[nodiscard]] static bool is_flush_manipulator([[maybe_unused]] const T& item) noexcept
+    {
+        using manipulator_t = std::ostream& (*)(std::ostream&);
+        if constexpr (std::is_same_v<std::decay_t<T>, manipulator_t>)
+            return (static_cast<manipulator_t>(item) == &endl) || (static_cast<manipulator_t>(item) == &flush);
+        else
+            return false;
+    }
+
+    /**
+     * @brief Append the output of a call to `print()` to the pending output in buffered mode, and wake up the background thread if there was nothing pending before. If the pending output does not have room, either waits for room or discards the output, according to the overflow policy.
+     *
+     * @param text The output.
+     * @param flush_after Whether the streams should be flushed after the output is written.
+     */
+    void push_output(const std::string_view text, const bool flush_after)
+    {
+        std::unique_lock buffer_lock(buffer_mutex);
+        const auto has_room = [this, &text]
+        {
+            return pending.empty() || (pending.size() + text.size() <= buffer_capacity);
+        };
+        if (!has_room())
+        {
+            if (buffer_policy == overflow_policy::drop)
+            {
+                ++dropped;
+                return;
+            }
+            space_cv.wait(buffer_lock, has_room);
+        }
+        const bool was_idle = pending.empty();
+        pending.append(text);
+        if (flush_after)
+            ++flush_requests;
+        buffer_lock.unlock();
+        // If something was already pending, the background thread has already been woken up, and will take this output together with it.
+        if (was_idle)
+            flusher_cv.notify_one();
+    }
+
+    /**
+     * @brief The function run by the background thread in buffered mode. Repeatedly takes all the pending output at once, writes it to each stream using a single call to `write()`, and flushes the streams if requested, until buffered mode is disabled and nothing is left pending.
+     */
+    void flush_pending()
+    {
+        std::string batch;
+        std::unique_lock buffer_lock(buffer_mutex);
+        while (true)
+        {
+            flusher_cv.wait(buffer_lock,
+                [this]
+                {
+                    return !pending.empty() || (flush_requests != flushes_done) || stopping;
+                });
+            if (pending.empty() && (flush_requests == flushes_done) && stopping)
+                break;
+            // Swapping the strings hands the capacity of the previous batch back to the printing threads, so once both strings are large enough, no more memory is allocated.
+            batch.swap(pending);
+            const std::uint64_t requests = flush_requests;
+            const bool flush_streams = stopping || (requests != flushes_done);
+            buffer_lock.unlock();
+            space_cv.notify_all();
+            {
+                const std::scoped_lock stream_lock(stream_mutex);
+                for (std::ostream* const stream : out_streams)
+                {
+                    stream->write(batch.data(), static_cast<std::streamsize>(batch.size()));
+                    if (flush_streams)
+                        stream->flush();
+                }
+            }
+            batch.clear();
+            buffer_lock.lock();
+            flushes_done = requests;
+            space_cv.notify_all();
+        }
+    }
+
     /**
      * @brief The output streams to print to.
      */
     std::vector<std::ostream*> out_streams;
 
     /**
-     * @brief A mutex to synchronize printing.
+     * @brief A mutex to synchronize printing. In buffered mode, it is only locked by the background thread.
      */
     mutable std::mutex stream_mutex;
+
+    /**
+     * @brief A flag indicating whether buffered mode is enabled.
+     */
+    std::atomic<bool> buffered = false;
+
+    /**
+     * @brief A mutex to synchronize access to the pending output and the other members used in buffered mode.
+     */
+    mutable std::mutex buffer_mutex;
+
+    /**
+     * @brief A condition variable to wake up the background thread when output is pending, a flush is requested, or buffered mode is disabled.
+     */
+    std::condition_variable flusher_cv;
+
+    /**
+     * @brief A condition variable to notify threads waiting for room in the pending output, or for a flush to finish, that the background thread has taken a batch or finished writing one.
+     */
+    std::condition_variable space_cv;
+
+    /**
+     * @brief The output appended by the printing threads that the background thread has not taken yet.
+     */
+    std::string pending;
+
+    /**
+     * @brief The maximum number of bytes of pending output.
+     */
+    std::size_t buffer_capacity = default_buffer_capacity;
+
+    /**
+     * @brief What to do if the pending output is full.
+     */
+    overflow_policy buffer_policy = overflow_policy::block;
+
+    /**
+     * @brief The number of calls whose output was discarded because the pending output was full.
+     */
+    std::size_t dropped = 0;
+
+    /**
+     * @brief The number of flushes requested so far, either by `flush_buffers()` or by printing a flushing manipulator.
+     */
+    std::uint64_t flush_requests = 0;
+
+    /**
+     * @brief The number of requested flushes that the background thread has carried out, that is, the value of `flush_requests` when it took the last batch that it finished writing.
+     */
+    std::uint64_t flushes_done = 0;
+
+    /**
+     * @brief A flag indicating to the background thread to write the remaining pending output and stop.
+     */
+    bool stopping = false;
+
+    /**
+     * @brief The background thread which writes the pending output in buffered mode.
+     */
+    std::thread flusher;
 }; // class synced_stream
 
 #ifdef __cpp_lib_semaphore
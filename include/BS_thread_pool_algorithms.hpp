@@ -0,0 +1,468 @@
+/**
+ * ██████  ███████       ████████ ██   ██ ██████  ███████  █████  ██████          ██████   ██████   ██████  ██
+ * ██   ██ ██      ██ ██    ██    ██   ██ ██   ██ ██      ██   ██ ██   ██         ██   ██ ██    ██ ██    ██ ██
+ * ██████  ███████          ██    ███████ ██████  █████   ███████ ██   ██         ██████  ██    ██ ██    ██ ██
+ * ██   ██      ██ ██ ██    ██    ██   ██ ██   ██ ██      ██   ██ ██   ██         ██      ██    ██ ██    ██ ██
+ * ██████  ███████          ██    ██   ██ ██   ██ ███████ ██   ██ ██████  ███████ ██       ██████   ██████  ███████
+ *
+ * @file BS_thread_pool_algorithms.hpp
+ * @author Barak Shoshany (baraksh@gmail.com) (https://baraksh.com/)
+ * @version 5.0.0
+ * @date 2024-12-19
+ * @copyright Copyright (c) 2024 Barak Shoshany. Licensed under the MIT license. If you found this project useful, please consider starring it on GitHub! If you use this library in software of any kind, please provide a link to the GitHub repository https://github.com/bshoshany/thread-pool in the source code and documentation. If you use this library in published research, please cite it as follows: Barak Shoshany, "A C++17 Thread Pool for High-Performance Scientific Computing", doi:10.1016/j.softx.2024.101687, SoftwareX 26 (2024) 101687, arXiv:2105.00613
+ *
+ * @brief `BS::thread_pool`: a fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool library. This optional companion header file contains parallel versions of some of the Standard Library algorithms, which run on a user-supplied thread pool. It is not needed in order to use the thread pool itself.
+ */
+
+#ifndef BS_THREAD_POOL_ALGORITHMS_HPP
+#define BS_THREAD_POOL_ALGORITHMS_HPP
+
+#include "BS_thread_pool.hpp"
+
+// If the thread pool library imported the C++ Standard Library as a module, the macro `BS_THREAD_POOL_IMPORT_STD` will still be defined at this point, and we do not need to include anything. Otherwise, it has been undefined by the main header file, and we include the Standard Library header files needed by the algorithms.
+#ifndef BS_THREAD_POOL_IMPORT_STD
+    #include <algorithm>
+    #include <cstddef>
+    #include <functional>
+    #include <iterator>
+    #include <numeric>
+    #include <type_traits>
+    #include <utility>
+    #include <vector>
+#endif
+
+/**
+ * @brief A namespace containing parallel versions of some of the Standard Library algorithms. Each algorithm takes a reference to a `BS::thread_pool` as its first argument, followed by the same arguments as the corresponding Standard Library algorithm. The range is divided into as many blocks as there are threads in the pool using the same logic as `submit_blocks()`, and all the blocks are submitted as a single batch, so idle threads (including, if the flag `BS::tp::work_stealing` is enabled, threads stealing from each other's queues) pick them up as soon as they become available. Each algorithm only returns once all of its blocks have finished executing, and rethrows the first exception thrown by any of them, if any. The iterators must be random-access iterators. Since each algorithm waits for its own tasks, it must not be called from within a thread of the same pool, otherwise it may deadlock.
+ */
+namespace BS::parallel {
+/**
+ * @brief Apply a function to every element in a range, in parallel. Equivalent to `std::for_each()`, except that the order in which the elements are visited is unspecified.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
+ * @tparam It The type of the iterators. Must be a random-access iterator.
+ * @tparam F The type of the function.
+ * @param pool The thread pool to use.
+ * @param first An iterator to the first element in the range.
+ * @param last An iterator to the element after the last element in the range.
+ * @param func The function to apply. Should take exactly one argument, a reference to an element. It will be called concurrently from multiple threads.
+ */
+template <opt_t OptFlags, typename It, typename F>
+void for_each(thread_pool<OptFlags>& pool, const It first, const It last, F&& func)
+{
+    using D = typename std::iterator_traits<It>::difference_type;
+    multi_future<void> futures = pool.submit_blocks(static_cast<D>(0), std::distance(first, last),
+        [first, &func](const D start, const D end)
+        {
+            std::for_each(first + start, first + end, func);
+        });
+    futures.get();
+}
+
+/**
+ * @brief Apply a unary operation to every element in a range and store the results in another range, in parallel. Equivalent to `std::transform()`.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
+ * @tparam InIt The type of the input iterators. Must be a random-access iterator.
+ * @tparam OutIt The type of the output iterator. Must be a random-access iterator.
+ * @tparam F The type of the operation.
+ * @param pool The thread pool to use.
+ * @param first An iterator to the first element in the input range.
+ * @param last An iterator to the element after the last element in the input range.
+ * @param d_first An iterator to the first element in the output range, which must be at least as large as the input range. May be equal to `first`.
+ * @param op The operation to apply. Should take exactly one argument, an element of the input range, and return a value that can be assigned to an element of the output range. It will be called concurrently from multiple threads.
+ * @return An iterator to the element after the last element written.
+ */
+template <opt_t OptFlags, typename InIt, typename OutIt, typename F>
+OutIt transform(thread_pool<OptFlags>& pool, const InIt first, const InIt last, const OutIt d_first, F&& op)
+{
+    using D = typename std::iterator_traits<InIt>::difference_type;
+    const D size = std::distance(first, last);
+    multi_future<void> futures = pool.submit_blocks(static_cast<D>(0), size,
+        [first, d_first, &op](const D start, const D end)
+        {
+            std::transform(first + start, first + end, d_first + start, op);
+        });
+    futures.get();
+    return d_first + size;
+}
+
+/**
+ * @brief Apply a binary operation to every pair of corresponding elements in two ranges and store the results in another range, in parallel. Equivalent to the binary overload of `std::transform()`.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
+ * @tparam InIt1 The type of the iterators of the first input range. Must be a random-access iterator.
+ * @tparam InIt2 The type of the iterator of the second input range. Must be a random-access iterator.
+ * @tparam OutIt The type of the output iterator. Must be a random-access iterator.
+ * @tparam F The type of the operation.
+ * @param pool The thread pool to use.
+ * @param first1 An iterator to the first element in the first input range.
+ * @param last1 An iterator to the element after the last element in the first input range.
+ * @param first2 An iterator to the first element in the second input range, which must be at least as large as the first input range.
+ * @param d_first An iterator to the first element in the output range, which must be at least as large as the first input range. May be equal to `first1` or `first2`.
+ * @param op The operation to apply. Should take exactly two arguments, an element of each of the input ranges, and return a value that can be assigned to an element of the output range. It will be called concurrently from multiple threads.
+ * @return An iterator to the element after the last element written.
+ */
+template <opt_t OptFlags, typename InIt1, typename InIt2, typename OutIt, typename F>
+OutIt transform(thread_pool<OptFlags>& pool, const InIt1 first1, const InIt1 last1, const InIt2 first2, const OutIt d_first, F&& op)
+{
+    using D = typename std::iterator_traits<InIt1>::difference_type;
+    const D size = std::distance(first1, last1);
+    multi_future<void> futures = pool.submit_blocks(static_cast<D>(0), size,
+        [first1, first2, d_first, &op](const D start, const D end)
+        {
+            std::transform(first1 + start, first1 + end, first2 + start, d_first + start, op);
+        });
+    futures.get();
+    return d_first + size;
+}
+
+/**
+ * @brief Reduce a range using a binary operation, in parallel. Equivalent to `std::reduce()`, except that the result is deterministic: each block is folded from left to right, and the results of the blocks are then folded from left to right starting with the initial value, so the operation only needs to be associative, not commutative.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
+ * @tparam It The type of the iterators. Must be a random-access iterator.
+ * @tparam T The type of the result.
+ * @tparam F The type of the operation.
+ * @param pool The thread pool to use.
+ * @param first An iterator to the first element in the range.
+ * @param last An iterator to the element after the last element in the range.
+ * @param init The initial value, which is combined with the result of the first block. If the range is empty, this value is returned.
+ * @param op The binary operation. Must be associative. Should take two arguments, each of which can be either an element or a `T`, and return a `T`. The default is `std::plus<>`. It will be called concurrently from multiple threads.
+ * @return The result of the reduction.
+ */
+template <opt_t OptFlags, typename It, typename T, typename F = std::plus<>>
+T reduce(thread_pool<OptFlags>& pool, const It first, const It last, T init, F op = {})
+{
+    using D = typename std::iterator_traits<It>::difference_type;
+    multi_future<T> futures = pool.submit_blocks(static_cast<D>(0), std::distance(first, last),
+        [first, &op](const D start, const D end)
+        {
+            T partial = *(first + start);
+            return std::accumulate(first + start + 1, first + end, std::move(partial), op);
+        });
+    for (T& partial : futures.get())
+        init = op(std::move(init), std::move(partial));
+    return init;
+}
+
+/**
+ * @brief Sum a range, in parallel, starting with a value-initialized element. Equivalent to `std::reduce()`; see the overload that takes an initial value for details.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
+ * @tparam It The type of the iterators. Must be a random-access iterator.
+ * @tparam T The type of the result, which is the value type of the iterators.
+ * @param pool The thread pool to use.
+ * @param first An iterator to the first element in the range.
+ * @param last An iterator to the element after the last element in the range.
+ * @return The sum of the elements, or `T{}` if the range is empty.
+ */
+template <opt_t OptFlags, typename It, typename T = typename std::iterator_traits<It>::value_type>
+T reduce(thread_pool<OptFlags>& pool, const It first, const It last)
+{
+    return reduce(pool, first, last, T{}, std::plus<>{});
+}
+
+/**
+ * @brief Compute the inclusive prefix sums of a range using a binary operation and store them in another range, in parallel. Equivalent to `std::inclusive_scan()`. Uses a two-pass blocked algorithm: first the total of each block is computed in parallel, then the offset of each block is obtained by folding the totals of the blocks before it, and finally each block is scanned in parallel starting from its offset. The operation is therefore evaluated roughly twice as many times as in a sequential scan.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
+ * @tparam InIt The type of the input iterators. Must be a random-access iterator.
+ * @tparam OutIt The type of the output iterator. Must be a random-access iterator.
+ * @tparam F The type of the operation.
+ * @param pool The thread pool to use.
+ * @param first An iterator to the first element in the input range.
+ * @param last An iterator to the element after the last element in the input range.
+ * @param d_first An iterator to the first element in the output range, which must be at least as large as the input range. May be equal to `first`.
+ * @param op The binary operation. Must be associative. The default is `std::plus<>`. It will be called concurrently from multiple threads.
+ * @return An iterator to the element after the last element written.
+ */
+template <opt_t OptFlags, typename InIt, typename OutIt, typename F = std::plus<>>
+OutIt inclusive_scan(thread_pool<OptFlags>& pool, const InIt first, const InIt last, const OutIt d_first, F op = {})
+{
+    using D = typename std::iterator_traits<InIt>::difference_type;
+    using T = typename std::iterator_traits<InIt>::value_type;
+    const D size = std::distance(first, last);
+    if (size <= 0)
+        return d_first;
+    const blocks<D> blks(static_cast<D>(0), size, pool.get_thread_count());
+    const std::size_t num_blocks = blks.get_num_blocks();
+    multi_future<T> totals_futures = pool.submit_sequence(static_cast<std::size_t>(0), num_blocks - 1,
+        [first, &blks, &op](const std::size_t blk)
+        {
+            T total = *(first + blks.start(blk));
+            return std::accumulate(first + blks.start(blk) + 1, first + blks.end(blk), std::move(total), op);
+        });
+    std::vector<T> offsets = totals_futures.get();
+    for (std::size_t blk = 1; blk < offsets.size(); ++blk)
+        offsets[blk] = op(offsets[blk - 1], offsets[blk]);
+    multi_future<void> futures = pool.submit_sequence(static_cast<std::size_t>(0), num_blocks,
+        [first, d_first, &blks, &offsets, &op](const std::size_t blk)
+        {
+            if (blk == 0)
+                std::inclusive_scan(first, first + blks.end(0), d_first, op);
+            else
+                std::inclusive_scan(first + blks.start(blk), first + blks.end(blk), d_first + blks.start(blk), op, offsets[blk - 1]);
+        });
+    futures.get();
+    return d_first + size;
+}
+
+/**
+ * @brief Compute the exclusive prefix sums of a range using a binary operation and an initial value and store them in another range, in parallel. Equivalent to `std::exclusive_scan()`. Uses the same two-pass blocked algorithm as `inclusive_scan()`.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
+ * @tparam InIt The type of the input iterators. Must be a random-access iterator.
+ * @tparam OutIt The type of the output iterator. Must be a random-access iterator.
+ * @tparam T The type of the initial value and the partial sums.
+ * @tparam F The type of the operation.
+ * @param pool The thread pool to use.
+ * @param first An iterator to the first element in the input range.
+ * @param last An iterator to the element after the last element in the input range.
+ * @param d_first An iterator to the first element in the output range, which must be at least as large as the input range. May be equal to `first`.
+ * @param init The initial value, which will be the first element written.
+ * @param op The binary operation. Must be associative. The default is `std::plus<>`. It will be called concurrently from multiple threads.
+ * @return An iterator to the element after the last element written.
+ */
+template <opt_t OptFlags, typename InIt, typename OutIt, typename T, typename F = std::plus<>>
+OutIt exclusive_scan(thread_pool<OptFlags>& pool, const InIt first, const InIt last, const OutIt d_first, T init, F op = {})
+{
+    using D = typename std::iterator_traits<InIt>::difference_type;
+    const D size = std::distance(first, last);
+    if (size <= 0)
+        return d_first;
+    const blocks<D> blks(static_cast<D>(0), size, pool.get_thread_count());
+    const std::size_t num_blocks = blks.get_num_blocks();
+    multi_future<T> totals_futures = pool.submit_sequence(static_cast<std::size_t>(0), num_blocks - 1,
+        [first, &blks, &op](const std::size_t blk)
+        {
+            T total = *(first + blks.start(blk));
+            return std::accumulate(first + blks.start(blk) + 1, first + blks.end(blk), std::move(total), op);
+        });
+    std::vector<T> offsets;
+    offsets.reserve(num_blocks);
+    offsets.push_back(std::move(init));
+    for (T& total : totals_futures.get())
+        offsets.push_back(op(offsets.back(), std::move(total)));
+    multi_future<void> futures = pool.submit_sequence(static_cast<std::size_t>(0), num_blocks,
+        [first, d_first, &blks, &offsets, &op](const std::size_t blk)
+        {
+            std::exclusive_scan(first + blks.start(blk), first + blks.end(blk), d_first + blks.start(blk), offsets[blk], op);
+        });
+    futures.get();
+    return d_first + size;
+}
+
+/**
+ * @brief Find how many of the first `k` elements of the merge of two sorted ranges come from the first range, using binary search, so that the output of a merge can be divided into parts which are merged independently. Ties are resolved in favor of the first range, as in `std::merge()`. A helper function used by `BS::parallel::sort()`.
+ *
+ * @tparam It The type of the iterators. Must be a random-access iterator.
+ * @tparam D The type of the sizes.
+ * @tparam C The type of the comparison function.
+ * @param first1 An iterator to the first element in the first range.
+ * @param size1 The number of elements in the first range.
+ * @param first2 An iterator to the first element in the second range.
+ * @param size2 The number of elements in the second range.
+ * @param k The number of elements at the start of the merged range. Must be between 0 and `size1 + size2`.
+ * @param comp The comparison function.
+ * @return The number of those elements which come from the first range. The rest, `k` minus this number, come from the second range.
+ */
+template <typename It, typename D, typename C>
+D merge_split(const It first1, const D size1, const It first2, const D size2, const D k, C& comp)
+{
+    D low = std::max(static_cast<D>(0), k - size2);
+    D high = std::min(k, size1);
+    while (low < high)
+    {
+        const D i = low + ((high - low) / 2);
+        // If element i of the first range is not greater than the last element taken from the second range, it is merged before that element, so more elements must be taken from the first range.
+        if (!comp(*(first2 + (k - i - 1)), *(first1 + i)))
+            low = i + 1;
+        else
+            high = i;
+    }
+    return low;
+}
+
+/**
+ * @brief Merge the pairs of adjacent sorted runs of a range into another range of the same size, in parallel, as one round of `BS::parallel::sort()`. Runs 2k and 2k+1 are merged into a single run; if there is an odd number of runs, the last one is moved as is. The output is divided into as many blocks as there are threads in the pool, regardless of where the runs begin and end, so all the threads take part in every round, including the last one, in which there is only a single pair of runs. Where each block starts in the two runs it merges is found using `merge_split()` before any of the blocks start, since the blocks move the elements out of the input range. A helper function used by `BS::parallel::sort()`.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
+ * @tparam SrcIt The type of the input iterator. Must be a random-access iterator.
+ * @tparam DstIt The type of the output iterator. Must be a random-access iterator.
+ * @tparam D The type of the indices.
+ * @tparam C The type of the comparison function.
+ * @param pool The thread pool to use.
+ * @param src An iterator to the first element in the input range. The elements are moved out of it.
+ * @param dst An iterator to the first element in the output range, which must not overlap the input range.
+ * @param bounds The indices at which the runs start, followed by the size of the range.
+ * @param comp The comparison function.
+ */
+template <opt_t OptFlags, typename SrcIt, typename DstIt, typename D, typename C>
+void merge_runs(thread_pool<OptFlags>& pool, const SrcIt src, const DstIt dst, const std::vector<D>& bounds, C& comp)
+{
+    const std::size_t num_runs = bounds.size() - 1;
+    // The index of the run containing an element, rounded down to the first run of its pair.
+    const auto first_run_of_pair = [&bounds](const D pos)
+    {
+        return (static_cast<std::size_t>(std::upper_bound(bounds.begin(), bounds.end(), pos) - bounds.begin()) - 1) & ~static_cast<std::size_t>(1);
+    };
+    const blocks<D> blks(static_cast<D>(0), bounds.back(), pool.get_thread_count());
+    const std::size_t num_blocks = blks.get_num_blocks();
+    // For each block, the number of elements of the output, up to the start of the block, which come from the first run of the pair the block starts in.
+    std::vector<D> splits(num_blocks, 0);
+    for (std::size_t blk = 0; blk < num_blocks; ++blk)
+    {
+        const D pos = blks.start(blk);
+        const std::size_t run = first_run_of_pair(pos);
+        if (run + 1 < num_runs)
+            splits[blk] = merge_split(src + bounds[run], bounds[run + 1] - bounds[run], src + bounds[run + 1], bounds[run + 2] - bounds[run + 1], pos - bounds[run], comp);
+    }
+    multi_future<void> futures = pool.submit_sequence(static_cast<std::size_t>(0), num_blocks,
+        [src, dst, &bounds, &blks, &splits, &first_run_of_pair, &comp, num_runs, num_blocks](const std::size_t blk)
+        {
+            const D start = blks.start(blk);
+            const D end = blks.end(blk);
+            std::size_t run = first_run_of_pair(start);
+            for (D pos = start; pos < end; run += 2)
+            {
+                const D low = bounds[run];
+                const D high = bounds[std::min(run + 2, num_runs)];
+                const D part_end = std::min(end, high);
+                if (run + 1 == num_runs)
+                {
+                    std::move(src + pos, src + part_end, dst + pos);
+                }
+                else
+                {
+                    const D mid = bounds[run + 1];
+                    // Only the first pair of a block can start in the middle, and only the last pair can end in the middle, where the next block starts.
+                    const D split_start = (pos == start) ? splits[blk] : 0;
+                    const D split_end = ((part_end < high) && (blk + 1 < num_blocks)) ? splits[blk + 1] : (mid - low);
+                    std::merge(std::make_move_iterator(src + low + split_start), std::make_move_iterator(src + low + split_end), std::make_move_iterator(src + mid + (pos - low - split_start)), std::make_move_iterator(src + mid + (part_end - low - split_end)), dst + pos, comp);
+                }
+                pos = part_end;
+            }
+        });
+    futures.get();
+}
+
+/**
+ * @brief Sort a range, in parallel. Equivalent to `std::sort()`. The range is divided into blocks, each block is sorted in parallel using `std::sort()`, and then adjacent sorted runs are merged pairwise, moving the elements back and forth between the range and a temporary buffer of the same size, until a single sorted run remains. Each merge round is divided evenly between all the threads using binary search, as described in `merge_runs()`, so the merges run in parallel even when only a few runs are left. Like `std::sort()`, the sort is not stable.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
+ * @tparam It The type of the iterators. Must be a random-access iterator.
+ * @tparam C The type of the comparison function.
+ * @param pool The thread pool to use.
+ * @param first An iterator to the first element in the range.
+ * @param last An iterator to the element after the last element in the range.
+ * @param comp The comparison function, which returns `true` if the first argument is less than the second. The default is `std::less<>`. It will be called concurrently from multiple threads.
+ */
+template <opt_t OptFlags, typename It, typename C = std::less<>>
+void sort(thread_pool<OptFlags>& pool, const It first, const It last, C comp = {})
+{
+    using D = typename std::iterator_traits<It>::difference_type;
+    using V = typename std::iterator_traits<It>::value_type;
+    const D size = std::distance(first, last);
+    if (size <= 1)
+        return;
+    const blocks<D> blks(static_cast<D>(0), size, pool.get_thread_count());
+    std::vector<D> bounds;
+    bounds.reserve(blks.get_num_blocks() + 1);
+    for (std::size_t blk = 0; blk < blks.get_num_blocks(); ++blk)
+        bounds.push_back(blks.start(blk));
+    bounds.push_back(size);
+    multi_future<void> sort_futures = pool.submit_sequence(static_cast<std::size_t>(0), bounds.size() - 1,
+        [first, &bounds, &comp](const std::size_t run)
+        {
+            std::sort(first + bounds[run], first + bounds[run + 1], comp);
+        });
+    sort_futures.get();
+    if (bounds.size() <= 2)
+        return;
+    // Merging in parallel requires the output to be separate from the input, so the runs are merged back and forth between the range and the buffer. The elements are moved into the buffer when it is created, so they do not need to be default constructible.
+    std::vector<V> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+    bool in_buffer = true;
+    while (bounds.size() > 2)
+    {
+        if (in_buffer)
+            merge_runs(pool, buffer.begin(), first, bounds, comp);
+        else
+            merge_runs(pool, first, buffer.begin(), bounds, comp);
+        in_buffer = !in_buffer;
+        std::vector<D> merged_bounds;
+        merged_bounds.reserve(((bounds.size() - 1) / 2) + 2);
+        for (std::size_t i = 0; i < bounds.size(); i += 2)
+            merged_bounds.push_back(bounds[i]);
+        if (merged_bounds.back() != size)
+            merged_bounds.push_back(size);
+        bounds = std::move(merged_bounds);
+    }
+    if (in_buffer)
+    {
+        multi_future<void> move_futures = pool.submit_blocks(static_cast<D>(0), size,
+            [first, &buffer](const D start, const D end)
+            {
+                std::move(buffer.begin() + start, buffer.begin() + end, first + start);
+            });
+        move_futures.get();
+    }
+}
+
+/**
+ * @brief Copy the elements of a range that satisfy a predicate into another range, in parallel, preserving their relative order. Equivalent to `std::copy_if()`. The predicate is evaluated once per element in parallel and the number of matches in each block is counted, then the offset of each block in the output range is obtained by summing the counts of the blocks before it, and finally each block copies its matches to its offset in parallel.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
+ * @tparam InIt The type of the input iterators. Must be a random-access iterator.
+ * @tparam OutIt The type of the output iterator. Must be a random-access iterator.
+ * @tparam P The type of the predicate.
+ * @param pool The thread pool to use.
+ * @param first An iterator to the first element in the input range.
+ * @param last An iterator to the element after the last element in the input range.
+ * @param d_first An iterator to the first element in the output range, which must be large enough to hold all the matches. The output range must not overlap the input range.
+ * @param pred The predicate. Should take exactly one argument, an element of the input range, and return `true` if the element should be copied. It will be called concurrently from multiple threads.
+ * @return An iterator to the element after the last element written.
+ */
+template <opt_t OptFlags, typename InIt, typename OutIt, typename P>
+OutIt copy_if(thread_pool<OptFlags>& pool, const InIt first, const InIt last, const OutIt d_first, P&& pred)
+{
+    using D = typename std::iterator_traits<InIt>::difference_type;
+    const D size = std::distance(first, last);
+    if (size <= 0)
+        return d_first;
+    const blocks<D> blks(static_cast<D>(0), size, pool.get_thread_count());
+    const std::size_t num_blocks = blks.get_num_blocks();
+    // We store the result of the predicate for each element, so that it does not need to be evaluated again in the second pass. We use `unsigned char` rather than `bool` since `std::vector<bool>` packs its elements into bits, which cannot be written concurrently.
+    std::vector<unsigned char> matches(static_cast<std::size_t>(size));
+    multi_future<D> count_futures = pool.submit_sequence(static_cast<std::size_t>(0), num_blocks,
+        [first, &blks, &matches, &pred](const std::size_t blk)
+        {
+            D count = 0;
+            for (D i = blks.start(blk); i < blks.end(blk); ++i)
+            {
+                const unsigned char match = pred(*(first + i)) ? 1 : 0;
+                matches[static_cast<std::size_t>(i)] = match;
+                count += match;
+            }
+            return count;
+        });
+    std::vector<D> offsets = count_futures.get();
+    const D total = std::accumulate(offsets.begin(), offsets.end(), static_cast<D>(0));
+    std::exclusive_scan(offsets.begin(), offsets.end(), offsets.begin(), static_cast<D>(0));
+    multi_future<void> copy_futures = pool.submit_sequence(static_cast<std::size_t>(0), num_blocks,
+        [first, d_first, &blks, &matches, &offsets](const std::size_t blk)
+        {
+            OutIt out = d_first + offsets[blk];
+            for (D i = blks.start(blk); i < blks.end(blk); ++i)
+            {
+                if (matches[static_cast<std::size_t>(i)] != 0)
+                {
+                    *out = *(first + i);
+                    ++out;
+                }
+            }
+        });
+    copy_futures.get();
+    return d_first + total;
+}
+} // namespace BS::parallel
+#endif
@@ -11,7 +11,7 @@
  * @date 2024-12-19
  * @copyright Copyright (c) 2024 Barak Shoshany. Licensed under the MIT license. If you found this project useful, please consider starring it on GitHub! If you use this library in software of any kind, please provide a link to the GitHub repository https://github.com/bshoshany/thread-pool in the source code and documentation. If you use this library in published research, please cite it as follows: Barak Shoshany, "A C++17 Thread Pool for High-Performance Scientific Computing", doi:10.1016/j.softx.2024.101687, SoftwareX 26 (2024) 101687, arXiv:2105.00613
  *
- * @brief `BS::thread_pool`: a fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool library. This module file wraps the header file BS_thread_pool.hpp inside a C++20 module so it can be imported using `import BS.thread_pool`.
+ * @brief `BS::thread_pool`: a fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool library. This module file wraps the header files BS_thread_pool.hpp and BS_thread_pool_algorithms.hpp inside a C++20 module so it can be imported using `import BS.thread_pool`.
  */
 
 module;
@@ -20,20 +20,42 @@ module;
 #define BS_THREAD_POOL_MODULE 5, 0, 0
 
 #include "BS_thread_pool.hpp"
+#include "BS_thread_pool_algorithms.hpp"
 
 export module BS.thread_pool;
 
 export namespace BS {
+using BS::arena_buffer_size;
 using BS::binary_semaphore;
 using BS::common_index_type_t;
+using BS::continuable_future;
 using BS::counting_semaphore;
+using BS::dynamic_blocks;
+using BS::elastic_thread_pool;
+using BS::fair_queue;
+using BS::fair_scheduler;
+using BS::group_future;
+using BS::latency_histogram;
+using BS::lf_thread_pool;
 using BS::light_thread_pool;
+using BS::mpmc_queue;
 using BS::multi_future;
+using BS::numa_thread_pool;
 using BS::pause_thread_pool;
+using BS::pool_statistics;
 using BS::pr;
 using BS::priority_t;
 using BS::priority_thread_pool;
+using BS::schedule;
+using BS::small_task;
+using BS::stats_thread_pool;
+using BS::stop_condition;
 using BS::synced_stream;
+using BS::task_buffer_size;
+using BS::task_cancelled;
+using BS::task_graph;
+using BS::task_group;
+using BS::task_group_statistics;
 using BS::this_thread;
 using BS::thread_pool;
 using BS::thread_pool_import_std;
@@ -41,11 +63,21 @@ using BS::thread_pool_module;
 using BS::thread_pool_native_extensions;
 using BS::thread_pool_version;
 using BS::tp;
+using BS::trace_buffer_size;
+using BS::trace_event;
+using BS::trace_thread_pool;
 using BS::version;
 using BS::wait_deadlock;
 using BS::wdc_thread_pool;
+using BS::when_all;
+using BS::ws_thread_pool;
+
+#if defined(__cpp_impl_coroutine) && defined(__cpp_lib_coroutine)
+using BS::task;
+#endif
 
 #ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
+using BS::get_os_numa_nodes;
 using BS::get_os_process_affinity;
 using BS::get_os_process_priority;
 using BS::os_process_priority;
@@ -54,3 +86,13 @@ using BS::set_os_process_affinity;
 using BS::set_os_process_priority;
 #endif
 } // namespace BS
+
+export namespace BS::parallel {
+using BS::parallel::copy_if;
+using BS::parallel::exclusive_scan;
+using BS::parallel::for_each;
+using BS::parallel::inclusive_scan;
+using BS::parallel::reduce;
+using BS::parallel::sort;
+using BS::parallel::transform;
+} // namespace BS::parallel
@@ -46,6 +46,7 @@ if shutil.which("g++") is not None and platform.system() != "Darwin":
 standards: list[str] = ["c++17", "c++20", "c++23"]
 workspace_path: pathlib.Path = pathlib.Path(__file__).parent.parent.resolve()
 source_path: pathlib.Path = workspace_path / "tests" / "BS_thread_pool_test.cpp"
+benchmark_path: pathlib.Path = workspace_path / "tests" / "BS_thread_pool_benchmark.cpp"
 script_path: pathlib.Path = workspace_path / "scripts" / "compile_cpp.py"
 try:
     compile_start: float = time.perf_counter()
@@ -81,6 +82,28 @@ try:
             if compile_result.returncode != 0:
                 print_message("Compilation failed, aborting script!")
                 sys.exit(compile_result.returncode)
+            # The benchmark program takes too long to run here, so we only check that it compiles.
+            print_message(f"Compiling the benchmark program with {compiler} using {std.upper()} standard...")
+            compile_result = subprocess.run(
+                args=[
+                    "python" if platform.system() == "Windows" else "python3",
+                    str(script_path.resolve()),
+                    str(benchmark_path.resolve()),
+                    "-c",
+                    compiler,
+                    "-s",
+                    std,
+                    "-t",
+                    "release",
+                    *warnings_as_errors,
+                    "-v",
+                ],
+                check=False,
+                text=True,
+            )
+            if compile_result.returncode != 0:
+                print_message("Compilation failed, aborting script!")
+                sys.exit(compile_result.returncode)
 except Exception as exc:
     print_message(f"Could not compile due to exception: {exc}.")
     sys.exit(1)
@@ -0,0 +1,648 @@
+/**
+ * ██████  ███████       ████████ ██   ██ ██████  ███████  █████  ██████          ██████   ██████   ██████  ██
+ * ██   ██ ██      ██ ██    ██    ██   ██ ██   ██ ██      ██   ██ ██   ██         ██   ██ ██    ██ ██    ██ ██
+ * ██████  ███████          ██    ███████ ██████  █████   ███████ ██   ██         ██████  ██    ██ ██    ██ ██
+ * ██   ██      ██ ██ ██    ██    ██   ██ ██   ██ ██      ██   ██ ██   ██         ██      ██    ██ ██    ██ ██
+ * ██████  ███████          ██    ██   ██ ██   ██ ███████ ██   ██ ██████  ███████ ██       ██████   ██████  ███████
+ *
+ * @file BS_thread_pool_benchmark.cpp
+ * @author Barak Shoshany (baraksh@gmail.com) (https://baraksh.com/)
+ * @version 5.0.0
+ * @date 2024-12-19
+ * @copyright Copyright (c) 2024 Barak Shoshany. Licensed under the MIT license. If you found this project useful, please consider starring it on GitHub! If you use this library in software of any kind, please provide a link to the GitHub repository https://github.com/bshoshany/thread-pool in the source code and documentation. If you use this library in published research, please cite it as follows: Barak Shoshany, "A C++17 Thread Pool for High-Performance Scientific Computing", doi:10.1016/j.softx.2024.101687, SoftwareX 26 (2024) 101687, arXiv:2105.00613
+ *
+ * @brief `BS::thread_pool`: a fast, lightweight, modern, and easy-to-use C++17/C++20/C++23 thread pool library. This program measures the overhead of the thread pool itself, using tasks that do almost nothing, for different variants of the pool, and writes the results in JSON or CSV format so they can be compared between versions. It is not needed in order to use the library.
+ */
+
+// We need to include <version> since if we're using `import std` it will not define any feature-test macros, including `__cpp_lib_modules`, which we need to check if `import std` is supported in the first place.
+#ifdef __has_include
+    #if __has_include(<version>)
+        #include <version> // NOLINT(misc-include-cleaner)
+    #endif
+#endif
+
+// If the macro `BS_THREAD_POOL_IMPORT_STD` is defined, import the C++ Standard Library as a module. Otherwise, include the relevant Standard Library header files. See `BS_thread_pool_test.cpp` for more details.
+#if defined(BS_THREAD_POOL_IMPORT_STD) && defined(__cpp_lib_modules) && (__cplusplus >= 202004L) && (defined(_MSC_VER) || (defined(__clang__) && defined(_LIBCPP_VERSION) && !defined(__apple_build_version__)))
+import std;
+#else
+    #include <algorithm>
+    #include <atomic>
+    #include <chrono>
+    #include <cmath>
+    #include <cstddef>
+    #include <cstdint>
+    #include <ctime>
+    #include <fstream>
+    #include <future>
+    #include <iomanip>
+    #include <ios>
+    #include <iostream>
+    #include <limits>
+    #include <map>
+    #include <random>
+    #include <set>
+    #include <sstream>
+    #include <string>
+    #include <string_view>
+    #include <thread>
+    #include <utility>
+    #include <vector>
+
+    #ifdef __cpp_exceptions
+        #include <exception>
+    #endif
+    #ifdef __cpp_lib_format
+        #include <format>
+    #endif
+#endif
+
+// If the macro `BS_THREAD_POOL_TEST_IMPORT_MODULE` is defined, import the thread pool library as a module. Otherwise, include the header file.
+#define BS_THREAD_POOL_BENCHMARK_VERSION 5, 0, 0
+#if defined(BS_THREAD_POOL_TEST_IMPORT_MODULE) && (__cplusplus >= 202002L)
+import BS.thread_pool;
+static_assert(BS::thread_pool_version == BS::version(BS_THREAD_POOL_BENCHMARK_VERSION), "The versions of BS_thread_pool_benchmark.cpp and the BS.thread_pool module do not match. Aborting compilation.");
+#else
+    #include "BS_thread_pool.hpp"
+static_assert(BS::thread_pool_version == BS::version(BS_THREAD_POOL_BENCHMARK_VERSION), "The versions of BS_thread_pool_benchmark.cpp and BS_thread_pool.hpp do not match. Aborting compilation.");
+#endif
+
+// A global synced stream which prints to the standard output.
+BS::synced_stream sync_out;
+
+// ====================================
+// Functions for collecting the results
+// ====================================
+
+/**
+ * @brief The clock used for all measurements.
+ */
+using bench_clock = std::chrono::steady_clock;
+
+/**
+ * @brief Get the number of nanoseconds between two time points, as a floating-point number.
+ *
+ * @param start The first time point.
+ * @param end The second time point.
+ * @return The number of nanoseconds.
+ */
+double ns_between(const bench_clock::time_point start, const bench_clock::time_point end)
+{
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+/**
+ * @brief A struct to store a summary of a set of samples.
+ */
+struct [[nodiscard]] sample_summary
+{
+    std::size_t samples = 0;
+    double mean = 0;
+    double sd = 0;
+    double min = 0;
+    double median = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+/**
+ * @brief Summarize a set of samples: their mean, standard deviation, minimum, maximum, and percentiles. The percentiles are calculated using the nearest-rank method.
+ *
+ * @param values The samples. Will be sorted in place.
+ * @return The summary.
+ */
+sample_summary summarize(std::vector<double>& values)
+{
+    sample_summary summary;
+    if (values.empty())
+        return summary;
+    std::sort(values.begin(), values.end());
+    const std::size_t num = values.size();
+    const double num_d = static_cast<double>(num);
+    double mean = 0;
+    for (const double value : values)
+        mean += value / num_d;
+    double variance = 0;
+    for (const double value : values)
+        variance += (value - mean) * (value - mean) / num_d;
+    const auto percentile = [&values, num, num_d](const double fraction)
+    {
+        const auto rank = static_cast<std::size_t>(std::ceil(fraction * num_d));
+        return values[std::min(std::max<std::size_t>(rank, 1), num) - 1];
+    };
+    summary.samples = num;
+    summary.mean = mean;
+    summary.sd = std::sqrt(variance);
+    summary.min = values.front();
+    summary.median = percentile(0.5);
+    summary.p90 = percentile(0.9);
+    summary.p99 = percentile(0.99);
+    summary.max = values.back();
+    return summary;
+}
+
+/**
+ * @brief A struct to store the result of a single benchmark.
+ */
+struct [[nodiscard]] benchmark_result
+{
+    /**
+     * @brief The name of the benchmark.
+     */
+    std::string benchmark;
+
+    /**
+     * @brief The variant of the pool, i.e. the flags it was created with.
+     */
+    std::string variant;
+
+    /**
+     * @brief The number of threads in the pool.
+     */
+    std::size_t threads = 0;
+
+    /**
+     * @brief The number of threads submitting tasks to the pool.
+     */
+    std::size_t producers = 0;
+
+    /**
+     * @brief A benchmark-specific parameter, such as the depth of the tree of tasks in the fork-join benchmark, or 0 if the benchmark has no parameter.
+     */
+    std::size_t parameter = 0;
+
+    /**
+     * @brief The unit of the samples, e.g. "ns" or "tasks/ms".
+     */
+    std::string unit;
+
+    /**
+     * @brief The summary of the samples.
+     */
+    sample_summary summary;
+};
+
+/**
+ * @brief All the results collected so far, in the order in which the benchmarks were performed.
+ */
+std::vector<benchmark_result> results;
+
+/**
+ * @brief Summarize a set of samples, store the result in `results`, and print it.
+ *
+ * @param result The result, with all the members except the summary filled in.
+ * @param values The samples.
+ */
+void record(benchmark_result result, std::vector<double>& values)
+{
+    constexpr int width_name = 26;
+    constexpr int width_variant = 14;
+    constexpr int width_count = 4;
+    constexpr int width_value = 10;
+    result.summary = summarize(values);
+    sync_out.println(std::left, std::setw(width_name), result.benchmark, std::setw(width_variant), result.variant, std::right, "threads: ", std::setw(width_count), result.threads, ", producers: ", std::setw(width_count), result.producers, ", parameter: ", std::setw(width_count), result.parameter, " -> mean: ", std::setw(width_value), result.summary.mean, " ", result.unit, ", sd: ", std::setw(width_value), result.summary.sd, ", median: ", std::setw(width_value), result.summary.median, ", p99: ", std::setw(width_value), result.summary.p99, '.');
+    results.push_back(std::move(result));
+}
+
+// =========================
+// The benchmarks themselves
+// =========================
+
+/**
+ * @brief A struct to store the parameters of the benchmarks.
+ */
+struct [[nodiscard]] benchmark_config
+{
+    /**
+     * @brief The number of times to repeat each throughput measurement. One extra repetition is performed first to warm up the pool, and discarded.
+     */
+    std::size_t repetitions = 10;
+
+    /**
+     * @brief The number of tasks to submit in each throughput measurement, per producer.
+     */
+    std::size_t tasks = 100000;
+
+    /**
+     * @brief The number of samples to collect for each latency measurement.
+     */
+    std::size_t latency_samples = 10000;
+
+    /**
+     * @brief The depths of the trees of tasks to try in the fork-join benchmark.
+     */
+    std::vector<std::size_t> depths = {8, 12, 16};
+};
+
+/**
+ * @brief Measure the throughput of empty tasks submitted using `detach_task()` by several threads at once, which measures the contention on the queue. Each producer submits the same number of tasks. The time is measured from the moment the producers are released to the moment all the tasks have finished executing.
+ *
+ * @tparam OptFlags The flags of the pool.
+ * @param variant The name of the variant.
+ * @param config The parameters of the benchmarks.
+ */
+template <BS::opt_t OptFlags>
+void benchmark_empty_task_throughput(const std::string_view variant, const benchmark_config& config)
+{
+    BS::thread_pool<OptFlags> pool;
+    const std::size_t max_producers = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    for (std::size_t producers = 1; producers <= max_producers; producers = (producers * 2 > max_producers && producers < max_producers) ? max_producers : producers * 2)
+    {
+        std::vector<double> values;
+        for (std::size_t rep = 0; rep <= config.repetitions; ++rep)
+        {
+            std::atomic<bool> go = false;
+            std::vector<std::thread> threads;
+            threads.reserve(producers);
+            for (std::size_t i = 0; i < producers; ++i)
+            {
+                threads.emplace_back(
+                    [&pool, &go, &config]
+                    {
+                        while (!go.load(std::memory_order_acquire))
+                            std::this_thread::yield();
+                        for (std::size_t j = 0; j < config.tasks; ++j)
+                            pool.detach_task([] {});
+                    });
+            }
+            const bench_clock::time_point start = bench_clock::now();
+            go.store(true, std::memory_order_release);
+            for (std::thread& thread : threads)
+                thread.join();
+            pool.wait();
+            const bench_clock::time_point end = bench_clock::now();
+            if (rep > 0)
+                values.push_back(static_cast<double>(producers * config.tasks) / (ns_between(start, end) / 1e6));
+        }
+        record({"empty_task_throughput", std::string(variant), pool.get_thread_count(), producers, 0, "tasks/ms", {}}, values);
+    }
+}
+
+/**
+ * @brief Measure the time it takes for a task to start executing after it was submitted using `detach_task()` to an idle pool, which mostly consists of the time it takes to wake up a sleeping thread. The pool waits for each task to finish before submitting the next one, so the threads are always asleep when a task is submitted.
+ *
+ * @tparam OptFlags The flags of the pool.
+ * @param variant The name of the variant.
+ * @param config The parameters of the benchmarks.
+ */
+template <BS::opt_t OptFlags>
+void benchmark_submit_to_start_latency(const std::string_view variant, const benchmark_config& config)
+{
+    BS::thread_pool<OptFlags> pool;
+    std::vector<double> values(config.latency_samples);
+    for (std::size_t i = 0; i < config.latency_samples; ++i)
+    {
+        const bench_clock::time_point submitted = bench_clock::now();
+        pool.detach_task(
+            [&values, i, submitted]
+            {
+                values[i] = ns_between(submitted, bench_clock::now());
+            });
+        pool.wait();
+    }
+    record({"submit_to_start_latency", std::string(variant), pool.get_thread_count(), 1, 0, "ns", {}}, values);
+}
+
+/**
+ * @brief Measure the cost of submitting an empty task using `detach_task()` and using `submit_task()`, from a single thread. Only the time it takes to submit the tasks is measured, not the time it takes to execute them, so the difference is the cost of creating the promise and the future.
+ *
+ * @tparam OptFlags The flags of the pool.
+ * @param variant The name of the variant.
+ * @param config The parameters of the benchmarks.
+ */
+template <BS::opt_t OptFlags>
+void benchmark_submission_cost(const std::string_view variant, const benchmark_config& config)
+{
+    BS::thread_pool<OptFlags> pool;
+    std::vector<double> detach_values;
+    std::vector<double> submit_values;
+    std::vector<std::future<void>> futures;
+    futures.reserve(config.tasks);
+    for (std::size_t rep = 0; rep <= config.repetitions; ++rep)
+    {
+        const bench_clock::time_point detach_start = bench_clock::now();
+        for (std::size_t i = 0; i < config.tasks; ++i)
+            pool.detach_task([] {});
+        const bench_clock::time_point detach_end = bench_clock::now();
+        pool.wait();
+        const bench_clock::time_point submit_start = bench_clock::now();
+        for (std::size_t i = 0; i < config.tasks; ++i)
+            futures.push_back(pool.submit_task([] {}));
+        const bench_clock::time_point submit_end = bench_clock::now();
+        pool.wait();
+        futures.clear();
+        if (rep > 0)
+        {
+            detach_values.push_back(ns_between(detach_start, detach_end) / static_cast<double>(config.tasks));
+            submit_values.push_back(ns_between(submit_start, submit_end) / static_cast<double>(config.tasks));
+        }
+    }
+    record({"detach_task_cost", std::string(variant), pool.get_thread_count(), 1, 0, "ns/task", {}}, detach_values);
+    record({"submit_task_cost", std::string(variant), pool.get_thread_count(), 1, 0, "ns/task", {}}, submit_values);
+}
+
+/**
+ * @brief Measure the round-trip time of submitting a single empty task using `detach_task()` and waiting for it using `wait()`, which includes waking up a thread, executing the task, and notifying the waiting thread.
+ *
+ * @tparam OptFlags The flags of the pool.
+ * @param variant The name of the variant.
+ * @param config The parameters of the benchmarks.
+ */
+template <BS::opt_t OptFlags>
+void benchmark_wait_round_trip(const std::string_view variant, const benchmark_config& config)
+{
+    BS::thread_pool<OptFlags> pool;
+    std::vector<double> values;
+    values.reserve(config.latency_samples);
+    for (std::size_t i = 0; i < config.latency_samples; ++i)
+    {
+        const bench_clock::time_point start = bench_clock::now();
+        pool.detach_task([] {});
+        pool.wait();
+        values.push_back(ns_between(start, bench_clock::now()));
+    }
+    record({"wait_round_trip", std::string(variant), pool.get_thread_count(), 1, 0, "ns", {}}, values);
+}
+
+/**
+ * @brief Measure the throughput of empty tasks with random priorities, submitted using `detach_task()` from a single thread. The priorities are generated in advance, so generating them is not measured. If the flag `BS::tp::priority` is disabled, the priorities are ignored, so comparing the variants shows the cost of the priority queue.
+ *
+ * @tparam OptFlags The flags of the pool.
+ * @param variant The name of the variant.
+ * @param config The parameters of the benchmarks.
+ */
+template <BS::opt_t OptFlags>
+void benchmark_priority_throughput(const std::string_view variant, const benchmark_config& config)
+{
+    BS::thread_pool<OptFlags> pool;
+    std::mt19937_64 twister(config.tasks);
+    std::uniform_int_distribution<int> distribution(BS::pr::lowest, BS::pr::highest);
+    std::vector<BS::priority_t> priorities(config.tasks);
+    for (BS::priority_t& priority : priorities)
+        priority = static_cast<BS::priority_t>(distribution(twister));
+    std::vector<double> values;
+    for (std::size_t rep = 0; rep <= config.repetitions; ++rep)
+    {
+        const bench_clock::time_point start = bench_clock::now();
+        for (std::size_t i = 0; i < config.tasks; ++i)
+            pool.detach_task([] {}, priorities[i]);
+        pool.wait();
+        const bench_clock::time_point end = bench_clock::now();
+        if (rep > 0)
+            values.push_back(static_cast<double>(config.tasks) / (ns_between(start, end) / 1e6));
+    }
+    record({"priority_throughput", std::string(variant), pool.get_thread_count(), 1, 0, "tasks/ms", {}}, values);
+}
+
+/**
+ * @brief Submit a task which forks into two child tasks, recursively, until the given depth is reached.
+ *
+ * @tparam OptFlags The flags of the pool.
+ * @param pool The pool.
+ * @param depth The remaining depth of the tree.
+ */
+template <BS::opt_t OptFlags>
+void fork_tasks(BS::thread_pool<OptFlags>& pool, const std::size_t depth)
+{
+    pool.detach_task(
+        [&pool, depth]
+        {
+            if (depth > 0)
+            {
+                fork_tasks(pool, depth - 1);
+                fork_tasks(pool, depth - 1);
+            }
+        });
+}
+
+/**
+ * @brief Measure the throughput of a binary tree of tasks, where each task submits its two children from within the pool, and the whole tree is joined using `wait()`. This measures the cost of submitting tasks from within the pool, which is where work stealing is expected to help.
+ *
+ * @tparam OptFlags The flags of the pool.
+ * @param variant The name of the variant.
+ * @param config The parameters of the benchmarks.
+ */
+template <BS::opt_t OptFlags>
+void benchmark_fork_join(const std::string_view variant, const benchmark_config& config)
+{
+    BS::thread_pool<OptFlags> pool;
+    for (const std::size_t depth : config.depths)
+    {
+        const double num_tasks = std::pow(2.0, static_cast<double>(depth + 1)) - 1;
+        std::vector<double> values;
+        for (std::size_t rep = 0; rep <= config.repetitions; ++rep)
+        {
+            const bench_clock::time_point start = bench_clock::now();
+            fork_tasks(pool, depth);
+            pool.wait();
+            const bench_clock::time_point end = bench_clock::now();
+            if (rep > 0)
+                values.push_back(num_tasks / (ns_between(start, end) / 1e6));
+        }
+        record({"fork_join", std::string(variant), pool.get_thread_count(), 1, depth, "tasks/ms", {}}, values);
+    }
+}
+
+/**
+ * @brief Perform all the benchmarks for one variant of the pool.
+ *
+ * @tparam OptFlags The flags of the pool.
+ * @param variant The name of the variant.
+ * @param config The parameters of the benchmarks.
+ */
+template <BS::opt_t OptFlags>
+void benchmark_variant(const std::string_view variant, const benchmark_config& config)
+{
+    sync_out.println("\nBenchmarking the variant: ", variant, "...");
+    benchmark_empty_task_throughput<OptFlags>(variant, config);
+    benchmark_submit_to_start_latency<OptFlags>(variant, config);
+    benchmark_submission_cost<OptFlags>(variant, config);
+    benchmark_wait_round_trip<OptFlags>(variant, config);
+    benchmark_priority_throughput<OptFlags>(variant, config);
+    benchmark_fork_join<OptFlags>(variant, config);
+}
+
+// =================================
+// Functions for writing the results
+// =================================
+
+/**
+ * @brief Get a string representing the current time.
+ *
+ * @return The string.
+ */
+std::string get_time()
+{
+#ifdef __cpp_lib_format
+    return std::format("{:%Y-%m-%d_%H.%M.%S}", std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::system_clock::now()));
+#else
+    std::string time_string = "YYYY-MM-DD_HH.MM.SS";
+    std::tm local_tm = {};
+    const std::time_t epoch = std::time(nullptr);
+    #if defined(_MSC_VER) && !defined(__cpp_lib_modules)
+    if (localtime_s(&local_tm, &epoch) != 0)
+        return "";
+    #elif defined(__linux__) || defined(__APPLE__)
+    if (localtime_r(&epoch, &local_tm) == nullptr)
+        return "";
+    #else
+    local_tm = *std::localtime(&epoch);
+    #endif
+    const std::size_t bytes = std::strftime(time_string.data(), time_string.length() + 1, "%Y-%m-%d_%H.%M.%S", &local_tm);
+    if (bytes != time_string.length())
+        return "";
+    return time_string;
+#endif
+}
+
+/**
+ * @brief Detect the compiler used to compile this program.
+ *
+ * @return A string describing the compiler.
+ */
+std::string detect_compiler()
+{
+    std::ostringstream out;
+#if defined(__apple_build_version__)
+    out << "Apple Clang v" << __clang_major__ << '.' << __clang_minor__ << '.' << __clang_patchlevel__;
+#elif defined(__clang__)
+    out << "Clang v" << __clang_major__ << '.' << __clang_minor__ << '.' << __clang_patchlevel__;
+#elif defined(__GNUC__)
+    out << "GCC v" << __GNUC__ << '.' << __GNUC_MINOR__ << '.' << __GNUC_PATCHLEVEL__;
+#elif defined(_MSC_FULL_VER)
+    out << "MSVC v" << _MSC_FULL_VER;
+#else
+    out << "Other";
+#endif
+    return out.str();
+}
+
+/**
+ * @brief Write the results in JSON format: an object with information about the system and the library, and an array `results` with one object per result.
+ *
+ * @param out The stream to write to.
+ * @param timestamp The time at which the benchmarks were started.
+ */
+void write_json(std::ostream& out, const std::string_view timestamp)
+{
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    out << "{\n";
+    out << "  \"library_version\": \"" << BS::thread_pool_version << "\",\n";
+    out << "  \"compiler\": \"" << detect_compiler() << "\",\n";
+    out << "  \"cpp_standard\": " << __cplusplus << ",\n";
+    out << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "  \"timestamp\": \"" << timestamp << "\",\n";
+    out << "  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const benchmark_result& result = results[i];
+        const sample_summary& summary = result.summary;
+        out << ((i == 0) ? "\n" : ",\n");
+        out << "    {\"benchmark\": \"" << result.benchmark << "\", \"variant\": \"" << result.variant << "\", \"threads\": " << result.threads << ", \"producers\": " << result.producers << ", \"parameter\": " << result.parameter << ", \"unit\": \"" << result.unit << "\", \"samples\": " << summary.samples << ", \"mean\": " << summary.mean << ", \"sd\": " << summary.sd << ", \"min\": " << summary.min << ", \"median\": " << summary.median << ", \"p90\": " << summary.p90 << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+/**
+ * @brief Write the results in CSV format, with a header row and one row per result.
+ *
+ * @param out The stream to write to.
+ */
+void write_csv(std::ostream& out)
+{
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    out << "benchmark,variant,threads,producers,parameter,unit,samples,mean,sd,min,median,p90,p99,max\n";
+    for (const benchmark_result& result : results)
+    {
+        const sample_summary& summary = result.summary;
+        out << result.benchmark << ',' << result.variant << ',' << result.threads << ',' << result.producers << ',' << result.parameter << ',' << result.unit << ',' << summary.samples << ',' << summary.mean << ',' << summary.sd << ',' << summary.min << ',' << summary.median << ',' << summary.p90 << ',' << summary.p99 << ',' << summary.max << '\n';
+    }
+}
+
+/**
+ * @brief Write the results to a file.
+ *
+ * @tparam F The type of the function that writes the results.
+ * @param filename The name of the file.
+ * @param write The function that writes the results, which takes the stream as its argument.
+ * @return `true` if the file was written successfully, `false` otherwise.
+ */
+template <typename F>
+bool write_file(const std::string& filename, F&& write)
+{
+    std::ofstream file(filename);
+    if (!file.is_open())
+    {
+        sync_out.println("ERROR: Could not create the file ", filename, '.');
+        return false;
+    }
+    std::forward<F>(write)(file);
+    sync_out.println("Results written to ", filename, '.');
+    return true;
+}
+
+// ==================================
+// The main function and related code
+// ==================================
+
+int main(int argc, char* argv[]) // NOLINT(bugprone-exception-escape)
+{
+#ifdef __cpp_exceptions
+    try
+    {
+#endif
+        const std::map<std::string_view, std::string_view> allowed = {{"csv", "Write the results to a CSV file."}, {"help", "Show this help message and exit."}, {"json", "Write the results to a JSON file."}, {"quick", "Perform fewer repetitions with fewer tasks, for a quick check."}};
+        const std::set<std::string_view> args(argv + 1, argv + argc);
+        const bool valid = std::all_of(args.begin(), args.end(),
+            [&allowed](const std::string_view arg)
+            {
+                return allowed.count(arg) == 1;
+            });
+        if (!valid || args.count("help") == 1)
+        {
+            sync_out.println("Available options (all are on/off and default to off):");
+            for (const auto& [arg, desc] : allowed)
+                sync_out.println("  ", std::left, std::setw(5), arg, "  ", desc);
+            return valid ? 0 : 1;
+        }
+
+        sync_out.println("BS::thread_pool v", BS::thread_pool_version, " scheduler overhead benchmarks");
+        sync_out.println("Compiler: ", detect_compiler(), ", C++ standard: ", __cplusplus, ", hardware concurrency: ", std::thread::hardware_concurrency(), '.');
+        sync_out.println("Important: Please do not run any other applications, especially multithreaded applications, in parallel with this benchmark!");
+
+        benchmark_config config;
+        if (args.count("quick") == 1)
+        {
+            config.repetitions = 3;
+            config.tasks = 10000;
+            config.latency_samples = 1000;
+            config.depths = {8, 12};
+        }
+        const std::string timestamp = get_time();
+
+        benchmark_variant<BS::tp::none>("default", config);
+        benchmark_variant<BS::tp::priority>("priority", config);
+        benchmark_variant<BS::tp::work_stealing>("work_stealing", config);
+        benchmark_variant<BS::tp::lock_free>("lock_free", config);
+
+        sync_out.println();
+        bool success = true;
+        if (args.count("json") == 1)
+            success = write_file("BS_thread_pool_benchmark-" + timestamp + ".json",
+                          [&timestamp](std::ostream& out)
+                          {
+                              write_json(out, timestamp);
+                          }) &&
+                      success;
+        if (args.count("csv") == 1)
+            success = write_file("BS_thread_pool_benchmark-" + timestamp + ".csv", write_csv) && success;
+        return success ? 0 : 1;
+#ifdef __cpp_exceptions
+    }
+    catch (const std::exception& e)
+    {
+        sync_out.println("ERROR: An exception was thrown: ", e.what());
+        return 1;
+    }
+#endif
+}
@@ -27,6 +27,7 @@ import std;
 constexpr bool using_import_std = true;
 #else
     #include <algorithm>
+    #include <array>
     #include <atomic>
     #include <chrono>
     #include <cmath>
@@ -63,6 +64,12 @@ constexpr bool using_import_std = true;
         #include <exception>
         #include <stdexcept>
     #endif
+    #ifdef __cpp_lib_jthread
+        #include <stop_token>
+    #endif
+    #ifdef __cpp_lib_memory_resource
+        #include <memory_resource>
+    #endif
     #ifdef __cpp_lib_format
         #include <format>
     #endif
@@ -77,6 +84,7 @@ static_assert(BS::thread_pool_module, "The flag BS::thread_pool_module is set to
 static_assert(BS::thread_pool_version == BS::version(BS_THREAD_POOL_TEST_VERSION), "The versions of BS_thread_pool_test.cpp and the BS.thread_pool module do not match. Aborting compilation.");
 #else
     #include "BS_thread_pool.hpp"
+    #include "BS_thread_pool_algorithms.hpp"
 static_assert(!BS::thread_pool_module, "The flag BS::thread_pool_module is set to true, but the library was not imported as a module. Aborting compilation.");
 static_assert(BS::thread_pool_version == BS::version(BS_THREAD_POOL_TEST_VERSION), "The versions of BS_thread_pool_test.cpp and BS_thread_pool.hpp do not match. Aborting compilation.");
 #endif
@@ -199,6 +207,26 @@ bool no_flags_set(const T& flags)
         });
 }
 
+/**
+ * @brief Wait until a condition becomes true, or until a timeout of 5 seconds has passed.
+ *
+ * @tparam F The type of the condition.
+ * @param condition The condition.
+ * @return `true` if the condition became true, `false` if the timeout has passed.
+ */
+template <typename F>
+bool wait_for_condition(F&& condition)
+{
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!condition())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
 // =======================================
 // Functions for generating random numbers
 // =======================================
@@ -1243,6 +1271,47 @@ void check_wait_multiple_deadlock()
     check(passed);
 }
 
+// An auxiliary thread pool used by check_wait_concurrent(). It's a global variable so that the program will not get stuck upon destruction of this pool if a waiting thread is never woken up.
+BS::thread_pool check_wait_concurrent_pool;
+
+/**
+ * @brief Check that several threads can wait for the same pool at the same time, and that a thread whose wait_for() times out does not prevent the other waiting threads from being woken up.
+ */
+void check_wait_concurrent()
+{
+    constexpr std::chrono::milliseconds short_sleep_time(10);
+    constexpr std::chrono::milliseconds long_sleep_time(100);
+    constexpr std::size_t n_waiting_tasks = 4;
+    sync_out.println("Checking that a timed out wait_for() does not prevent other threads in wait() from being woken up...");
+    BS::thread_pool pool(1);
+    std::atomic<bool> release = false;
+    pool.detach_task(
+        [&release, short_sleep_time]
+        {
+            while (!release)
+                std::this_thread::sleep_for(short_sleep_time);
+        });
+    std::atomic<std::size_t> count = 0;
+    for (std::size_t i = 0; i < n_waiting_tasks; ++i)
+    {
+        check_wait_concurrent_pool.detach_task(
+            [&pool, &count]
+            {
+                pool.wait();
+                ++count;
+            });
+    }
+    std::this_thread::sleep_for(long_sleep_time);
+    check(!pool.wait_for(short_sleep_time));
+    check(static_cast<std::size_t>(0), count.load());
+    release = true;
+    check(pool.wait_for(long_sleep_time * 50));
+    check(check_wait_concurrent_pool.wait_for(long_sleep_time * 50));
+    check(n_waiting_tasks, count.load());
+    sync_out.println("Checking that wait_for() returns immediately if there are no tasks...");
+    check(pool.wait_for(std::chrono::milliseconds(0)));
+}
+
 #ifdef __cpp_exceptions
 // An auxiliary thread pool used by check_wait_self_deadlock(). It's a global variable so that the program will not get stuck upon destruction of this pool if a deadlock actually occurs.
 BS::wdc_thread_pool check_wait_self_deadlock_pool;
@@ -1555,6 +1624,547 @@ void check_blocks()
     }
 }
 
+/**
+ * @brief Get the name of a scheduling policy.
+ *
+ * @param policy The scheduling policy.
+ * @return The name of the policy.
+ */
+std::string_view schedule_name(const BS::schedule policy)
+{
+    switch (policy)
+    {
+    case BS::schedule::static_blocks:
+        return "static_blocks";
+    case BS::schedule::dynamic:
+        return "dynamic";
+    case BS::schedule::guided:
+        return "guided";
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * @brief Check that detach_loop(), submit_loop(), detach_blocks(), or submit_blocks() work with a specific scheduling policy and chunk size, for a specific range of indices.
+ *
+ * @param pool The thread pool to check.
+ * @param random_start The first index in the loop.
+ * @param random_end The last index in the loop plus 1.
+ * @param policy The scheduling policy.
+ * @param chunk_size The chunk size.
+ * @param which_func A string naming the function to check.
+ * @return `true` if the check succeeded, `false` otherwise.
+ */
+bool check_schedule_policy(BS::thread_pool<>& pool, const std::int64_t random_start, const std::int64_t random_end, const BS::schedule policy, const std::size_t chunk_size, const std::string_view which_func)
+{
+    sync_out.println("Verifying that ", which_func, " with policy ", schedule_name(policy), " and chunk size ", chunk_size, " from ", random_start, " to ", random_end, " modifies all indices exactly once...");
+    const std::size_t num_indices = static_cast<std::size_t>(random_end - random_start);
+    std::vector<std::atomic<std::int64_t>> flags(num_indices);
+    std::atomic<bool> indices_out_of_range = false;
+    const auto loop = [&flags, random_start, random_end, &indices_out_of_range](const std::int64_t idx)
+    {
+        if (idx < random_start || idx >= random_end)
+            indices_out_of_range = true;
+        else
+            ++flags[static_cast<std::size_t>(idx - random_start)];
+    };
+    const auto block = [&loop](const std::int64_t start, const std::int64_t end)
+    {
+        for (std::int64_t idx = start; idx < end; ++idx)
+            loop(idx);
+    };
+    if (which_func == "detach_loop()")
+    {
+        pool.detach_loop(random_start, random_end, loop, policy, chunk_size);
+        pool.wait();
+    }
+    else if (which_func == "submit_loop()")
+    {
+        BS::multi_future<void> future = pool.submit_loop(random_start, random_end, loop, policy, chunk_size);
+        if (policy != BS::schedule::static_blocks && future.size() > pool.get_thread_count())
+        {
+            sync_out.println("Error: More tasks than threads were submitted!");
+            return false;
+        }
+        future.wait();
+    }
+    else if (which_func == "detach_blocks()")
+    {
+        pool.detach_blocks(random_start, random_end, block, policy, chunk_size);
+        pool.wait();
+    }
+    else
+    {
+        pool.submit_blocks(random_start, random_end, block, policy, chunk_size).wait();
+    }
+    if (indices_out_of_range)
+    {
+        sync_out.println("Error: Loop indices out of range!");
+        return false;
+    }
+    return all_flags_equal(flags, 1);
+}
+
+/**
+ * @brief Check that the overloads of detach_loop(), submit_loop(), detach_blocks(), and submit_blocks() that take a scheduling policy work, and that guided scheduling produces chunks of decreasing size.
+ */
+void check_schedule()
+{
+    constexpr std::int64_t range = 100000;
+    BS::thread_pool pool;
+    for (const BS::schedule policy : {BS::schedule::static_blocks, BS::schedule::dynamic, BS::schedule::guided})
+    {
+        for (const std::size_t chunk_size : {static_cast<std::size_t>(0), static_cast<std::size_t>(1), static_cast<std::size_t>(97)})
+        {
+            for (const std::string_view which_func : {"detach_loop()", "submit_loop()", "detach_blocks()", "submit_blocks()"})
+            {
+                const std::pair<std::int64_t, std::int64_t> indices = random_pair(-range, range);
+                check(check_schedule_policy(pool, indices.first, indices.second, policy, chunk_size, which_func));
+            }
+        }
+    }
+    sync_out.println("Verifying that the overloads with a scheduling policy and identical start and end indices do nothing...");
+    {
+        std::atomic<std::size_t> count = 0;
+        pool.detach_loop(5, 5, [&count](std::int64_t) { ++count; }, BS::schedule::dynamic);
+        pool.wait();
+        check(pool.submit_loop(5, 5, [&count](std::int64_t) { ++count; }, BS::schedule::guided).empty());
+        check(count == 0);
+    }
+    sync_out.println("Verifying that guided scheduling produces chunks of non-increasing size, no smaller than the minimum...");
+    {
+        constexpr std::size_t min_chunk = 10;
+        BS::dynamic_blocks<std::int64_t> blks(0, range, BS::schedule::guided, min_chunk, 4);
+        std::int64_t start = 0;
+        std::int64_t end = 0;
+        std::int64_t expected_start = 0;
+        std::int64_t previous_size = range;
+        bool correct = true;
+        while (blks.next(start, end))
+        {
+            const std::int64_t size = end - start;
+            correct = correct && (start == expected_start) && (size <= previous_size) && ((size >= static_cast<std::int64_t>(min_chunk)) || (end == range));
+            expected_start = end;
+            previous_size = size;
+        }
+        check(correct && (expected_start == range));
+    }
+}
+
+/**
+ * @brief Check that run_blocks() and run_loop() execute every index exactly once with the calling thread taking part, that they can be nested within the pool without deadlocking, that they finish even if the pool is paused, and that they rethrow exceptions thrown by the blocks.
+ */
+void check_run_loop()
+{
+    constexpr std::int64_t range = 10000;
+    BS::thread_pool pool;
+    const std::size_t num_threads = pool.get_thread_count();
+    sync_out.println("Verifying that run_loop() and run_blocks() execute every index exactly once...");
+    for (const std::size_t num_blocks : {static_cast<std::size_t>(0), static_cast<std::size_t>(1), num_threads * 10})
+    {
+        const std::pair<std::int64_t, std::int64_t> indices = random_pair(-range, range);
+        std::vector<std::atomic<std::size_t>> counts(static_cast<std::size_t>(indices.second - indices.first));
+        pool.run_loop(indices.first, indices.second,
+            [&counts, &indices](const std::int64_t i)
+            {
+                ++counts[static_cast<std::size_t>(i - indices.first)];
+            },
+            num_blocks);
+        pool.run_blocks(indices.first, indices.second,
+            [&counts, &indices](const std::int64_t start, const std::int64_t end)
+            {
+                for (std::int64_t i = start; i < end; ++i)
+                    ++counts[static_cast<std::size_t>(i - indices.first)];
+            },
+            num_blocks);
+        check(std::all_of(counts.begin(), counts.end(),
+            [](const std::atomic<std::size_t>& count)
+            {
+                return count == 2;
+            }));
+    }
+    sync_out.println("Verifying that run_loop() with identical start and end indices does nothing...");
+    {
+        std::atomic<std::size_t> count = 0;
+        pool.run_loop(5, 5, [&count](std::int64_t) { ++count; });
+        check(count == 0);
+    }
+    sync_out.println("Verifying that run_blocks() does not copy or move the block function...");
+    {
+        struct immovable_block
+        {
+            immovable_block() = default;
+            immovable_block(const immovable_block&) = delete;
+            immovable_block(immovable_block&&) = delete;
+            immovable_block& operator=(const immovable_block&) = delete;
+            immovable_block& operator=(immovable_block&&) = delete;
+            ~immovable_block() = default;
+            void operator()(const std::size_t start, const std::size_t end) const
+            {
+                total += end - start;
+            }
+            mutable std::atomic<std::size_t> total = 0;
+        };
+        const immovable_block block;
+        pool.run_blocks(std::size_t{0}, std::size_t{1000}, block, num_threads * 4);
+        check(1000, block.total.load());
+    }
+    sync_out.println("Verifying that the calling thread takes part in the loop...");
+    {
+        std::atomic<bool> caller_participated = false;
+        const std::thread::id caller_id = std::this_thread::get_id();
+        // The threads of the pool wait until the calling thread has run an index, or until a timeout, so the check does not depend on whether the pool's threads can claim all the blocks before the calling thread gets to run.
+        const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        pool.run_loop(std::size_t{0}, num_threads * 100,
+            [&caller_participated, caller_id, deadline](std::size_t)
+            {
+                if (std::this_thread::get_id() == caller_id)
+                {
+                    caller_participated = true;
+                    return;
+                }
+                while (!caller_participated && (std::chrono::steady_clock::now() < deadline))
+                    std::this_thread::yield();
+            },
+            num_threads * 100);
+        check(caller_participated.load());
+    }
+    sync_out.println("Verifying that nested run_loop() calls from all the threads of the pool do not deadlock...");
+    {
+        constexpr std::size_t inner_size = 1000;
+        std::atomic<std::size_t> count = 0;
+        pool.run_loop(std::size_t{0}, num_threads * 2,
+            [&pool, &count](std::size_t)
+            {
+                pool.run_loop(std::size_t{0}, inner_size,
+                    [&count](std::size_t)
+                    {
+                        ++count;
+                    });
+            });
+        check(num_threads * 2 * inner_size, count.load());
+    }
+    sync_out.println("Verifying that run_loop() finishes even if the pool is paused...");
+    {
+        BS::pause_thread_pool paused_pool;
+        paused_pool.pause();
+        std::atomic<std::size_t> count = 0;
+        paused_pool.run_loop(std::size_t{0}, std::size_t{100},
+            [&count](std::size_t)
+            {
+                ++count;
+            });
+        check(100, count.load());
+        paused_pool.purge();
+        paused_pool.unpause();
+    }
+#ifdef __cpp_exceptions
+    sync_out.println("Verifying that run_blocks() rethrows an exception thrown by a block...");
+    {
+        bool caught = false;
+        try
+        {
+            pool.run_blocks(std::size_t{0}, std::size_t{100},
+                [](const std::size_t start, const std::size_t)
+                {
+                    if (start == 0)
+                        throw std::runtime_error("Exception thrown!");
+                },
+                10);
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        check(caught);
+    }
+#endif
+    pool.wait();
+}
+
+/**
+ * @brief Check that submit_reduce() computes sums, minima and maxima, histograms, and non-commutative reductions correctly, with different index types and numbers of blocks.
+ */
+void check_reduce()
+{
+    constexpr std::int64_t range = 100000;
+    constexpr std::size_t repeats = 10;
+    BS::thread_pool pool;
+    for (std::size_t i = 0; i < repeats; ++i)
+    {
+        const std::pair<std::int64_t, std::int64_t> indices = random_pair(-range, range);
+        const std::size_t num_blocks = random<std::size_t>(1, pool.get_thread_count() * 4);
+        sync_out.println("Verifying that submit_reduce() from ", indices.first, " to ", indices.second, " with ", num_blocks, " blocks correctly sums the indices...");
+        std::int64_t correct_sum = 0;
+        for (std::int64_t j = indices.first; j < indices.second; ++j)
+            correct_sum += j;
+        check(correct_sum, pool.submit_reduce(
+                                  indices.first, indices.second,
+                                  [](const std::int64_t j)
+                                  {
+                                      return j;
+                                  },
+                                  std::plus<>(), static_cast<std::int64_t>(0), num_blocks)
+                               .get());
+    }
+    {
+        sync_out.println("Verifying that submit_reduce() works with mixed index types...");
+        const std::int16_t first = -100;
+        const std::uint8_t last = 200;
+        std::int64_t correct_sum = 0;
+        for (std::int16_t j = first; j < static_cast<std::int16_t>(last); ++j)
+            correct_sum += j * j;
+        check(correct_sum, pool.submit_reduce(
+                                  first, last,
+                                  [](const std::int16_t j)
+                                  {
+                                      return static_cast<std::int64_t>(j) * j;
+                                  },
+                                  std::plus<>(), static_cast<std::int64_t>(0))
+                               .get());
+    }
+    {
+        sync_out.println("Verifying that submit_reduce() correctly computes the minimum and maximum...");
+        const auto value = [](const std::size_t j)
+        {
+            return static_cast<std::int64_t>((j * 7919) % 10007) - 5000;
+        };
+        std::int64_t correct_min = std::numeric_limits<std::int64_t>::max();
+        std::int64_t correct_max = std::numeric_limits<std::int64_t>::min();
+        for (std::size_t j = 0; j < static_cast<std::size_t>(range); ++j)
+        {
+            correct_min = std::min(correct_min, value(j));
+            correct_max = std::max(correct_max, value(j));
+        }
+        std::future<std::int64_t> min_future = pool.submit_reduce(
+            0, static_cast<std::size_t>(range), value,
+            [](const std::int64_t a, const std::int64_t b)
+            {
+                return std::min(a, b);
+            },
+            std::numeric_limits<std::int64_t>::max());
+        std::future<std::int64_t> max_future = pool.submit_reduce(
+            0, static_cast<std::size_t>(range), value,
+            [](const std::int64_t a, const std::int64_t b)
+            {
+                return std::max(a, b);
+            },
+            std::numeric_limits<std::int64_t>::min());
+        check(correct_min, min_future.get());
+        check(correct_max, max_future.get());
+    }
+    {
+        constexpr std::size_t num_bins = 10;
+        sync_out.println("Verifying that submit_reduce() with a block map function correctly computes a histogram...");
+        const std::vector<std::size_t> histogram = pool.submit_reduce(
+                                                           0, range,
+                                                           [](const std::int64_t start, const std::int64_t end)
+                                                           {
+                                                               std::vector<std::size_t> bins(num_bins);
+                                                               for (std::int64_t j = start; j < end; ++j)
+                                                                   ++bins[static_cast<std::size_t>((j * j) % static_cast<std::int64_t>(num_bins))];
+                                                               return bins;
+                                                           },
+                                                           [](std::vector<std::size_t> a, const std::vector<std::size_t>& b)
+                                                           {
+                                                               for (std::size_t bin = 0; bin < num_bins; ++bin)
+                                                                   a[bin] += b[bin];
+                                                               return a;
+                                                           },
+                                                           std::vector<std::size_t>(num_bins))
+                                                       .get();
+        std::vector<std::size_t> correct_histogram(num_bins);
+        for (std::int64_t j = 0; j < range; ++j)
+            ++correct_histogram[static_cast<std::size_t>((j * j) % static_cast<std::int64_t>(num_bins))];
+        check(histogram == correct_histogram);
+    }
+    {
+        constexpr std::size_t length = 1000;
+        sync_out.println("Verifying that submit_reduce() combines the partial results in order for a non-commutative reduction...");
+        std::string correct_string;
+        for (std::size_t j = 0; j < length; ++j)
+            correct_string += static_cast<char>('a' + (j % 26));
+        const std::string result = pool.submit_reduce(
+                                           0, length,
+                                           [](const std::size_t j)
+                                           {
+                                               return std::string(1, static_cast<char>('a' + (j % 26)));
+                                           },
+                                           std::plus<>(), std::string(), pool.get_thread_count() * 3)
+                                       .get();
+        check(result == correct_string);
+    }
+    {
+        sync_out.println("Verifying that submit_reduce() with an empty range returns the identity element...");
+        check(static_cast<std::int64_t>(42), pool.submit_reduce(
+                                                  5, 5,
+                                                  [](const std::int64_t j)
+                                                  {
+                                                      return j;
+                                                  },
+                                                  std::plus<>(), static_cast<std::int64_t>(42))
+                                               .get());
+    }
+#ifdef __cpp_exceptions
+    {
+        sync_out.println("Verifying that submit_reduce() forwards exceptions thrown by the map function...");
+        std::future<std::int64_t> future = pool.submit_reduce(
+            0, range,
+            [](const std::int64_t j)
+            {
+                if (j == range / 2)
+                    throw std::runtime_error("Exception thrown by the map function!");
+                return j;
+            },
+            std::plus<>(), static_cast<std::int64_t>(0));
+        bool caught = false;
+        try
+        {
+            future.get();
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        check(caught);
+    }
+#endif
+}
+
+// ================================================
+// Functions to verify the parallel algorithm suite
+// ================================================
+
+/**
+ * @brief Check that the parallel algorithms in the namespace `BS::parallel` produce the same results as the corresponding sequential Standard Library algorithms, with different numbers of threads and range sizes, including empty ranges and ranges smaller than the number of threads.
+ */
+void check_parallel_algorithms()
+{
+    constexpr std::array<std::size_t, 4> thread_counts = {1, 3, 4, 7};
+    constexpr std::array<std::size_t, 5> sizes = {0, 1, 5, 1000, 100001};
+    for (const std::size_t num_threads : thread_counts)
+    {
+        BS::thread_pool pool(num_threads);
+        for (const std::size_t size : sizes)
+        {
+            sync_out.println("Verifying the parallel algorithms with ", num_threads, " threads and ", size, " elements...");
+            std::vector<std::int64_t> values(size);
+            for (std::int64_t& value : values)
+                value = random<std::int64_t>(-1000, 1000);
+
+            std::vector<std::int64_t> for_each_values = values;
+            BS::parallel::for_each(pool, for_each_values.begin(), for_each_values.end(),
+                [](std::int64_t& value)
+                {
+                    value *= 3;
+                });
+            bool for_each_correct = true;
+            for (std::size_t i = 0; i < size; ++i)
+                for_each_correct = for_each_correct && (for_each_values[i] == values[i] * 3);
+            check(for_each_correct);
+
+            const auto square = [](const std::int64_t value)
+            {
+                return value * value;
+            };
+            std::vector<std::int64_t> transformed(size);
+            std::vector<std::int64_t> correct_transformed(size);
+            check(BS::parallel::transform(pool, values.begin(), values.end(), transformed.begin(), square) == transformed.end());
+            std::transform(values.begin(), values.end(), correct_transformed.begin(), square);
+            check(transformed == correct_transformed);
+            BS::parallel::transform(pool, values.begin(), values.end(), for_each_values.begin(), transformed.begin(), std::minus<>());
+            std::transform(values.begin(), values.end(), for_each_values.begin(), correct_transformed.begin(), std::minus<>());
+            check(transformed == correct_transformed);
+
+            check(std::accumulate(values.begin(), values.end(), static_cast<std::int64_t>(7)), BS::parallel::reduce(pool, values.begin(), values.end(), static_cast<std::int64_t>(7)));
+            check(std::accumulate(values.begin(), values.end(), static_cast<std::int64_t>(0)), BS::parallel::reduce(pool, values.begin(), values.end()));
+            std::vector<std::string> strings(size);
+            for (std::size_t i = 0; i < size; ++i)
+                strings[i] = std::string(1, static_cast<char>('a' + (i % 26)));
+            check(std::accumulate(strings.begin(), strings.end(), std::string(">")) == BS::parallel::reduce(pool, strings.begin(), strings.end(), std::string(">")));
+
+            std::vector<std::int64_t> scanned(size);
+            std::vector<std::int64_t> correct_scanned(size);
+            check(BS::parallel::inclusive_scan(pool, values.begin(), values.end(), scanned.begin()) == scanned.end());
+            std::inclusive_scan(values.begin(), values.end(), correct_scanned.begin());
+            check(scanned == correct_scanned);
+            BS::parallel::exclusive_scan(pool, values.begin(), values.end(), scanned.begin(), static_cast<std::int64_t>(5));
+            std::exclusive_scan(values.begin(), values.end(), correct_scanned.begin(), static_cast<std::int64_t>(5));
+            check(scanned == correct_scanned);
+            scanned = values;
+            BS::parallel::inclusive_scan(pool, scanned.begin(), scanned.end(), scanned.begin(),
+                [](const std::int64_t a, const std::int64_t b)
+                {
+                    return std::max(a, b);
+                });
+            std::inclusive_scan(values.begin(), values.end(), correct_scanned.begin(),
+                [](const std::int64_t a, const std::int64_t b)
+                {
+                    return std::max(a, b);
+                });
+            check(scanned == correct_scanned);
+
+            std::vector<std::int64_t> sorted = values;
+            std::vector<std::int64_t> correct_sorted = values;
+            BS::parallel::sort(pool, sorted.begin(), sorted.end());
+            std::sort(correct_sorted.begin(), correct_sorted.end());
+            check(sorted == correct_sorted);
+            BS::parallel::sort(pool, sorted.begin(), sorted.end(), std::greater<>());
+            std::sort(correct_sorted.begin(), correct_sorted.end(), std::greater<>());
+            check(sorted == correct_sorted);
+            // Move-only elements verify that the merges only move the elements between the range and the temporary buffer, and never copy them.
+            std::vector<std::unique_ptr<std::int64_t>> pointers;
+            pointers.reserve(size);
+            for (const std::int64_t value : values)
+                pointers.push_back(std::make_unique<std::int64_t>(value));
+            BS::parallel::sort(pool, pointers.begin(), pointers.end(),
+                [](const std::unique_ptr<std::int64_t>& first, const std::unique_ptr<std::int64_t>& second)
+                {
+                    return *first < *second;
+                });
+            std::sort(correct_sorted.begin(), correct_sorted.end());
+            check(std::equal(pointers.begin(), pointers.end(), correct_sorted.begin(), correct_sorted.end(),
+                [](const std::unique_ptr<std::int64_t>& pointer, const std::int64_t value)
+                {
+                    return *pointer == value;
+                }));
+
+            const auto is_even = [](const std::int64_t value)
+            {
+                return value % 2 == 0;
+            };
+            std::vector<std::int64_t> copied(size);
+            std::vector<std::int64_t> correct_copied;
+            const std::vector<std::int64_t>::iterator copied_end = BS::parallel::copy_if(pool, values.begin(), values.end(), copied.begin(), is_even);
+            std::copy_if(values.begin(), values.end(), std::back_inserter(correct_copied), is_even);
+            check(std::vector<std::int64_t>(copied.begin(), copied_end) == correct_copied);
+        }
+    }
+#ifdef __cpp_exceptions
+    {
+        sync_out.println("Verifying that the parallel algorithms forward exceptions thrown by the user-supplied functions...");
+        BS::thread_pool pool(4);
+        std::vector<std::int64_t> values(1000);
+        bool caught = false;
+        try
+        {
+            BS::parallel::for_each(pool, values.begin(), values.end(),
+                [&values](const std::int64_t& value)
+                {
+                    if (&value == &values[500])
+                        throw std::runtime_error("Exception thrown by the function!");
+                });
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        check(caught);
+    }
+#endif
+}
+
 // ============================================
 // Functions to verify sequence parallelization
 // ============================================
@@ -1699,364 +2309,2688 @@ void check_sequence()
     }
 }
 
-// ===============================================
-// Functions to verify task monitoring and control
-// ===============================================
+// ===================================
+// Functions to verify grouped results
+// ===================================
 
 /**
- * @brief Check that task monitoring works.
+ * @brief Check that submit_sequence_grouped() and submit_blocks_grouped() return a `BS::group_future` which waits for all the tasks and stores their results in order.
  */
-void check_task_monitoring()
+void check_grouped()
 {
-    constexpr std::chrono::milliseconds sleep_time(300);
-    const std::size_t num_threads = std::min<std::size_t>(std::thread::hardware_concurrency(), 4);
-    sync_out.println("Creating pool with ", num_threads, " threads.");
-    BS::thread_pool pool(num_threads);
-    sync_out.println("Submitting ", num_threads * 3, " tasks.");
-    BS::counting_semaphore sem(0);
-    for (std::size_t i = 0; i < num_threads * 3; ++i)
+    constexpr std::int64_t range = 1000;
+    BS::thread_pool pool;
     {
-        pool.detach_task(
-            [i, &sem]
+        const std::pair<std::int64_t, std::int64_t> indices = random_pair(-range, range);
+        sync_out.println("Verifying that submit_sequence_grouped() from ", indices.first, " to ", indices.second, " stores the squares of all indices in order...");
+        const BS::group_future<std::int64_t> future = pool.submit_sequence_grouped(indices.first, indices.second,
+            [](const std::int64_t index)
             {
-                sem.acquire();
-                sync_out.println("Task ", i, " released.");
+                return index * index;
             });
+        const std::vector<std::int64_t>& squares = future.get();
+        check(static_cast<std::size_t>(indices.second - indices.first), future.size());
+        check(future.size(), future.ready_count());
+        bool all_correct = squares.size() == future.size();
+        for (std::size_t i = 0; all_correct && i < squares.size(); ++i)
+        {
+            const std::int64_t index = indices.first + static_cast<std::int64_t>(i);
+            all_correct = squares[i] == index * index;
+        }
+        check(all_correct);
+        sync_out.println("Verifying that copies of the BS::group_future share the same results, without copying them...");
+        const BS::group_future<std::int64_t> copy = future;
+        check(&squares == &copy.get());
     }
+    {
+        const std::pair<std::int64_t, std::int64_t> indices = random_pair(-range, range);
+        sync_out.println("Verifying that submit_blocks_grouped() from ", indices.first, " to ", indices.second, " with 7 blocks correctly sums all squares of indices...");
+        const BS::group_future<std::int64_t> future = pool.submit_blocks_grouped(
+            indices.first, indices.second,
+            [](const std::int64_t start, const std::int64_t end)
+            {
+                std::int64_t total = 0;
+                for (std::int64_t i = start; i < end; ++i)
+                    total += i * i;
+                return total;
+            },
+            7);
+        std::int64_t sum = 0;
+        for (const std::int64_t partial_sum : future.get())
+            sum += partial_sum;
+        std::int64_t correct_sum = 0;
+        for (std::int64_t i = indices.first; i < indices.second; ++i)
+            correct_sum += i * i;
+        check(correct_sum, sum);
+        check(future.size(), future.ready_count());
+    }
+    {
+        const std::pair<std::int64_t, std::int64_t> indices = random_pair(-range, range);
+        sync_out.println("Verifying that submit_sequence_grouped() from ", indices.first, " to ", indices.second, " with no return value modifies all indices exactly once...");
+        std::vector<std::atomic<std::int64_t>> flags(static_cast<std::size_t>(indices.second - indices.first));
+        pool.submit_sequence_grouped(indices.first, indices.second,
+                [&flags, first = indices.first](const std::int64_t index)
+                {
+                    ++flags[static_cast<std::size_t>(index - first)];
+                })
+            .wait();
+        check(all_flags_equal(flags, 1));
+    }
+    sync_out.println("Verifying that submit_sequence_grouped() with end index smaller than the start index returns a ready BS::group_future with no results...");
+    {
+        std::atomic<std::size_t> count = 0;
+        const std::pair<std::int64_t, std::int64_t> indices = random_pair(-range, range);
+        const BS::group_future<std::size_t> future = pool.submit_sequence_grouped(indices.second, indices.first,
+            [&count](const std::int64_t)
+            {
+                return ++count;
+            });
+        check(future.valid() && future.size() == 0 && future.ready_count() == 0 && future.wait_for(std::chrono::milliseconds(0)) && future.get().empty());
+        check(count == 0);
+    }
+    sync_out.println("Verifying that a default-constructed BS::group_future is not valid...");
+    check(!BS::group_future<void>().valid());
+    sync_out.println("Verifying that BS::group_future::wait_for() times out while the tasks are still running...");
+    {
+        std::promise<void> release;
+        const std::shared_future<void> released = release.get_future().share();
+        const BS::group_future<void> future = pool.submit_sequence_grouped(0, 4,
+            [&released](const int)
+            {
+                released.wait();
+            });
+        check(!future.wait_for(std::chrono::milliseconds(10)));
+        check(future.ready_count() < future.size());
+        release.set_value();
+        check(future.wait_until(std::chrono::steady_clock::now() + std::chrono::seconds(5)));
+        check(future.size(), future.ready_count());
+    }
+}
+
+// ====================================
+// Functions to verify batch submission
+// ====================================
+
+/**
+ * @brief Check that detach_batch() and submit_batch() work with both iterator ranges and generators, and that a batch wakes up all the idle threads it needs.
+ */
+void check_batch()
+{
+    constexpr std::size_t num_tasks = 1000;
+    BS::thread_pool pool;
+    {
+        sync_out.println("Verifying that detach_batch() with a generator executes each of ", num_tasks, " tasks exactly once...");
+        std::vector<std::atomic<std::size_t>> flags(num_tasks);
+        pool.detach_batch(num_tasks,
+            [&flags](const std::size_t i)
+            {
+                return [&flags, i]
+                {
+                    ++flags[i];
+                };
+            });
+        pool.wait();
+        check(all_flags_equal(flags, static_cast<std::size_t>(1)));
+    }
+    {
+        sync_out.println("Verifying that detach_batch() with an iterator range executes each of ", num_tasks, " tasks exactly once...");
+        std::vector<std::atomic<std::size_t>> flags(num_tasks);
+        std::vector<std::function<void()>> functions;
+        functions.reserve(num_tasks);
+        for (std::size_t i = 0; i < num_tasks; ++i)
+        {
+            functions.emplace_back(
+                [&flags, i]
+                {
+                    ++flags[i];
+                });
+        }
+        pool.detach_batch(functions.begin(), functions.end());
+        pool.wait();
+        check(all_flags_equal(flags, static_cast<std::size_t>(1)));
+    }
+    {
+        sync_out.println("Verifying that detach_batch() can move move-only tasks out of a range...");
+        std::atomic<std::size_t> counter = 0;
+        std::vector<BS::small_task> tasks;
+        tasks.reserve(num_tasks);
+        for (std::size_t i = 0; i < num_tasks; ++i)
+        {
+            tasks.emplace_back(
+                [&counter, unique = std::make_unique<std::size_t>(1)]
+                {
+                    counter += *unique;
+                });
+        }
+        pool.detach_batch(std::make_move_iterator(tasks.begin()), std::make_move_iterator(tasks.end()));
+        pool.wait();
+        check(num_tasks, counter.load());
+    }
+    {
+        sync_out.println("Verifying that submit_batch() with a generator returns the correct values...");
+        const std::vector<std::size_t> results = pool.submit_batch(num_tasks,
+                                                          [](const std::size_t i)
+                                                          {
+                                                              return [i]
+                                                              {
+                                                                  return i * i;
+                                                              };
+                                                          })
+                                                     .get();
+        bool correct = (results.size() == num_tasks);
+        for (std::size_t i = 0; correct && (i < num_tasks); ++i)
+            correct = (results[i] == i * i);
+        check(correct);
+    }
+    {
+        sync_out.println("Verifying that submit_batch() with an iterator range returns the correct values...");
+        std::vector<std::function<std::size_t()>> functions;
+        functions.reserve(num_tasks);
+        for (std::size_t i = 0; i < num_tasks; ++i)
+        {
+            functions.emplace_back(
+                [i]
+                {
+                    return i + 1;
+                });
+        }
+        const std::vector<std::size_t> results = pool.submit_batch(functions.cbegin(), functions.cend()).get();
+        bool correct = (results.size() == num_tasks);
+        for (std::size_t i = 0; correct && (i < num_tasks); ++i)
+            correct = (results[i] == i + 1);
+        check(correct);
+    }
+    {
+        sync_out.println("Verifying that submit_batch() with an empty batch returns an empty BS::multi_future...");
+        std::vector<std::function<void()>> functions;
+        check(pool.submit_batch(functions.begin(), functions.end()).empty());
+        check(pool.submit_batch(0, [](std::size_t) { return [] {}; }).empty());
+    }
+    {
+        const std::size_t num_threads = pool.get_thread_count();
+        sync_out.println("Verifying that a batch of ", num_threads, " tasks wakes up all ", num_threads, " idle threads...");
+        std::atomic<std::size_t> started = 0;
+        std::atomic<bool> all_started = true;
+        pool.detach_batch(num_threads,
+            [&started, &all_started, num_threads](std::size_t)
+            {
+                return [&started, &all_started, num_threads]
+                {
+                    ++started;
+                    const std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+                    while (started < num_threads && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    if (started < num_threads)
+                        all_started = false;
+                };
+            });
+        pool.wait();
+        check(all_started.load());
+    }
+    {
+        sync_out.println("Verifying that detach_batch() works from within a work-stealing pool...");
+        BS::ws_thread_pool ws_pool;
+        std::atomic<std::size_t> counter = 0;
+        ws_pool.detach_task(
+            [&ws_pool, &counter]
+            {
+                ws_pool.detach_batch(num_tasks,
+                    [&counter](std::size_t)
+                    {
+                        return [&counter]
+                        {
+                            ++counter;
+                        };
+                    });
+            });
+        ws_pool.wait();
+        check(num_tasks, counter.load());
+    }
+}
+
+// =================================================
+// Functions to verify continuations and task graphs
+// =================================================
+
+/**
+ * @brief Check that submit_continuable(), then(), and when_all() produce the correct results, propagate exceptions, and run continuations on the pool.
+ */
+void check_continuations()
+{
+    BS::thread_pool pool(4);
+    sync_out.println("Verifying that a chain of continuations produces the correct result...");
+    const BS::continuable_future<std::int64_t> first = pool.submit_continuable(
+        []
+        {
+            return static_cast<std::int64_t>(21);
+        });
+    const BS::continuable_future<std::string> chain = first
+                                                          .then(pool,
+                                                              [](const std::int64_t value)
+                                                              {
+                                                                  return value * 2;
+                                                              })
+                                                          .then(pool,
+                                                              [](const std::int64_t value)
+                                                              {
+                                                                  return std::to_string(value);
+                                                              });
+    check(chain.get() == "42");
+    check(first.get() == 21);
+
+    sync_out.println("Verifying that continuations run in the pool's threads...");
+    const std::thread::id caller_id = std::this_thread::get_id();
+    const BS::continuable_future<bool> in_pool = first.then(pool,
+        [caller_id](std::int64_t)
+        {
+            return BS::this_thread::get_pool().has_value() && std::this_thread::get_id() != caller_id;
+        });
+    check(in_pool.get());
+
+    sync_out.println("Verifying that continuations of tasks with no return value work...");
+    std::atomic<bool> flag = false;
+    const BS::continuable_future<void> void_chain = pool.submit_continuable(
+                                                            [&flag]
+                                                            {
+                                                                flag = true;
+                                                            })
+                                                        .then(pool,
+                                                            [&flag]
+                                                            {
+                                                                return flag.load();
+                                                            })
+                                                        .then(pool,
+                                                            [](const bool value)
+                                                            {
+                                                                if (!value)
+                                                                    sync_out.println("The continuation ran before the previous task finished!");
+                                                            });
+    void_chain.wait();
+    check(flag.load());
+
+    sync_out.println("Verifying that when_all() combines the results in order...");
+    constexpr std::size_t num_futures = 100;
+    std::vector<BS::continuable_future<std::size_t>> futures;
+    for (std::size_t i = 0; i < num_futures; ++i)
+    {
+        futures.push_back(pool.submit_continuable(
+            [i]
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds((i * 37) % 100));
+                return i;
+            }));
+    }
+    const std::vector<std::size_t> results = BS::when_all(futures).get();
+    bool in_order = results.size() == num_futures;
+    for (std::size_t i = 0; in_order && i < num_futures; ++i)
+        in_order = results[i] == i;
+    check(in_order);
+    const BS::continuable_future<std::size_t> total = BS::when_all(futures).then(pool,
+        [](const std::vector<std::size_t>& values)
+        {
+            return std::accumulate(values.begin(), values.end(), static_cast<std::size_t>(0));
+        });
+    check(num_futures * (num_futures - 1) / 2, total.get());
+    check(BS::when_all(std::vector<BS::continuable_future<void>>()).wait_for(std::chrono::milliseconds(0)));
+
+#ifdef __cpp_exceptions
+    sync_out.println("Verifying that exceptions propagate through continuations and when_all()...");
+    bool continuation_ran = false;
+    const BS::continuable_future<std::int64_t> failed = pool.submit_continuable(
+                                                                []() -> std::int64_t
+                                                                {
+                                                                    throw std::runtime_error("Exception thrown by the task!");
+                                                                })
+                                                            .then(pool,
+                                                                [&continuation_ran](const std::int64_t value)
+                                                                {
+                                                                    continuation_ran = true;
+                                                                    return value;
+                                                                });
+    bool caught = false;
+    try
+    {
+        std::vector<BS::continuable_future<std::int64_t>> with_failure = {first, failed};
+        static_cast<void>(BS::when_all(with_failure).get());
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    check(caught && !continuation_ran);
+#endif
+}
+
+/**
+ * @brief Check that a task graph runs every task exactly once and only after all of its dependencies, can be run more than once, and skips the remaining tasks if a task throws an exception.
+ */
+void check_task_graph()
+{
+    BS::thread_pool pool(4);
+    constexpr std::size_t num_layers = 10;
+    constexpr std::size_t layer_width = 20;
+    sync_out.println("Verifying that a layered task graph with ", num_layers, " layers of ", layer_width, " tasks respects all dependencies...");
+    BS::task_graph graph;
+    std::vector<std::atomic<std::size_t>> finish_order(num_layers * layer_width);
+    std::vector<std::atomic<std::size_t>> run_count(num_layers * layer_width);
+    std::atomic<std::size_t> counter = 0;
+    std::vector<std::vector<BS::task_graph::task_id>> dependencies(num_layers * layer_width);
+    for (std::size_t layer = 0; layer < num_layers; ++layer)
+    {
+        for (std::size_t i = 0; i < layer_width; ++i)
+        {
+            const std::size_t index = (layer * layer_width) + i;
+            if (layer > 0)
+            {
+                // Each task depends on between one and three random tasks in the previous layer.
+                const std::size_t num_dependencies = random<std::size_t>(1, 3);
+                for (std::size_t d = 0; d < num_dependencies; ++d)
+                    dependencies[index].push_back(((layer - 1) * layer_width) + random<std::size_t>(0, layer_width - 1));
+            }
+            check(index, graph.add_task(
+                             [&finish_order, &run_count, &counter, index]
+                             {
+                                 ++run_count[index];
+                                 finish_order[index] = counter++;
+                             },
+                             dependencies[index]));
+        }
+    }
+    check(num_layers * layer_width, graph.get_task_count());
+    for (std::size_t run = 0; run < 2; ++run)
+    {
+        for (std::atomic<std::size_t>& count : run_count)
+            count = 0;
+        counter = 0;
+        graph.run(pool).get();
+        bool all_once = true;
+        bool respects_dependencies = true;
+        for (std::size_t index = 0; index < num_layers * layer_width; ++index)
+        {
+            all_once = all_once && (run_count[index] == 1);
+            for (const BS::task_graph::task_id dependency : dependencies[index])
+                respects_dependencies = respects_dependencies && (finish_order[dependency] < finish_order[index]);
+        }
+        check(all_once && respects_dependencies);
+    }
+
+    sync_out.println("Verifying that an empty task graph completes immediately...");
+    check(BS::task_graph().run(pool).wait_for(std::chrono::milliseconds(0)));
+
+    sync_out.println("Verifying that the graph's tasks outlive the graph object...");
+    std::atomic<bool> ran = false;
+    BS::continuable_future<void> detached_run;
+    {
+        BS::binary_semaphore semaphore(0);
+        BS::task_graph temporary;
+        const BS::task_graph::task_id blocker = temporary.add_task(
+            [&semaphore]
+            {
+                semaphore.acquire();
+            });
+        temporary.add_task(
+            [&ran]
+            {
+                ran = true;
+            },
+            {blocker});
+        detached_run = temporary.run(pool);
+        semaphore.release();
+    }
+    detached_run.wait();
+    check(ran.load());
+
+#ifdef __cpp_exceptions
+    sync_out.println("Verifying that an exception thrown by a task skips its dependents and is stored in the future...");
+    BS::task_graph failing;
+    std::atomic<bool> dependent_ran = false;
+    const BS::task_graph::task_id thrower = failing.add_task(
+        []
+        {
+            throw std::runtime_error("Exception thrown by the task!");
+        });
+    failing.add_task(
+        [&dependent_ran]
+        {
+            dependent_ran = true;
+        },
+        {thrower});
+    bool caught = false;
+    try
+    {
+        failing.run(pool).get();
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    check(caught && !dependent_ran);
+#endif
+}
+
+// ===============================
+// Functions to verify task groups
+// ===============================
+
+/**
+ * @brief Check that task groups wait only for their own tasks, can be cancelled, collect statistics, and let a waiting thread of the pool run the group's tasks itself.
+ */
+void check_task_group()
+{
+    {
+        BS::thread_pool pool(2);
+        sync_out.println("Verifying that waiting for a task group does not wait for other tasks in the pool...");
+        BS::binary_semaphore blocker(0);
+        pool.detach_task(
+            [&blocker]
+            {
+                blocker.acquire();
+            });
+        constexpr std::size_t num_tasks = 100;
+        std::atomic<std::size_t> count = 0;
+        BS::task_group group(pool);
+        for (std::size_t i = 0; i < num_tasks; ++i)
+        {
+            group.detach_task(
+                [&count]
+                {
+                    ++count;
+                });
+        }
+        std::future<std::size_t> future = group.submit_task(
+            []
+            {
+                return static_cast<std::size_t>(42);
+            });
+        group.wait();
+        check(num_tasks, count.load());
+        check(std::size_t{42}, future.get());
+        check(std::size_t{0}, group.get_tasks_total());
+        check(pool.get_tasks_total() > 0);
+
+        sync_out.println("Verifying that the task group's statistics count the submitted and completed tasks...");
+        BS::task_group_statistics stats = group.get_statistics();
+        check(num_tasks + 1, stats.tasks_submitted);
+        check(num_tasks + 1, stats.tasks_completed);
+        check(std::size_t{0}, stats.tasks_cancelled);
+        check(std::size_t{0}, stats.tasks_failed);
+        blocker.release();
+        pool.wait();
+    }
+
+    {
+        BS::thread_pool pool(1);
+        sync_out.println("Verifying that wait_for() times out and cancel() discards the tasks that have not started...");
+        BS::binary_semaphore blocker(0);
+        BS::task_group group(pool);
+        std::atomic<std::size_t> count = 0;
+        group.detach_task(
+            [&blocker]
+            {
+                blocker.acquire();
+            });
+        constexpr std::size_t num_tasks = 10;
+        for (std::size_t i = 0; i < num_tasks; ++i)
+        {
+            group.detach_task(
+                [&count]
+                {
+                    ++count;
+                });
+        }
+        std::future<void> dropped = group.submit_task([] {});
+        check(!group.wait_for(std::chrono::milliseconds(10)));
+        // Wait for the blocker to start, so that all the other tasks are still queued when cancelling.
+        while (group.get_tasks_running() == 0)
+            std::this_thread::yield();
+        check(num_tasks + 1, group.get_tasks_queued());
+        check(num_tasks + 1, group.cancel());
+        blocker.release();
+        check(group.wait_for(std::chrono::seconds(10)));
+        check(std::size_t{0}, count.load());
+        check(num_tasks + 1, group.get_statistics().tasks_cancelled);
+#ifdef __cpp_exceptions
+        bool broken = false;
+        try
+        {
+            dropped.get();
+        }
+        catch (const std::future_error& e)
+        {
+            broken = (e.code() == std::future_errc::broken_promise);
+        }
+        check(broken);
+
+        sync_out.println("Verifying that exceptions thrown by detached tasks in the group are counted...");
+        group.detach_task(
+            []
+            {
+                throw std::runtime_error("Exception thrown by the task!");
+            });
+        group.wait();
+        check(std::size_t{1}, group.get_statistics().tasks_failed);
+#endif
+    }
+
+    {
+        BS::thread_pool pool(1);
+        sync_out.println("Verifying that waiting for a task group from within the only thread of the pool runs the group's tasks instead of deadlocking...");
+        constexpr std::size_t num_tasks = 10;
+        std::atomic<std::size_t> count = 0;
+        std::size_t helped = 0;
+        pool.submit_task(
+                [&pool, &count, &helped]
+                {
+                    BS::task_group group(pool);
+                    for (std::size_t i = 0; i < num_tasks; ++i)
+                    {
+                        group.detach_task(
+                            [&count]
+                            {
+                                ++count;
+                            });
+                    }
+                    group.wait();
+                    helped = group.get_statistics().tasks_helped;
+                })
+            .wait();
+        check(num_tasks, count.load());
+        check(num_tasks, helped);
+    }
+}
+
+// ===================================
+// Functions to verify fair scheduling
+// ===================================
+
+/**
+ * @brief Busy-wait for the given duration, to simulate a task which uses the CPU.
+ *
+ * @param duration The duration.
+ */
+void spin_for(const std::chrono::microseconds duration)
+{
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end)
+    {
+    }
+}
+
+/**
+ * @brief Submit tasks which spin for the given durations to two fair queues sharing a single-threaded pool, while the thread is blocked so that all of them are waiting when it is released, and count how many of the first tasks to run belong to the first queue.
+ *
+ * @param weight1 The weight of the first queue.
+ * @param weight2 The weight of the second queue.
+ * @param duration1 The duration of the tasks of the first queue.
+ * @param duration2 The duration of the tasks of the second queue.
+ * @param num_counted The number of tasks to count, from the start.
+ * @return The number of tasks of the first queue among the first `num_counted` tasks to run.
+ */
+std::size_t check_fair_share(const std::uint32_t weight1, const std::uint32_t weight2, const std::chrono::microseconds duration1, const std::chrono::microseconds duration2, const std::size_t num_counted)
+{
+    BS::thread_pool pool(1);
+    BS::fair_scheduler scheduler(pool);
+    BS::fair_queue queue1(scheduler, weight1);
+    BS::fair_queue queue2(scheduler, weight2);
+    BS::binary_semaphore blocker(0);
+    pool.detach_task(
+        [&blocker]
+        {
+            blocker.acquire();
+        });
+    std::vector<std::size_t> order;
+    for (std::size_t i = 0; i < num_counted; ++i)
+    {
+        queue1.detach_task(
+            [&order, duration1]
+            {
+                spin_for(duration1);
+                order.push_back(1);
+            });
+        queue2.detach_task(
+            [&order, duration2]
+            {
+                spin_for(duration2);
+                order.push_back(2);
+            });
+    }
+    blocker.release();
+    queue1.wait();
+    queue2.wait();
+    return static_cast<std::size_t>(std::count(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(num_counted), 1));
+}
+
+/**
+ * @brief Check that fair queues sharing a pool through a `BS::fair_scheduler` wait, purge, and pause independently of each other, that their share of the threads' time follows their weights and accounts for the duration of their tasks, and that waiting for a queue from a thread of the pool runs the queue's tasks instead of deadlocking.
+ */
+void check_fair_scheduler()
+{
+    {
+        sync_out.println("Verifying that waiting for a fair queue does not wait for the other queues...");
+        BS::thread_pool pool(2);
+        BS::fair_scheduler scheduler(pool);
+        BS::fair_queue fast(scheduler);
+        BS::fair_queue slow(scheduler);
+        BS::binary_semaphore blocker(0);
+        slow.detach_task(
+            [&blocker]
+            {
+                blocker.acquire();
+            });
+        constexpr std::size_t num_tasks = 100;
+        std::atomic<std::size_t> count = 0;
+        for (std::size_t i = 0; i < num_tasks; ++i)
+        {
+            fast.detach_task(
+                [&count]
+                {
+                    ++count;
+                });
+        }
+        std::future<std::size_t> future = fast.submit_task(
+            []
+            {
+                return static_cast<std::size_t>(42);
+            });
+        fast.wait();
+        check(num_tasks, count.load());
+        check(std::size_t{42}, future.get());
+        check(std::size_t{0}, fast.get_tasks_total());
+        check(std::size_t{1}, slow.get_tasks_running());
+        check(!slow.wait_for(std::chrono::milliseconds(10)));
+        blocker.release();
+        slow.wait();
+        check(std::size_t{0}, slow.get_tasks_total());
+    }
+    {
+        sync_out.println("Verifying that pausing and purging a fair queue does not affect the other queues...");
+        BS::thread_pool pool(2);
+        BS::fair_scheduler scheduler(pool);
+        BS::fair_queue paused(scheduler);
+        BS::fair_queue running(scheduler);
+        constexpr std::size_t num_tasks = 10;
+        std::atomic<std::size_t> paused_count = 0;
+        std::atomic<std::size_t> running_count = 0;
+        paused.pause();
+        check(paused.is_paused());
+        for (std::size_t i = 0; i < num_tasks; ++i)
+        {
+            paused.detach_task(
+                [&paused_count]
+                {
+                    ++paused_count;
+                });
+            running.detach_task(
+                [&running_count]
+                {
+                    ++running_count;
+                });
+        }
+        running.wait();
+        paused.wait();
+        check(num_tasks, running_count.load());
+        check(std::size_t{0}, paused_count.load());
+        check(num_tasks, paused.get_tasks_queued());
+        check(num_tasks, paused.purge());
+        check(std::size_t{0}, paused.get_tasks_queued());
+        for (std::size_t i = 0; i < num_tasks; ++i)
+        {
+            paused.detach_task(
+                [&paused_count]
+                {
+                    ++paused_count;
+                });
+        }
+        paused.unpause();
+        check(!paused.is_paused());
+        paused.wait();
+        check(num_tasks, paused_count.load());
+    }
+    {
+        sync_out.println("Verifying that a fair queue with 3 times the weight runs about 3 times as many tasks of the same duration...");
+        const std::size_t count = check_fair_share(3, 1, std::chrono::milliseconds(1), std::chrono::milliseconds(1), 200);
+        sync_out.println("-> ", count, " of the first 200 tasks belong to the queue with the higher weight.");
+        check(count >= 120 && count <= 180);
+    }
+    {
+        sync_out.println("Verifying that fair queues with equal weights get equal time, even if the tasks of one of them are 3 times as short...");
+        const std::size_t count = check_fair_share(1, 1, std::chrono::milliseconds(1), std::chrono::milliseconds(3), 200);
+        sync_out.println("-> ", count, " of the first 200 tasks belong to the queue with the shorter tasks.");
+        check(count >= 120 && count <= 180);
+    }
+    {
+        sync_out.println("Verifying that waiting for a fair queue from a thread of the same pool does not deadlock...");
+        BS::thread_pool pool(1);
+        BS::fair_scheduler scheduler(pool);
+        BS::fair_queue queue(scheduler);
+        constexpr std::size_t num_tasks = 10;
+        std::atomic<std::size_t> count = 0;
+        pool.submit_task(
+                [&queue, &count]
+                {
+                    for (std::size_t i = 0; i < num_tasks; ++i)
+                    {
+                        queue.detach_task(
+                            [&count]
+                            {
+                                ++count;
+                            });
+                    }
+                    queue.wait();
+                })
+            .wait();
+        check(num_tasks, count.load());
+    }
+    {
+        sync_out.println("Verifying that the tasks of a fair queue still run after the pool is purged...");
+        BS::thread_pool pool(1);
+        BS::fair_scheduler scheduler(pool);
+        BS::fair_queue queue(scheduler);
+        BS::binary_semaphore blocker(0);
+        pool.detach_task(
+            [&blocker]
+            {
+                blocker.acquire();
+            });
+        constexpr std::size_t num_tasks = 10;
+        std::atomic<std::size_t> count = 0;
+        for (std::size_t i = 0; i < num_tasks; ++i)
+        {
+            queue.detach_task(
+                [&count]
+                {
+                    ++count;
+                });
+        }
+        // The pool's only thread is blocked, so this discards all the dispatch tasks of the scheduler, but not the tasks of the queue.
+        pool.purge();
+        blocker.release();
+        pool.wait();
+        check(std::size_t{0}, count.load());
+        check(num_tasks, queue.get_tasks_queued());
+        check(queue.wait_for(std::chrono::seconds(10)));
+        check(num_tasks, count.load());
+        pool.detach_task(
+            [&blocker]
+            {
+                blocker.acquire();
+            });
+        for (std::size_t i = 0; i < num_tasks; ++i)
+        {
+            queue.detach_task(
+                [&count]
+                {
+                    ++count;
+                });
+        }
+        pool.purge();
+        blocker.release();
+        pool.wait();
+        queue.detach_task(
+            [&count]
+            {
+                ++count;
+            });
+        pool.wait();
+        check((2 * num_tasks) + 1, count.load());
+    }
+}
+
+#if defined(__cpp_impl_coroutine) && defined(__cpp_lib_coroutine)
+// ======================================
+// Functions to verify coroutine support
+// ======================================
+
+/**
+ * @brief A coroutine which resumes in the given pool, records whether it is running in a thread of that pool, and returns twice its argument.
+ *
+ * @param pool The thread pool.
+ * @param value The value to double.
+ * @param in_pool A reference to a flag which will be cleared if the coroutine resumes outside the pool.
+ * @return A task with twice the value.
+ */
+BS::task<std::int64_t> coroutine_double(BS::thread_pool<>& pool, const std::int64_t value, std::atomic<bool>& in_pool)
+{
+    co_await pool.schedule();
+    if (BS::this_thread::get_pool() != static_cast<void*>(&pool))
+        in_pool = false;
+    co_return value * 2;
+}
+
+/**
+ * @brief A coroutine which awaits a number of other coroutines one after the other and sums their results.
+ *
+ * @param pool The thread pool.
+ * @param count The number of coroutines to await.
+ * @param in_pool A reference to a flag which will be cleared if any coroutine resumes outside the pool.
+ * @return A task with the sum of the results.
+ */
+BS::task<std::int64_t> coroutine_sum(BS::thread_pool<>& pool, const std::int64_t count, std::atomic<bool>& in_pool)
+{
+    std::int64_t sum = 0;
+    for (std::int64_t i = 0; i < count; ++i)
+        sum += co_await coroutine_double(pool, i, in_pool);
+    co_return sum;
+}
+
+/**
+ * @brief A coroutine which awaits a `BS::continuable_future` returned by `submit_continuable()` and the combined future returned by `BS::when_all()`.
+ *
+ * @param pool The thread pool.
+ * @return A task with the sum of all the results.
+ */
+BS::task<std::size_t> coroutine_await_futures(BS::thread_pool<>& pool)
+{
+    const std::size_t first = co_await pool.submit_continuable(
+        []
+        {
+            return static_cast<std::size_t>(1000);
+        });
+    std::vector<BS::continuable_future<std::size_t>> futures;
+    for (std::size_t i = 0; i < 10; ++i)
+    {
+        futures.push_back(pool.submit_continuable(
+            [i]
+            {
+                return i;
+            }));
+    }
+    const std::vector<std::size_t> results = co_await BS::when_all(futures);
+    co_return std::accumulate(results.begin(), results.end(), first);
+}
+
+#ifdef __cpp_exceptions
+/**
+ * @brief A coroutine which resumes in the given pool and then throws an exception.
+ *
+ * @param pool The thread pool.
+ * @return A task with no result.
+ */
+BS::task<> coroutine_throw(BS::thread_pool<>& pool)
+{
+    co_await pool.schedule();
+    throw std::runtime_error("Exception thrown by the coroutine!");
+}
+#endif
+
+/**
+ * @brief Check that coroutines can resume in the pool using `schedule()`, await each other and continuable futures, and propagate exceptions.
+ */
+void check_coroutines()
+{
+    BS::thread_pool pool(4);
+    std::atomic<bool> in_pool = true;
+    sync_out.println("Verifying that a coroutine awaiting pool.schedule() resumes in the pool...");
+    check(static_cast<std::int64_t>(42), coroutine_double(pool, 21, in_pool).get());
+    check(in_pool.load());
+    constexpr std::int64_t count = 1000;
+    sync_out.println("Verifying that a coroutine awaiting ", count, " other coroutines in a row computes the correct result...");
+    check(count * (count - 1), coroutine_sum(pool, count, in_pool).get());
+    check(in_pool.load());
+    sync_out.println("Verifying that several coroutines created at the same time produce independent results...");
+    std::vector<BS::task<std::int64_t>> tasks;
+    for (std::int64_t i = 0; i < 20; ++i)
+        tasks.push_back(coroutine_sum(pool, i, in_pool));
+    bool all_correct = true;
+    for (std::int64_t i = 0; i < 20; ++i)
+        all_correct = all_correct && (tasks[static_cast<std::size_t>(i)].get() == i * (i - 1));
+    check(all_correct && in_pool.load());
+    sync_out.println("Verifying that a coroutine can await continuable futures...");
+    check(static_cast<std::size_t>(1045), coroutine_await_futures(pool).get());
+#ifdef __cpp_exceptions
+    sync_out.println("Verifying that an exception thrown by a coroutine is rethrown by get()...");
+    bool caught = false;
+    try
+    {
+        coroutine_throw(pool).get();
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    check(caught);
+#endif
+}
+#endif
+
+// ===============================================
+// Functions to verify task monitoring and control
+// ===============================================
+
+/**
+ * @brief Check that task monitoring works.
+ */
+void check_task_monitoring()
+{
+    constexpr std::chrono::milliseconds sleep_time(300);
+    const std::size_t num_threads = std::min<std::size_t>(std::thread::hardware_concurrency(), 4);
+    sync_out.println("Creating pool with ", num_threads, " threads.");
+    BS::thread_pool pool(num_threads);
+    sync_out.println("Submitting ", num_threads * 3, " tasks.");
+    BS::counting_semaphore sem(0);
+    for (std::size_t i = 0; i < num_threads * 3; ++i)
+    {
+        pool.detach_task(
+            [i, &sem]
+            {
+                sem.acquire();
+                sync_out.println("Task ", i, " released.");
+            });
+    }
+    std::this_thread::sleep_for(sleep_time);
+    sync_out.println("After submission, should have: ", num_threads * 3, " tasks total, ", num_threads, " tasks running, ", num_threads * 2, " tasks queued...");
+    sync_out.print("Result: ", pool.get_tasks_total(), " tasks total, ", pool.get_tasks_running(), " tasks running, ", pool.get_tasks_queued(), " tasks queued ");
+    check(pool.get_tasks_total() == num_threads * 3 && pool.get_tasks_running() == num_threads && pool.get_tasks_queued() == num_threads * 2);
+    sem.release(static_cast<std::ptrdiff_t>(num_threads));
+    std::this_thread::sleep_for(sleep_time);
+    sync_out.println("After releasing ", num_threads, " tasks, should have: ", num_threads * 2, " tasks total, ", num_threads, " tasks running, ", num_threads, " tasks queued...");
+    sync_out.print("Result: ", pool.get_tasks_total(), " tasks total, ", pool.get_tasks_running(), " tasks running, ", pool.get_tasks_queued(), " tasks queued ");
+    check(pool.get_tasks_total() == num_threads * 2 && pool.get_tasks_running() == num_threads && pool.get_tasks_queued() == num_threads);
+    sem.release(static_cast<std::ptrdiff_t>(num_threads));
+    std::this_thread::sleep_for(sleep_time);
+    sync_out.println("After releasing ", num_threads, " more tasks, should have: ", num_threads, " tasks total, ", num_threads, " tasks running, ", 0, " tasks queued...");
+    sync_out.print("Result: ", pool.get_tasks_total(), " tasks total, ", pool.get_tasks_running(), " tasks running, ", pool.get_tasks_queued(), " tasks queued ");
+    check(pool.get_tasks_total() == num_threads && pool.get_tasks_running() == num_threads && pool.get_tasks_queued() == 0);
+    sem.release(static_cast<std::ptrdiff_t>(num_threads));
+    std::this_thread::sleep_for(sleep_time);
+    sync_out.println("After releasing the final ", num_threads, " tasks, should have: ", 0, " tasks total, ", 0, " tasks running, ", 0, " tasks queued...");
+    sync_out.print("Result: ", pool.get_tasks_total(), " tasks total, ", pool.get_tasks_running(), " tasks running, ", pool.get_tasks_queued(), " tasks queued ");
+    check(pool.get_tasks_total() == 0 && pool.get_tasks_running() == 0 && pool.get_tasks_queued() == 0);
+}
+
+/**
+ * @brief Check that task monitoring can be used from another thread while the pool is busy, since the getters do not lock the global mutex: the total number of tasks reported is never smaller than the number of tasks that have not yet finished.
+ */
+void check_task_monitoring_concurrent()
+{
+    constexpr std::size_t num_tasks = 10000;
+    BS::thread_pool pool;
+    std::atomic<std::size_t> submitted = 0;
+    std::atomic<std::size_t> finished = 0;
+    std::atomic<std::size_t> polls = 0;
+    bool never_missed = true;
+    sync_out.println("Detaching ", num_tasks, " tasks while polling get_tasks_total() from another thread...");
+    std::thread monitor(
+        [&pool, &submitted, &finished, &polls, &never_missed]
+        {
+            do
+            {
+                const std::size_t submitted_before = submitted;
+                const std::size_t total = pool.get_tasks_total();
+                if (total + finished < submitted_before)
+                    never_missed = false;
+                ++polls;
+            } while (finished < num_tasks);
+        });
+    // Make sure the monitoring thread has started before submitting the tasks, so it does not miss them all on a system with few cores.
+    while (polls == 0)
+        std::this_thread::yield();
+    for (std::size_t i = 0; i < num_tasks; ++i)
+    {
+        pool.detach_task(
+            [&finished]
+            {
+                ++finished;
+            });
+        ++submitted;
+    }
+    pool.wait();
+    monitor.join();
+    sync_out.println("Polled ", polls.load(), " times.");
+    check(never_missed);
+    check(static_cast<std::size_t>(0), pool.get_tasks_total());
+}
+
+/**
+ * @brief Check that pausing works.
+ */
+void check_pausing()
+{
+    constexpr std::chrono::milliseconds sleep_time(200);
+    BS::pause_thread_pool pool;
+    sync_out.println("Checking that the pool correctly reports that it is not paused after construction...");
+    check(!pool.is_paused());
+    sync_out.println("Pausing pool.");
+    pool.pause();
+    sync_out.println("Checking that the pool correctly reports that it is paused...");
+    check(pool.is_paused());
+    sync_out.println("Submitting task and waiting.");
+    std::atomic<bool> flag = false;
+    pool.detach_task(
+        [&flag]
+        {
+            flag = true;
+            sync_out.println("Task executed.");
+        });
     std::this_thread::sleep_for(sleep_time);
-    sync_out.println("After submission, should have: ", num_threads * 3, " tasks total, ", num_threads, " tasks running, ", num_threads * 2, " tasks queued...");
-    sync_out.print("Result: ", pool.get_tasks_total(), " tasks total, ", pool.get_tasks_running(), " tasks running, ", pool.get_tasks_queued(), " tasks queued ");
-    check(pool.get_tasks_total() == num_threads * 3 && pool.get_tasks_running() == num_threads && pool.get_tasks_queued() == num_threads * 2);
-    sem.release(static_cast<std::ptrdiff_t>(num_threads));
-    std::this_thread::sleep_for(sleep_time);
-    sync_out.println("After releasing ", num_threads, " tasks, should have: ", num_threads * 2, " tasks total, ", num_threads, " tasks running, ", num_threads, " tasks queued...");
-    sync_out.print("Result: ", pool.get_tasks_total(), " tasks total, ", pool.get_tasks_running(), " tasks running, ", pool.get_tasks_queued(), " tasks queued ");
-    check(pool.get_tasks_total() == num_threads * 2 && pool.get_tasks_running() == num_threads && pool.get_tasks_queued() == num_threads);
-    sem.release(static_cast<std::ptrdiff_t>(num_threads));
+    sync_out.println("Verifying that the task has not been executed...");
+    check(!flag);
+    sync_out.println("Unpausing pool and waiting.");
+    pool.unpause();
     std::this_thread::sleep_for(sleep_time);
-    sync_out.println("After releasing ", num_threads, " more tasks, should have: ", num_threads, " tasks total, ", num_threads, " tasks running, ", 0, " tasks queued...");
-    sync_out.print("Result: ", pool.get_tasks_total(), " tasks total, ", pool.get_tasks_running(), " tasks running, ", pool.get_tasks_queued(), " tasks queued ");
-    check(pool.get_tasks_total() == num_threads && pool.get_tasks_running() == num_threads && pool.get_tasks_queued() == 0);
-    sem.release(static_cast<std::ptrdiff_t>(num_threads));
+    sync_out.println("Verifying that the task has been executed...");
+    check(flag);
+    sync_out.println("Checking that the pool correctly reports that it is not paused...");
+    check(!pool.is_paused());
+}
+
+/**
+ * @brief Check that purge() works.
+ */
+void check_purge()
+{
+    constexpr std::chrono::milliseconds long_sleep_time(200);
+    constexpr std::chrono::milliseconds short_sleep_time(100);
+    constexpr std::size_t num_tasks = 10;
+    BS::thread_pool pool(1);
+    sync_out.println("Submitting ", num_tasks, " tasks to the pool.");
+    std::vector<std::atomic<bool>> flags(num_tasks);
+    for (std::size_t i = 0; i < num_tasks; ++i)
+    {
+        pool.detach_task(
+            [&flags, i, long_sleep_time]
+            {
+                std::this_thread::sleep_for(long_sleep_time);
+                sync_out.println("Task ", i, " done.");
+                flags[i] = true;
+            });
+    }
+    std::this_thread::sleep_for(short_sleep_time);
+    sync_out.println("Purging the pool and waiting for tasks...");
+    pool.purge();
+    pool.wait();
+    sync_out.println("Checking that only the first task was executed...");
+    flags[0] = !flags[0];
+    check(no_flags_set(flags));
+}
+
+/**
+ * @brief Check that tasks submitted with a stop condition are dropped once stop is requested or their deadline passes, and that running tasks can poll `BS::this_thread::stop_requested()`.
+ */
+void check_stop_condition()
+{
+    BS::thread_pool pool(1);
+    constexpr std::size_t num_tasks = 10;
+    std::atomic<std::size_t> count = 0;
+
+    sync_out.println("Verifying that tasks whose deadline has passed are dropped without being executed...");
+    const std::chrono::steady_clock::time_point past = std::chrono::steady_clock::now();
+    pool.detach_task(
+        [&count]
+        {
+            ++count;
+        },
+        past);
+    pool.detach_loop(
+        0, num_tasks,
+        [&count](const std::size_t)
+        {
+            ++count;
+        },
+        past);
+    std::future<std::size_t> dropped_future = pool.submit_task(
+        []
+        {
+            return std::size_t{1};
+        },
+        past);
+    pool.wait();
+    check(std::size_t{0}, count.load());
+#ifdef __cpp_exceptions
+    bool cancelled = false;
+    try
+    {
+        static_cast<void>(dropped_future.get());
+    }
+    catch (const BS::task_cancelled&)
+    {
+        cancelled = true;
+    }
+    check(cancelled);
+#endif
+
+    sync_out.println("Verifying that tasks whose deadline has not passed are executed, and can poll BS::this_thread::stop_requested() until it passes...");
+    check(!BS::this_thread::stop_requested());
+    std::future<bool> polled = pool.submit_task(
+        []
+        {
+            const bool initially = BS::this_thread::stop_requested();
+            while (!BS::this_thread::stop_requested())
+                std::this_thread::yield();
+            return !initially;
+        },
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(50));
+    check(polled.get());
+
+#ifdef __cpp_lib_jthread
+    sync_out.println("Verifying that queued blocks are dropped once stop is requested on their stop token...");
+    BS::binary_semaphore blocker(0);
+    pool.detach_task(
+        [&blocker]
+        {
+            blocker.acquire();
+        });
+    std::stop_source source;
+    BS::multi_future<std::size_t> blocks_future = pool.submit_blocks(
+        std::size_t{0}, num_tasks * num_tasks,
+        [&count](const std::size_t start, const std::size_t end)
+        {
+            count += end - start;
+            return end - start;
+        },
+        source.get_token(), num_tasks);
+    pool.detach_sequence(
+        0, num_tasks,
+        [&count](const std::size_t)
+        {
+            ++count;
+        },
+        source.get_token());
+    source.request_stop();
+    blocker.release();
+    pool.wait();
+    check(std::size_t{0}, count.load());
+    #ifdef __cpp_exceptions
+    std::size_t num_cancelled = 0;
+    for (std::future<std::size_t>& future : blocks_future)
+    {
+        try
+        {
+            static_cast<void>(future.get());
+        }
+        catch (const BS::task_cancelled&)
+        {
+            ++num_cancelled;
+        }
+    }
+    check(num_tasks, num_cancelled);
+    #endif
+
+    sync_out.println("Verifying that a running task sees BS::this_thread::get_stop_token() and exits early when stop is requested...");
+    std::stop_source running_source;
+    std::atomic<bool> started = false;
+    std::future<bool> exited = pool.submit_task(
+        [&started]
+        {
+            started = true;
+            const std::stop_token token = BS::this_thread::get_stop_token();
+            while (!BS::this_thread::stop_requested())
+                std::this_thread::yield();
+            return token.stop_requested();
+        },
+        running_source.get_token());
+    while (!started)
+        std::this_thread::yield();
+    running_source.request_stop();
+    check(exited.get());
+#endif
+}
+
+#ifdef __cpp_exceptions
+// ======================================
+// Functions to verify exception handling
+// ======================================
+
+/**
+ * @brief An exception class to be thrown when testing exception handling.
+ */
+struct test_exception : public std::runtime_error
+{
+    test_exception() : std::runtime_error("Exception thrown!") {};
+};
+
+/**
+ * @brief A function that throws a `test_exception`.
+ */
+void throws()
+{
+    sync_out.println("Throwing exception...");
+    throw test_exception();
+};
+
+/**
+ * @brief Check that exceptions are forwarded correctly by submit_task().
+ */
+void check_exceptions_submit()
+{
+    BS::thread_pool pool;
+    sync_out.println("Checking that exceptions are forwarded correctly by submit_task()...");
+    bool caught = false;
+    std::future<void> future = pool.submit_task(throws);
+    try
+    {
+        future.get();
+    }
+    catch (const test_exception&)
+    {
+        caught = true;
+    }
+    check(caught);
+}
+
+/**
+ * @brief Check that exceptions are forwarded correctly by `BS::multi_future`.
+ */
+void check_exceptions_multi_future()
+{
+    BS::thread_pool pool;
+    sync_out.println("Checking that exceptions are forwarded correctly by BS::multi_future...");
+    bool caught = false;
+    BS::multi_future<void> future;
+    future.push_back(pool.submit_task(throws));
+    future.push_back(pool.submit_task(throws));
+    try
+    {
+        future.get();
+    }
+    catch (const test_exception&)
+    {
+        caught = true;
+    }
+    check(caught);
+}
+
+/**
+ * @brief Check that exceptions are forwarded correctly by `BS::group_future`, and that the other tasks in the group still run.
+ */
+void check_exceptions_group_future()
+{
+    BS::thread_pool pool;
+    sync_out.println("Checking that exceptions are forwarded correctly by BS::group_future...");
+    constexpr std::size_t num_tasks = 10;
+    std::atomic<std::size_t> count = 0;
+    const BS::group_future<void> future = pool.submit_sequence_grouped(static_cast<std::size_t>(0), num_tasks,
+        [&count](const std::size_t index)
+        {
+            ++count;
+            if (index == 3 || index == 7)
+                throws();
+        });
+    bool caught = false;
+    try
+    {
+        future.get();
+    }
+    catch (const test_exception&)
+    {
+        caught = true;
+    }
+    check(caught);
+    check(num_tasks, count.load());
+}
+#endif
+
+// =====================================
+// Functions to verify vector operations
+// =====================================
+
+/**
+ * @brief Check that parallelized vector operations work as expected by calculating the sum of two randomized vectors of a specific size in two ways, single-threaded and multithreaded, and comparing the results.
+ *
+ * @param pool The thread pool to check.
+ * @param vector_size The size of the vectors.
+ * @param num_tasks The number of tasks to split the calculation into.
+ * @return `true` if the single-threaded and multithreaded results are equal, `false` otherwise.
+ */
+bool check_vector_of_size(BS::thread_pool<>& pool, const std::size_t vector_size, const std::size_t num_tasks)
+{
+    constexpr std::int64_t value_range = 1000000;
+    std::vector<std::int64_t> vector_1(vector_size);
+    std::vector<std::int64_t> vector_2(vector_size);
+    for (std::size_t i = 0; i < vector_size; ++i)
+    {
+        vector_1[i] = random(-value_range, value_range);
+        vector_2[i] = random(-value_range, value_range);
+    }
+    sync_out.println("Adding two vectors with ", vector_size, " elements using ", num_tasks, " tasks...");
+    std::vector<std::int64_t> sum_single(vector_size);
+    for (std::size_t i = 0; i < vector_size; ++i)
+        sum_single[i] = vector_1[i] + vector_2[i];
+    std::vector<std::int64_t> sum_multi(vector_size);
+    pool.submit_blocks(
+            0, vector_size,
+            [&sum_multi, &vector_1, &vector_2](const std::size_t start, const std::size_t end)
+            {
+                for (std::size_t i = start; i < end; ++i)
+                    sum_multi[i] = vector_1[i] + vector_2[i];
+            },
+            num_tasks)
+        .wait();
+    for (std::size_t i = 0; i < vector_size; ++i)
+    {
+        if (sum_single[i] != sum_multi[i])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Check that parallelized vector operations work as expected.
+ */
+void check_vectors()
+{
+    constexpr std::size_t size_range = 1000000;
+    constexpr std::size_t repeats = 10;
+    BS::thread_pool pool;
+    for (std::size_t i = 0; i < repeats; ++i)
+        check(check_vector_of_size(pool, random<std::size_t>(0, size_range), random<std::size_t>(1, pool.get_thread_count())));
+}
+
+// =================================
+// Functions to verify task priority
+// =================================
+
+// Priorities are 8-bit integers, but `std::uniform_int_distribution` needs at least a 16-bit integer.
+using rand_priority_t = std::int16_t;
+
+/**
+ * @brief Check that task priority works as expected with all task submission methods.
+ */
+void check_priority()
+{
+    constexpr std::chrono::milliseconds sleep_time(200);
+    constexpr std::size_t num_tasks = 10;
+    // Set the pool to have only 1 thread, so it can only run 1 task at a time. This will ensure the tasks will be executed in priority order.
+    BS::thread_pool<BS::tp::priority | BS::tp::pause> pool(1);
+    pool.pause();
+
+    // Create a shuffled lists of priorities.
+    std::vector<BS::priority_t> priorities;
+    priorities.reserve(num_tasks - 1);
+    for (std::size_t i = 0; i < num_tasks - 1; ++i)
+        priorities.push_back(static_cast<BS::priority_t>((i % 2 == 0) ? random<rand_priority_t>(0, BS::pr::highest) : random<rand_priority_t>(BS::pr::lowest, 0)));
+    priorities.push_back(BS::pr::lowest);
+    priorities.push_back(0);
+    priorities.push_back(BS::pr::highest);
+    std::shuffle(priorities.begin(), priorities.end(), std::mt19937_64(std::random_device()()));
+
+    // Submit tasks using various methods in random priority order.
+    std::vector<BS::priority_t> execution_order;
+    std::mutex exec_mutex;
+    const auto execute_task_priority = [&execution_order, &exec_mutex](const BS::priority_t priority)
+    {
+        const std::scoped_lock lock(exec_mutex);
+        sync_out.println("Task with priority ", static_cast<rand_priority_t>(priority), " executed.");
+        execution_order.push_back(priority);
+    };
+    const std::vector<std::string_view> functions = {"detach_task", "submit_task", "detach_sequence", "submit_sequence", "detach_loop", "submit_loop", "detach_blocks", "submit_blocks"};
+    for (const BS::priority_t priority : priorities)
+    {
+        const std::string_view func = functions[random<std::size_t>(0, functions.size() - 1)];
+        sync_out.println("Launching ", func, "() with priority ", static_cast<rand_priority_t>(priority), "...");
+        if (func == "detach_task")
+        {
+            pool.detach_task(
+                [priority, &execute_task_priority]
+                {
+                    execute_task_priority(priority);
+                },
+                priority);
+        }
+        else if (func == "submit_task")
+        {
+            std::ignore = pool.submit_task(
+                [priority, &execute_task_priority]
+                {
+                    execute_task_priority(priority);
+                },
+                priority);
+        }
+        else if (func == "detach_sequence")
+        {
+            pool.detach_sequence(
+                0, 1,
+                [priority, &execute_task_priority](std::int64_t)
+                {
+                    execute_task_priority(priority);
+                },
+                priority);
+        }
+        else if (func == "submit_sequence")
+        {
+            std::ignore = pool.submit_sequence(
+                0, 1,
+                [priority, &execute_task_priority](std::int64_t)
+                {
+                    execute_task_priority(priority);
+                },
+                priority);
+        }
+        else if (func == "detach_loop")
+        {
+            pool.detach_loop(
+                0, 1,
+                [priority, &execute_task_priority](std::int64_t)
+                {
+                    execute_task_priority(priority);
+                },
+                0, priority);
+        }
+        else if (func == "submit_loop")
+        {
+            std::ignore = pool.submit_loop(
+                0, 1,
+                [priority, &execute_task_priority](std::int64_t)
+                {
+                    execute_task_priority(priority);
+                },
+                0, priority);
+        }
+        else if (func == "detach_blocks")
+        {
+            pool.detach_blocks(
+                0, 1,
+                [priority, &execute_task_priority](std::int64_t, std::int64_t)
+                {
+                    execute_task_priority(priority);
+                },
+                0, priority);
+        }
+        else if (func == "submit_blocks")
+        {
+            std::ignore = pool.submit_blocks(
+                0, 1,
+                [priority, &execute_task_priority](std::int64_t, std::int64_t)
+                {
+                    execute_task_priority(priority);
+                },
+                0, priority);
+        }
+    }
+
+    // Unpause the pool so the tasks can be executed, then check that they were executed in the correct order.
+    sync_out.println("Checking execution order...");
     std::this_thread::sleep_for(sleep_time);
-    sync_out.println("After releasing the final ", num_threads, " tasks, should have: ", 0, " tasks total, ", 0, " tasks running, ", 0, " tasks queued...");
-    sync_out.print("Result: ", pool.get_tasks_total(), " tasks total, ", pool.get_tasks_running(), " tasks running, ", pool.get_tasks_queued(), " tasks queued ");
-    check(pool.get_tasks_total() == 0 && pool.get_tasks_running() == 0 && pool.get_tasks_queued() == 0);
+    pool.unpause();
+    pool.wait();
+    std::sort(priorities.rbegin(), priorities.rend());
+    check(execution_order == priorities);
+}
+
+/**
+ * @brief Check that tasks with the same priority are executed in the order they were submitted, and that the order is preserved when tasks with other priorities are interleaved with them.
+ */
+void check_priority_fifo()
+{
+    constexpr std::size_t num_tasks = 1000;
+    BS::thread_pool<BS::tp::priority | BS::tp::pause> pool(1);
+    pool.pause();
+    const std::vector<BS::priority_t> levels = {BS::pr::lowest, BS::pr::low, BS::pr::normal, BS::pr::high, BS::pr::highest};
+    std::vector<std::pair<BS::priority_t, std::size_t>> execution_order;
+    execution_order.reserve(num_tasks);
+    sync_out.println("Submitting ", num_tasks, " tasks with ", levels.size(), " interleaved priorities...");
+    for (std::size_t i = 0; i < num_tasks; ++i)
+    {
+        const BS::priority_t priority = levels[random<std::size_t>(0, levels.size() - 1)];
+        pool.detach_task(
+            [&execution_order, priority, i]
+            {
+                execution_order.emplace_back(priority, i);
+            },
+            priority);
+    }
+    check(num_tasks, pool.get_tasks_queued());
+    pool.unpause();
+    pool.wait();
+    sync_out.println("Checking that the tasks were executed in order of decreasing priority, and in order of submission within each priority...");
+    check(num_tasks, execution_order.size());
+    bool ordered = true;
+    for (std::size_t i = 1; i < execution_order.size(); ++i)
+    {
+        const auto& [prev_priority, prev_index] = execution_order[i - 1];
+        const auto& [priority, index] = execution_order[i];
+        if ((priority > prev_priority) || ((priority == prev_priority) && (index < prev_index)))
+            ordered = false;
+    }
+    check(ordered);
+}
+
+/**
+ * @brief Check that a pool with both priorities and work stealing enabled executes tasks submitted from outside the pool in order of priority, executes tasks submitted from within the pool to the local queues, and can be reset.
+ */
+void check_priority_work_stealing()
+{
+    constexpr std::size_t num_tasks = 100;
+    BS::thread_pool<BS::tp::priority | BS::tp::work_stealing> pool(1);
+    BS::binary_semaphore blocker(0);
+    pool.detach_task(
+        [&blocker]
+        {
+            blocker.acquire();
+        });
+    const std::vector<BS::priority_t> levels = {BS::pr::lowest, BS::pr::low, BS::pr::normal, BS::pr::high, BS::pr::highest};
+    std::vector<BS::priority_t> execution_order;
+    sync_out.println("Submitting ", num_tasks, " tasks with random priorities to a pool with priorities and work stealing...");
+    for (std::size_t i = 0; i < num_tasks; ++i)
+    {
+        const BS::priority_t priority = levels[random<std::size_t>(0, levels.size() - 1)];
+        pool.detach_task(
+            [&execution_order, priority]
+            {
+                execution_order.push_back(priority);
+            },
+            priority);
+    }
+    blocker.release();
+    pool.wait();
+    sync_out.println("Checking that the tasks were executed in order of decreasing priority...");
+    check(num_tasks, execution_order.size());
+    check(std::is_sorted(execution_order.rbegin(), execution_order.rend()));
+    sync_out.println("Checking that tasks submitted from within the pool to the local queues are executed, before and after resetting the pool...");
+    std::atomic<std::size_t> count = 0;
+    const auto submit_locally = [&pool, &count]
+    {
+        pool.detach_task(
+            [&pool, &count]
+            {
+                for (std::size_t i = 0; i < num_tasks; ++i)
+                {
+                    pool.detach_task(
+                        [&count]
+                        {
+                            ++count;
+                        });
+                }
+            });
+        pool.wait();
+    };
+    submit_locally();
+    check(num_tasks, count.load());
+    pool.reset(2);
+    submit_locally();
+    check(2 * num_tasks, count.load());
+}
+
+// =================================
+// Functions to verify work stealing
+// =================================
+
+/**
+ * @brief Check that work stealing works: tasks submitted from within the pool are executed, idle threads steal them, and monitoring, purging, and pausing take the local queues into account.
+ */
+void check_work_stealing()
+{
+    constexpr std::size_t num_threads = 4;
+    constexpr std::size_t num_subtasks = 100;
+    {
+        BS::ws_thread_pool pool(num_threads);
+        sync_out.println("Submitting ", num_threads, " tasks, each submitting ", num_subtasks, " subtasks from within the pool...");
+        std::atomic<std::size_t> counter = 0;
+        for (std::size_t i = 0; i < num_threads; ++i)
+        {
+            pool.detach_task(
+                [&pool, &counter]
+                {
+                    for (std::size_t j = 0; j < num_subtasks; ++j)
+                    {
+                        pool.detach_task(
+                            [&counter]
+                            {
+                                ++counter;
+                            });
+                    }
+                });
+        }
+        pool.wait();
+        sync_out.println("Checking that all subtasks were executed...");
+        check(num_threads * num_subtasks, counter.load());
+    }
+    {
+        BS::ws_thread_pool pool(num_threads);
+        sync_out.println("Submitting a task which submits ", num_subtasks, " subtasks to its own local queue and then blocks until they are done...");
+        std::atomic<std::size_t> counter = 0;
+        std::atomic<bool> stolen = false;
+        pool.detach_task(
+            [&pool, &counter, &stolen]
+            {
+                for (std::size_t j = 0; j < num_subtasks; ++j)
+                {
+                    pool.detach_task(
+                        [&counter]
+                        {
+                            ++counter;
+                        });
+                }
+                const std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+                while (counter < num_subtasks && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                stolen = (counter == num_subtasks);
+            });
+        pool.wait();
+        sync_out.println("Checking that the subtasks were stolen by the other threads...");
+        check(stolen.load());
+    }
+    {
+        BS::thread_pool<BS::tp::work_stealing | BS::tp::pause> pool(1);
+        std::atomic<std::size_t> counter = 0;
+        const auto submit_and_pause = [&pool, &counter]
+        {
+            pool.detach_task(
+                [&pool, &counter]
+                {
+                    for (std::size_t j = 0; j < num_subtasks; ++j)
+                    {
+                        pool.detach_task(
+                            [&counter]
+                            {
+                                ++counter;
+                            });
+                    }
+                    pool.pause();
+                });
+            pool.wait();
+        };
+        sync_out.println("Submitting a task which submits ", num_subtasks, " subtasks to its own local queue and then pauses the pool...");
+        submit_and_pause();
+        sync_out.println("Checking that get_tasks_queued() reports the tasks in the local queue...");
+        check(num_subtasks, pool.get_tasks_queued());
+        sync_out.println("Purging the pool and checking that the local queue is empty and no subtasks were executed...");
+        pool.purge();
+        check(static_cast<std::size_t>(0), pool.get_tasks_queued());
+        pool.unpause();
+        pool.wait();
+        check(static_cast<std::size_t>(0), counter.load());
+        sync_out.println("Submitting the same task again, then resetting the pool while paused and checking that the tasks in the local queue are preserved...");
+        submit_and_pause();
+        pool.reset(num_threads);
+        check(num_subtasks, pool.get_tasks_queued());
+        sync_out.println("Unpausing the pool and checking that all subtasks were executed...");
+        pool.unpause();
+        pool.wait();
+        check(num_subtasks, counter.load());
+    }
+}
+
+/**
+ * @brief Check that tasks submitted to the mailbox of a specific thread are executed by that thread, in order, that a mask selects the least loaded thread, and that mailbox stealing, purging, and resetting work.
+ */
+void check_mailboxes()
+{
+    constexpr std::size_t num_threads = 4;
+    constexpr std::size_t num_tasks = 1000;
+    {
+        BS::ws_thread_pool pool(num_threads);
+        sync_out.println("Submitting ", num_tasks, " tasks to the mailbox of each of the ", num_threads, " threads...");
+        std::vector<std::atomic<std::size_t>> wrong_thread(num_threads);
+        std::vector<std::atomic<std::size_t>> out_of_order(num_threads);
+        std::vector<std::size_t> last(num_threads, 0);
+        for (std::size_t i = 1; i <= num_tasks; ++i)
+        {
+            for (std::size_t w = 0; w < num_threads; ++w)
+            {
+                pool.detach_task_to(w,
+                    [&wrong_thread, &out_of_order, &last, i, w]
+                    {
+                        if (BS::this_thread::get_index() != w)
+                            ++wrong_thread[w];
+                        if (last[w] != i - 1)
+                            ++out_of_order[w];
+                        last[w] = i;
+                    });
+            }
+        }
+        pool.wait();
+        sync_out.println("Checking that every task was executed by its thread, in the order it was submitted...");
+        check(std::all_of(wrong_thread.begin(), wrong_thread.end(),
+                  [](const std::atomic<std::size_t>& count)
+                  {
+                      return count == 0;
+                  }) &&
+            std::all_of(out_of_order.begin(), out_of_order.end(),
+                [](const std::atomic<std::size_t>& count)
+                {
+                    return count == 0;
+                }));
+        sync_out.println("Checking that submit_task_to() with a worker index and with a mask returns the index of the thread that executed the task...");
+        const auto get_index = []
+        {
+            return BS::this_thread::get_index();
+        };
+        check(pool.submit_task_to(num_threads - 1, get_index).get() == num_threads - 1);
+        check(pool.submit_task_to(std::vector<bool>{false, false, true}, get_index).get() == 2);
+        sync_out.println("Checking that a mask that does not select any thread submits the task as usual...");
+        check(pool.submit_task_to(std::vector<bool>{}, get_index).get().has_value());
+        sync_out.println("Checking that a mask selects the thread with the fewest tasks in its mailbox...");
+        {
+            std::atomic<bool> release = false;
+            std::atomic<std::size_t> blocked = 0;
+            const auto block = [&release, &blocked]
+            {
+                ++blocked;
+                while (!release)
+                    std::this_thread::yield();
+            };
+            pool.detach_task_to(0, block);
+            pool.detach_task_to(1, block);
+            while (blocked < 2)
+                std::this_thread::yield();
+            pool.detach_task_to(0, [] {});
+            std::future<std::optional<std::size_t>> future = pool.submit_task_to(std::vector<bool>{true, true}, get_index);
+            release = true;
+            check(future.get() == 1);
+        }
+        sync_out.println("Submitting tasks to the mailboxes of all the threads from within the pool...");
+        std::atomic<std::size_t> counter = 0;
+        pool.detach_task(
+            [&pool, &counter]
+            {
+                for (std::size_t i = 0; i < num_tasks; ++i)
+                {
+                    pool.detach_task_to(i,
+                        [&counter]
+                        {
+                            ++counter;
+                        });
+                }
+            });
+        pool.wait();
+        check(num_tasks, counter.load());
+    }
+    {
+        BS::ws_thread_pool pool(num_threads);
+        sync_out.println("Blocking a thread and checking that the tasks in its mailbox are only taken by other threads if mailbox stealing is enabled...");
+        check(!pool.get_mailbox_stealing());
+        std::atomic<bool> release = false;
+        std::atomic<bool> started = false;
+        pool.detach_task_to(0,
+            [&release, &started]
+            {
+                started = true;
+                while (!release)
+                    std::this_thread::yield();
+            });
+        while (!started)
+            std::this_thread::yield();
+        std::future<std::optional<std::size_t>> future = pool.submit_task_to(0,
+            []
+            {
+                return BS::this_thread::get_index();
+            });
+        check(future.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout);
+        pool.set_mailbox_stealing(true);
+        check(pool.get_mailbox_stealing());
+        const std::optional<std::size_t> index = future.get();
+        check(index.has_value() && (*index != 0));
+        release = true;
+        pool.wait();
+    }
+    {
+        BS::thread_pool<BS::tp::work_stealing | BS::tp::pause> pool(num_threads);
+        std::atomic<std::size_t> counter = 0;
+        const auto submit_paused = [&pool, &counter]
+        {
+            pool.pause();
+            for (std::size_t i = 0; i < num_tasks; ++i)
+            {
+                pool.detach_task_to(i,
+                    [&counter]
+                    {
+                        ++counter;
+                    });
+            }
+        };
+        sync_out.println("Submitting ", num_tasks, " tasks to the mailboxes of a paused pool...");
+        submit_paused();
+        sync_out.println("Checking that get_tasks_queued() reports the tasks in the mailboxes...");
+        check(num_tasks, pool.get_tasks_queued());
+        sync_out.println("Purging the pool and checking that the mailboxes are empty and no tasks were executed...");
+        pool.purge();
+        check(static_cast<std::size_t>(0), pool.get_tasks_queued());
+        pool.unpause();
+        pool.wait();
+        check(static_cast<std::size_t>(0), counter.load());
+        sync_out.println("Submitting the same tasks again, then resetting the pool while paused and checking that they are preserved...");
+        submit_paused();
+        pool.reset(1);
+        check(num_tasks, pool.get_tasks_queued());
+        pool.unpause();
+        pool.wait();
+        check(num_tasks, counter.load());
+        constexpr std::size_t capacity = 4;
+        constexpr std::size_t num_submitters = 4;
+        sync_out.println("Setting a queue capacity of ", capacity, ", pausing the pool, and submitting tasks to the mailboxes from ", num_submitters, " threads at once...");
+        pool.reset(num_threads);
+        pool.set_queue_capacity(capacity);
+        pool.pause();
+        counter = 0;
+        std::vector<std::thread> submitters;
+        for (std::size_t i = 0; i < num_submitters; ++i)
+        {
+            submitters.emplace_back(
+                [&pool, &counter, i]
+                {
+                    for (std::size_t j = 0; j < capacity; ++j)
+                    {
+                        pool.detach_task_to(i + j,
+                            [&counter]
+                            {
+                                ++counter;
+                            });
+                    }
+                });
+        }
+        check(wait_for_condition(
+            [&pool]
+            {
+                return pool.get_tasks_queued() >= capacity;
+            }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        sync_out.println("Checking that the capacity is not exceeded...");
+        check(capacity, pool.get_tasks_queued());
+        pool.unpause();
+        for (std::thread& submitter : submitters)
+            submitter.join();
+        pool.wait();
+        check(num_submitters * capacity, counter.load());
+        pool.set_queue_capacity(0);
+    }
 }
 
+// =======================================
+// Functions to verify the lock-free queue
+// =======================================
+
 /**
- * @brief Check that pausing works.
+ * @brief Check that the lock-free queue works.
  */
-void check_pausing()
+void check_lock_free()
 {
-    constexpr std::chrono::milliseconds sleep_time(200);
-    BS::pause_thread_pool pool;
-    sync_out.println("Checking that the pool correctly reports that it is not paused after construction...");
-    check(!pool.is_paused());
-    sync_out.println("Pausing pool.");
-    pool.pause();
-    sync_out.println("Checking that the pool correctly reports that it is paused...");
-    check(pool.is_paused());
-    sync_out.println("Submitting task and waiting.");
-    std::atomic<bool> flag = false;
-    pool.detach_task(
-        [&flag]
+    {
+        sync_out.println("Checking BS::mpmc_queue directly...");
+        BS::mpmc_queue<std::size_t> queue(5);
+        check(static_cast<std::size_t>(8), queue.capacity());
+        check(queue.empty());
+        bool pushed = true;
+        for (std::size_t i = 0; i < queue.capacity(); ++i)
+            pushed = pushed && queue.try_push(i);
+        check(pushed);
+        check(!queue.try_push(static_cast<std::size_t>(0)));
+        check(queue.capacity(), queue.size());
+        bool popped_in_order = true;
+        std::size_t value = 0;
+        for (std::size_t i = 0; i < queue.capacity(); ++i)
+            popped_in_order = popped_in_order && queue.try_pop(value) && (value == i);
+        check(popped_in_order);
+        check(!queue.try_pop(value));
+        check(queue.empty());
+    }
+    constexpr std::size_t num_producers = 4;
+    constexpr std::size_t num_tasks = 10000;
+    {
+        BS::lf_thread_pool pool;
+        sync_out.println("Detaching ", num_tasks, " tasks from each of ", num_producers, " producer threads concurrently...");
+        std::atomic<std::size_t> counter = 0;
+        std::vector<std::thread> producers;
+        producers.reserve(num_producers);
+        for (std::size_t i = 0; i < num_producers; ++i)
         {
-            flag = true;
-            sync_out.println("Task executed.");
-        });
-    std::this_thread::sleep_for(sleep_time);
-    sync_out.println("Verifying that the task has not been executed...");
-    check(!flag);
-    sync_out.println("Unpausing pool and waiting.");
-    pool.unpause();
-    std::this_thread::sleep_for(sleep_time);
-    sync_out.println("Verifying that the task has been executed...");
-    check(flag);
-    sync_out.println("Checking that the pool correctly reports that it is not paused...");
-    check(!pool.is_paused());
+            producers.emplace_back(
+                [&pool, &counter]
+                {
+                    for (std::size_t j = 0; j < num_tasks; ++j)
+                    {
+                        pool.detach_task(
+                            [&counter]
+                            {
+                                ++counter;
+                            });
+                    }
+                });
+        }
+        for (std::thread& producer : producers)
+            producer.join();
+        pool.wait();
+        sync_out.println("Checking that all tasks were executed...");
+        check(num_producers * num_tasks, counter.load());
+        sync_out.println("Submitting tasks with return values and checking the results...");
+        BS::multi_future<std::size_t> futures;
+        for (std::size_t i = 0; i < num_tasks; ++i)
+        {
+            futures.push_back(pool.submit_task(
+                [i]
+                {
+                    return i * i;
+                }));
+        }
+        bool correct = true;
+        for (std::size_t i = 0; i < num_tasks; ++i)
+            correct = correct && (futures[i].get() == i * i);
+        check(correct);
+    }
+    {
+        BS::thread_pool<BS::tp::lock_free | BS::tp::pause> pool;
+        const std::size_t num_overflow = BS::mpmc_queue<int>::default_capacity + num_tasks;
+        sync_out.println("Pausing the pool and detaching ", num_overflow, " tasks, which is more than the capacity of the lock-free queue...");
+        std::atomic<std::size_t> counter = 0;
+        pool.pause();
+        for (std::size_t i = 0; i < num_overflow; ++i)
+        {
+            pool.detach_task(
+                [&counter]
+                {
+                    ++counter;
+                });
+        }
+        sync_out.println("Checking that get_tasks_queued() reports all the tasks...");
+        check(num_overflow, pool.get_tasks_queued());
+        sync_out.println("Purging the pool and checking that no tasks were executed...");
+        pool.purge();
+        check(static_cast<std::size_t>(0), pool.get_tasks_queued());
+        pool.unpause();
+        pool.wait();
+        check(static_cast<std::size_t>(0), counter.load());
+        sync_out.println("Pausing the pool again, detaching the same tasks, then unpausing and checking that all of them were executed...");
+        pool.pause();
+        for (std::size_t i = 0; i < num_overflow; ++i)
+        {
+            pool.detach_task(
+                [&counter]
+                {
+                    ++counter;
+                });
+        }
+        pool.unpause();
+        pool.wait();
+        check(num_overflow, counter.load());
+    }
 }
 
+// =========================================
+// Functions to verify NUMA-aware scheduling
+// =========================================
+
 /**
- * @brief Check that purge() works.
+ * @brief Check that NUMA-aware scheduling works: the threads are divided between the nodes, tasks submitted to any node are executed, and monitoring, purging, pausing, and resetting take the node queues into account.
  */
-void check_purge()
+void check_numa()
 {
-    constexpr std::chrono::milliseconds long_sleep_time(200);
-    constexpr std::chrono::milliseconds short_sleep_time(100);
-    constexpr std::size_t num_tasks = 10;
-    BS::thread_pool pool(1);
-    sync_out.println("Submitting ", num_tasks, " tasks to the pool.");
-    std::vector<std::atomic<bool>> flags(num_tasks);
+    constexpr std::size_t num_threads = 4;
+    constexpr std::size_t num_tasks = 1000;
+    BS::thread_pool<BS::tp::numa | BS::tp::pause> pool(num_threads);
+    check(BS::thread_pool<BS::tp::numa>::work_stealing_enabled);
+    const std::size_t num_nodes = pool.get_numa_node_count();
+    sync_out.println("The pool uses ", num_nodes, " NUMA node(s).");
+    check(num_nodes >= 1);
+#ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
+    #if defined(_WIN32) || defined(__linux__)
+    const std::optional<std::vector<std::vector<bool>>> nodes = BS::get_os_numa_nodes();
+    sync_out.println("Checking that the NUMA topology was determined, and that the pool does not use more nodes than the system has...");
+    check(nodes.has_value() && (num_nodes <= nodes->size()));
+    #endif
+#endif
+    sync_out.println("Checking that the threads are divided between the nodes in order...");
+    bool assigned = true;
+    for (std::size_t i = 0; i < num_threads; ++i)
+    {
+        assigned = assigned && (pool.get_thread_numa_node(i) < num_nodes);
+        if (i > 0)
+            assigned = assigned && (pool.get_thread_numa_node(i) >= pool.get_thread_numa_node(i - 1));
+    }
+    check(assigned);
+    std::atomic<std::size_t> counter = 0;
+    sync_out.println("Detaching ", num_tasks, " tasks to all nodes, with node indices that wrap around...");
     for (std::size_t i = 0; i < num_tasks; ++i)
+    {
+        pool.detach_task_on_node(
+            i,
+            [&counter]
+            {
+                ++counter;
+            });
+    }
+    pool.wait();
+    check(num_tasks, counter.load());
+    sync_out.println("Submitting tasks with return values to each node and checking the results...");
+    std::vector<std::future<std::size_t>> futures;
+    for (std::size_t node = 0; node < num_nodes; ++node)
+    {
+        futures.push_back(pool.submit_task_on_node(
+            node,
+            [node]
+            {
+                return node + 1;
+            }));
+    }
+    bool correct = true;
+    for (std::size_t node = 0; node < num_nodes; ++node)
+        correct = correct && (futures[node].get() == node + 1);
+    check(correct);
+    sync_out.println("Detaching tasks to the nodes from within the pool...");
+    counter = 0;
+    for (std::size_t i = 0; i < num_threads; ++i)
     {
         pool.detach_task(
-            [&flags, i, long_sleep_time]
+            [&pool, &counter, num_nodes]
             {
-                std::this_thread::sleep_for(long_sleep_time);
-                sync_out.println("Task ", i, " done.");
-                flags[i] = true;
+                for (std::size_t j = 0; j < num_tasks; ++j)
+                {
+                    pool.detach_task_on_node(
+                        j % num_nodes,
+                        [&counter]
+                        {
+                            ++counter;
+                        });
+                }
             });
     }
-    std::this_thread::sleep_for(short_sleep_time);
-    sync_out.println("Purging the pool and waiting for tasks...");
+    pool.wait();
+    check(num_threads * num_tasks, counter.load());
+    sync_out.println("Pausing the pool, detaching tasks to the nodes, and checking that they are counted as queued...");
+    counter = 0;
+    pool.pause();
+    for (std::size_t i = 0; i < num_tasks; ++i)
+    {
+        pool.detach_task_on_node(
+            i,
+            [&counter]
+            {
+                ++counter;
+            });
+    }
+    check(num_tasks, pool.get_tasks_queued());
+    sync_out.println("Resetting the pool while paused and checking that the tasks in the node queues are preserved...");
+    pool.reset(num_threads);
+    check(num_tasks, pool.get_tasks_queued());
+    sync_out.println("Purging the pool and checking that the node queues are empty...");
     pool.purge();
+    check(static_cast<std::size_t>(0), pool.get_tasks_queued());
+    pool.unpause();
     pool.wait();
-    sync_out.println("Checking that only the first task was executed...");
-    flags[0] = !flags[0];
-    check(no_flags_set(flags));
+    check(static_cast<std::size_t>(0), counter.load());
+    constexpr std::size_t capacity = 4;
+    constexpr std::size_t num_submitters = 4;
+    sync_out.println("Setting a queue capacity of ", capacity, ", pausing the pool, and detaching tasks to the nodes from ", num_submitters, " threads at once...");
+    pool.set_queue_capacity(capacity);
+    pool.pause();
+    std::vector<std::thread> submitters;
+    for (std::size_t i = 0; i < num_submitters; ++i)
+    {
+        submitters.emplace_back(
+            [&pool, &counter, i]
+            {
+                for (std::size_t j = 0; j < capacity; ++j)
+                {
+                    pool.detach_task_on_node(
+                        i + j,
+                        [&counter]
+                        {
+                            ++counter;
+                        });
+                }
+            });
+    }
+    check(wait_for_condition(
+        [&pool]
+        {
+            return pool.get_tasks_queued() >= capacity;
+        }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    sync_out.println("Checking that the capacity is not exceeded...");
+    check(capacity, pool.get_tasks_queued());
+    pool.unpause();
+    for (std::thread& submitter : submitters)
+        submitter.join();
+    pool.wait();
+    check(num_submitters * capacity, counter.load());
+    pool.set_queue_capacity(0);
 }
 
-#ifdef __cpp_exceptions
-// ======================================
-// Functions to verify exception handling
-// ======================================
+// ============================================
+// Functions to verify spinning before sleeping
+// ============================================
 
 /**
- * @brief An exception class to be thrown when testing exception handling.
+ * @brief Check that spinning before sleeping works with a specific thread pool: all tasks are executed, and spinning workers are not counted as running tasks.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
  */
-struct test_exception : public std::runtime_error
+template <BS::opt_t OptFlags>
+void check_spinning_pool()
 {
-    test_exception() : std::runtime_error("Exception thrown!") {};
-};
+    constexpr std::size_t num_threads = 4;
+    constexpr std::size_t num_tasks = 1000;
+    constexpr std::size_t spin_budget = 100000;
+    BS::thread_pool<OptFlags> pool(num_threads);
+    pool.set_spin_budget(spin_budget);
+    check(spin_budget, pool.get_spin_budget());
+    std::atomic<std::size_t> counter = 0;
+    sync_out.println("Detaching ", num_tasks, " tasks one at a time, waiting for each one to finish before detaching the next...");
+    for (std::size_t i = 0; i < num_tasks; ++i)
+    {
+        pool.submit_task(
+                [&counter]
+                {
+                    ++counter;
+                })
+            .wait();
+    }
+    check(num_tasks, counter.load());
+    sync_out.println("Detaching ", num_tasks, " tasks at once, and the same number of tasks from within the pool...");
+    counter = 0;
+    for (std::size_t i = 0; i < num_tasks; ++i)
+    {
+        pool.detach_task(
+            [&counter]
+            {
+                ++counter;
+            });
+    }
+    pool.detach_task(
+        [&pool, &counter]
+        {
+            for (std::size_t i = 0; i < num_tasks; ++i)
+            {
+                pool.detach_task(
+                    [&counter]
+                    {
+                        ++counter;
+                    });
+            }
+        });
+    pool.wait();
+    check(2 * num_tasks, counter.load());
+    sync_out.println("Checking that spinning workers are not counted as running tasks...");
+    check(static_cast<std::size_t>(0), pool.get_tasks_running());
+    pool.set_spin_budget(0);
+    check(static_cast<std::size_t>(0), pool.get_spin_budget());
+}
 
 /**
- * @brief A function that throws a `test_exception`.
+ * @brief Check that spinning before sleeping works with several combinations of optional features.
  */
-void throws()
+void check_spinning()
 {
-    sync_out.println("Throwing exception...");
-    throw test_exception();
-};
+    sync_out.println("Checking a pool with no optional features...");
+    check_spinning_pool<BS::tp::none>();
+    sync_out.println("Checking a pool with task priority...");
+    check_spinning_pool<BS::tp::priority>();
+    sync_out.println("Checking a pool with work stealing...");
+    check_spinning_pool<BS::tp::work_stealing>();
+    sync_out.println("Checking a pool with the lock-free queue...");
+    check_spinning_pool<BS::tp::lock_free>();
+}
+
+// =============================================
+// Functions to verify the statistics collection
+// =============================================
 
 /**
- * @brief Check that exceptions are forwarded correctly by submit_task().
+ * @brief Check that the buckets of `BS::latency_histogram` cover all values without gaps or overlaps.
  */
-void check_exceptions_submit()
+void check_histogram_buckets()
 {
-    BS::thread_pool pool;
-    sync_out.println("Checking that exceptions are forwarded correctly by submit_task()...");
-    bool caught = false;
-    std::future<void> future = pool.submit_task(throws);
-    try
-    {
-        future.get();
-    }
-    catch (const test_exception&)
+    using histogram = BS::latency_histogram;
+    bool passed = true;
+    for (std::size_t i = 0; i < histogram::num_buckets; ++i)
     {
-        caught = true;
+        passed = passed && (histogram::bucket_index(histogram::bucket_lower_bound(i)) == i) && (histogram::bucket_index(histogram::bucket_upper_bound(i)) == i);
+        if (i > 0)
+            passed = passed && (histogram::bucket_lower_bound(i) == histogram::bucket_upper_bound(i - 1) + 1);
     }
-    check(caught);
+    check(passed);
+    sync_out.println("Checking that each bucket is at most 1/16 wider than its lower bound...");
+    passed = true;
+    for (std::size_t i = histogram::sub_bucket_count; i < histogram::num_buckets - 1; ++i)
+        passed = passed && ((histogram::bucket_upper_bound(i) - histogram::bucket_lower_bound(i) + 1) * histogram::sub_bucket_count <= histogram::bucket_lower_bound(i));
+    check(passed);
 }
 
 /**
- * @brief Check that exceptions are forwarded correctly by `BS::multi_future`.
+ * @brief Check that the statistics collected by a pool are consistent with the tasks it executed: every task is counted once, the execution times are at least as long as the tasks, the per-thread statistics add up to the totals, and the totals survive a reset.
  */
-void check_exceptions_multi_future()
+void check_statistics_pool()
 {
-    BS::thread_pool pool;
-    sync_out.println("Checking that exceptions are forwarded correctly by BS::multi_future...");
-    bool caught = false;
-    BS::multi_future<void> future;
-    future.push_back(pool.submit_task(throws));
-    future.push_back(pool.submit_task(throws));
-    try
-    {
-        future.get();
-    }
-    catch (const test_exception&)
+    constexpr std::size_t num_threads = 4;
+    constexpr std::size_t num_tasks = 100;
+    constexpr std::chrono::microseconds sleep_time(500);
+    BS::thread_pool<BS::tp::statistics | BS::tp::work_stealing> pool(num_threads);
+    sync_out.println("Detaching ", num_tasks, " tasks that sleep for ", sleep_time.count(), " microseconds, and the same number of tasks from within the pool...");
+    for (std::size_t i = 0; i < num_tasks; ++i)
     {
-        caught = true;
+        pool.detach_task(
+            [sleep_time]
+            {
+                std::this_thread::sleep_for(sleep_time);
+            });
     }
-    check(caught);
+    pool.detach_task(
+        [&pool]
+        {
+            for (std::size_t i = 0; i < num_tasks; ++i)
+                pool.detach_task([] {});
+        });
+    pool.wait();
+    const std::uint64_t total_tasks = (2 * num_tasks) + 1;
+    BS::pool_statistics stats = pool.get_statistics();
+    sync_out.println("Checking that every task was counted once...");
+    check(total_tasks, stats.execution_time.get_count());
+    check(total_tasks, stats.wait_time.get_count());
+    sync_out.println("Checking that the execution times are at least as long as the sleeping tasks...");
+    const auto sleep_ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(sleep_time).count());
+    check(stats.execution_time.get_max() >= sleep_ns);
+    check(stats.execution_time.get_sum() >= num_tasks * sleep_ns);
+    check(stats.execution_time.get_quantile(1.0) == stats.execution_time.get_max());
+    sync_out.println("Checking that the statistics of the threads add up to the totals...");
+    BS::pool_statistics sum;
+    for (std::size_t i = 0; i < num_threads; ++i)
+        sum.merge(pool.get_thread_statistics(i));
+    check(stats.execution_time.get_count(), sum.execution_time.get_count());
+    check(stats.execution_time.get_sum(), sum.execution_time.get_sum());
+    check(stats.steals, sum.steals);
+    sync_out.println("Checking that the totals are kept when the pool is reset...");
+    pool.reset(num_threads / 2);
+    pool.detach_task([] {});
+    pool.wait();
+    stats = pool.get_statistics();
+    check(total_tasks + 1, stats.execution_time.get_count());
+    check(static_cast<std::uint64_t>(1), pool.get_thread_statistics(0).execution_time.get_count() + pool.get_thread_statistics(1).execution_time.get_count());
+    sync_out.println("Checking the Prometheus output...");
+    std::ostringstream stream;
+    stats.write_prometheus(stream, "test");
+    const std::string output = stream.str();
+    check(output.find("# TYPE test_task_execution_seconds histogram\n") != std::string::npos);
+    check(output.find("test_task_execution_seconds_count " + std::to_string(total_tasks + 1) + "\n") != std::string::npos);
+    check(output.find("test_task_wait_seconds_bucket{le=\"+Inf\"} " + std::to_string(total_tasks + 1) + "\n") != std::string::npos);
+    check(output.find("test_steals_total " + std::to_string(stats.steals) + "\n") != std::string::npos);
 }
-#endif
-
-// =====================================
-// Functions to verify vector operations
-// =====================================
 
 /**
- * @brief Check that parallelized vector operations work as expected by calculating the sum of two randomized vectors of a specific size in two ways, single-threaded and multithreaded, and comparing the results.
- *
- * @param pool The thread pool to check.
- * @param vector_size The size of the vectors.
- * @param num_tasks The number of tasks to split the calculation into.
- * @return `true` if the single-threaded and multithreaded results are equal, `false` otherwise.
+ * @brief Check that the statistics collection works.
  */
-bool check_vector_of_size(BS::thread_pool<>& pool, const std::size_t vector_size, const std::size_t num_tasks)
+void check_statistics()
 {
-    constexpr std::int64_t value_range = 1000000;
-    std::vector<std::int64_t> vector_1(vector_size);
-    std::vector<std::int64_t> vector_2(vector_size);
-    for (std::size_t i = 0; i < vector_size; ++i)
-    {
-        vector_1[i] = random(-value_range, value_range);
-        vector_2[i] = random(-value_range, value_range);
-    }
-    sync_out.println("Adding two vectors with ", vector_size, " elements using ", num_tasks, " tasks...");
-    std::vector<std::int64_t> sum_single(vector_size);
-    for (std::size_t i = 0; i < vector_size; ++i)
-        sum_single[i] = vector_1[i] + vector_2[i];
-    std::vector<std::int64_t> sum_multi(vector_size);
-    pool.submit_blocks(
-            0, vector_size,
-            [&sum_multi, &vector_1, &vector_2](const std::size_t start, const std::size_t end)
-            {
-                for (std::size_t i = start; i < end; ++i)
-                    sum_multi[i] = vector_1[i] + vector_2[i];
-            },
-            num_tasks)
-        .wait();
-    for (std::size_t i = 0; i < vector_size; ++i)
-    {
-        if (sum_single[i] != sum_multi[i])
-            return false;
-    }
-    return true;
+    sync_out.println("Checking the buckets of BS::latency_histogram...");
+    check_histogram_buckets();
+    check_statistics_pool();
 }
 
+// ================================
+// Functions to verify task tracing
+// ================================
+
 /**
- * @brief Check that parallelized vector operations work as expected.
+ * @brief Check that task tracing records the tag, priority, and times of each task, that the trace buffers wrap around, and that the trace is written in the JSON trace event format.
  */
-void check_vectors()
+void check_trace()
 {
-    constexpr std::size_t size_range = 1000000;
-    constexpr std::size_t repeats = 10;
-    BS::thread_pool pool;
-    for (std::size_t i = 0; i < repeats; ++i)
-        check(check_vector_of_size(pool, random<std::size_t>(0, size_range), random<std::size_t>(1, pool.get_thread_count())));
+    constexpr std::size_t num_threads = 2;
+    constexpr std::size_t num_tasks = 10;
+    BS::thread_pool<BS::tp::trace | BS::tp::priority> pool(num_threads,
+        []([[maybe_unused]] const std::size_t idx)
+        {
+#ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
+            BS::this_thread::set_os_thread_name(make_string("Traced #", idx));
+#endif
+        });
+    sync_out.println("Detaching ", num_tasks, " tagged tasks with priority 3, each submitting another task, and one untagged task...");
+    {
+        const BS::this_thread::trace_tag tag("parent");
+        for (std::size_t i = 0; i < num_tasks; ++i)
+        {
+            pool.detach_task(
+                [&pool]
+                {
+                    pool.detach_task([] {});
+                },
+                3);
+        }
+    }
+    pool.detach_task([] {});
+    pool.wait();
+    std::vector<BS::trace_event> events = pool.get_trace();
+    sync_out.println("Checking that every task was recorded once...");
+    check((2 * num_tasks) + 1, events.size());
+    sync_out.println("Checking that the tasks submitted by the tagged tasks inherited their tag, and that the untagged task has no tag...");
+    std::size_t tagged = 0;
+    std::size_t with_priority = 0;
+    bool times_ordered = true;
+    bool indices_valid = true;
+    for (const BS::trace_event& event : events)
+    {
+        if (event.tag != nullptr && std::string_view(event.tag) == "parent")
+            ++tagged;
+        if (event.priority == 3)
+            ++with_priority;
+        times_ordered = times_ordered && (event.enqueued <= event.dequeued) && (event.dequeued <= event.completed);
+        indices_valid = indices_valid && (event.thread_idx < num_threads);
+    }
+    check(2 * num_tasks, tagged);
+    sync_out.println("Checking that the priorities were recorded...");
+    check(num_tasks, with_priority);
+    sync_out.println("Checking that each task was submitted before it started, and started before it finished...");
+    check(times_ordered);
+    check(indices_valid);
+    sync_out.println("Checking the JSON output...");
+    {
+        const BS::this_thread::trace_tag tag("quote\"backslash\\");
+        pool.detach_task([] {});
+    }
+    pool.wait();
+    std::ostringstream stream;
+    pool.write_chrome_trace(stream);
+    const std::string output = stream.str();
+    check(output.rfind("{\"traceEvents\":[\n", 0) == 0);
+    check(output.find("\"name\":\"quote\\\"backslash\\\\\",\"cat\":\"task\",\"ph\":\"X\"") != std::string::npos);
+    check(output.find("\"name\":\"task\",\"cat\":\"queue\",\"ph\":\"b\"") != std::string::npos);
+#ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
+    check(output.find("\"args\":{\"name\":\"Traced #1\"}") != std::string::npos);
+#else
+    check(output.find("\"args\":{\"name\":\"Thread 1\"}") != std::string::npos);
+#endif
+    check(output.size() >= 4 && output.compare(output.size() - 4, 4, "\n]}\n") == 0);
+    sync_out.println("Checking that clear_trace() discards the events...");
+    pool.clear_trace();
+    check(pool.get_trace().empty());
+    sync_out.println("Checking that only the last ", BS::trace_buffer_size, " events of each thread are kept...");
+    pool.reset(1);
+    pool.detach_batch(BS::trace_buffer_size + num_tasks,
+        [](std::size_t)
+        {
+            return [] {};
+        });
+    pool.wait();
+    events = pool.get_trace();
+    check(BS::trace_buffer_size, events.size());
+    check(std::all_of(events.begin(), events.end(),
+        [](const BS::trace_event& event)
+        {
+            return event.thread_idx == 0;
+        }));
 }
 
-// =================================
-// Functions to verify task priority
-// =================================
-
-// Priorities are 8-bit integers, but `std::uniform_int_distribution` needs at least a 16-bit integer.
-using rand_priority_t = std::int16_t;
+// ============================================
+// Functions to verify the elastic thread count
+// ============================================
 
 /**
- * @brief Check that task priority works as expected with all task submission methods.
+ * @brief Check that a pool with the elastic thread count starts threads when the running threads get blocked or when tasks back up in the queue, retires them once they have been idle for the idle timeout, and does not lose any tasks along the way.
  */
-void check_priority()
+template <BS::opt_t OptFlags>
+void check_elastic_pool()
 {
-    constexpr std::chrono::milliseconds sleep_time(200);
-    constexpr std::size_t num_tasks = 10;
-    // Set the pool to have only 1 thread, so it can only run 1 task at a time. This will ensure the tasks will be executed in priority order.
-    BS::thread_pool<BS::tp::priority | BS::tp::pause> pool(1);
-    pool.pause();
-
-    // Create a shuffled lists of priorities.
-    std::vector<BS::priority_t> priorities;
-    priorities.reserve(num_tasks - 1);
-    for (std::size_t i = 0; i < num_tasks - 1; ++i)
-        priorities.push_back(static_cast<BS::priority_t>((i % 2 == 0) ? random<rand_priority_t>(0, BS::pr::highest) : random<rand_priority_t>(BS::pr::lowest, 0)));
-    priorities.push_back(BS::pr::lowest);
-    priorities.push_back(0);
-    priorities.push_back(BS::pr::highest);
-    std::shuffle(priorities.begin(), priorities.end(), std::mt19937_64(std::random_device()()));
-
-    // Submit tasks using various methods in random priority order.
-    std::vector<BS::priority_t> execution_order;
-    std::mutex exec_mutex;
-    const auto execute_task_priority = [&execution_order, &exec_mutex](const BS::priority_t priority)
-    {
-        const std::scoped_lock lock(exec_mutex);
-        sync_out.println("Task with priority ", static_cast<rand_priority_t>(priority), " executed.");
-        execution_order.push_back(priority);
+    constexpr std::size_t max_threads = 8;
+    constexpr std::size_t min_threads = 2;
+    constexpr std::size_t num_blocking = 6;
+    constexpr std::size_t num_tasks = 200;
+    std::atomic<std::size_t> inits = 0;
+    std::atomic<std::size_t> cleanups = 0;
+    const auto count_init = [&inits]
+    {
+        ++inits;
     };
-    const std::vector<std::string_view> functions = {"detach_task", "submit_task", "detach_sequence", "submit_sequence", "detach_loop", "submit_loop", "detach_blocks", "submit_blocks"};
-    for (const BS::priority_t priority : priorities)
     {
-        const std::string_view func = functions[random<std::size_t>(0, functions.size() - 1)];
-        sync_out.println("Launching ", func, "() with priority ", static_cast<rand_priority_t>(priority), "...");
-        if (func == "detach_task")
+        BS::thread_pool<OptFlags | BS::tp::elastic> pool(max_threads, count_init);
+        pool.set_cleanup_func(
+            [&cleanups]
+            {
+                ++cleanups;
+            });
+        sync_out.println("Checking that only the minimum number of threads is started...");
+        check(max_threads, pool.get_thread_count());
+        check(static_cast<std::size_t>(1), pool.get_active_thread_count());
+        pool.set_min_threads(min_threads);
+        pool.set_idle_timeout(std::chrono::milliseconds(20));
+        check(min_threads, pool.get_min_threads());
+        check(static_cast<std::int64_t>(20), static_cast<std::int64_t>(pool.get_idle_timeout().count()));
+        check(min_threads, pool.get_active_thread_count());
+
+        sync_out.println("Detaching ", num_blocking, " tasks that block inside a blocking region until all of them have started...");
+        std::atomic<std::size_t> started = 0;
+        std::atomic<bool> release = false;
+        for (std::size_t i = 0; i < num_blocking; ++i)
         {
             pool.detach_task(
-                [priority, &execute_task_priority]
+                [&started, &release]
                 {
-                    execute_task_priority(priority);
-                },
-                priority);
+                    const BS::this_thread::blocking_region region;
+                    ++started;
+                    while (!release)
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                });
         }
-        else if (func == "submit_task")
+        check(wait_for_condition(
+            [&started]
+            {
+                return started == num_blocking;
+            }));
+        check(num_blocking, pool.get_blocked_thread_count());
+        check(pool.get_active_thread_count() >= num_blocking);
+        release = true;
+        pool.wait();
+        check(static_cast<std::size_t>(0), pool.get_blocked_thread_count());
+
+        sync_out.println("Checking that the extra threads retire after the idle timeout...");
+        check(wait_for_condition(
+            [&pool]
+            {
+                return pool.get_active_thread_count() == min_threads;
+            }));
+        sync_out.println("Checking that get_thread_ids() returns default identifiers for the slots of the retired threads...");
+        check(wait_for_condition(
+            [&pool]
+            {
+                const std::vector<std::thread::id> ids = pool.get_thread_ids();
+                return static_cast<std::size_t>(std::count_if(ids.begin(), ids.end(),
+                           [](const std::thread::id id)
+                           {
+                               return id != std::thread::id();
+                           }))
+                    == min_threads;
+            }));
+
+        sync_out.println("Detaching ", num_tasks, " tasks that sleep for 1 millisecond...");
+        std::atomic<std::size_t> counter = 0;
+        for (std::size_t i = 0; i < num_tasks; ++i)
         {
-            std::ignore = pool.submit_task(
-                [priority, &execute_task_priority]
+            pool.detach_task(
+                [&counter]
                 {
-                    execute_task_priority(priority);
-                },
-                priority);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    ++counter;
+                });
         }
-        else if (func == "detach_sequence")
+        std::size_t peak = 0;
+        while (counter < num_tasks)
         {
-            pool.detach_sequence(
-                0, 1,
-                [priority, &execute_task_priority](std::int64_t)
-                {
-                    execute_task_priority(priority);
-                },
-                priority);
+            peak = std::max(peak, pool.get_active_thread_count());
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
         }
-        else if (func == "submit_sequence")
+        pool.wait();
+        sync_out.println("Checking that more threads were started while the tasks were backing up, and that all the tasks were executed...");
+        check(peak > min_threads);
+        check(peak <= max_threads);
+        check(num_tasks, counter.load());
+
+        sync_out.println("Checking that resetting the pool keeps the minimum number of threads...");
+        pool.reset(max_threads / 2, count_init);
+        check(max_threads / 2, pool.get_thread_count());
+        check(min_threads, pool.get_active_thread_count());
+    }
+    sync_out.println("Checking that the cleanup function ran once for every thread that was started...");
+    check(inits.load(), cleanups.load());
+}
+
+/**
+ * @brief Check that the elastic thread count works, and that a blocking region does nothing in a thread that does not belong to an elastic pool.
+ */
+void check_elastic()
+{
+    sync_out.println("Checking a pool with no other optional features...");
+    check_elastic_pool<BS::tp::none>();
+    sync_out.println("Checking a pool with work stealing...");
+    check_elastic_pool<BS::tp::work_stealing>();
+    sync_out.println("Checking a pool with the lock-free queue...");
+    check_elastic_pool<BS::tp::lock_free>();
+    sync_out.println("Checking that a blocking region in a thread of a pool without the elastic thread count does nothing...");
+    BS::thread_pool pool(1);
+    pool.submit_task(
+            []
+            {
+                const BS::this_thread::blocking_region outer;
+                const BS::this_thread::blocking_region inner;
+            })
+        .wait();
+    check(static_cast<std::size_t>(1), pool.get_thread_count());
+}
+
+// ======================================
+// Functions to verify the queue capacity
+// ======================================
+
+/**
+ * @brief Check that a queue capacity limits the number of queued tasks, that `try_detach_task()` and `detach_task_for()` fail without consuming the task when the queue is full, that `detach_task()` and the batch functions block until there is room, and that tasks submitted from within the pool are not limited.
+ */
+template <BS::opt_t OptFlags>
+void check_queue_capacity_pool()
+{
+    constexpr std::size_t num_threads = 2;
+    constexpr std::size_t capacity = 4;
+    BS::thread_pool<OptFlags> pool(num_threads);
+    check(static_cast<std::size_t>(0), pool.get_queue_capacity());
+    pool.set_queue_capacity(capacity);
+    check(capacity, pool.get_queue_capacity());
+    std::atomic<bool> release = false;
+    std::atomic<bool> full = false;
+    std::atomic<bool> inner_accepted = false;
+    std::atomic<std::size_t> counter = 0;
+    sync_out.println("Blocking all ", num_threads, " threads and filling the queue with ", capacity, " tasks...");
+    pool.detach_task(
+        [&pool, &release, &full, &inner_accepted]
         {
-            std::ignore = pool.submit_sequence(
-                0, 1,
-                [priority, &execute_task_priority](std::int64_t)
-                {
-                    execute_task_priority(priority);
-                },
-                priority);
-        }
-        else if (func == "detach_loop")
+            while (!full)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            inner_accepted = pool.try_detach_task([] {});
+            while (!release)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+    for (std::size_t i = 1; i < num_threads; ++i)
+    {
+        pool.detach_task(
+            [&release]
+            {
+                while (!release)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            });
+    }
+    check(wait_for_condition(
+        [&pool]
         {
-            pool.detach_loop(
-                0, 1,
-                [priority, &execute_task_priority](std::int64_t)
+            return pool.get_tasks_queued() == 0;
+        }));
+    std::size_t accepted = 0;
+    for (std::size_t i = 0; i < capacity + 2; ++i)
+    {
+        if (pool.try_detach_task(
+                [&counter]
                 {
-                    execute_task_priority(priority);
-                },
-                0, priority);
-        }
-        else if (func == "submit_loop")
+                    ++counter;
+                }))
+            ++accepted;
+    }
+    check(capacity, accepted);
+    check(capacity, pool.get_tasks_queued());
+
+    sync_out.println("Checking that tasks submitted from within the pool are not limited...");
+    full = true;
+    check(wait_for_condition(
+        [&inner_accepted]
         {
-            std::ignore = pool.submit_loop(
-                0, 1,
-                [priority, &execute_task_priority](std::int64_t)
-                {
-                    execute_task_priority(priority);
-                },
-                0, priority);
-        }
-        else if (func == "detach_blocks")
+            return inner_accepted.load();
+        }));
+    check(capacity + 1, pool.get_tasks_queued());
+
+    sync_out.println("Checking that a rejected task is left untouched...");
+    auto rejected = [payload = std::vector<std::size_t>(100, 1), &counter]
+    {
+        counter += payload.size();
+    };
+    check(!pool.try_detach_task(std::move(rejected))); // NOLINT(bugprone-use-after-move,hicpp-invalid-access-moved)
+    const std::chrono::milliseconds timeout(20);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    check(!pool.detach_task_for(std::move(rejected), timeout)); // NOLINT(bugprone-use-after-move,hicpp-invalid-access-moved)
+    check(std::chrono::steady_clock::now() - start >= timeout);
+    std::size_t before = counter;
+    rejected(); // NOLINT(bugprone-use-after-move,hicpp-invalid-access-moved)
+    check(before + 100, counter.load());
+
+    sync_out.println("Checking that detach_task() blocks while the queue is full...");
+    std::atomic<bool> blocked_done = false;
+    std::thread blocked_thread(
+        [&pool, &counter, &blocked_done]
         {
-            pool.detach_blocks(
-                0, 1,
-                [priority, &execute_task_priority](std::int64_t, std::int64_t)
+            pool.detach_task(
+                [&counter]
                 {
-                    execute_task_priority(priority);
-                },
-                0, priority);
-        }
-        else if (func == "submit_blocks")
+                    ++counter;
+                });
+            blocked_done = true;
+        });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    check(!blocked_done);
+    release = true;
+    blocked_thread.join();
+    pool.wait();
+    before = counter;
+
+    sync_out.println("Submitting a batch of 100 tasks, larger than the capacity, while monitoring the queue...");
+    std::atomic<bool> monitoring = true;
+    std::atomic<std::size_t> max_queued = 0;
+    std::thread monitor(
+        [&pool, &monitoring, &max_queued]
         {
-            std::ignore = pool.submit_blocks(
-                0, 1,
-                [priority, &execute_task_priority](std::int64_t, std::int64_t)
-                {
-                    execute_task_priority(priority);
-                },
-                0, priority);
-        }
-    }
+            while (monitoring)
+            {
+                max_queued = std::max(max_queued.load(), pool.get_tasks_queued());
+                std::this_thread::yield();
+            }
+        });
+    pool.detach_sequence(std::size_t{0}, std::size_t{100},
+        [&counter](std::size_t)
+        {
+            ++counter;
+        });
+    pool.wait();
+    monitoring = false;
+    monitor.join();
+    check(before + 100, counter.load());
+    check(max_queued <= capacity);
 
-    // Unpause the pool so the tasks can be executed, then check that they were executed in the correct order.
-    sync_out.println("Checking execution order...");
-    std::this_thread::sleep_for(sleep_time);
-    pool.unpause();
+    sync_out.println("Checking that setting the capacity to 0 makes the queue unbounded...");
+    pool.set_queue_capacity(0);
+    release = false;
+    for (std::size_t i = 0; i < num_threads; ++i)
+    {
+        pool.detach_task(
+            [&release]
+            {
+                while (!release)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            });
+    }
+    accepted = 0;
+    for (std::size_t i = 0; i < capacity * 2; ++i)
+    {
+        if (pool.try_detach_task([] {}))
+            ++accepted;
+    }
+    release = true;
     pool.wait();
-    std::sort(priorities.rbegin(), priorities.rend());
-    check(execution_order == priorities);
+    check(capacity * 2, accepted);
+}
+
+/**
+ * @brief Check that the queue capacity works.
+ */
+void check_queue_capacity()
+{
+    sync_out.println("Checking a pool with no optional features...");
+    check_queue_capacity_pool<BS::tp::none>();
+    sync_out.println("Checking a pool with task priority...");
+    check_queue_capacity_pool<BS::tp::priority>();
+    sync_out.println("Checking a pool with work stealing...");
+    check_queue_capacity_pool<BS::tp::work_stealing>();
+    sync_out.println("Checking a pool with the lock-free queue...");
+    check_queue_capacity_pool<BS::tp::lock_free>();
 }
 
 // =======================================================================
@@ -2359,16 +5293,229 @@ void check_shared_ptr_all()
  */
 void check_task_destruct()
 {
-    constexpr std::chrono::milliseconds sleep_time(20);
-    BS::thread_pool pool;
+    constexpr std::chrono::milliseconds sleep_time(20);
+    BS::thread_pool pool;
+    std::atomic<bool> object_exists = false;
+    {
+        const std::shared_ptr<detect_destruct> ptr = std::make_shared<detect_destruct>(&object_exists);
+        pool.submit_task([ptr] {}).wait();
+    }
+    std::this_thread::sleep_for(sleep_time);
+    check(!object_exists);
+}
+
+/**
+ * @brief Check that the function shared by all the tasks of a loop or sequence is destroyed exactly once, together with the last task, whether the tasks are executed, purged from the queue, or submitted from within the pool.
+ */
+void check_shared_function_destruct()
+{
+    constexpr std::size_t num_tasks = 100;
+    std::atomic<std::size_t> executed = 0;
+    std::atomic<std::size_t> destroyed = 0;
+    int object = 0;
+    const auto make_guard = [&destroyed, &object]
+    {
+        const auto deleter = [&destroyed](int*)
+        {
+            ++destroyed;
+        };
+        return std::unique_ptr<int, decltype(deleter)>(&object, deleter);
+    };
+    sync_out.println("Checking that the function is destroyed once, after the last task runs...");
+    {
+        BS::thread_pool pool;
+        pool.detach_loop(0, num_tasks,
+            [&executed, guard = make_guard()](std::size_t)
+            {
+                ++executed;
+            });
+        std::ignore = pool.submit_sequence(0, num_tasks,
+            [&executed, guard = make_guard()](std::size_t)
+            {
+                ++executed;
+            });
+        pool.wait();
+        check(2 * num_tasks, executed.load());
+    }
+    check(2, destroyed.load());
+    sync_out.println("Checking that the function is destroyed once when its tasks are purged...");
+    {
+        BS::pause_thread_pool pool;
+        pool.pause();
+        pool.detach_blocks(0, num_tasks,
+            [guard = make_guard()](std::size_t, std::size_t) {}, num_tasks);
+        check(2, destroyed.load());
+        pool.purge();
+        check(3, destroyed.load());
+        pool.unpause();
+    }
+    sync_out.println("Checking that the function is destroyed once when the loop is submitted from within the pool...");
+    {
+        BS::thread_pool pool;
+        pool.submit_task(
+                [&pool, &executed, &make_guard]
+                {
+                    pool.detach_sequence(0, num_tasks,
+                        [&executed, guard = make_guard()](std::size_t)
+                        {
+                            ++executed;
+                        });
+                })
+            .wait();
+        pool.wait();
+        check(3 * num_tasks, executed.load());
+    }
+    check(4, destroyed.load());
+}
+
+/**
+ * @brief Check that `BS::small_task` stores small callable objects inline, supports move-only and large callable objects, and destroys them exactly once.
+ */
+void check_small_task()
+{
+    sync_out.println("Checking that small callable objects are stored inline and large ones are not...");
+    std::array<std::byte, BS::task_buffer_size> small_capture = {};
+    std::array<std::byte, BS::task_buffer_size + 1> large_capture = {};
+    const auto small_lambda = [small_capture] { static_cast<void>(small_capture); };
+    const auto large_lambda = [large_capture] { static_cast<void>(large_capture); };
+    check(BS::small_task::stored_inline<decltype(small_lambda)>);
+    check(!BS::small_task::stored_inline<decltype(large_lambda)>);
+    sync_out.println("Checking that a task with a result and a small capture is stored inline...");
+    std::promise<std::size_t> promise;
+    auto lambda_with_promise = [promise = std::move(promise), ptr = std::make_shared<std::size_t>(0), start = std::size_t(0), end = std::size_t(0)]() mutable
+    {
+        promise.set_value(*ptr + start + end);
+    };
+    check(BS::small_task::stored_inline<decltype(lambda_with_promise)>);
+    sync_out.println("Checking that empty, moved-from, and moved-to tasks behave correctly...");
+    std::size_t counter = 0;
+    BS::small_task task1;
+    check(!task1);
+    BS::small_task task2 = [&counter]
+    {
+        ++counter;
+    };
+    task1 = std::move(task2);
+    check(static_cast<bool>(task1) && !task2); // NOLINT(bugprone-use-after-move, clang-analyzer-cplusplus.Move)
+    task1();
+    check(static_cast<std::size_t>(1), counter);
+    sync_out.println("Checking that large callable objects are executed and destroyed correctly...");
+    std::atomic<bool> object_exists = false;
+    {
+        BS::small_task task3 = [ptr = std::make_shared<detect_destruct>(&object_exists), large_capture]
+        {
+            static_cast<void>(large_capture);
+        };
+        BS::small_task task4 = std::move(task3);
+        task4();
+        check(object_exists.load());
+    }
+    check(!object_exists);
+    sync_out.println("Submitting a move-only task to the pool...");
+    BS::thread_pool pool;
+    std::unique_ptr<std::size_t> unique = std::make_unique<std::size_t>(42);
+    check(static_cast<std::size_t>(42), pool.submit_task(
+                                                 [unique = std::move(unique)]
+                                                 {
+                                                     return *unique;
+                                                 })
+                                             .get());
+}
+
+#ifdef __cpp_lib_memory_resource
+/**
+ * @brief A memory resource which counts the allocations and deallocations passed on to the default memory resource.
+ */
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+    std::size_t allocations = 0;
+    std::size_t deallocations = 0;
+
+private:
+    void* do_allocate(const std::size_t bytes, const std::size_t alignment) override
+    {
+        ++allocations;
+        return std::pmr::get_default_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* const ptr, const std::size_t bytes, const std::size_t alignment) override
+    {
+        ++deallocations;
+        std::pmr::get_default_resource()->deallocate(ptr, bytes, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+/**
+ * @brief Check that the per-thread memory resources work, and that large tasks can be allocated from a memory resource.
+ */
+void check_memory_resource()
+{
+    sync_out.println("Checking that the main thread uses the default memory resource...");
+    check(BS::this_thread::memory_resource() == std::pmr::get_default_resource());
+    check(BS::this_thread::pooled_memory_resource() == std::pmr::get_default_resource());
+
+    sync_out.println("Checking that the threads of a pool have their own arena and pooled memory resource...");
+    BS::thread_pool pool(1);
+    const auto get_resources = []
+    {
+        return std::pair<std::pmr::memory_resource*, std::pmr::memory_resource*>(BS::this_thread::memory_resource(), BS::this_thread::pooled_memory_resource());
+    };
+    const std::pair<std::pmr::memory_resource*, std::pmr::memory_resource*> resources = pool.submit_task(get_resources).get();
+    check(resources.first != std::pmr::get_default_resource() && resources.second != std::pmr::get_default_resource() && resources.first != resources.second);
+    check(resources == pool.submit_task(get_resources).get());
+
+    sync_out.println("Checking that the arena is released between tasks...");
+    const auto allocate_scratch = []
+    {
+        std::pmr::vector<std::size_t> scratch(BS::this_thread::memory_resource());
+        scratch.resize(16);
+        return static_cast<const void*>(scratch.data());
+    };
+    const void* const first_scratch = pool.submit_task(allocate_scratch).get();
+    check(first_scratch == pool.submit_task(allocate_scratch).get());
+
+    sync_out.println("Checking that a large callable object can be allocated from a memory resource...");
+    counting_resource counter;
+    std::array<std::byte, BS::task_buffer_size + 1> large_capture = {};
     std::atomic<bool> object_exists = false;
+    std::size_t calls = 0;
     {
-        const std::shared_ptr<detect_destruct> ptr = std::make_shared<detect_destruct>(&object_exists);
-        pool.submit_task([ptr] {}).wait();
+        BS::small_task task1(std::allocator_arg, &counter,
+            [ptr = std::make_shared<detect_destruct>(&object_exists), large_capture, &calls]
+            {
+                static_cast<void>(large_capture);
+                ++calls;
+            });
+        BS::small_task task2 = std::move(task1);
+        task2();
+        check(object_exists.load());
     }
-    std::this_thread::sleep_for(sleep_time);
+    check(!object_exists);
+    check(std::size_t{1}, calls);
+    check(std::size_t{1}, counter.allocations);
+    check(std::size_t{1}, counter.deallocations);
+
+    sync_out.println("Checking that large tasks submitted from within the pool are executed and destroyed correctly...");
+    pool.submit_task(
+            [&pool, &object_exists, large_capture]
+            {
+                pool.detach_task(
+                    [ptr = std::make_shared<detect_destruct>(&object_exists), large_capture]
+                    {
+                        static_cast<void>(large_capture);
+                    });
+            })
+        .wait();
+    pool.wait();
     check(!object_exists);
 }
+#endif
 
 /**
  * @brief Check that the type trait `BS::common_index_type` works as expected.
@@ -2395,6 +5542,135 @@ void check_common_index_type()
     // NOLINTEND(misc-redundant-expression)
 }
 
+/**
+ * @brief A stream buffer which collects its output in a string, counts how many times it was flushed, and can be closed to make writes block until it is opened again, used to check buffered `BS::synced_stream` objects.
+ */
+class gated_buffer : public std::streambuf
+{
+public:
+    std::string text;
+    std::atomic<bool> open = true;
+    std::atomic<bool> entered = false;
+    std::atomic<std::size_t> syncs = 0;
+
+protected:
+    int_type overflow(const int_type ch) override
+    {
+        if (traits_type::eq_int_type(ch, traits_type::eof()))
+            return traits_type::eof();
+        const char chr = traits_type::to_char_type(ch);
+        xsputn(&chr, 1);
+        return ch;
+    }
+
+    std::streamsize xsputn(const char* const str, const std::streamsize count) override
+    {
+        entered = true;
+        while (!open)
+            std::this_thread::yield();
+        text.append(str, static_cast<std::size_t>(count));
+        return count;
+    }
+
+    int sync() override
+    {
+        ++syncs;
+        return 0;
+    }
+};
+
+/**
+ * @brief Check that a buffered `BS::synced_stream` keeps the output of each call in one piece, writes everything when flushed or when buffered mode is disabled, flushes the streams when a flushing manipulator is printed, and counts the output discarded by the drop policy.
+ */
+void check_synced_stream_buffered()
+{
+    constexpr std::size_t num_threads = 4;
+    constexpr std::size_t lines_per_thread = 200;
+    {
+        sync_out.println("Checking that the output of each call is written in one piece...");
+        std::ostringstream out;
+        BS::synced_stream buffered_out(out);
+        buffered_out.start_buffering();
+        check(buffered_out.is_buffered());
+        BS::thread_pool pool(num_threads);
+        pool.detach_sequence<std::size_t>(0, num_threads,
+            [&buffered_out](const std::size_t thread)
+            {
+                for (std::size_t line = 0; line < lines_per_thread; ++line)
+                    buffered_out.println(thread, ' ', line, ' ', std::string(50, static_cast<char>('a' + thread)));
+            });
+        pool.wait();
+        buffered_out.flush_buffers();
+        std::istringstream in(out.str());
+        std::vector<std::size_t> next_line(num_threads, 0);
+        std::string text;
+        bool intact = true;
+        std::size_t num_lines = 0;
+        while (std::getline(in, text))
+        {
+            std::istringstream line_in(text);
+            std::size_t thread = num_threads;
+            std::size_t line = 0;
+            std::string letters;
+            line_in >> thread >> line >> letters;
+            if (thread >= num_threads || line != next_line[thread] || letters != std::string(50, static_cast<char>('a' + thread)))
+            {
+                intact = false;
+                break;
+            }
+            ++next_line[thread];
+            ++num_lines;
+        }
+        check(intact && num_lines == num_threads * lines_per_thread);
+    }
+    {
+        sync_out.println("Checking that flush_buffers() and stop_buffering() write all the pending output...");
+        std::ostringstream out;
+        BS::synced_stream buffered_out(out);
+        buffered_out.start_buffering();
+        buffered_out.print("Hello, ", 42, '!');
+        buffered_out.flush_buffers();
+        check(out.str() == "Hello, 42!");
+        buffered_out.println(" Goodbye.");
+        buffered_out.stop_buffering();
+        check(!buffered_out.is_buffered());
+        check(out.str() == "Hello, 42! Goodbye.\n");
+        buffered_out.print("Unbuffered.");
+        check(out.str() == "Hello, 42! Goodbye.\nUnbuffered.");
+    }
+    {
+        sync_out.println("Checking that printing BS::synced_stream::endl flushes the streams...");
+        gated_buffer buffer;
+        std::ostream out(&buffer);
+        BS::synced_stream buffered_out(out);
+        buffered_out.start_buffering();
+        buffered_out.print("Flushed", BS::synced_stream::endl);
+        const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (buffer.syncs == 0 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        check(buffer.syncs > 0);
+        buffered_out.flush_buffers();
+        check(buffer.text == "Flushed\n");
+    }
+    {
+        sync_out.println("Checking that the drop policy discards and counts output that does not fit...");
+        gated_buffer buffer;
+        std::ostream out(&buffer);
+        BS::synced_stream buffered_out(out);
+        buffered_out.start_buffering(10, BS::synced_stream::overflow_policy::drop);
+        buffer.open = false;
+        buffered_out.print("first");
+        while (!buffer.entered)
+            std::this_thread::yield();
+        buffered_out.print("0123456789");
+        buffered_out.print("dropped");
+        check(buffered_out.get_dropped() == 1);
+        buffer.open = true;
+        buffered_out.flush_buffers();
+        check(buffer.text == "first0123456789");
+    }
+}
+
 // ================================
 // Functions to check for deadlocks
 // ================================
@@ -3106,6 +6382,16 @@ public:
         elapsed_time = std::chrono::steady_clock::now() - start_time;
     }
 
+    /**
+     * @brief Get the number of milliseconds stored when `stop()` was last called, including the fractional part.
+     *
+     * @return The number of milliseconds.
+     */
+    [[nodiscard]] double fractional_ms() const
+    {
+        return std::chrono::duration<double, std::milli>(elapsed_time).count();
+    }
+
     /**
      * @brief Get the number of milliseconds stored when `stop()` was last called.
      *
@@ -3128,6 +6414,49 @@ private:
     std::chrono::duration<double> elapsed_time = std::chrono::duration<double>::zero();
 }; // class timer
 
+/**
+ * @brief Benchmark the throughput of the pool with tasks that do almost nothing, so that the time is dominated by the pool's own bookkeeping: the global mutex and counters when the tasks are submitted from outside the pool, and the local queues when they are submitted from within it. If different threads write to the same cache line, the throughput drops sharply as the number of threads increases.
+ *
+ * @param max_threads The maximum number of threads to try. The number of threads starts at 1 and is doubled until it exceeds this number.
+ */
+void benchmark_tiny_tasks(const std::size_t max_threads)
+{
+    constexpr std::size_t tasks_per_thread = 100000;
+    constexpr int width_threads = 4;
+    constexpr int width_tpms = 8;
+    sync_out.println("Measuring the throughput of tiny tasks, submitted from outside the pool as a batch and from within the pool to the local queues (with ", tasks_per_thread, " tasks per thread):");
+    timer tmr;
+    for (std::size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+    {
+        BS::thread_pool<BS::tp::work_stealing> pool(num_threads);
+        const std::size_t num_tasks = num_threads * tasks_per_thread;
+        const auto tiny_task = [] {};
+        tmr.start();
+        pool.detach_batch(num_tasks,
+            [&tiny_task](std::size_t)
+            {
+                return tiny_task;
+            });
+        pool.wait();
+        tmr.stop();
+        const std::chrono::milliseconds::rep global_ms = std::max<std::chrono::milliseconds::rep>(tmr.ms(), 1);
+        tmr.start();
+        for (std::size_t i = 0; i < num_threads; ++i)
+        {
+            pool.detach_task(
+                [&pool, &tiny_task]
+                {
+                    for (std::size_t j = 0; j < tasks_per_thread; ++j)
+                        pool.detach_task(tiny_task);
+                });
+        }
+        pool.wait();
+        tmr.stop();
+        const std::chrono::milliseconds::rep local_ms = std::max<std::chrono::milliseconds::rep>(tmr.ms(), 1);
+        sync_out.println(std::setw(width_threads), num_threads, (num_threads == 1) ? " thread:  " : " threads: ", "global queue ", std::setw(width_tpms), static_cast<double>(num_tasks) / static_cast<double>(global_ms), " tasks/ms, local queues ", std::setw(width_tpms), static_cast<double>(num_tasks) / static_cast<double>(local_ms), " tasks/ms.");
+    }
+}
+
 /**
  * @brief Benchmark multithreaded performance by calculating the Mandelbrot set.
  *
@@ -3276,6 +6605,32 @@ void check_performance(const bool benchmark, const bool plot, const bool save)
             }
         }
         print_speedup(different_n_timings, try_tasks);
+
+        // Compare with dynamic and guided scheduling, which claim chunks from a shared counter instead of dividing the image into blocks in advance, and are therefore less sensitive to the uneven distribution of escape times across the image.
+        for (const BS::schedule policy : {BS::schedule::dynamic, BS::schedule::guided})
+        {
+            image = image_matrix<color>(benchmark_image_size, benchmark_image_size);
+            sync_out.print(std::setw(width_tasks), thread_count, (thread_count == 1) ? " task:  [" : " tasks: [");
+            for (std::size_t i = 0; i < num_repeats; ++i)
+            {
+                tmr.start();
+                pool.detach_blocks(0, benchmark_image_size * benchmark_image_size, loop, policy);
+                pool.wait();
+                tmr.stop();
+                same_n_timings.push_back(tmr.ms());
+                sync_out.print('.');
+                offset = (offset + 1) % num_repeats;
+            }
+            sync_out.println("]  (", schedule_name(policy), " scheduling)");
+            const mean_sd stats = analyze(same_n_timings);
+            const std::chrono::milliseconds::rep total_time = std::reduce(same_n_timings.begin(), same_n_timings.end());
+            const double pixels_per_ms = static_cast<double>(benchmark_image_size * benchmark_image_size) / static_cast<double>(total_time);
+            same_n_timings.clear();
+            print_timing(stats, pixels_per_ms);
+        }
+
+        // Measure the overhead of the pool itself, at up to twice as many threads as the hardware supports, where contention between the threads is highest.
+        benchmark_tiny_tasks(2 * thread_count);
     }
 
     if (plot)
@@ -3303,6 +6658,408 @@ void check_performance(const bool benchmark, const bool plot, const bool save)
     print_header("Thread pool performance test completed!", '+');
 }
 
+/**
+ * @brief A struct to store the result of one configuration of the benchmark matrix: the median and minimum of its run times, and the number of rounds they were calculated from.
+ */
+struct [[nodiscard]] matrix_result
+{
+    std::string workload;
+    std::string pool;
+    std::size_t threads = 0;
+    std::string strategy;
+    std::size_t rounds = 0;
+    double median = 0;
+    double min = 0;
+
+    /**
+     * @brief Get the key identifying the configuration, used to match it with the same configuration in the baseline.
+     *
+     * @return The key.
+     */
+    [[nodiscard]] std::string key() const
+    {
+        return workload + ',' + pool + ',' + std::to_string(threads) + ',' + strategy;
+    }
+};
+
+/**
+ * @brief A struct to store a workload used in the benchmark matrix: its name, the number of indices in its loop, and the loop function.
+ */
+struct [[nodiscard]] matrix_workload
+{
+    std::string_view name;
+    std::size_t size = 0;
+    std::function<void(std::size_t, std::size_t)> loop;
+};
+
+/**
+ * @brief Calculate the median of a set of numbers.
+ *
+ * @param values The numbers. Must not be empty.
+ * @return The median.
+ */
+double median_of(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    const std::size_t middle = values.size() / 2;
+    return ((values.size() % 2) == 1) ? values[middle] : ((values[middle - 1] + values[middle]) / 2);
+}
+
+/**
+ * @brief Run all the workloads, thread counts, and partitioning strategies of the benchmark matrix using one pool variant, and append the results. For each thread count, the configurations are run in interleaved rounds, one run of each configuration per round, after one warm-up round which is not measured, so that a slow period of the system affects all the configurations a little instead of a few of them a lot.
+ *
+ * @tparam OptFlags The template parameter of the thread pool.
+ * @param pool_name The name of the pool variant.
+ * @param workloads The workloads.
+ * @param thread_counts The numbers of threads to try.
+ * @param num_rounds The number of measured rounds.
+ * @param results The vector to append the results to.
+ */
+template <BS::opt_t OptFlags>
+void benchmark_matrix_pool(const std::string_view pool_name, const std::vector<matrix_workload>& workloads, const std::vector<std::size_t>& thread_counts, const std::size_t num_rounds, std::vector<matrix_result>& results)
+{
+    constexpr int width_workload = 7;
+    constexpr int width_pool = 8;
+    constexpr int width_threads = 3;
+    constexpr int width_strategy = 10;
+    constexpr int width_ms = 8;
+    // Static partitioning into as many blocks as threads, and into 4 and 16 times as many, followed by the dynamic and guided scheduling policies.
+    constexpr std::array<std::size_t, 5> blocks_per_thread = {1, 4, 16, 0, 0};
+    constexpr std::array<BS::schedule, 5> policies = {BS::schedule::static_blocks, BS::schedule::static_blocks, BS::schedule::static_blocks, BS::schedule::dynamic, BS::schedule::guided};
+    timer tmr;
+    for (const std::size_t num_threads : thread_counts)
+    {
+        BS::thread_pool<OptFlags> pool(num_threads);
+        std::vector<std::vector<double>> timings(workloads.size() * blocks_per_thread.size());
+        for (std::size_t round = 0; round <= num_rounds; ++round)
+        {
+            for (std::size_t config = 0; config < timings.size(); ++config)
+            {
+                const matrix_workload& workload = workloads[config / blocks_per_thread.size()];
+                const std::size_t strategy = config % blocks_per_thread.size();
+                tmr.start();
+                if (blocks_per_thread[strategy] > 0)
+                    pool.detach_blocks(std::size_t{0}, workload.size, workload.loop, blocks_per_thread[strategy] * num_threads);
+                else
+                    pool.detach_blocks(std::size_t{0}, workload.size, workload.loop, policies[strategy]);
+                pool.wait();
+                tmr.stop();
+                if (round > 0)
+                    timings[config].push_back(tmr.fractional_ms());
+            }
+        }
+        for (std::size_t config = 0; config < timings.size(); ++config)
+        {
+            const std::size_t strategy = config % blocks_per_thread.size();
+            matrix_result result;
+            result.workload = workloads[config / blocks_per_thread.size()].name;
+            result.pool = pool_name;
+            result.threads = num_threads;
+            result.strategy = (blocks_per_thread[strategy] > 0) ? "blocks_x" + std::to_string(blocks_per_thread[strategy]) : std::string(schedule_name(policies[strategy]));
+            result.rounds = num_rounds;
+            result.median = median_of(timings[config]);
+            result.min = *std::min_element(timings[config].begin(), timings[config].end());
+            sync_out.println(std::left, std::setw(width_workload), result.workload, ' ', std::setw(width_pool), result.pool, ' ', std::right, std::setw(width_threads), result.threads, " threads, ", std::left, std::setw(width_strategy), result.strategy, std::right, ": median ", std::setw(width_ms), result.median, " ms, minimum ", std::setw(width_ms), result.min, " ms.");
+            results.push_back(std::move(result));
+        }
+    }
+}
+
+/**
+ * @brief Write the results of the benchmark matrix to a CSV file, with one line per configuration.
+ *
+ * @param results The results.
+ * @param filename The name of the file.
+ * @param append Whether to append the results to the file if it already exists, instead of replacing it.
+ * @return `true` if the file was written successfully, `false` otherwise.
+ */
+bool write_matrix_results(const std::vector<matrix_result>& results, const std::string_view filename, const bool append)
+{
+    const bool write_header = !append || !std::ifstream(std::string(filename)).good();
+    std::ofstream file(std::string(filename), append ? (std::ios::out | std::ios::app) : std::ios::out);
+    if (!file.is_open())
+        return false;
+    if (write_header)
+        file << "workload,pool,threads,strategy,rounds,median_ms,min_ms\n";
+    file << std::fixed << std::setprecision(4);
+    for (const matrix_result& result : results)
+        file << result.key() << ',' << result.rounds << ',' << result.median << ',' << result.min << '\n';
+    return static_cast<bool>(file);
+}
+
+/**
+ * @brief Read the baseline of the benchmark matrix from a CSV file written by `write_matrix_results()`, which may contain the results of several runs of the test program appended to each other.
+ *
+ * @param filename The name of the file.
+ * @return A map from the key of each configuration to the medians it had in each run. Empty if the file does not exist.
+ */
+std::map<std::string, std::vector<double>> read_matrix_baseline(const std::string_view filename)
+{
+    std::map<std::string, std::vector<double>> baseline;
+    std::ifstream file(std::string(filename), std::ios::in);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream line_stream(line);
+        std::vector<std::string> fields;
+        std::string field;
+        while (std::getline(line_stream, field, ','))
+            fields.push_back(field);
+        // Skip the headers, and any lines that are not in the expected format.
+        if (fields.size() != 7 || fields[0] == "workload")
+            continue;
+        baseline[fields[0] + ',' + fields[1] + ',' + fields[2] + ',' + fields[3]].push_back(std::stod(fields[5]));
+    }
+    return baseline;
+}
+
+/**
+ * @brief Calculate the regularized incomplete beta function using its continued fraction expansion, as needed for the cumulative distribution function of Student's t-distribution.
+ *
+ * @param a The first parameter.
+ * @param b The second parameter.
+ * @param x The point at which to evaluate the function, between 0 and 1.
+ * @return The value of the function.
+ */
+double incomplete_beta(const double a, const double b, const double x)
+{
+    if (x <= 0)
+        return 0;
+    if (x >= 1)
+        return 1;
+    // The continued fraction converges quickly only for x < (a + 1) / (a + b + 2), so otherwise we use the symmetry I_x(a, b) = 1 - I_{1-x}(b, a).
+    if (x > (a + 1) / (a + b + 2))
+        return 1 - incomplete_beta(b, a, 1 - x);
+    constexpr int max_iterations = 300;
+    constexpr double epsilon = 1e-14;
+    constexpr double tiny = 1e-300;
+    const double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + (a * std::log(x)) + (b * std::log(1 - x))) / a;
+    // Evaluate the continued fraction using the modified Lentz's method.
+    double c = 1;
+    double d = 1 - ((a + b) * x / (a + 1));
+    d = 1 / ((std::abs(d) < tiny) ? tiny : d);
+    double result = d;
+    for (int m = 1; m <= max_iterations; ++m)
+    {
+        for (int step = 0; step < 2; ++step)
+        {
+            const double md = static_cast<double>(m);
+            const double numerator = (step == 0) ? (md * (b - md) * x / ((a + (2 * md) - 1) * (a + (2 * md)))) : (-(a + md) * (a + b + md) * x / ((a + (2 * md)) * (a + (2 * md) + 1)));
+            d = 1 + (numerator * d);
+            d = 1 / ((std::abs(d) < tiny) ? tiny : d);
+            c = 1 + (numerator / c);
+            c = (std::abs(c) < tiny) ? tiny : c;
+            result *= d * c;
+        }
+        if (std::abs((d * c) - 1) < epsilon)
+            break;
+    }
+    return front * result;
+}
+
+/**
+ * @brief Calculate the probability that a random variable with Student's t-distribution is larger than a given value.
+ *
+ * @param t_stat The value.
+ * @param dof The degrees of freedom.
+ * @return The probability.
+ */
+double t_upper_tail(const double t_stat, const double dof)
+{
+    const double tail = incomplete_beta(dof / 2, 0.5, dof / (dof + (t_stat * t_stat))) / 2;
+    return (t_stat >= 0) ? tail : (1 - tail);
+}
+
+/**
+ * @brief Flag the tests which are significant according to the Benjamini-Hochberg procedure, which keeps the expected fraction of false discoveries among the flagged tests below the given level, no matter how many tests are performed.
+ *
+ * @param p_values The p-values of the tests.
+ * @param fdr_level The false discovery rate.
+ * @return A vector indicating which tests are significant.
+ */
+std::vector<bool> benjamini_hochberg(const std::vector<double>& p_values, const double fdr_level)
+{
+    std::vector<std::size_t> order(p_values.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::sort(order.begin(), order.end(),
+        [&p_values](const std::size_t first, const std::size_t second)
+        {
+            return p_values[first] < p_values[second];
+        });
+    std::size_t num_significant = 0;
+    for (std::size_t rank = 1; rank <= order.size(); ++rank)
+    {
+        if (p_values[order[rank - 1]] <= fdr_level * static_cast<double>(rank) / static_cast<double>(order.size()))
+            num_significant = rank;
+    }
+    std::vector<bool> significant(p_values.size(), false);
+    for (std::size_t rank = 0; rank < num_significant; ++rank)
+        significant[order[rank]] = true;
+    return significant;
+}
+
+/**
+ * @brief Compare the results of the benchmark matrix with a baseline, and flag the configurations which became significantly slower or faster. Since consecutive runs within the same process are correlated, and the differences between processes are usually much larger than the differences between runs, the baseline must contain the results of at least 3 separate runs of the test program, and the median of each configuration is compared to the spread of its medians between those runs. For each configuration, a one-sided t-test for a new observation checks whether the new median lies above (or below) the baseline medians more than their spread between runs explains, and the Benjamini-Hochberg procedure is applied to the p-values of all the configurations, with a false discovery rate of 5%, so that testing many configurations does not produce false alarms by chance. In addition, a change is only flagged if the median changed by at least 5%, so that tiny but consistent differences are not reported.
+ *
+ * @param results The results.
+ * @param baseline The baseline.
+ * @return The number of regressions found.
+ */
+std::size_t compare_matrix_results(const std::vector<matrix_result>& results, const std::map<std::string, std::vector<double>>& baseline)
+{
+    constexpr std::size_t min_baseline_runs = 3;
+    constexpr double fdr_level = 0.05;
+    constexpr double min_relative_change = 0.05;
+    std::vector<const matrix_result*> compared;
+    std::vector<double> baseline_means;
+    std::vector<double> slower_p_values;
+    std::vector<double> faster_p_values;
+    std::size_t fewest_runs = std::numeric_limits<std::size_t>::max();
+    for (const matrix_result& result : results)
+    {
+        const auto found = baseline.find(result.key());
+        if (found == baseline.end())
+            continue;
+        const std::vector<double>& medians = found->second;
+        fewest_runs = std::min(fewest_runs, medians.size());
+        if (medians.size() < min_baseline_runs)
+            continue;
+        const double runs = static_cast<double>(medians.size());
+        const double mean = std::accumulate(medians.begin(), medians.end(), 0.0) / runs;
+        double variance = 0;
+        for (const double median : medians)
+            variance += (median - mean) * (median - mean) / (runs - 1);
+        // The standard error of the difference between a new observation and the mean of the previous ones.
+        const double std_error = std::sqrt(variance * (1 + (1 / runs)));
+        double slower_p = 1;
+        double faster_p = 1;
+        if (std_error > 0)
+        {
+            const double t_stat = (result.median - mean) / std_error;
+            slower_p = t_upper_tail(t_stat, runs - 1);
+            faster_p = t_upper_tail(-t_stat, runs - 1);
+        }
+        compared.push_back(&result);
+        baseline_means.push_back(mean);
+        slower_p_values.push_back(slower_p);
+        faster_p_values.push_back(faster_p);
+    }
+    if (compared.empty())
+    {
+        if (fewest_runs != std::numeric_limits<std::size_t>::max())
+            sync_out.println("The baseline only contains ", fewest_runs, " runs, but at least ", min_baseline_runs, " are needed to estimate the variation between runs, so the results were not compared. Run the test program with the argument baseline again to add more runs.");
+        else
+            sync_out.println("The baseline contains none of the configurations that were run, so the results were not compared.");
+        return 0;
+    }
+    const std::vector<bool> slower = benjamini_hochberg(slower_p_values, fdr_level);
+    const std::vector<bool> faster = benjamini_hochberg(faster_p_values, fdr_level);
+    std::size_t num_regressions = 0;
+    std::size_t num_improvements = 0;
+    for (std::size_t i = 0; i < compared.size(); ++i)
+    {
+        const double relative_change = (compared[i]->median - baseline_means[i]) / baseline_means[i];
+        if (slower[i] && relative_change >= min_relative_change)
+        {
+            ++num_regressions;
+            sync_out.println("REGRESSION: ", compared[i]->key(), ": ", baseline_means[i], " ms -> ", compared[i]->median, " ms (+", relative_change * 100, "%, p = ", slower_p_values[i], ").");
+        }
+        else if (faster[i] && -relative_change >= min_relative_change)
+        {
+            ++num_improvements;
+            sync_out.println("Improvement: ", compared[i]->key(), ": ", baseline_means[i], " ms -> ", compared[i]->median, " ms (", relative_change * 100, "%, p = ", faster_p_values[i], ").");
+        }
+    }
+    sync_out.println("Compared ", compared.size(), " configurations with the baseline: ", num_regressions, " significant regressions, ", num_improvements, " significant improvements.");
+    return num_regressions;
+}
+
+/**
+ * @brief Run the benchmark matrix: every combination of workload (compute-bound, memory-bound, and compute-bound with uneven work per index), pool variant, thread count (powers of 2 up to the hardware concurrency), and loop partitioning strategy (static blocks at 1, 4, and 16 blocks per thread, and dynamic and guided scheduling). The results are written to `BS_thread_pool_benchmark_matrix.csv`, and compared with `BS_thread_pool_benchmark_baseline.csv` if it exists. The workload sizes are fixed, rather than calibrated to the system, so that the results of different runs on the same system can be compared.
+ *
+ * @param add_to_baseline Whether to also append the results to the baseline, as one more run.
+ * @return The number of regressions found compared to the baseline.
+ */
+std::size_t benchmark_matrix(const bool add_to_baseline)
+{
+    print_header("Performing the benchmark matrix:");
+    constexpr std::string_view results_filename = "BS_thread_pool_benchmark_matrix.csv";
+    constexpr std::string_view baseline_filename = "BS_thread_pool_benchmark_baseline.csv";
+    constexpr std::size_t num_rounds = 10;
+    constexpr std::size_t compute_size = static_cast<std::size_t>(1) << 15U;
+    constexpr std::size_t compute_iterations = 64;
+    constexpr std::size_t memory_size = static_cast<std::size_t>(1) << 22U;
+
+    std::vector<double> compute_out(compute_size);
+    std::vector<double> memory_a(memory_size);
+    std::vector<double> memory_b(memory_size, 1.0);
+    std::vector<double> memory_c(memory_size, 2.0);
+    const auto compute = [](const std::size_t index, const std::size_t iterations)
+    {
+        double value = static_cast<double>(index);
+        for (std::size_t k = 0; k < iterations; ++k)
+            value = std::sqrt(value + static_cast<double>(k));
+        return value;
+    };
+    std::vector<matrix_workload> workloads;
+    workloads.push_back({"compute", compute_size,
+        [&compute_out, &compute](const std::size_t start, const std::size_t end)
+        {
+            for (std::size_t i = start; i < end; ++i)
+                compute_out[i] = compute(i, compute_iterations);
+        }});
+    // The STREAM triad, which reads two arrays and writes a third, each much larger than the caches, so the run time is dominated by the memory bandwidth.
+    workloads.push_back({"memory", memory_size,
+        [&memory_a, &memory_b, &memory_c](const std::size_t start, const std::size_t end)
+        {
+            for (std::size_t i = start; i < end; ++i)
+                memory_a[i] = memory_b[i] + (3.0 * memory_c[i]);
+        }});
+    // The same total work as the compute-bound workload, but the work per index increases linearly, so the last block of a static partition into one block per thread takes about twice as long as the average.
+    workloads.push_back({"uneven", compute_size,
+        [&compute_out, &compute](const std::size_t start, const std::size_t end)
+        {
+            for (std::size_t i = start; i < end; ++i)
+                compute_out[i] = compute(i, 1 + ((2 * compute_iterations * i) / compute_size));
+        }});
+
+    std::vector<std::size_t> thread_counts;
+    const std::size_t max_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    for (std::size_t num_threads = 1; num_threads < max_threads; num_threads *= 2)
+        thread_counts.push_back(num_threads);
+    thread_counts.push_back(max_threads);
+    sync_out.println("Each configuration will be run ", num_rounds, " times, in interleaved rounds after one warm-up round, using up to ", max_threads, " threads.");
+
+    sync_out.print(std::fixed, std::setprecision(3));
+    std::vector<matrix_result> results;
+    benchmark_matrix_pool<BS::tp::none>("light", workloads, thread_counts, num_rounds, results);
+    benchmark_matrix_pool<BS::tp::priority>("priority", workloads, thread_counts, num_rounds, results);
+    benchmark_matrix_pool<BS::tp::pause>("pause", workloads, thread_counts, num_rounds, results);
+    benchmark_matrix_pool<BS::tp::work_stealing>("ws", workloads, thread_counts, num_rounds, results);
+    benchmark_matrix_pool<BS::tp::lock_free>("lf", workloads, thread_counts, num_rounds, results);
+
+    if (write_matrix_results(results, results_filename, false))
+        sync_out.println("Results saved to ", results_filename, '.');
+    else
+        sync_out.println("ERROR: Could not write the results to ", results_filename, '.');
+
+    std::size_t num_regressions = 0;
+    const std::map<std::string, std::vector<double>> baseline = read_matrix_baseline(baseline_filename);
+    if (!baseline.empty())
+        num_regressions = compare_matrix_results(results, baseline);
+    else
+        sync_out.println("No baseline found in ", baseline_filename, ", so the results were not compared.");
+
+    if (add_to_baseline)
+    {
+        if (write_matrix_results(results, baseline_filename, true))
+            sync_out.println("Results added to the baseline in ", baseline_filename, " as run number ", (baseline.empty() ? 0 : baseline.begin()->second.size()) + 1, '.');
+        else
+            sync_out.println("ERROR: Could not write the baseline to ", baseline_filename, '.');
+    }
+    return num_regressions;
+}
+
 // ==================================
 // The main function and related code
 // ==================================
@@ -3514,7 +7271,7 @@ int main(int argc, char* argv[]) // NOLINT(bugprone-exception-escape)
         }
         else
         {
-            defaults = {{"help", false}, {"stdout", true}, {"log", true}, {"tests", true}, {"deadlock", false}, {"benchmarks", true}, {"plot", false}, {"save", false}};
+            defaults = {{"help", false}, {"stdout", true}, {"log", true}, {"tests", true}, {"deadlock", false}, {"benchmarks", true}, {"plot", false}, {"save", false}, {"matrix", false}, {"baseline", false}};
         }
 
         // Parse the command line arguments.
@@ -3527,6 +7284,8 @@ int main(int argc, char* argv[]) // NOLINT(bugprone-exception-escape)
         args.add_argument("benchmarks", "Perform full Mandelbrot plot benchmarks.", defaults["benchmarks"]);
         args.add_argument("plot", "Perform quick Mandelbrot plot benchmarks.", defaults["plot"]);
         args.add_argument("save", "Save the Mandelbrot plot to a file.", defaults["save"]);
+        args.add_argument("matrix", "Perform the benchmark matrix and compare it with the baseline.", defaults["matrix"]);
+        args.add_argument("baseline", "Perform the benchmark matrix and add it to the baseline as one more run.", defaults["baseline"]);
 
         if (args.size() > 0)
         {
@@ -3543,11 +7302,11 @@ int main(int argc, char* argv[]) // NOLINT(bugprone-exception-escape)
                 sync_out.println("\nERROR: No output stream specified! Please enter one or more of: log, stdout. Aborting.");
                 return 0;
             }
-            if (!args["benchmarks"] && !args["deadlock"] && !args["plot"] && !args["tests"])
+            if (!args["baseline"] && !args["benchmarks"] && !args["deadlock"] && !args["matrix"] && !args["plot"] && !args["tests"])
             {
                 show_intro();
                 args.show_help();
-                sync_out.println("\nERROR: No tests or benchmarks requested! Please enter one or more of: benchmarks, deadlock, plot, tests. Aborting.");
+                sync_out.println("\nERROR: No tests or benchmarks requested! Please enter one or more of: baseline, benchmarks, deadlock, matrix, plot, tests. Aborting.");
                 return 0;
             }
         }
@@ -3608,12 +7367,14 @@ int main(int argc, char* argv[]) // NOLINT(bugprone-exception-escape)
             check_wait_for();
             check_wait_until();
             check_wait_multiple_deadlock();
+            check_wait_concurrent();
 #ifdef __cpp_exceptions
             check_wait_self_deadlock();
 
             print_header("Checking exception handling:");
             check_exceptions_submit();
             check_exceptions_multi_future();
+            check_exceptions_group_future();
 #else
         print_header("NOTE: Exceptions are disabled, skipping wait deadlock check and exception handling tests.");
 #endif
@@ -3624,11 +7385,49 @@ int main(int argc, char* argv[]) // NOLINT(bugprone-exception-escape)
             print_header("Checking detach_blocks() and submit_blocks():");
             check_blocks();
 
+            print_header("Checking scheduling policies for loops and blocks:");
+            check_schedule();
+
+            print_header("Checking run_loop() and run_blocks():");
+            check_run_loop();
+
+            print_header("Checking submit_reduce():");
+            check_reduce();
+
+            print_header("Checking the parallel algorithms:");
+            check_parallel_algorithms();
+
             print_header("Checking detach_sequence() and submit_sequence():");
             check_sequence();
 
+            print_header("Checking submit_blocks_grouped() and submit_sequence_grouped():");
+            check_grouped();
+
+            print_header("Checking detach_batch() and submit_batch():");
+            check_batch();
+
+            print_header("Checking continuations:");
+            check_continuations();
+
+            print_header("Checking task graphs:");
+            check_task_graph();
+
+            print_header("Checking task groups:");
+            check_task_group();
+
+            print_header("Checking fair scheduling:");
+            check_fair_scheduler();
+
+#if defined(__cpp_impl_coroutine) && defined(__cpp_lib_coroutine)
+            print_header("Checking coroutines:");
+            check_coroutines();
+#else
+        print_header("NOTE: C++20 coroutines are not available, skipping coroutine tests.");
+#endif
+
             print_header("Checking task monitoring:");
             check_task_monitoring();
+            check_task_monitoring_concurrent();
 
             print_header("Checking pausing:");
             check_pausing();
@@ -3636,11 +7435,43 @@ int main(int argc, char* argv[]) // NOLINT(bugprone-exception-escape)
             print_header("Checking purge():");
             check_purge();
 
+            print_header("Checking stop conditions:");
+            check_stop_condition();
+
             print_header("Checking parallelized vector operations:");
             check_vectors();
 
             print_header("Checking task priority:");
             check_priority();
+            check_priority_fifo();
+            check_priority_work_stealing();
+
+            print_header("Checking work stealing:");
+            check_work_stealing();
+
+            print_header("Checking per-thread mailboxes:");
+            check_mailboxes();
+
+            print_header("Checking the lock-free queue:");
+            check_lock_free();
+
+            print_header("Checking NUMA-aware scheduling:");
+            check_numa();
+
+            print_header("Checking spinning before sleeping:");
+            check_spinning();
+
+            print_header("Checking statistics collection:");
+            check_statistics();
+
+            print_header("Checking task tracing:");
+            check_trace();
+
+            print_header("Checking the elastic thread count:");
+            check_elastic();
+
+            print_header("Checking the queue capacity:");
+            check_queue_capacity();
 
             print_header("Checking thread initialization/cleanup functions and BS::this_thread:");
             check_init();
@@ -3656,13 +7487,27 @@ int main(int argc, char* argv[]) // NOLINT(bugprone-exception-escape)
             print_header("Checking that tasks are destructed immediately after running:");
             check_task_destruct();
 
+            print_header("Checking that the function shared by parallelized tasks is destroyed once:");
+            check_shared_function_destruct();
+
+            print_header("Checking BS::small_task:");
+            check_small_task();
+
+#ifdef __cpp_lib_memory_resource
+            print_header("Checking per-thread memory resources:");
+            check_memory_resource();
+#endif
+
             print_header("Checking BS::common_index_type:");
             check_common_index_type();
 
+            print_header("Checking buffered BS::synced_stream:");
+            check_synced_stream_buffered();
+
 #ifdef BS_THREAD_POOL_NATIVE_EXTENSIONS
             print_header("Checking native extensions:");
     #ifndef _WIN32
-            if ((args["benchmarks"] || args["plot"]) && !BS::set_os_process_priority(BS::os_process_priority::realtime))
+            if ((args["benchmarks"] || args["plot"] || args["matrix"] || args["baseline"]) && !BS::set_os_process_priority(BS::os_process_priority::realtime))
             {
                 sync_out.println("NOTE: Skipping process/thread priority checks since the test is running on Linux/macOS without root privileges and benchmarks are enabled. On Linux/macOS, if priorities are decreased, they cannot be increased back to normal without root privileges, so the process will be stuck on the lowest priority, and the benchmarks will be unreliable.\n");
             }
@@ -3722,6 +7567,13 @@ int main(int argc, char* argv[]) // NOLINT(bugprone-exception-escape)
         if (args["benchmarks"] || args["plot"])
             check_performance(args["benchmarks"], args["plot"], args["save"]);
 
+        if ((args["matrix"] || args["baseline"]) && benchmark_matrix(args["baseline"]) > 0)
+        {
+            print_header("FAILURE: Significant performance regressions compared to the baseline!", '+');
+            log_file.close();
+            return 1;
+        }
+
         log_file.close();
         return 0;
 #ifdef __cpp_exceptions